@@ -0,0 +1,625 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensebenchmark.h"
+#include "syntheticscene.h"
+
+#include "realsenseframefilter.h"
+#include "realsensedepthfile.h"
+#include "realsensedepthrecorder.h"
+#include "realsensenetwork.h"
+#include "realsenseservice.h"
+#include "realsensestreamreceiver.h"
+#include "realsensestreamsender.h"
+#include "realsenseworkerpool.h"
+
+#include <nap/signalslot.h>
+#include <rs.hpp>
+#include <hpp/rs_internal.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+namespace nap
+{
+    namespace benchmark
+    {
+        //////////////////////////////////////////////////////////////////////////
+        // Static helpers
+        //////////////////////////////////////////////////////////////////////////
+
+        static constexpr int sFrameCount = 4;
+        static constexpr int sLoopbackPort = 58231;
+
+
+        static rs2_intrinsics toRS2(const RealSenseCameraIntrincics& intrinsics)
+        {
+            rs2_intrinsics result = {};
+            result.width = intrinsics.mWidth;
+            result.height = intrinsics.mHeight;
+            result.ppx = intrinsics.mPPX;
+            result.ppy = intrinsics.mPPY;
+            result.fx = intrinsics.mFX;
+            result.fy = intrinsics.mFY;
+            result.model = static_cast<rs2_distortion>(intrinsics.mModel);
+            std::copy(std::begin(intrinsics.mCoeffs), std::end(intrinsics.mCoeffs), std::begin(result.coeffs));
+            return result;
+        }
+
+
+        /**
+         * Synthetic camera: a software device with a Z16 depth and a color stream that plays the synthetic scene.
+         * Frames are pre-rendered, every call to next injects the next depth and color frame and returns them as frameset.
+         */
+        class SyntheticDevice final
+        {
+        public:
+            SyntheticDevice(const Resolution& resolution, rs2_format colorFormat, int colorBytesPerPixel) :
+                mDepthSensor(mDevice.add_sensor("Depth")), mColorSensor(mDevice.add_sensor("Color"))
+            {
+                auto depth_intrinsics = createIntrinsics(resolution, RS2_DISTORTION_NONE);
+                auto color_intrinsics = createIntrinsics(resolution, RS2_DISTORTION_INVERSE_BROWN_CONRADY);
+                mDepthProfile = mDepthSensor.add_video_stream({ RS2_STREAM_DEPTH, 0, 0, resolution.mWidth, resolution.mHeight, 30,
+                                                                static_cast<int>(sizeof(uint16)), RS2_FORMAT_Z16, toRS2(depth_intrinsics) }, true);
+                mColorProfile = mColorSensor.add_video_stream({ RS2_STREAM_COLOR, 0, 1, resolution.mWidth, resolution.mHeight, 30,
+                                                                colorBytesPerPixel, colorFormat, toRS2(color_intrinsics) }, true);
+                mDepthSensor.add_read_only_option(RS2_OPTION_DEPTH_UNITS, sDepthScale);
+
+                auto extrinsics = createDepthToColor();
+                rs2_extrinsics depth_to_color = {};
+                std::copy(std::begin(extrinsics.mRotation), std::end(extrinsics.mRotation), std::begin(depth_to_color.rotation));
+                std::copy(std::begin(extrinsics.mTranslation), std::end(extrinsics.mTranslation), std::begin(depth_to_color.translation));
+                mDepthProfile.register_extrinsics_to(mColorProfile, depth_to_color);
+
+                mDepthFrames.resize(sFrameCount);
+                mColorFrames.resize(sFrameCount);
+                for(int i = 0; i < sFrameCount; i++)
+                {
+                    renderDepth(depth_intrinsics, i, mDepthFrames[i]);
+                    renderColor(resolution, i, colorBytesPerPixel, mColorFrames[i]);
+                }
+                mColorStride = resolution.mWidth * colorBytesPerPixel;
+                mColorBytesPerPixel = colorBytesPerPixel;
+                mWidth = resolution.mWidth;
+
+                // composes the depth and color frame of the same index into a frameset
+                mComposer = std::make_unique<rs2::processing_block>([this](rs2::frame frame, rs2::frame_source& source)
+                {
+                    source.frame_ready(source.allocate_composite_frame({ frame, mPendingColor }));
+                });
+                mComposer->start(mFramesets);
+
+                mDepthSensor.open(mDepthProfile);
+                mColorSensor.open(mColorProfile);
+                mDepthSensor.start(mDepthQueue);
+                mColorSensor.start(mColorQueue);
+            }
+
+            ~SyntheticDevice()
+            {
+                mDepthSensor.stop();
+                mColorSensor.stop();
+                mDepthSensor.close();
+                mColorSensor.close();
+            }
+
+            /**
+             * @return the next frameset of the synthetic scene
+             */
+            rs2::frameset next()
+            {
+                int index = mFrameNumber % sFrameCount;
+                double timestamp = mFrameNumber * 1000.0 / 30.0;
+                mDepthSensor.on_video_frame({ mDepthFrames[index].data(), [](void*) {}, mWidth * static_cast<int>(sizeof(uint16)),
+                                              static_cast<int>(sizeof(uint16)), timestamp, RS2_TIMESTAMP_DOMAIN_SYSTEM_TIME,
+                                              mFrameNumber, mDepthProfile.get(), sDepthScale });
+                mColorSensor.on_video_frame({ mColorFrames[index].data(), [](void*) {}, mColorStride, mColorBytesPerPixel,
+                                              timestamp, RS2_TIMESTAMP_DOMAIN_SYSTEM_TIME, mFrameNumber, mColorProfile.get(), 0.0f });
+                mFrameNumber++;
+
+                rs2::frame depth = mDepthQueue.wait_for_frame();
+                mPendingColor = mColorQueue.wait_for_frame();
+                mComposer->invoke(depth);
+                return mFramesets.wait_for_frame().as<rs2::frameset>();
+            }
+
+        private:
+            rs2::software_device mDevice;
+            rs2::software_sensor mDepthSensor;
+            rs2::software_sensor mColorSensor;
+            rs2::stream_profile mDepthProfile;
+            rs2::stream_profile mColorProfile;
+            rs2::frame_queue mDepthQueue;
+            rs2::frame_queue mColorQueue;
+            rs2::frame_queue mFramesets;
+            rs2::frame mPendingColor;
+            std::unique_ptr<rs2::processing_block> mComposer;
+            std::vector<std::vector<uint16>> mDepthFrames;
+            std::vector<std::vector<uint8>> mColorFrames;
+            int mColorStride = 0;
+            int mColorBytesPerPixel = 0;
+            int mWidth = 0;
+            int mFrameNumber = 1;
+        };
+
+
+        /**
+         * Pre-composed framesets the benchmarks cycle through, frame creation is not part of the measured time
+         */
+        struct FrameSetInput
+        {
+            FrameSetInput(const Resolution& resolution, rs2_format colorFormat = RS2_FORMAT_RGB8, int colorBytesPerPixel = 3) :
+                mDevice(resolution, colorFormat, colorBytesPerPixel)
+            {
+                for(int i = 0; i < sFrameCount; i++)
+                    mFrameSets.emplace_back(mDevice.next());
+            }
+
+            const rs2::frameset& next()             { return mFrameSets[mNext++ % sFrameCount]; }
+
+            SyntheticDevice mDevice;
+            std::vector<rs2::frameset> mFrameSets;
+            int mNext = 0;
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        // Filter chains
+        //////////////////////////////////////////////////////////////////////////
+
+        /**
+         * Registers a chain of module frame filters applied to the depth frame, the filters are created by the factory
+         */
+        static void addFilterChain(const std::string& name, const std::function<std::vector<std::unique_ptr<RealSenseFrameFilter>>(const Resolution&)>& factory)
+        {
+            for(const auto& resolution : getResolutions())
+            {
+                add("filter_chain/" + name + "/" + resolution.toString(), [resolution, factory](State& state)
+                {
+                    auto filters = factory(resolution);
+                    for(auto& filter : filters)
+                    {
+                        utility::ErrorState error_state;
+                        if(!filter->init(error_state))
+                        {
+                            state.skip(error_state.toString());
+                            return;
+                        }
+                    }
+
+                    FrameSetInput input(resolution);
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]()
+                    {
+                        rs2::frame frame = input.next().get_depth_frame();
+                        for(auto& filter : filters)
+                            frame = filter->process(frame);
+                    });
+                });
+            }
+        }
+
+
+        static void registerFilterChains()
+        {
+            addFilterChain("decimate", [](const Resolution&)
+            {
+                std::vector<std::unique_ptr<RealSenseFrameFilter>> filters;
+                filters.emplace_back(std::make_unique<RealSenseDecFilter>());
+                return filters;
+            });
+
+            addFilterChain("spatial", [](const Resolution&)
+            {
+                std::vector<std::unique_ptr<RealSenseFrameFilter>> filters;
+                filters.emplace_back(std::make_unique<RealSenseSpatialFilter>());
+                return filters;
+            });
+
+            addFilterChain("decimate_spatial", [](const Resolution&)
+            {
+                std::vector<std::unique_ptr<RealSenseFrameFilter>> filters;
+                filters.emplace_back(std::make_unique<RealSenseDecFilter>());
+                filters.emplace_back(std::make_unique<RealSenseSpatialFilter>());
+                return filters;
+            });
+
+            addFilterChain("colorize", [](const Resolution&)
+            {
+                std::vector<std::unique_ptr<RealSenseFrameFilter>> filters;
+                filters.emplace_back(std::make_unique<RealSenseColorizeFilter>());
+                return filters;
+            });
+
+            // crop to the center half of the frame before colorizing
+            addFilterChain("crop_colorize", [](const Resolution& resolution)
+            {
+                auto crop = std::make_unique<RealSenseCropFilter>();
+                crop->mX = resolution.mWidth / 4;
+                crop->mY = resolution.mHeight / 4;
+                crop->mWidth = resolution.mWidth / 2;
+                crop->mHeight = resolution.mHeight / 2;
+
+                std::vector<std::unique_ptr<RealSenseFrameFilter>> filters;
+                filters.emplace_back(std::move(crop));
+                filters.emplace_back(std::make_unique<RealSenseColorizeFilter>());
+                return filters;
+            });
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Format conversion, align and fan-out
+        //////////////////////////////////////////////////////////////////////////
+
+        static void registerFrameKernels()
+        {
+            for(const auto& resolution : getResolutions())
+            {
+                std::string suffix = resolution.toString();
+                add("format_conversion/yuyv_to_rgb8/" + suffix, [resolution](State& state)
+                {
+                    FrameSetInput input(resolution, RS2_FORMAT_YUYV, 2);
+                    rs2::yuy_decoder decoder;
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { decoder.process(input.next().get_color_frame()); });
+                });
+
+                // reference for the RealSenseAlignEngine benchmarks
+                add("align_rs2/depth_to_color/" + suffix, [resolution](State& state)
+                {
+                    FrameSetInput input(resolution);
+                    rs2::align align(RS2_STREAM_COLOR);
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { align.process(input.next()); });
+                });
+
+                add("align_rs2/color_to_depth/" + suffix, [resolution](State& state)
+                {
+                    FrameSetInput input(resolution);
+                    rs2::align align(RS2_STREAM_DEPTH);
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { align.process(input.next()); });
+                });
+            }
+
+            // cost of handing a frameset to the listeners of a device: every listener picks its frame and queues it,
+            // as RealSenseRenderFrameComponentInstance does, after which the main thread polls every queue
+            for(int listeners : { 1, 4, 16 })
+            {
+                Resolution resolution = { 848, 480 };
+                add("listener_fanout/" + std::to_string(listeners) + "/" + resolution.toString(), [resolution, listeners](State& state)
+                {
+                    FrameSetInput input(resolution);
+                    Signal<const rs2::frameset&> frameset_processed;
+                    std::vector<rs2::frame_queue> queues(listeners);
+                    std::vector<std::unique_ptr<Slot<const rs2::frameset&>>> slots;
+                    for(int i = 0; i < listeners; i++)
+                    {
+                        auto stream = i % 2 == 0 ? RS2_STREAM_DEPTH : RS2_STREAM_COLOR;
+                        auto& queue = queues[i];
+                        slots.emplace_back(std::make_unique<Slot<const rs2::frameset&>>([stream, &queue](const rs2::frameset& frameset)
+                        {
+                            for(const auto& frame : frameset)
+                            {
+                                if(frame.get_profile().stream_type() == stream)
+                                    queue.enqueue(frame);
+                            }
+                        }));
+                        frameset_processed.connect(*slots.back());
+                    }
+
+                    state.setItemsPerIteration(static_cast<uint64>(listeners));
+                    state.measure([&]()
+                    {
+                        frameset_processed.trigger(input.next());
+                        rs2::frame frame;
+                        for(auto& queue : queues)
+                            queue.poll_for_frame(&frame);
+                    });
+                });
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Recording
+        //////////////////////////////////////////////////////////////////////////
+
+        static uint64 getFileSize(const std::string& path)
+        {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            return file.is_open() ? static_cast<uint64>(file.tellg()) : 0;
+        }
+
+
+        /**
+         * Reports the size of a depth recording per frame, the compression ratio and the write throughput in uncompressed MB/s.
+         * The throughput includes closing the recording, which writes the data that was buffered or queued while recording.
+         */
+        static void reportRecording(State& state, const Resolution& resolution, uint64 frames, const std::string& path, double closeSeconds)
+        {
+            double raw_size = static_cast<double>(resolution.getPixelCount() * sizeof(uint16));
+            double frame_size = static_cast<double>(getFileSize(path)) / static_cast<double>(std::max<uint64>(frames, 1));
+            double seconds = state.getMeasuredTime() + closeSeconds;
+            state.setCounter("bytes_per_frame", frame_size);
+            state.setCounter("compression_ratio", frame_size > 0.0 ? raw_size / frame_size : 0.0);
+            state.setCounter("mb_per_second", seconds > 0.0 ? raw_size * state.getIterations() / seconds / 1000000.0 : 0.0);
+        }
+
+
+        static double getSecondsSince(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+
+        static void registerRecording()
+        {
+            for(const auto& resolution : getResolutions())
+            {
+                std::string suffix = resolution.toString();
+
+                // the work of a RealSenseDepthRecorder with its default settings: banded RVL on a worker pool, written in chunks.
+                // the recorder encodes and writes on separate threads, here both run on the calling thread to measure their combined cost
+                add("recording/rvl/" + suffix, [resolution](State& state)
+                {
+                    auto intrinsics = createIntrinsics(resolution, RS2_DISTORTION_NONE);
+                    std::vector<std::vector<uint16>> frames(sFrameCount);
+                    for(int i = 0; i < sFrameCount; i++)
+                        renderDepth(intrinsics, i, frames[i]);
+
+                    RealSenseDepthRecorder settings;
+                    RealSenseWorkerPool pool(0);
+                    RealSenseDepthFileHeader header;
+                    header.mWidth = resolution.mWidth;
+                    header.mHeight = resolution.mHeight;
+                    header.mFps = 30;
+                    header.mDepthScale = sDepthScale;
+
+                    utility::ErrorState error_state;
+                    std::string path = getTemporaryPath("naprealsense_benchmark.rsdr");
+                    RealSenseDepthFileWriter writer;
+                    if(!writer.open(path, header, settings.mChunkFrames, error_state))
+                    {
+                        state.skip(error_state.toString());
+                        return;
+                    }
+
+                    RealSenseDepthFileFrame encoded;
+                    uint64 written = 0;
+                    bool failed = false;
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.setBytesPerIteration(resolution.getPixelCount() * sizeof(uint16));
+                    state.measure([&]()
+                    {
+                        encoded.mFrameNumber = written;
+                        encoded.mTimestamp = written * 1000.0 / 30.0;
+                        encoded.encode(frames[written % sFrameCount].data(), resolution.mWidth, resolution.mHeight, settings.mBands, &pool);
+                        failed |= !writer.write(encoded, error_state);
+                        written++;
+                    });
+
+                    auto start = std::chrono::steady_clock::now();
+                    failed |= !writer.close(error_state);
+                    if(failed)
+                        state.skip(error_state.toString());
+                    else
+                        reportRecording(state, resolution, written, path, getSecondsSince(start));
+                    std::remove(path.c_str());
+                });
+
+                // uncompressed Z16 frames written back to back, the lower bound of any recording format
+                add("recording/z16_raw/" + suffix, [resolution](State& state)
+                {
+                    auto intrinsics = createIntrinsics(resolution, RS2_DISTORTION_NONE);
+                    std::vector<std::vector<uint16>> frames(sFrameCount);
+                    for(int i = 0; i < sFrameCount; i++)
+                        renderDepth(intrinsics, i, frames[i]);
+
+                    std::string path = getTemporaryPath("naprealsense_benchmark.z16");
+                    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                    if(!file.is_open())
+                    {
+                        state.skip("unable to create " + path);
+                        return;
+                    }
+
+                    auto frame_size = static_cast<std::streamsize>(resolution.getPixelCount() * sizeof(uint16));
+                    uint64 written = 0;
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.setBytesPerIteration(resolution.getPixelCount() * sizeof(uint16));
+                    state.measure([&]()
+                    {
+                        file.write(reinterpret_cast<const char*>(frames[written++ % sFrameCount].data()), frame_size);
+                    });
+
+                    auto start = std::chrono::steady_clock::now();
+                    file.close();
+                    if(file.fail())
+                        state.skip("unable to write " + path);
+                    else
+                        reportRecording(state, resolution, written, path, getSecondsSince(start));
+                    std::remove(path.c_str());
+                });
+
+                // librealsense recording of the depth stream to a rosbag file.
+                // the recorder serializes frames on its own thread, the remaining frames are written when the recorder is destroyed
+                add("recording/rs2_bag/" + suffix, [resolution](State& state)
+                {
+                    std::string path = getTemporaryPath("naprealsense_benchmark.bag");
+                    try
+                    {
+                        auto intrinsics = createIntrinsics(resolution, RS2_DISTORTION_NONE);
+                        std::vector<std::vector<uint16>> frames(sFrameCount);
+                        for(int i = 0; i < sFrameCount; i++)
+                            renderDepth(intrinsics, i, frames[i]);
+
+                        rs2::software_device device;
+                        auto sensor = device.add_sensor("Depth");
+                        auto profile = sensor.add_video_stream({ RS2_STREAM_DEPTH, 0, 0, resolution.mWidth, resolution.mHeight, 30,
+                                                                 static_cast<int>(sizeof(uint16)), RS2_FORMAT_Z16, toRS2(intrinsics) }, true);
+                        sensor.add_read_only_option(RS2_OPTION_DEPTH_UNITS, sDepthScale);
+
+                        // frames are recorded when they pass the sensor of the recorder
+                        auto recorder = std::make_unique<rs2::recorder>(path, device);
+                        auto recorded_sensor = recorder->query_sensors().front();
+                        rs2::frame_queue queue;
+                        recorded_sensor.open(profile);
+                        recorded_sensor.start(queue);
+
+                        int frame_number = 1;
+                        state.setItemsPerIteration(resolution.getPixelCount());
+                        state.setBytesPerIteration(resolution.getPixelCount() * sizeof(uint16));
+                        state.measure([&]()
+                        {
+                            sensor.on_video_frame({ frames[frame_number % sFrameCount].data(), [](void*) {}, resolution.mWidth * static_cast<int>(sizeof(uint16)),
+                                                    static_cast<int>(sizeof(uint16)), frame_number * 1000.0 / 30.0, RS2_TIMESTAMP_DOMAIN_SYSTEM_TIME,
+                                                    frame_number, profile.get(), sDepthScale });
+                            frame_number++;
+                            queue.wait_for_frame();
+                        });
+
+                        auto start = std::chrono::steady_clock::now();
+                        recorded_sensor.stop();
+                        recorded_sensor.close();
+                        recorded_sensor = rs2::sensor();
+                        recorder.reset();
+                        reportRecording(state, resolution, static_cast<uint64>(frame_number - 1), path, getSecondsSince(start));
+                    }
+                    catch(const std::exception& e)
+                    {
+                        state.skip(e.what());
+                    }
+                    std::remove(path.c_str());
+                });
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Network loopback
+        //////////////////////////////////////////////////////////////////////////
+
+        /**
+         * Waits until the receiver accepted or dropped at least count frames
+         * @return false when the frames did not arrive before the timeout, for example because a datagram was lost
+         */
+        static bool waitForFrames(const RealSenseStreamReceiver& receiver, uint64 count, std::chrono::milliseconds timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while(true)
+            {
+                auto statistics = receiver.getStatistics();
+                if(statistics.mFrames + statistics.mDroppedFrames >= count)
+                    return true;
+
+                if(std::chrono::steady_clock::now() > deadline)
+                    return false;
+                std::this_thread::yield();
+            }
+        }
+
+
+        /**
+         * Registers a benchmark that streams RVL depth frames from a RealSenseStreamWriter, the transport of the RealSenseStreamSender,
+         * to a RealSenseStreamReceiver over loopback.
+         * Paced benchmarks wait until the receiver accepted a frame before the next frame is sent: the iteration time is the per frame latency.
+         * Burst benchmarks send frames back to back: the iteration time is the send cost and the drop rate shows what the receiver can't keep up with.
+         */
+        static void addStreamBenchmark(ERealSenseNetworkProtocol protocol, bool paced, const Resolution& resolution)
+        {
+            std::string name = std::string("network_stream/") + (protocol == ERealSenseNetworkProtocol::TCP ? "tcp" : "udp") +
+                               (paced ? "/paced/" : "/burst/") + resolution.toString();
+            add(name, [protocol, paced, resolution](State& state)
+            {
+                utility::ErrorState error_state;
+                RealSenseService service(nullptr);
+                if(!service.init(error_state))
+                {
+                    state.skip(error_state.toString());
+                    return;
+                }
+
+                RealSenseStreamReceiver receiver(service);
+                receiver.mID = "benchmark_receiver";
+                receiver.mProtocol = protocol;
+                receiver.mPort = sLoopbackPort;
+                receiver.mSerial = "benchmark";
+                receiver.mStreams = { ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH };
+                RealSenseStreamSender settings;
+                RealSenseStreamWriter writer;
+                if(!receiver.init(error_state) || !receiver.start(error_state))
+                {
+                    state.skip(error_state.toString());
+                    return;
+                }
+
+                if(!writer.connect(protocol, "127.0.0.1", sLoopbackPort, settings.mPacketSize, error_state))
+                {
+                    state.skip(error_state.toString());
+                    receiver.stop();
+                    return;
+                }
+
+                FrameSetInput input(resolution);
+                auto& pool = service.getWorkerPool();
+                auto timeout = std::chrono::milliseconds(protocol == ERealSenseNetworkProtocol::UDP ? 100 : 1000);
+                uint64 sent = 0;
+                bool failed = false;
+                state.setItemsPerIteration(resolution.getPixelCount());
+                state.setBytesPerIteration(resolution.getPixelCount() * sizeof(uint16));
+                state.measure([&]()
+                {
+                    auto frame = input.next().get_depth_frame();
+                    failed |= !writer.write(frame, sDepthScale, settings.mCompressDepth, settings.mBands, &pool);
+                    sent++;
+                    if(paced && !waitForFrames(receiver, sent, timeout))
+                        failed |= protocol == ERealSenseNetworkProtocol::TCP;
+                });
+
+                // lost datagrams are never accepted or dropped by the receiver, the remainder counts as lost after the timeout
+                waitForFrames(receiver, sent, std::chrono::milliseconds(1000));
+                writer.close();
+                receiver.stop();
+                if(failed)
+                {
+                    state.skip("loopback connection failed");
+                    return;
+                }
+
+                auto statistics = receiver.getStatistics();
+                double received = static_cast<double>(statistics.mFrames);
+                state.setCounter("drop_rate", sent > 0 ? 1.0 - received / static_cast<double>(sent) : 0.0);
+                state.setCounter("wire_bytes_per_frame", received > 0.0 ? static_cast<double>(statistics.mBytes) / received : 0.0);
+                state.setCounter("latency_ms", statistics.mAverageLatency);
+                state.setCounter("max_latency_ms", statistics.mMaxLatency);
+                state.setCounter("receive_mbit_per_second", statistics.getThroughput());
+            });
+        }
+
+
+        static void registerNetwork()
+        {
+            // compress, send over loopback, receive and parse: the end-to-end cost of a streamed depth frame
+            for(auto protocol : { ERealSenseNetworkProtocol::TCP, ERealSenseNetworkProtocol::UDP })
+            {
+                for(const auto& resolution : getResolutions())
+                {
+                    addStreamBenchmark(protocol, true, resolution);
+                    addStreamBenchmark(protocol, false, resolution);
+                }
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        void registerFrameBenchmarks()
+        {
+            registerFilterChains();
+            registerFrameKernels();
+            registerRecording();
+            registerNetwork();
+        }
+    }
+}
@@ -0,0 +1,362 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensebenchmark.h"
+#include "syntheticscene.h"
+
+#include "realsensedeprojection.h"
+#include "realsensedepthcolorizer.h"
+#include "realsensealignengine.h"
+#include "realsensedepthcodec.h"
+#include "realsensebackgroundmodel.h"
+#include "realsenseblobdetector.h"
+#include "realsenseheightmap.h"
+#include "realsensenormals.h"
+#include "realsensefloorplane.h"
+#include "realsensedepthtriangulator.h"
+#include "realsenseworkerpool.h"
+
+#include <cmath>
+#include <map>
+#include <memory>
+
+namespace nap
+{
+    namespace benchmark
+    {
+        //////////////////////////////////////////////////////////////////////////
+        // Static helpers
+        //////////////////////////////////////////////////////////////////////////
+
+        /**
+         * Amount of pre-rendered frames kernels cycle through, so caches don't hold the same frame every iteration
+         */
+        static constexpr int sFrameCount = 4;
+
+
+        /**
+         * Pre-rendered depth frames and deprojection map of the synthetic depth camera at one resolution
+         */
+        struct DepthInput
+        {
+            RealSenseCameraIntrincics mIntrinsics;
+            RealSenseDeprojectionMap mRays;
+            std::vector<std::vector<uint16>> mFrames;
+            int mNext = 0;
+
+            const uint16* next()                    { return mFrames[mNext++ % sFrameCount].data(); }
+            int getStride() const                   { return mIntrinsics.mWidth * static_cast<int>(sizeof(uint16)); }
+        };
+
+
+        static DepthInput& getDepthInput(const Resolution& resolution)
+        {
+            static std::map<std::pair<int, int>, std::unique_ptr<DepthInput>> inputs;
+            auto& input = inputs[{ resolution.mWidth, resolution.mHeight }];
+            if(input == nullptr)
+            {
+                input = std::make_unique<DepthInput>();
+                input->mIntrinsics = createIntrinsics(resolution, RS2_DISTORTION_NONE);
+                input->mRays.update(input->mIntrinsics);
+                input->mFrames.resize(sFrameCount);
+                for(int i = 0; i < sFrameCount; i++)
+                    renderDepth(input->mIntrinsics, i, input->mFrames[i]);
+            }
+            return *input;
+        }
+
+
+        static RealSenseWorkerPool& getPool()
+        {
+            static RealSenseWorkerPool pool(0);
+            return pool;
+        }
+
+
+        /**
+         * Registers a benchmark once on the calling thread ('st') and once split over the worker pool ('mt')
+         */
+        static void addThreaded(const std::string& name, const std::function<void(State&, RealSenseWorkerPool*)>& function)
+        {
+            add(name + "/st", [function](State& state) { function(state, nullptr); });
+            add(name + "/mt", [function](State& state) { function(state, &getPool()); });
+        }
+
+
+        /**
+         * Camera to floor transform of the synthetic camera, floor space has y up and the camera looks along -z
+         */
+        static glm::mat4 getCameraToFloor()
+        {
+            float pitch = glm::radians(sCameraPitch);
+            glm::mat4 transform(1.0f);
+            transform[1] = { 0.0f, -std::cos(pitch), std::sin(pitch), 0.0f };
+            transform[2] = { 0.0f, -std::sin(pitch), -std::cos(pitch), 0.0f };
+            transform[3] = { 0.0f, sCameraHeight, 0.0f, 1.0f };
+            return transform;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Deprojection
+        //////////////////////////////////////////////////////////////////////////
+
+        static void registerDeprojection()
+        {
+            for(int model = RS2_DISTORTION_NONE; model < RS2_DISTORTION_COUNT; model++)
+            {
+                for(const auto& resolution : getResolutions())
+                {
+                    auto distortion = static_cast<ERealSenseDistortionModels>(model);
+                    std::string suffix = std::string(getModelName(distortion)) + "/" + resolution.toString();
+
+                    // same math as deproject_pixel_to_point in pointcloud.vert, evaluated for every pixel
+                    add("deproject_pixel/" + suffix, [resolution, distortion](State& state)
+                    {
+                        auto& input = getDepthInput(resolution);
+                        auto intrinsics = createIntrinsics(resolution, distortion);
+                        std::vector<glm::vec3> points(resolution.getPixelCount());
+                        state.setItemsPerIteration(resolution.getPixelCount());
+                        state.measure([&]()
+                        {
+                            const uint16* depth = input.next();
+                            size_t i = 0;
+                            for(int y = 0; y < resolution.mHeight; y++)
+                            {
+                                for(int x = 0; x < resolution.mWidth; x++, i++)
+                                    points[i] = realsense::deprojectPixelToPoint(intrinsics, { static_cast<float>(x), static_cast<float>(y) }, depth[i] * sDepthScale);
+                            }
+                        });
+                    });
+
+                    add("deprojection_map_update/" + suffix, [resolution, distortion](State& state)
+                    {
+                        auto intrinsics = createIntrinsics(resolution, distortion);
+                        RealSenseDeprojectionMap rays;
+                        state.setItemsPerIteration(resolution.getPixelCount());
+                        state.measure([&]() { rays.update(intrinsics); });
+                    });
+                }
+            }
+
+            // per-frame cost once the rays are cached, independent of the distortion model
+            for(const auto& resolution : getResolutions())
+            {
+                add("deproject_map/" + resolution.toString(), [resolution](State& state)
+                {
+                    auto& input = getDepthInput(resolution);
+                    std::vector<float> x(resolution.getPixelCount()), y(resolution.getPixelCount()), z(resolution.getPixelCount());
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]()
+                    {
+                        const uint16* depth = input.next();
+                        const float* ray_x = input.mRays.getX();
+                        const float* ray_y = input.mRays.getY();
+                        for(size_t i = 0; i < x.size(); i++)
+                        {
+                            float value = depth[i] * sDepthScale;
+                            x[i] = ray_x[i] * value;
+                            y[i] = ray_y[i] * value;
+                            z[i] = value;
+                        }
+                    });
+                });
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Colorize, align and codec
+        //////////////////////////////////////////////////////////////////////////
+
+        static void registerImageKernels()
+        {
+            for(const auto& resolution : getResolutions())
+            {
+                std::string suffix = resolution.toString();
+                add("colorize/linear/" + suffix, [resolution](State& state)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseDepthColorizer colorizer;
+                    colorizer.setHistogramEqualization(false);
+                    colorizer.setRange(0.3f, 6.0f, sDepthScale);
+                    colorizer.updateLookupTable();
+                    std::vector<uint32> rgba(resolution.getPixelCount());
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { colorizer.colorize(input.next(), rgba.data(), rgba.size()); });
+                });
+
+                // histogram accumulation every 4th pixel and colorization, the lookup table is rebuilt separately
+                add("colorize/equalized/" + suffix, [resolution](State& state)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseDepthColorizer colorizer;
+                    colorizer.setRange(0.3f, 6.0f, sDepthScale);
+                    std::vector<uint32> rgba(resolution.getPixelCount());
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]()
+                    {
+                        const uint16* depth = input.next();
+                        colorizer.accumulate(depth, rgba.size(), 4);
+                        colorizer.colorize(depth, rgba.data(), rgba.size());
+                    });
+                });
+
+                addThreaded("align_engine/depth_to_color/" + suffix, [resolution](State& state, RealSenseWorkerPool* pool)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseAlignEngine engine;
+                    engine.configure(input.mIntrinsics, createIntrinsics(resolution, RS2_DISTORTION_INVERSE_BROWN_CONRADY), createDepthToColor());
+                    std::vector<uint16> output(resolution.getPixelCount());
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { engine.alignDepthToOther(input.next(), sDepthScale, output.data(), pool); });
+                });
+
+                addThreaded("align_engine/color_to_depth/" + suffix, [resolution](State& state, RealSenseWorkerPool* pool)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseAlignEngine engine;
+                    engine.configure(input.mIntrinsics, createIntrinsics(resolution, RS2_DISTORTION_INVERSE_BROWN_CONRADY), createDepthToColor());
+                    std::vector<uint8> color, output(resolution.getPixelCount() * 3);
+                    renderColor(resolution, 0, 3, color);
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { engine.alignOtherToDepth(input.next(), sDepthScale, color.data(), 3, output.data(), pool); });
+                });
+
+                add("rvl_compress/" + suffix, [resolution](State& state)
+                {
+                    auto& input = getDepthInput(resolution);
+                    int count = static_cast<int>(resolution.getPixelCount());
+                    std::vector<uint8> compressed(realsense::getRVLBound(count));
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.setBytesPerIteration(resolution.getPixelCount() * sizeof(uint16));
+                    state.measure([&]() { realsense::compressRVL(input.next(), count, compressed.data()); });
+                });
+
+                add("rvl_decompress/" + suffix, [resolution](State& state)
+                {
+                    auto& input = getDepthInput(resolution);
+                    int count = static_cast<int>(resolution.getPixelCount());
+                    std::vector<std::vector<uint8>> compressed(sFrameCount);
+                    for(auto& frame : compressed)
+                    {
+                        frame.resize(realsense::getRVLBound(count));
+                        frame.resize(realsense::compressRVL(input.next(), count, frame.data()));
+                    }
+
+                    std::vector<uint16> output(resolution.getPixelCount());
+                    int next = 0;
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.setBytesPerIteration(resolution.getPixelCount() * sizeof(uint16));
+                    state.measure([&]()
+                    {
+                        const auto& frame = compressed[next++ % sFrameCount];
+                        realsense::decompressRVL(frame.data(), frame.size(), output.data(), count);
+                    });
+                });
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Scene analysis
+        //////////////////////////////////////////////////////////////////////////
+
+        static void registerAnalysisKernels()
+        {
+            for(const auto& resolution : getResolutions())
+            {
+                std::string suffix = resolution.toString();
+                addThreaded("background_subtract/" + suffix, [resolution](State& state, RealSenseWorkerPool* pool)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseBackgroundModel model;
+                    model.resize(resolution.mWidth, resolution.mHeight);
+                    model.reset(1);
+
+                    RealSenseBackgroundModel::Parameters parameters;
+                    std::vector<uint16> foreground(resolution.getPixelCount());
+                    std::vector<uint8> mask(resolution.getPixelCount());
+                    model.process(input.next(), input.getStride(), foreground.data(), mask.data(), parameters, pool);
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { model.process(input.next(), input.getStride(), foreground.data(), mask.data(), parameters, pool); });
+                });
+
+                addThreaded("blob_detect/" + suffix, [resolution](State& state, RealSenseWorkerPool* pool)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseBlobDetector detector;
+                    RealSenseBlobTracker tracker;
+                    RealSenseBlobDetector::Parameters parameters;
+                    std::vector<RealSenseBlob> blobs;
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]()
+                    {
+                        detector.detect(input.next(), input.getStride(), sDepthScale, input.mRays, parameters, pool, blobs);
+                        tracker.track(blobs, 0.3f);
+                    });
+                });
+
+                addThreaded("height_map/" + suffix, [resolution](State& state, RealSenseWorkerPool* pool)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseHeightMapBuilder builder;
+                    builder.setCameraTransform(getCameraToFloor());
+                    RealSenseHeightMapBuilder::Parameters parameters;
+                    parameters.mOrigin = { -2.5f, -5.0f };
+                    parameters.mSize = { 5.0f, 5.0f };
+                    RealSenseHeightMap height_map;
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { builder.build(input.next(), input.getStride(), sDepthScale, input.mRays, parameters, pool, height_map); });
+                });
+
+                addThreaded("normals/" + suffix, [resolution](State& state, RealSenseWorkerPool* pool)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseNormalEstimator estimator;
+                    RealSenseNormalEstimator::Parameters parameters;
+                    std::vector<glm::vec4> normals;
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { estimator.estimate(input.next(), input.getStride(), sDepthScale, input.mRays, parameters, pool, normals); });
+                });
+
+                // steady state: the cached plane is refined every frame
+                add("floor_plane/" + suffix, [resolution](State& state)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseFloorEstimator estimator;
+                    RealSenseFloorEstimator::Parameters parameters;
+                    estimator.update(input.next(), input.getStride(), sDepthScale, input.mRays, parameters);
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]() { estimator.update(input.next(), input.getStride(), sDepthScale, input.mRays, parameters); });
+                });
+            }
+
+            // the mesh grid matches the depth resolution, the resolutions the depth mesh is used at
+            for(const auto& resolution : { Resolution{ 424, 240 }, Resolution{ 848, 480 } })
+            {
+                addThreaded("depth_mesh/" + resolution.toString(), [resolution](State& state, RealSenseWorkerPool* pool)
+                {
+                    auto& input = getDepthInput(resolution);
+                    RealSenseDepthTriangulator triangulator;
+                    RealSenseDepthTriangulator::Parameters parameters;
+                    parameters.mColumns = resolution.mWidth;
+                    parameters.mRows = resolution.mHeight;
+                    std::vector<uint32> indices;
+                    state.setItemsPerIteration(resolution.getPixelCount());
+                    state.measure([&]()
+                    {
+                        triangulator.triangulate(input.next(), input.getStride(), resolution.mWidth, resolution.mHeight, parameters, pool, indices);
+                    });
+                });
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        void registerKernelBenchmarks()
+        {
+            registerDeprojection();
+            registerImageKernels();
+            registerAnalysisKernels();
+        }
+    }
+}
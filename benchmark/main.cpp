@@ -0,0 +1,16 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensebenchmark.h"
+
+/**
+ * Runs the naprealsense kernel benchmarks.
+ * Usage: naprealsense_benchmark [--filter=<substring>] [--min-time=<seconds>] [--json=<path>] [--depth-file=<path>]
+ */
+int main(int argc, char** argv)
+{
+    nap::benchmark::registerKernelBenchmarks();
+    nap::benchmark::registerFrameBenchmarks();
+    return nap::benchmark::run(argc, argv);
+}
@@ -0,0 +1,252 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensebenchmark.h"
+#include "syntheticscene.h"
+#include "realsenseconversion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace nap
+{
+    namespace benchmark
+    {
+        //////////////////////////////////////////////////////////////////////////
+        // Static helpers
+        //////////////////////////////////////////////////////////////////////////
+
+        static constexpr int sWarmupIterations = 3;
+        static constexpr size_t sMinIterations = 10;
+        static constexpr size_t sMaxIterations = 1000000;
+
+
+        struct Entry
+        {
+            std::string mName;
+            std::function<void(State&)> mFunction;
+        };
+
+
+        static std::vector<Entry>& getEntries()
+        {
+            static std::vector<Entry> entries;
+            return entries;
+        }
+
+
+        static std::string getArgument(int argc, char** argv, const char* name, const std::string& fallback)
+        {
+            size_t length = std::strlen(name);
+            for(int i = 1; i < argc; i++)
+            {
+                if(std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=')
+                    return argv[i] + length + 1;
+            }
+            return fallback;
+        }
+
+
+        /**
+         * @return CPU time consumed by all threads of the process in nanoseconds, includes the worker pool threads
+         */
+        static double getProcessCPUTime()
+        {
+#ifdef _WIN32
+            FILETIME creation, exit, kernel, user;
+            if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+                return 0.0;
+            ULARGE_INTEGER kernel_time, user_time;
+            kernel_time.LowPart = kernel.dwLowDateTime;
+            kernel_time.HighPart = kernel.dwHighDateTime;
+            user_time.LowPart = user.dwLowDateTime;
+            user_time.HighPart = user.dwHighDateTime;
+            return static_cast<double>(kernel_time.QuadPart + user_time.QuadPart) * 100.0;
+#else
+            timespec time;
+            if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0)
+                return 0.0;
+            return static_cast<double>(time.tv_sec) * 1e9 + static_cast<double>(time.tv_nsec);
+#endif
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Files
+        //////////////////////////////////////////////////////////////////////////
+
+        std::string getTemporaryPath(const std::string& name)
+        {
+            const char* directory = std::getenv("TMPDIR");
+            if(directory == nullptr || directory[0] == '\0')
+                directory = std::getenv("TEMP");
+#ifdef _WIN32
+            return std::string(directory != nullptr ? directory : ".") + "\\" + name;
+#else
+            return std::string(directory != nullptr ? directory : "/tmp") + "/" + name;
+#endif
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Resolutions
+        //////////////////////////////////////////////////////////////////////////
+
+        const std::vector<Resolution>& getResolutions()
+        {
+            static const std::vector<Resolution> resolutions = { { 424, 240 }, { 640, 480 }, { 848, 480 }, { 1280, 720 } };
+            return resolutions;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // State
+        //////////////////////////////////////////////////////////////////////////
+
+        void State::measure(const std::function<void()>& iteration)
+        {
+            for(int i = 0; i < sWarmupIterations; i++)
+                iteration();
+
+            mTimes.clear();
+            double total = 0.0;
+            double cpu_start = getProcessCPUTime();
+            while((total < mMinTime * 1e9 || mTimes.size() < sMinIterations) && mTimes.size() < sMaxIterations)
+            {
+                auto start = std::chrono::steady_clock::now();
+                iteration();
+                double duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                mTimes.emplace_back(duration);
+                total += duration;
+            }
+            mCPUTime = getProcessCPUTime() - cpu_start;
+        }
+
+
+        void State::setCounter(const std::string& name, double value)
+        {
+            auto it = std::find_if(mCounters.begin(), mCounters.end(), [&name](const std::pair<std::string, double>& counter) { return counter.first == name; });
+            if(it != mCounters.end())
+                it->second = value;
+            else
+                mCounters.emplace_back(name, value);
+        }
+
+
+        double State::getMeasuredTime() const
+        {
+            return std::accumulate(mTimes.begin(), mTimes.end(), 0.0) * 1e-9;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Registry
+        //////////////////////////////////////////////////////////////////////////
+
+        void add(const std::string& name, const std::function<void(State&)>& function)
+        {
+            getEntries().push_back({ name, function });
+        }
+
+
+        int run(int argc, char** argv)
+        {
+            std::string filter = getArgument(argc, argv, "--filter", "");
+            std::string json_path = getArgument(argc, argv, "--json", "");
+            double min_time = std::atof(getArgument(argc, argv, "--min-time", "0.5").c_str());
+            std::string depth_file = getArgument(argc, argv, "--depth-file", "");
+            if(!depth_file.empty())
+            {
+                utility::ErrorState error_state;
+                if(!loadDepthRecording(depth_file, error_state))
+                {
+                    std::fprintf(stderr, "%s\n", error_state.toString().c_str());
+                    return 1;
+                }
+            }
+
+            // output follows the Google Benchmark JSON layout so existing compare tools can diff runs
+            std::string json = "{\n  \"context\": {\n";
+            json += "    \"executable\": \"" + realsense::escapeJSON(argv[0]) + "\",\n";
+            json += "    \"num_cpus\": " + std::to_string(std::thread::hardware_concurrency()) + ",\n";
+            json += "    \"min_time\": " + std::to_string(min_time) + ",\n";
+            json += "    \"depth_source\": \"" + (depth_file.empty() ? std::string("synthetic") : realsense::escapeJSON(depth_file)) + "\"\n  },\n  \"benchmarks\": [\n";
+
+            std::printf("%-56s %12s %12s %12s %14s\n", "Benchmark", "Mean (us)", "Median (us)", "Min (us)", "Items/s");
+            bool first = true;
+            for(auto& entry : getEntries())
+            {
+                if(!filter.empty() && entry.mName.find(filter) == std::string::npos)
+                    continue;
+
+                State state;
+                state.mMinTime = min_time;
+                entry.mFunction(state);
+                if(!state.mSkipReason.empty() || state.mTimes.empty())
+                {
+                    std::printf("%-56s skipped: %s\n", entry.mName.c_str(), state.mSkipReason.empty() ? "nothing measured" : state.mSkipReason.c_str());
+                    continue;
+                }
+
+                auto& times = state.mTimes;
+                double count = static_cast<double>(times.size());
+                double mean = std::accumulate(times.begin(), times.end(), 0.0) / count;
+                double variance = 0.0;
+                for(double time : times)
+                    variance += (time - mean) * (time - mean);
+                double stddev = std::sqrt(variance / count);
+                std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+                double median = times[times.size() / 2];
+                double minimum = *std::min_element(times.begin(), times.end());
+                double cpu_time = state.mCPUTime / count;
+                double items_per_second = state.mItems > 0 ? static_cast<double>(state.mItems) / (mean * 1e-9) : 0.0;
+                double bytes_per_second = state.mBytes > 0 ? static_cast<double>(state.mBytes) / (mean * 1e-9) : 0.0;
+
+                std::printf("%-56s %12.2f %12.2f %12.2f %14.4g\n", entry.mName.c_str(), mean / 1000.0, median / 1000.0, minimum / 1000.0, items_per_second);
+                std::string counters;
+                for(const auto& counter : state.mCounters)
+                {
+                    std::printf("    %s=%.4g", counter.first.c_str(), counter.second);
+                    counters += ",\n      \"" + counter.first + "\": " + std::to_string(counter.second);
+                }
+                if(!state.mCounters.empty())
+                    std::printf("\n");
+
+                char buffer[1024];
+                std::snprintf(buffer, sizeof(buffer),
+                              "    {\n      \"name\": \"%s\",\n      \"run_type\": \"iteration\",\n      \"iterations\": %zu,\n"
+                              "      \"real_time\": %.3f,\n      \"cpu_time\": %.3f,\n      \"median_time\": %.3f,\n      \"min_time\": %.3f,\n"
+                              "      \"stddev_time\": %.3f,\n      \"time_unit\": \"us\",\n      \"items_per_second\": %.1f,\n      \"bytes_per_second\": %.1f",
+                              entry.mName.c_str(), times.size(), mean / 1000.0, cpu_time / 1000.0, median / 1000.0, minimum / 1000.0,
+                              stddev / 1000.0, items_per_second, bytes_per_second);
+                json += first ? "" : ",\n";
+                json += buffer + counters + "\n    }";
+                first = false;
+            }
+            json += "\n  ]\n}\n";
+
+            if(!json_path.empty())
+            {
+                std::ofstream file(json_path, std::ios::out | std::ios::trunc);
+                if(!file.is_open())
+                {
+                    std::fprintf(stderr, "Unable to open %s for writing\n", json_path.c_str());
+                    return 1;
+                }
+                file << json;
+            }
+            return 0;
+        }
+    }
+}
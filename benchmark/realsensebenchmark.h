@@ -0,0 +1,139 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nap
+{
+    namespace benchmark
+    {
+        //////////////////////////////////////////////////////////////////////////
+
+        /**
+         * Resolution a benchmark runs at
+         */
+        struct Resolution
+        {
+            int mWidth;
+            int mHeight;
+
+            /**
+             * @return resolution formatted as 'widthxheight'
+             */
+            std::string toString() const        { return std::to_string(mWidth) + "x" + std::to_string(mHeight); }
+
+            /**
+             * @return amount of pixels
+             */
+            uint64 getPixelCount() const        { return static_cast<uint64>(mWidth) * static_cast<uint64>(mHeight); }
+        };
+
+        /**
+         * @return the depth resolutions all frame kernels are measured at
+         */
+        const std::vector<Resolution>& getResolutions();
+
+        /**
+         * Timing state of a single benchmark, passed to the benchmark function
+         */
+        class State final
+        {
+        public:
+            /**
+             * Calls iteration repeatedly until the minimum time has passed, after a few untimed warm-up calls.
+             * Every call is timed individually, only the code inside iteration is measured.
+             * The process CPU time of the measured calls is recorded as well, including time spent on worker threads.
+             * @param iteration the code to measure
+             */
+            void measure(const std::function<void()>& iteration);
+
+            /**
+             * Sets the amount of items (usually pixels) processed per iteration, reported as items per second
+             * @param items amount of items per iteration
+             */
+            void setItemsPerIteration(uint64 items)         { mItems = items; }
+
+            /**
+             * Sets the amount of bytes processed per iteration, reported as bytes per second
+             * @param bytes amount of bytes per iteration
+             */
+            void setBytesPerIteration(uint64 bytes)         { mBytes = bytes; }
+
+            /**
+             * Marks the benchmark as skipped, for example when a socket can't be opened
+             * @param reason reported instead of the timings
+             */
+            void skip(const std::string& reason)            { mSkipReason = reason; }
+
+            /**
+             * Reports an additional value of the benchmark, such as a compression ratio or drop rate.
+             * Counters are printed below the timings and stored as extra fields of the benchmark in the JSON output.
+             * @param name name of the counter, setting the same name again replaces the value
+             * @param value the value
+             */
+            void setCounter(const std::string& name, double value);
+
+            /**
+             * @return amount of measured iterations, excluding warm-up calls
+             */
+            size_t getIterations() const                    { return mTimes.size(); }
+
+            /**
+             * @return total duration of the measured iterations in seconds
+             */
+            double getMeasuredTime() const;
+
+        private:
+            friend int run(int argc, char** argv);
+
+            double mMinTime = 0.5;                          ///< Minimum measured time in seconds
+            std::vector<double> mTimes;                     ///< Duration of every measured iteration in nanoseconds
+            double mCPUTime = 0.0;                          ///< Process CPU time of all measured iterations in nanoseconds
+            uint64 mItems = 0;
+            uint64 mBytes = 0;
+            std::string mSkipReason;
+            std::vector<std::pair<std::string, double>> mCounters;
+        };
+
+        /**
+         * Returns a path in the temporary directory for files written by a benchmark, from TMPDIR or TEMP
+         * @param name file name
+         * @return the path
+         */
+        std::string getTemporaryPath(const std::string& name);
+
+        /**
+         * Registers a benchmark
+         * @param name unique name, usually 'kernel/variant/resolution'
+         * @param function sets up the input and calls State::measure
+         */
+        void add(const std::string& name, const std::function<void(State&)>& function);
+
+        /**
+         * Registers the benchmarks of the CPU kernels: deprojection, colorize, align, RVL, background, blobs, height map, normals, floor and mesh
+         */
+        void registerKernelBenchmarks();
+
+        /**
+         * Registers the benchmarks that run on librealsense frames: filter chains, format conversion, rs2::align, listener fan-out, depth recording formats and network loopback
+         */
+        void registerFrameBenchmarks();
+
+        /**
+         * Runs all registered benchmarks that match the filter and prints the results.
+         * Arguments: --filter=<substring>, --min-time=<seconds>, --json=<path>,
+         * --depth-file=<path> to run on the frames of a depth recording instead of the synthetic scene
+         * @return process exit code
+         */
+        int run(int argc, char** argv);
+    }
+}
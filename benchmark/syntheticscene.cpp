@@ -0,0 +1,249 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "syntheticscene.h"
+#include "realsensedeprojection.h"
+#include "realsensedepthfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace nap
+{
+    namespace benchmark
+    {
+        //////////////////////////////////////////////////////////////////////////
+        // Static helpers
+        //////////////////////////////////////////////////////////////////////////
+
+        static constexpr float sWallDistance = 4.5f;
+        static constexpr float sMaxDepth = 6.0f;
+        static constexpr float sSphereRadius = 0.3f;
+        static constexpr int sMaxRecordedFrames = 30;
+
+
+        /**
+         * Depth frames loaded from a recording, in sDepthScale units
+         */
+        struct DepthRecording
+        {
+            int mWidth = 0;
+            int mHeight = 0;
+            std::vector<std::vector<uint16>> mFrames;
+        };
+
+
+        static DepthRecording& getRecording()
+        {
+            static DepthRecording recording;
+            return recording;
+        }
+
+
+        /**
+         * Cheap integer hash, used for reproducible noise without a random generator in the pixel loop
+         */
+        static uint32 hash(uint32 value)
+        {
+            value ^= value >> 16;
+            value *= 0x7feb352d;
+            value ^= value >> 15;
+            value *= 0x846ca68b;
+            value ^= value >> 16;
+            return value;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Scene
+        //////////////////////////////////////////////////////////////////////////
+
+        RealSenseCameraIntrincics createIntrinsics(const Resolution& resolution, ERealSenseDistortionModels model)
+        {
+            RealSenseCameraIntrincics intrinsics = {};
+            intrinsics.mWidth = resolution.mWidth;
+            intrinsics.mHeight = resolution.mHeight;
+            intrinsics.mPPX = resolution.mWidth * 0.5f + 1.5f;
+            intrinsics.mPPY = resolution.mHeight * 0.5f - 0.75f;
+            intrinsics.mFX = resolution.mWidth * 0.5f / std::tan(glm::radians(87.0f) * 0.5f);
+            intrinsics.mFY = intrinsics.mFX;
+            intrinsics.mModel = model;
+
+            const float brown_conrady[5] = { 0.12f, -0.24f, 0.001f, -0.0008f, 0.09f };
+            const float ftheta[5] = { 0.92f, 0.0f, 0.0f, 0.0f, 0.0f };
+            const float kannala_brandt[5] = { -0.0078f, 0.044f, -0.041f, 0.0076f, 0.0f };
+            const float* coeffs = nullptr;
+            switch(model)
+            {
+            case RS2_DISTORTION_MODIFIED_BROWN_CONRADY:
+            case RS2_DISTORTION_INVERSE_BROWN_CONRADY:
+            case RS2_DISTORTION_BROWN_CONRADY:
+                coeffs = brown_conrady;
+                break;
+            case RS2_DISTORTION_FTHETA:
+                coeffs = ftheta;
+                break;
+            case RS2_DISTORTION_KANNALA_BRANDT4:
+                coeffs = kannala_brandt;
+                break;
+            default:
+                break;
+            }
+
+            for(int i = 0; i < 5; i++)
+                intrinsics.mCoeffs[i] = coeffs != nullptr ? coeffs[i] : 0.0f;
+            return intrinsics;
+        }
+
+
+        RealSenseCameraExtrinsics createDepthToColor()
+        {
+            RealSenseCameraExtrinsics extrinsics = { { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f }, { 0.015f, 0.0f, 0.0f } };
+            return extrinsics;
+        }
+
+
+        const char* getModelName(ERealSenseDistortionModels model)
+        {
+            switch(model)
+            {
+            case RS2_DISTORTION_MODIFIED_BROWN_CONRADY:
+                return "modified_brown_conrady";
+            case RS2_DISTORTION_INVERSE_BROWN_CONRADY:
+                return "inverse_brown_conrady";
+            case RS2_DISTORTION_FTHETA:
+                return "ftheta";
+            case RS2_DISTORTION_BROWN_CONRADY:
+                return "brown_conrady";
+            case RS2_DISTORTION_KANNALA_BRANDT4:
+                return "kannala_brandt4";
+            default:
+                return "none";
+            }
+        }
+
+
+        bool loadDepthRecording(const std::string& path, utility::ErrorState& errorState)
+        {
+            RealSenseDepthFileReader reader;
+            if(!reader.open(path, errorState))
+                return false;
+
+            const auto& header = reader.getHeader();
+            float scale = header.mDepthScale > 0.0f ? header.mDepthScale / sDepthScale : 1.0f;
+            size_t count = static_cast<size_t>(header.mWidth) * static_cast<size_t>(header.mHeight);
+
+            auto& recording = getRecording();
+            recording.mWidth = header.mWidth;
+            recording.mHeight = header.mHeight;
+            recording.mFrames.clear();
+            RealSenseDepthFileFrame encoded;
+            while(static_cast<int>(recording.mFrames.size()) < sMaxRecordedFrames && reader.read(encoded, errorState))
+            {
+                std::vector<uint16> frame(count);
+                if(!errorState.check(encoded.decode(frame.data(), header.mWidth, header.mHeight, nullptr), "%s: corrupt frame %d", path.c_str(),
+                                     static_cast<int>(recording.mFrames.size())))
+                    return false;
+
+                if(scale != 1.0f)
+                    for(auto& value : frame)
+                        value = static_cast<uint16>(std::min(value * scale, 65535.0f));
+                recording.mFrames.emplace_back(std::move(frame));
+            }
+
+            if(errorState.hasErrors())
+                return false;
+            return errorState.check(!recording.mFrames.empty(), "%s: recording holds no frames", path.c_str());
+        }
+
+
+        void renderDepth(const RealSenseCameraIntrincics& intrinsics, int frame, std::vector<uint16>& depth)
+        {
+            const auto& recording = getRecording();
+            if(!recording.mFrames.empty())
+            {
+                const auto& source = recording.mFrames[frame % recording.mFrames.size()];
+                depth.resize(static_cast<size_t>(intrinsics.mWidth) * static_cast<size_t>(intrinsics.mHeight));
+                for(int y = 0; y < intrinsics.mHeight; y++)
+                {
+                    const uint16* row = source.data() + static_cast<size_t>(y * recording.mHeight / intrinsics.mHeight) * recording.mWidth;
+                    for(int x = 0; x < intrinsics.mWidth; x++)
+                        depth[static_cast<size_t>(y) * intrinsics.mWidth + x] = row[x * recording.mWidth / intrinsics.mWidth];
+                }
+                return;
+            }
+
+            RealSenseDeprojectionMap rays;
+            rays.update(intrinsics);
+
+            // camera space has y pointing down and z forward, the camera is pitched down towards the floor
+            float pitch = glm::radians(sCameraPitch);
+            glm::vec3 up = { 0.0f, -std::cos(pitch), -std::sin(pitch) };
+            glm::vec3 forward = { 0.0f, -std::sin(pitch), std::cos(pitch) };
+            glm::vec3 right = { 1.0f, 0.0f, 0.0f };
+
+            glm::vec3 spheres[3];
+            for(int i = 0; i < 3; i++)
+            {
+                float phase = frame * 0.05f + i * 2.1f;
+                float x = std::sin(phase) * 1.2f;
+                float distance = 2.0f + i * 0.7f + std::cos(phase) * 0.3f;
+                spheres[i] = right * x + up * (sSphereRadius - sCameraHeight) + forward * distance;
+            }
+
+            size_t count = static_cast<size_t>(intrinsics.mWidth) * static_cast<size_t>(intrinsics.mHeight);
+            depth.resize(count);
+            for(size_t i = 0; i < count; i++)
+            {
+                glm::vec3 ray = { rays.getX()[i], rays.getY()[i], 1.0f };
+                float z = std::numeric_limits<float>::max();
+
+                // floor and back wall, the ray has z = 1 so the ray parameter is the depth
+                float ray_up = glm::dot(ray, up);
+                if(ray_up < 0.0f)
+                    z = std::min(z, -sCameraHeight / ray_up);
+
+                float ray_forward = glm::dot(ray, forward);
+                if(ray_forward > 0.0f)
+                    z = std::min(z, sWallDistance / ray_forward);
+
+                for(const auto& center : spheres)
+                {
+                    float a = glm::dot(ray, ray);
+                    float b = glm::dot(ray, center);
+                    float c = glm::dot(center, center) - sSphereRadius * sSphereRadius;
+                    float discriminant = b * b - a * c;
+                    if(discriminant >= 0.0f)
+                        z = std::min(z, (b - std::sqrt(discriminant)) / a);
+                }
+
+                uint32 noise = hash(static_cast<uint32>(i) * 2654435761u + static_cast<uint32>(frame));
+                if(!std::isfinite(z) || z <= 0.0f || z > sMaxDepth || noise % 100 < 2)
+                {
+                    depth[i] = 0;
+                    continue;
+                }
+
+                // stereo depth noise grows with the square of the distance
+                z += (static_cast<float>(noise & 0xffff) / 65535.0f - 0.5f) * 0.004f * z * z;
+                depth[i] = static_cast<uint16>(z / sDepthScale);
+            }
+        }
+
+
+        void renderColor(const Resolution& resolution, int frame, int bytesPerPixel, std::vector<uint8>& color)
+        {
+            color.resize(resolution.getPixelCount() * static_cast<size_t>(bytesPerPixel));
+            uint8* pixel = color.data();
+            for(int y = 0; y < resolution.mHeight; y++)
+            {
+                for(int x = 0; x < resolution.mWidth; x++)
+                {
+                    for(int c = 0; c < bytesPerPixel; c++)
+                        *pixel++ = static_cast<uint8>((x + frame * 3) ^ (y + c * 64));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// Local includes
+#include "realsensebenchmark.h"
+#include "realsensetypes.h"
+
+// External Includes
+#include <utility/errorstate.h>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+    namespace benchmark
+    {
+        //////////////////////////////////////////////////////////////////////////
+
+        static constexpr float sDepthScale = 0.001f;    ///< Depth units of the synthetic depth frames in meters
+        static constexpr float sCameraHeight = 1.5f;    ///< Height of the synthetic camera above the floor in meters
+        static constexpr float sCameraPitch = 20.0f;    ///< Downward pitch of the synthetic camera in degrees
+
+        /**
+         * Returns intrinsics with the field of view of a D400 depth camera (87 x 58 degrees) and typical coefficients of the given model
+         * @param resolution resolution of the stream
+         * @param model distortion model
+         * @return camera intrinsics
+         */
+        RealSenseCameraIntrincics createIntrinsics(const Resolution& resolution, ERealSenseDistortionModels model);
+
+        /**
+         * @return extrinsics from the synthetic depth to the synthetic color camera, a 15 mm horizontal baseline
+         */
+        RealSenseCameraExtrinsics createDepthToColor();
+
+        /**
+         * @return lower case name of a distortion model, used in benchmark names
+         */
+        const char* getModelName(ERealSenseDistortionModels model);
+
+        /**
+         * Renders a depth frame of a synthetic room: a floor, a back wall and three spheres that move with the frame index.
+         * Depth is in sDepthScale units, with depth dependent noise and 2% invalid pixels like a real stereo depth camera.
+         * When a depth recording is loaded, the recorded frame with the frame index is returned instead, see loadDepthRecording.
+         * @param intrinsics intrinsics of the depth stream
+         * @param frame frame index, moves the spheres and reseeds the noise
+         * @param depth receives the depth values, tightly packed
+         */
+        void renderDepth(const RealSenseCameraIntrincics& intrinsics, int frame, std::vector<uint16>& depth);
+
+        /**
+         * Loads the first frames of a depth recording made with a RealSenseDepthRecorder, renderDepth returns these frames from then on.
+         * Recorded frames are resampled to the benchmark resolution with nearest neighbour sampling and converted to sDepthScale units.
+         * The intrinsics of the benchmarks stay synthetic, kernels that depend on the scene geometry see the recorded depth through the synthetic camera.
+         * @param path path of the recording
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool loadDepthRecording(const std::string& path, utility::ErrorState& errorState);
+
+        /**
+         * Renders a color frame with a moving pattern
+         * @param resolution resolution of the frame
+         * @param frame frame index, moves the pattern
+         * @param bytesPerPixel bytes per pixel of the color format
+         * @param color receives the pixels, tightly packed
+         */
+        void renderColor(const Resolution& resolution, int frame, int bytesPerPixel, std::vector<uint8>& color);
+    }
+}
@@ -15,6 +15,8 @@ uniform UBO
 {
 	uniform float		realsense_depth_scale;
 	uniform float		point_size;
+	uniform mat4		camera_transform;	/**< Transform applied to the points in camera space (x right, y down, z forward) */
+	uniform float		normal_shading;		/**< 1 to shade the points with the normal texture, 0 to ignore it */
 } ubo;
 
 uniform cam_intrinsics
@@ -31,6 +33,7 @@ uniform cam_intrinsics
 
 uniform sampler2D depth_texture;
 uniform sampler2D color_texture;
+uniform sampler2D normal_texture;	// camera space normals, w is 0 for points without a normal
 
 in vec3	in_Position;
 in vec4	in_Color0;
@@ -123,7 +126,7 @@ vec3 deproject_pixel_to_point(vec2 pixel, float depth)
 void main(void)
 {
 	vec3 p = deproject_pixel_to_point(in_UV0.xy, texture(depth_texture, in_UV0.xy).r);
-	p.y *= -1.0;
+	p = (ubo.camera_transform * vec4(p, 1)).xyz;
 
 	gl_Position =
 		mvp.projectionMatrix *
@@ -132,5 +135,10 @@ void main(void)
 
 	// Pass color and uv's
 	pass_Color = texture(color_texture, in_UV0.xy).rgba;
+
+	// normals face the camera, light along the view direction of the depth camera
+	vec4 normal = texture(normal_texture, in_UV0.xy);
+	float shading = normal.w > 0.0 ? 0.35 + 0.65 * max(-normal.z, 0.0) : 1.0;
+	pass_Color.rgb *= mix(1.0, shading, ubo.normal_shading);
 	gl_PointSize = ubo.point_size;
 }
\ No newline at end of file
@@ -38,6 +38,10 @@ namespace nap
         if (!error.check(mRealSenseDevice != nullptr, "unable to find RealSenseDevice with name: %s", "RealSenseDevice"))
             return false;
 
+        mMetricsGUI = mResourceManager->findObject<RealSenseMetricsGUI>("RealSenseMetrics");
+        if (!error.check(mMetricsGUI != nullptr, "unable to find RealSenseMetricsGUI with name: %s", "RealSenseMetrics"))
+            return false;
+
         mRealSenseEntity = mScene->findEntity("RealSenseEntity");
         if (!error.check(mRealSenseEntity != nullptr, "unable to find Entity with name: %s", "RealSenseEntity"))
             return false;
@@ -160,9 +164,19 @@ namespace nap
                 float ratio = (float)depth_texture.getHeight() / (float)depth_texture.getWidth();
                 ImGui::Text("Depth Texture :");
                 ImGui::Image(depth_texture, ImVec2(col_width, col_width * ratio), ImVec2(0, 0), ImVec2(1, 1));
+
+                // metadata of the displayed depth frame, -1 when not reported by the camera
+                const auto& info = depth_renderer->getFrameInfo();
+                ImGui::Text(utility::stringFormat("Frame: %llu, dropped: %u", (unsigned long long)info.mFrameNumber, info.mDropped).c_str());
+                ImGui::Text(utility::stringFormat("Exposure: %lld us, gain: %lld, laser power: %lld",
+                                                  (long long)info.mExposure, (long long)info.mGain, (long long)info.mLaserPower).c_str());
             }
         }
 
+        // Display frame rates, drops, queue depths and timings of the device and components
+        if (ImGui::CollapsingHeader("Metrics"))
+            mMetricsGUI->show(false);
+
         ImGui::End();
     }
 }
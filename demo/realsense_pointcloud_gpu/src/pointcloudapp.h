@@ -16,6 +16,7 @@
 #include <app.h>
 #include <rendertexture2d.h>
 #include <realsensedevice.h>
+#include <realsensemetricsgui.h>
 
 namespace nap 
 {
@@ -81,6 +82,7 @@ namespace nap
 		ObjectPtr<EntityInstance>	mCameraEntity = nullptr;		///< Pointer to the entity that holds the perspective camera
         ObjectPtr<EntityInstance>	mRealSenseEntity = nullptr;		///< Pointer to the realsense entity
         ObjectPtr<RealSenseDevice>  mRealSenseDevice = nullptr;		///< Pointer to the realsense device
+        ObjectPtr<RealSenseMetricsGUI> mMetricsGUI = nullptr;       ///< Pointer to the realsense metrics panel
         ObjectPtr<RenderTexture2D>  mColorTexture = nullptr;        ///< Pointer to the color render texture
         ObjectPtr<RenderTexture2D>  mDepthTexture = nullptr;        ///< Pointer to the depth render texture
         ObjectPtr<EntityInstance>   mRenderEntity = nullptr;        ///< Pointer to the render entity containing the renderable pointcloud
@@ -6,6 +6,11 @@ target_include_directories(${PROJECT_NAME} PUBLIC ${REALSENSE_INCLUDE_DIR})
 
 target_link_libraries(${PROJECT_NAME} ${REALSENSE_LIBS})
 
+if(UNIX AND NOT APPLE)
+    # shm_open, used by the shared memory exporter
+    target_link_libraries(${PROJECT_NAME} rt)
+endif()
+
 if(WIN32)
     # Copy realsense DLL to build directory on Windows (plus into packaged app)
     copy_realsense_dll()
@@ -16,4 +21,12 @@ if(NAP_BUILD_CONTEXT MATCHES "framework_release")
         # Install realsense lib into packaged app
         install(FILES $<TARGET_FILE:realsenselib> DESTINATION lib)
     endif()
-endif()
\ No newline at end of file
+endif()
+option(NAPREALSENSE_BUILD_BENCHMARKS "Build the naprealsense kernel benchmarks" OFF)
+if(NAPREALSENSE_BUILD_BENCHMARKS)
+    # Standalone executable, run with --json=<path> to store results for comparison between builds
+    file(GLOB BENCHMARK_SOURCES ${CMAKE_CURRENT_LIST_DIR}/benchmark/*.cpp)
+    add_executable(naprealsense_benchmark ${BENCHMARK_SOURCES})
+    target_include_directories(naprealsense_benchmark PRIVATE ${CMAKE_CURRENT_LIST_DIR}/src ${CMAKE_CURRENT_LIST_DIR}/benchmark)
+    target_link_libraries(naprealsense_benchmark ${PROJECT_NAME})
+endif()
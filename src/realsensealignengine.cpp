@@ -0,0 +1,251 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensealignengine.h"
+#include "realsenseworkerpool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Amount of tasks the work is split into per worker thread, more tasks than threads balances uneven rows
+     */
+    static constexpr int sTasksPerThread = 4;
+
+
+    static int getTaskCount(RealSenseWorkerPool* pool, int rows)
+    {
+        int threads = pool != nullptr ? pool->getThreadCount() + 1 : 1;
+        return std::max(1, std::min(rows, threads * sTasksPerThread));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseAlignEngine
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseAlignEngine::configure(const RealSenseCameraIntrincics& depthIntrinsics, const RealSenseCameraIntrincics& otherIntrinsics,
+                                         const RealSenseCameraExtrinsics& depthToOther)
+    {
+        mDepthIntrinsics = depthIntrinsics;
+        mOtherIntrinsics = otherIntrinsics;
+        mExtrinsics = depthToOther;
+        mDistorted = realsense::hasProjectionDistortion(otherIntrinsics);
+
+        // rotate the rays of both pixel corners into the other camera, per frame only scaling by depth and translation remain
+        const float* r = depthToOther.mRotation;
+        size_t count = static_cast<size_t>(depthIntrinsics.mWidth) * static_cast<size_t>(depthIntrinsics.mHeight);
+        const glm::vec2 offsets[2] = { { -0.5f, -0.5f }, { 0.5f, 0.5f } };
+        for(int corner = 0; corner < 2; corner++)
+        {
+            RealSenseDeprojectionMap map;
+            map.update(depthIntrinsics, offsets[corner]);
+
+            mRayX[corner].resize(count);
+            mRayY[corner].resize(count);
+            mRayZ[corner].resize(count);
+            for(size_t i = 0; i < count; i++)
+            {
+                float x = map.getX()[i];
+                float y = map.getY()[i];
+                mRayX[corner][i] = r[0] * x + r[3] * y + r[6];
+                mRayY[corner][i] = r[1] * x + r[4] * y + r[7];
+                mRayZ[corner][i] = r[2] * x + r[5] * y + r[8];
+            }
+        }
+
+        mMinX.assign(count, -1);
+        mMinY.assign(count, -1);
+        mMaxX.assign(count, -1);
+        mMaxY.assign(count, -1);
+        mRowMinY.assign(depthIntrinsics.mHeight, 0);
+        mRowMaxY.assign(depthIntrinsics.mHeight, -1);
+        mScratch.assign(static_cast<size_t>(depthIntrinsics.mWidth) * depthIntrinsics.mHeight * 4, 0.0f);
+        mConfigured = true;
+    }
+
+
+    void RealSenseAlignEngine::projectRows(const uint16* depth, float depthScale, int firstRow, int lastRow)
+    {
+        const int width = mDepthIntrinsics.mWidth;
+        const float tx = mExtrinsics.mTranslation[0];
+        const float ty = mExtrinsics.mTranslation[1];
+        const float tz = mExtrinsics.mTranslation[2];
+        const float fx = mOtherIntrinsics.mFX;
+        const float fy = mOtherIntrinsics.mFY;
+        const float ppx = mOtherIntrinsics.mPPX;
+        const float ppy = mOtherIntrinsics.mPPY;
+        const float max_x = static_cast<float>(mOtherIntrinsics.mWidth - 1);
+        const float max_y = static_cast<float>(mOtherIntrinsics.mHeight - 1);
+
+        for(int row = firstRow; row < lastRow; row++)
+        {
+            const size_t offset = static_cast<size_t>(row) * width;
+            const uint16* depth_row = depth + offset;
+            float* u0 = mScratch.data() + offset * 4;
+            float* v0 = u0 + width;
+            float* u1 = v0 + width;
+            float* v1 = u1 + width;
+
+            if(!mDistorted)
+            {
+                // pinhole projection, branch free so the compiler vectorizes the loop
+                const float* rx0 = mRayX[0].data() + offset;
+                const float* ry0 = mRayY[0].data() + offset;
+                const float* rz0 = mRayZ[0].data() + offset;
+                const float* rx1 = mRayX[1].data() + offset;
+                const float* ry1 = mRayY[1].data() + offset;
+                const float* rz1 = mRayZ[1].data() + offset;
+                for(int x = 0; x < width; x++)
+                {
+                    float z = static_cast<float>(depth_row[x]) * depthScale;
+                    float inv_z0 = 1.0f / (rz0[x] * z + tz);
+                    float inv_z1 = 1.0f / (rz1[x] * z + tz);
+                    u0[x] = (rx0[x] * z + tx) * inv_z0 * fx + ppx;
+                    v0[x] = (ry0[x] * z + ty) * inv_z0 * fy + ppy;
+                    u1[x] = (rx1[x] * z + tx) * inv_z1 * fx + ppx;
+                    v1[x] = (ry1[x] * z + ty) * inv_z1 * fy + ppy;
+                }
+            }
+            else
+            {
+                for(int x = 0; x < width; x++)
+                {
+                    float z = static_cast<float>(depth_row[x]) * depthScale;
+                    size_t i = offset + x;
+                    glm::vec3 p0 = { mRayX[0][i] * z + tx, mRayY[0][i] * z + ty, mRayZ[0][i] * z + tz };
+                    glm::vec3 p1 = { mRayX[1][i] * z + tx, mRayY[1][i] * z + ty, mRayZ[1][i] * z + tz };
+                    glm::vec2 pixel0 = realsense::projectPointToPixel(mOtherIntrinsics, p0);
+                    glm::vec2 pixel1 = realsense::projectPointToPixel(mOtherIntrinsics, p1);
+                    u0[x] = pixel0.x; v0[x] = pixel0.y;
+                    u1[x] = pixel1.x; v1[x] = pixel1.y;
+                }
+            }
+
+            // clip projected rectangles to the other image
+            int row_min_y = mOtherIntrinsics.mHeight;
+            int row_max_y = -1;
+            int* min_x = mMinX.data() + offset;
+            int* min_y = mMinY.data() + offset;
+            int* max_x_out = mMaxX.data() + offset;
+            int* max_y_out = mMaxY.data() + offset;
+            for(int x = 0; x < width; x++)
+            {
+                bool valid = depth_row[x] != 0 &&
+                    std::min(u0[x], u1[x]) <= max_x + 0.5f && std::max(u0[x], u1[x]) >= -0.5f &&
+                    std::min(v0[x], v1[x]) <= max_y + 0.5f && std::max(v0[x], v1[x]) >= -0.5f;
+                if(!valid)
+                {
+                    min_x[x] = -1;
+                    continue;
+                }
+
+                min_x[x] = static_cast<int>(std::max(0.0f, std::min(u0[x], u1[x]) + 0.5f));
+                min_y[x] = static_cast<int>(std::max(0.0f, std::min(v0[x], v1[x]) + 0.5f));
+                max_x_out[x] = static_cast<int>(std::min(max_x, std::max(u0[x], u1[x]) + 0.5f));
+                max_y_out[x] = static_cast<int>(std::min(max_y, std::max(v0[x], v1[x]) + 0.5f));
+                row_min_y = std::min(row_min_y, min_y[x]);
+                row_max_y = std::max(row_max_y, max_y_out[x]);
+            }
+            mRowMinY[row] = row_min_y;
+            mRowMaxY[row] = row_max_y;
+        }
+    }
+
+
+    void RealSenseAlignEngine::alignDepthToOther(const uint16* depth, float depthScale, uint16* output, RealSenseWorkerPool* pool)
+    {
+        assert(mConfigured);
+        const int depth_width = mDepthIntrinsics.mWidth;
+        const int depth_height = mDepthIntrinsics.mHeight;
+        const int other_width = mOtherIntrinsics.mWidth;
+        const int other_height = mOtherIntrinsics.mHeight;
+
+        // project all depth rows
+        int task_count = getTaskCount(pool, depth_height);
+        RealSenseWorkerPool::parallelFor(pool, task_count, [&](int task)
+        {
+            int first = depth_height * task / task_count;
+            int last = depth_height * (task + 1) / task_count;
+            projectRows(depth, depthScale, first, last);
+        });
+
+        // scatter into horizontal bands of the output, every band is written by one task only
+        int band_count = getTaskCount(pool, other_height);
+        RealSenseWorkerPool::parallelFor(pool, band_count, [&](int band)
+        {
+            int band_first = other_height * band / band_count;
+            int band_last = other_height * (band + 1) / band_count - 1;
+            std::memset(output + static_cast<size_t>(band_first) * other_width, 0,
+                        static_cast<size_t>(band_last - band_first + 1) * other_width * sizeof(uint16));
+
+            for(int row = 0; row < depth_height; row++)
+            {
+                if(mRowMaxY[row] < band_first || mRowMinY[row] > band_last)
+                    continue;
+
+                size_t offset = static_cast<size_t>(row) * depth_width;
+                for(int x = 0; x < depth_width; x++)
+                {
+                    size_t i = offset + x;
+                    if(mMinX[i] < 0)
+                        continue;
+
+                    int first_y = std::max(mMinY[i], band_first);
+                    int last_y = std::min(mMaxY[i], band_last);
+                    uint16 value = depth[i];
+                    for(int y = first_y; y <= last_y; y++)
+                    {
+                        uint16* out_row = output + static_cast<size_t>(y) * other_width;
+                        for(int ox = mMinX[i]; ox <= mMaxX[i]; ox++)
+                            out_row[ox] = out_row[ox] != 0 ? std::min(out_row[ox], value) : value;
+                    }
+                }
+            }
+        });
+    }
+
+
+    void RealSenseAlignEngine::alignOtherToDepth(const uint16* depth, float depthScale, const uint8* other, int bytesPerPixel, uint8* output, RealSenseWorkerPool* pool)
+    {
+        assert(mConfigured);
+        const int depth_width = mDepthIntrinsics.mWidth;
+        const int depth_height = mDepthIntrinsics.mHeight;
+        const int other_width = mOtherIntrinsics.mWidth;
+
+        // project and gather per row, every output pixel is written by one task only
+        int task_count = getTaskCount(pool, depth_height);
+        RealSenseWorkerPool::parallelFor(pool, task_count, [&](int task)
+        {
+            int first = depth_height * task / task_count;
+            int last = depth_height * (task + 1) / task_count;
+            projectRows(depth, depthScale, first, last);
+
+            for(int row = first; row < last; row++)
+            {
+                size_t offset = static_cast<size_t>(row) * depth_width;
+                for(int x = 0; x < depth_width; x++)
+                {
+                    size_t i = offset + x;
+                    uint8* out_pixel = output + i * bytesPerPixel;
+                    if(mMinX[i] < 0)
+                    {
+                        std::memset(out_pixel, 0, bytesPerPixel);
+                        continue;
+                    }
+
+                    int ox = (mMinX[i] + mMaxX[i]) / 2;
+                    int oy = (mMinY[i] + mMaxY[i]) / 2;
+                    std::memcpy(out_pixel, other + (static_cast<size_t>(oy) * other_width + ox) * bytesPerPixel, bytesPerPixel);
+                }
+            }
+        });
+    }
+}
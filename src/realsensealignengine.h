@@ -0,0 +1,108 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <vector>
+
+// Local includes
+#include "realsensetypes.h"
+#include "realsensedeprojection.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseWorkerPool;
+
+    /**
+     * RealSenseAlignEngine
+     * Aligns depth to another camera stream (or the other stream to depth) for a fixed stream configuration.
+     * For a fixed configuration the location of a depth pixel in the other stream only depends on its depth:
+     * the rotated rays of both pixel corners are precomputed once, per frame every pixel costs a few multiply-adds and a division.
+     * Per-frame work is split in rows over the worker pool, all buffers are allocated on configure.
+     */
+    class NAPAPI RealSenseAlignEngine final
+    {
+    public:
+        /**
+         * Precomputes the rotated rays for the given stream configuration, only call when the configuration changes
+         * @param depthIntrinsics intrinsics of the depth stream
+         * @param otherIntrinsics intrinsics of the other stream
+         * @param depthToOther extrinsics from the depth to the other stream
+         */
+        void configure(const RealSenseCameraIntrincics& depthIntrinsics, const RealSenseCameraIntrincics& otherIntrinsics,
+                       const RealSenseCameraExtrinsics& depthToOther);
+
+        /**
+         * Maps every depth pixel onto the other stream, writing depth in the resolution of the other stream.
+         * Pixels in the other stream that are covered by multiple depth pixels receive the nearest depth.
+         * @param depth Z16 depth image in the depth resolution
+         * @param depthScale depth units in meters
+         * @param output Z16 output image in the resolution of the other stream
+         * @param pool optional worker pool, work is done on the calling thread when null
+         */
+        void alignDepthToOther(const uint16* depth, float depthScale, uint16* output, RealSenseWorkerPool* pool);
+
+        /**
+         * Samples the other stream for every depth pixel, writing the other stream in the depth resolution.
+         * Pixels without depth are set to zero.
+         * @param depth Z16 depth image in the depth resolution
+         * @param depthScale depth units in meters
+         * @param other image of the other stream
+         * @param bytesPerPixel bytes per pixel of the other stream
+         * @param output output image in the depth resolution with the pixel format of the other stream
+         * @param pool optional worker pool, work is done on the calling thread when null
+         */
+        void alignOtherToDepth(const uint16* depth, float depthScale, const uint8* other, int bytesPerPixel, uint8* output, RealSenseWorkerPool* pool);
+
+        /**
+         * @return if the engine is configured
+         */
+        bool isConfigured() const                                   { return mConfigured; }
+
+        /**
+         * @return intrinsics of the depth stream
+         */
+        const RealSenseCameraIntrincics& getDepthIntrinsics() const { return mDepthIntrinsics; }
+
+        /**
+         * @return intrinsics of the other stream
+         */
+        const RealSenseCameraIntrincics& getOtherIntrinsics() const { return mOtherIntrinsics; }
+
+    private:
+        /**
+         * Projects both corners of all depth pixels in the given row range into the other stream
+         */
+        void projectRows(const uint16* depth, float depthScale, int firstRow, int lastRow);
+
+        RealSenseCameraIntrincics mDepthIntrinsics = {};
+        RealSenseCameraIntrincics mOtherIntrinsics = {};
+        RealSenseCameraExtrinsics mExtrinsics = {};
+        bool mConfigured = false;
+        bool mDistorted = false;
+
+        // rotated rays of the top left and bottom right corner of every depth pixel
+        std::vector<float> mRayX[2];
+        std::vector<float> mRayY[2];
+        std::vector<float> mRayZ[2];
+
+        // per-frame projected bounds of every depth pixel in the other stream, -1 when invalid
+        std::vector<int> mMinX;
+        std::vector<int> mMinY;
+        std::vector<int> mMaxX;
+        std::vector<int> mMaxY;
+
+        // vertical extent of every projected depth row, used to split the depth to other scatter in output bands
+        std::vector<int> mRowMinY;
+        std::vector<int> mRowMaxY;
+
+        // per-row scratch buffers for the projected corners
+        std::vector<float> mScratch;
+    };
+}
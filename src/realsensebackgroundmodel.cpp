@@ -0,0 +1,220 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensebackgroundmodel.h"
+#include "realsenseworkerpool.h"
+
+#include <algorithm>
+#include <bitset>
+#include <functional>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define REALSENSE_BACKGROUND_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Amount of tiles the rows are split into per worker thread, more tiles than threads balances uneven rows
+     */
+    static constexpr int sTilesPerThread = 4;
+
+
+    /**
+     * Arguments of a frame shared by all tiles, captured by reference so the task does not allocate
+     */
+    struct FrameArguments
+    {
+        const uint8* mDepth = nullptr;
+        int mDepthStride = 0;
+        uint16* mBackground = nullptr;
+        uint16* mForeground = nullptr;
+        uint8* mMask = nullptr;
+        int* mTileCounts = nullptr;
+        int mWidth = 0;
+        int mHeight = 0;
+        int mTiles = 0;
+        bool mLearning = false;
+        RealSenseBackgroundModel::Parameters mParameters;
+    };
+
+
+    /**
+     * Processes count pixels of a row, returns the amount of foreground pixels
+     */
+    static int processRowScalar(const uint16* depth, uint16* background, uint16* foreground, uint8* mask, int count,
+                                const RealSenseBackgroundModel::Parameters& parameters, bool learning)
+    {
+        int foreground_count = 0;
+        for(int i = 0; i < count; i++)
+        {
+            uint16 value = depth[i];
+            uint16 model = background[i];
+            bool is_foreground = false;
+            if(learning)
+            {
+                background[i] = std::max(model, value);
+            }
+            else
+            {
+                bool valid = value != 0;
+                int closer = model > value ? model - value : 0;
+                is_foreground = valid && (model == 0 || closer > parameters.mThreshold);
+                if(valid && !is_foreground)
+                {
+                    int further = value > model ? value - model : 0;
+                    background[i] = static_cast<uint16>(model + std::min<int>(further, parameters.mStep) - std::min<int>(closer, parameters.mStep));
+                }
+            }
+
+            foreground_count += is_foreground ? 1 : 0;
+            if(foreground != nullptr)
+                foreground[i] = is_foreground ? value : 0;
+            if(mask != nullptr)
+                mask[i] = is_foreground ? 255 : 0;
+        }
+        return foreground_count;
+    }
+
+
+#ifdef REALSENSE_BACKGROUND_SSE2
+    /**
+     * Processes count pixels of a row, 8 at a time, returns the amount of foreground pixels.
+     * SSE2 lacks unsigned 16 bit compare, min and max: these are composed from saturating subtractions.
+     */
+    static int processRowSSE2(const uint16* depth, uint16* background, uint16* foreground, uint8* mask, int count,
+                              const RealSenseBackgroundModel::Parameters& parameters, bool learning)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i threshold = _mm_set1_epi16(static_cast<short>(parameters.mThreshold));
+        const __m128i step = _mm_set1_epi16(static_cast<short>(parameters.mStep));
+
+        int foreground_count = 0;
+        int i = 0;
+        for(; i + 8 <= count; i += 8)
+        {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + i));
+            __m128i model = _mm_loadu_si128(reinterpret_cast<const __m128i*>(background + i));
+            __m128i is_foreground = zero;
+            if(learning)
+            {
+                // max(model, value)
+                model = _mm_add_epi16(model, _mm_subs_epu16(value, model));
+            }
+            else
+            {
+                __m128i invalid = _mm_cmpeq_epi16(value, zero);
+                __m128i unknown = _mm_cmpeq_epi16(model, zero);
+                __m128i closer = _mm_subs_epu16(model, value);
+                __m128i further = _mm_subs_epu16(value, model);
+                __m128i beyond_threshold = _mm_xor_si128(_mm_cmpeq_epi16(_mm_subs_epu16(closer, threshold), zero), _mm_cmpeq_epi16(zero, zero));
+                is_foreground = _mm_andnot_si128(invalid, _mm_or_si128(unknown, beyond_threshold));
+
+                // move valid background pixels by min(difference, step)
+                __m128i up = _mm_sub_epi16(further, _mm_subs_epu16(further, step));
+                __m128i down = _mm_sub_epi16(closer, _mm_subs_epu16(closer, step));
+                __m128i updated = _mm_sub_epi16(_mm_add_epi16(model, up), down);
+                __m128i update = _mm_andnot_si128(_mm_or_si128(invalid, is_foreground), _mm_cmpeq_epi16(zero, zero));
+                model = _mm_or_si128(_mm_and_si128(update, updated), _mm_andnot_si128(update, model));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(background + i), model);
+
+            __m128i mask_bytes = _mm_packs_epi16(is_foreground, zero);
+            foreground_count += static_cast<int>(std::bitset<8>(_mm_movemask_epi8(mask_bytes) & 0xFF).count());
+            if(foreground != nullptr)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(foreground + i), _mm_and_si128(is_foreground, value));
+            if(mask != nullptr)
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(mask + i), mask_bytes);
+        }
+
+        return foreground_count + processRowScalar(depth + i, background + i, foreground != nullptr ? foreground + i : nullptr,
+                                                   mask != nullptr ? mask + i : nullptr, count - i, parameters, learning);
+    }
+#endif
+
+
+    /**
+     * Processes the rows of a tile
+     */
+    static void processTile(const FrameArguments& args, int tile)
+    {
+        int begin = static_cast<int>(static_cast<int64>(args.mHeight) * tile / args.mTiles);
+        int end = static_cast<int>(static_cast<int64>(args.mHeight) * (tile + 1) / args.mTiles);
+        int foreground_count = 0;
+        for(int row = begin; row < end; row++)
+        {
+            size_t offset = static_cast<size_t>(row) * static_cast<size_t>(args.mWidth);
+            const auto* depth = reinterpret_cast<const uint16*>(args.mDepth + static_cast<size_t>(row) * static_cast<size_t>(args.mDepthStride));
+            uint16* foreground = args.mForeground != nullptr ? args.mForeground + offset : nullptr;
+            uint8* mask = args.mMask != nullptr ? args.mMask + offset : nullptr;
+#ifdef REALSENSE_BACKGROUND_SSE2
+            foreground_count += processRowSSE2(depth, args.mBackground + offset, foreground, mask, args.mWidth, args.mParameters, args.mLearning);
+#else
+            foreground_count += processRowScalar(depth, args.mBackground + offset, foreground, mask, args.mWidth, args.mParameters, args.mLearning);
+#endif
+        }
+        args.mTileCounts[tile] = foreground_count;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseBackgroundModel
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseBackgroundModel::resize(int width, int height)
+    {
+        if(width == mWidth && height == mHeight)
+            return;
+
+        mWidth = width;
+        mHeight = height;
+        mBackground.resize(static_cast<size_t>(width) * static_cast<size_t>(height));
+        mTileCounts.resize(std::max(height, 1));
+        reset(mLearnFrameCount);
+    }
+
+
+    void RealSenseBackgroundModel::reset(int learnFrames)
+    {
+        mLearnFrameCount = std::max(learnFrames, 1);
+        mLearnFrames = mLearnFrameCount;
+        std::fill(mBackground.begin(), mBackground.end(), static_cast<uint16>(0));
+    }
+
+
+    int RealSenseBackgroundModel::process(const uint16* depth, int depthStride, uint16* foreground, uint8* mask,
+                                          const Parameters& parameters, RealSenseWorkerPool* pool)
+    {
+        if(mWidth <= 0 || mHeight <= 0)
+            return 0;
+
+        FrameArguments args;
+        args.mDepth = reinterpret_cast<const uint8*>(depth);
+        args.mDepthStride = depthStride;
+        args.mBackground = mBackground.data();
+        args.mForeground = foreground;
+        args.mMask = mask;
+        args.mTileCounts = mTileCounts.data();
+        args.mWidth = mWidth;
+        args.mHeight = mHeight;
+        args.mLearning = mLearnFrames > 0;
+        args.mParameters = parameters;
+
+        int threads = pool != nullptr ? pool->getThreadCount() + 1 : 1;
+        args.mTiles = std::max(1, std::min(mHeight, threads * sTilesPerThread));
+        RealSenseWorkerPool::parallelFor(pool, args.mTiles, [&args](int tile) { processTile(args, tile); });
+
+        if(mLearnFrames > 0)
+            mLearnFrames--;
+
+        int foreground_count = 0;
+        for(int tile = 0; tile < args.mTiles; tile++)
+            foreground_count += mTileCounts[tile];
+        return foreground_count;
+    }
+}
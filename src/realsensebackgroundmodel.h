@@ -0,0 +1,86 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseWorkerPool;
+
+    /**
+     * RealSenseBackgroundModel
+     * Per-pixel background depth model of a static scene, separates the foreground from 16 bit depth frames.
+     * While learning, the model keeps the farthest valid depth of every pixel. Afterwards a pixel is foreground when it is
+     * valid and closer than the background by more than the threshold, or when its background is unknown.
+     * Background pixels move the model towards the observed depth by at most the learning step per frame,
+     * a running median approximation that absorbs slow changes but not people passing by. Foreground pixels do not update the model.
+     * Rows are split into tiles over the worker pool, 8 pixels are processed at once with SSE2 on x64.
+     * Buffers are only allocated when the resolution changes.
+     */
+    class NAPAPI RealSenseBackgroundModel final
+    {
+    public:
+        /**
+         * Per-frame parameters, depth values are in depth units of the frame
+         */
+        struct Parameters
+        {
+            uint16 mThreshold = 50;     ///< Minimum distance in front of the background of a foreground pixel
+            uint16 mStep = 1;           ///< Maximum change of the background of a pixel per frame
+        };
+
+        /**
+         * Sets the resolution, clears the model and starts learning again when the resolution changes
+         * @param width width in pixels
+         * @param height height in pixels
+         */
+        void resize(int width, int height);
+
+        /**
+         * Clears the model and starts learning
+         * @param learnFrames amount of frames the model learns before separating foreground
+         */
+        void reset(int learnFrames);
+
+        /**
+         * Updates the model with a depth frame and separates the foreground
+         * @param depth depth values of the frame
+         * @param depthStride stride of the depth frame in bytes
+         * @param foreground receives the depth of foreground pixels and 0 for background pixels, tightly packed, can be nullptr
+         * @param mask receives 255 for foreground pixels and 0 for background pixels, tightly packed, can be nullptr
+         * @param parameters thresholds in depth units
+         * @param pool worker pool to split the tiles over, nullptr processes all tiles on the calling thread
+         * @return amount of foreground pixels
+         */
+        int process(const uint16* depth, int depthStride, uint16* foreground, uint8* mask, const Parameters& parameters, RealSenseWorkerPool* pool);
+
+        /**
+         * @return if the model is still learning the background
+         */
+        bool isLearning() const                     { return mLearnFrames > 0; }
+
+        /**
+         * @return the background depth of every pixel, 0 when unknown
+         */
+        const std::vector<uint16>& getBackground() const { return mBackground; }
+
+        int getWidth() const                        { return mWidth; }    ///< @return width in pixels
+        int getHeight() const                       { return mHeight; }   ///< @return height in pixels
+
+    private:
+        std::vector<uint16> mBackground;
+        std::vector<int> mTileCounts;
+        int mWidth = 0;
+        int mHeight = 0;
+        int mLearnFrames = 0;           ///< Amount of frames left to learn
+        int mLearnFrameCount = 30;      ///< Amount of frames to learn after a reset
+    };
+}
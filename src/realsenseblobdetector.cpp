@@ -0,0 +1,284 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsenseblobdetector.h"
+#include "realsensedeprojection.h"
+#include "realsenseworkerpool.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Amount of stripes per worker thread, every stripe boundary adds one row to the serial merge step
+     */
+    static constexpr int sStripesPerThread = 2;
+
+
+    /**
+     * Returns the root of a pixel, halves the path on the way. The root is the smallest pixel index of the component.
+     */
+    static int32 findRoot(int32* parent, int32 index)
+    {
+        while(parent[index] != index)
+        {
+            parent[index] = parent[parent[index]];
+            index = parent[index];
+        }
+        return index;
+    }
+
+
+    /**
+     * Joins the components of two pixels, the larger root is linked to the smaller root
+     */
+    static void unite(int32* parent, int32 a, int32 b)
+    {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if(a < b)
+            parent[b] = a;
+        else if(b < a)
+            parent[a] = b;
+    }
+
+
+    static bool isConnected(uint16 a, uint16 b, uint16 maxStep)
+    {
+        return std::abs(static_cast<int>(a) - static_cast<int>(b)) <= maxStep;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseBlobDetector
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseBlobDetector::labelStripe(Stripe& stripe, const uint16* depth, int depthStride, float depthScale,
+                                            const RealSenseDeprojectionMap& rays, uint16 maxStep)
+    {
+        int32* parent = mParent.data();
+        auto get_row = [depth, depthStride](int row)
+        {
+            return reinterpret_cast<const uint16*>(reinterpret_cast<const uint8*>(depth) + static_cast<size_t>(row) * static_cast<size_t>(depthStride));
+        };
+
+        // union-find within the stripe, rows above the stripe are joined in the merge step
+        for(int row = stripe.mBegin; row < stripe.mEnd; row++)
+        {
+            const uint16* values = get_row(row);
+            const uint16* above = row > stripe.mBegin ? get_row(row - 1) : nullptr;
+            int32 offset = row * mWidth;
+            for(int x = 0; x < mWidth; x++)
+            {
+                int32 index = offset + x;
+                uint16 value = values[x];
+                if(value == 0)
+                {
+                    parent[index] = -1;
+                    continue;
+                }
+
+                parent[index] = index;
+                if(x > 0 && values[x - 1] != 0 && isConnected(value, values[x - 1], maxStep))
+                    unite(parent, index, index - 1);
+                if(above != nullptr && above[x] != 0 && isConnected(value, above[x], maxStep))
+                    unite(parent, index, index - mWidth);
+            }
+        }
+
+        // accumulate the statistics per component, a root is always visited before the other pixels of its component
+        const float* ray_x = rays.getX();
+        const float* ray_y = rays.getY();
+        stripe.mComponents.clear();
+        for(int row = stripe.mBegin; row < stripe.mEnd; row++)
+        {
+            const uint16* values = get_row(row);
+            int32 offset = row * mWidth;
+            for(int x = 0; x < mWidth; x++)
+            {
+                int32 index = offset + x;
+                if(parent[index] < 0)
+                    continue;
+
+                float z = values[x] * depthScale;
+                glm::vec3 point = { ray_x[index] * z, ray_y[index] * z, z };
+                int32 root = findRoot(parent, index);
+                if(root == index)
+                {
+                    mSlot[index] = static_cast<int32>(stripe.mComponents.size());
+                    Accumulator component;
+                    component.mRoot = index;
+                    component.mPixelMin = { x, row };
+                    component.mPixelMax = { x, row };
+                    component.mMin = point;
+                    component.mMax = point;
+                    stripe.mComponents.emplace_back(component);
+                }
+
+                auto& component = stripe.mComponents[mSlot[root]];
+                component.mCount++;
+                component.mDepth += z;
+                component.mPixel.x += x;
+                component.mPixel.y += row;
+                component.mPoint += glm::dvec3(point.x, point.y, point.z);
+                component.mPixelMin.x = std::min(component.mPixelMin.x, x);
+                component.mPixelMax.x = std::max(component.mPixelMax.x, x);
+                component.mPixelMax.y = row;
+                component.mMin = glm::min(component.mMin, point);
+                component.mMax = glm::max(component.mMax, point);
+            }
+        }
+    }
+
+
+    void RealSenseBlobDetector::detect(const uint16* depth, int depthStride, float depthScale, const RealSenseDeprojectionMap& rays,
+                                       const Parameters& parameters, RealSenseWorkerPool* pool, std::vector<RealSenseBlob>& blobs)
+    {
+        blobs.clear();
+        if(mWidth != rays.getWidth() || mHeight != rays.getHeight())
+        {
+            mWidth = rays.getWidth();
+            mHeight = rays.getHeight();
+            size_t count = static_cast<size_t>(mWidth) * static_cast<size_t>(mHeight);
+            mParent.resize(count);
+            mSlot.resize(count);
+        }
+
+        if(mWidth <= 0 || mHeight <= 0)
+            return;
+
+        // split the rows into stripes
+        int threads = pool != nullptr ? pool->getThreadCount() + 1 : 1;
+        int stripe_count = std::max(1, std::min(mHeight, threads * sStripesPerThread));
+        if(static_cast<int>(mStripes.size()) != stripe_count)
+            mStripes.resize(stripe_count);
+        for(int i = 0; i < stripe_count; i++)
+        {
+            mStripes[i].mBegin = static_cast<int>(static_cast<int64>(mHeight) * i / stripe_count);
+            mStripes[i].mEnd = static_cast<int>(static_cast<int64>(mHeight) * (i + 1) / stripe_count);
+        }
+
+        RealSenseWorkerPool::parallelFor(pool, stripe_count, [&, this](int i) { labelStripe(mStripes[i], depth, depthStride, depthScale, rays, parameters.mMaxDepthStep); });
+
+        // join the components that touch a stripe boundary
+        int32* parent = mParent.data();
+        for(int i = 1; i < stripe_count; i++)
+        {
+            int row = mStripes[i].mBegin;
+            const auto* values = reinterpret_cast<const uint16*>(reinterpret_cast<const uint8*>(depth) + static_cast<size_t>(row) * static_cast<size_t>(depthStride));
+            const auto* above = reinterpret_cast<const uint16*>(reinterpret_cast<const uint8*>(values) - depthStride);
+            for(int x = 0; x < mWidth; x++)
+            {
+                if(values[x] != 0 && above[x] != 0 && isConnected(values[x], above[x], parameters.mMaxDepthStep))
+                    unite(parent, row * mWidth + x, (row - 1) * mWidth + x);
+            }
+        }
+
+        // merge the stripe components into their final root, roots are visited in increasing index order
+        // so the component of a root is always merged before the components linked to it
+        mMerged.clear();
+        for(const auto& stripe : mStripes)
+        {
+            for(const auto& component : stripe.mComponents)
+            {
+                int32 root = findRoot(parent, component.mRoot);
+                if(root == component.mRoot)
+                {
+                    mSlot[root] = static_cast<int32>(mMerged.size());
+                    mMerged.emplace_back(component);
+                    continue;
+                }
+
+                auto& merged = mMerged[mSlot[root]];
+                merged.mCount += component.mCount;
+                merged.mDepth += component.mDepth;
+                merged.mPixel.x += component.mPixel.x;
+                merged.mPixel.y += component.mPixel.y;
+                merged.mPoint += component.mPoint;
+                merged.mPixelMin.x = std::min(merged.mPixelMin.x, component.mPixelMin.x);
+                merged.mPixelMin.y = std::min(merged.mPixelMin.y, component.mPixelMin.y);
+                merged.mPixelMax.x = std::max(merged.mPixelMax.x, component.mPixelMax.x);
+                merged.mPixelMax.y = std::max(merged.mPixelMax.y, component.mPixelMax.y);
+                merged.mMin = glm::min(merged.mMin, component.mMin);
+                merged.mMax = glm::max(merged.mMax, component.mMax);
+            }
+        }
+
+        for(const auto& component : mMerged)
+        {
+            if(component.mCount < parameters.mMinPixels)
+                continue;
+
+            double count = static_cast<double>(component.mCount);
+            RealSenseBlob blob;
+            blob.mPixelCount = component.mCount;
+            blob.mMeanDepth = static_cast<float>(component.mDepth / count);
+            blob.mCentroid = { static_cast<float>(component.mPixel.x / count), static_cast<float>(component.mPixel.y / count) };
+            blob.mPixelMin = component.mPixelMin;
+            blob.mPixelMax = component.mPixelMax;
+            blob.mPosition = { static_cast<float>(component.mPoint.x / count), static_cast<float>(component.mPoint.y / count),
+                               static_cast<float>(component.mPoint.z / count) };
+            blob.mMin = component.mMin;
+            blob.mMax = component.mMax;
+            blobs.emplace_back(blob);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseBlobTracker
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseBlobTracker::track(std::vector<RealSenseBlob>& blobs, float maxDistance)
+    {
+        // all pairs within range, closest first
+        mCandidates.clear();
+        for(int t = 0; t < static_cast<int>(mTracks.size()); t++)
+        {
+            for(int b = 0; b < static_cast<int>(blobs.size()); b++)
+            {
+                float distance = glm::length(blobs[b].mPosition - mTracks[t].mPosition);
+                if(distance <= maxDistance)
+                    mCandidates.push_back({ distance, t, b });
+            }
+        }
+        std::sort(mCandidates.begin(), mCandidates.end(), [](const Candidate& a, const Candidate& b) { return a.mDistance < b.mDistance; });
+
+        mTrackMatched.assign(mTracks.size(), false);
+        for(auto& blob : blobs)
+            blob.mID = -1;
+
+        for(const auto& candidate : mCandidates)
+        {
+            auto& blob = blobs[candidate.mBlob];
+            if(mTrackMatched[candidate.mTrack] || blob.mID >= 0)
+                continue;
+
+            const auto& track = mTracks[candidate.mTrack];
+            mTrackMatched[candidate.mTrack] = true;
+            blob.mID = track.mID;
+            blob.mAge = track.mAge + 1;
+        }
+
+        // unmatched blobs start a new track, unmatched tracks are lost
+        mTracks.clear();
+        for(auto& blob : blobs)
+        {
+            if(blob.mID < 0)
+            {
+                blob.mID = mNextID++;
+                blob.mAge = 1;
+            }
+
+            Track track;
+            track.mID = blob.mID;
+            track.mAge = blob.mAge;
+            track.mPosition = blob.mPosition;
+            mTracks.emplace_back(track);
+        }
+    }
+}
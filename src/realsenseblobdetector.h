@@ -0,0 +1,148 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseDeprojectionMap;
+    class RealSenseWorkerPool;
+
+    /**
+     * A connected region of valid depth pixels
+     */
+    struct NAPAPI RealSenseBlob
+    {
+        int mID = -1;                                   ///< Tracking id, stays the same while the blob is tracked from frame to frame
+        int mAge = 0;                                   ///< Amount of consecutive frames the blob was tracked
+        int mPixelCount = 0;                            ///< Amount of pixels
+        float mMeanDepth = 0.0f;                        ///< Mean depth in meters
+        glm::vec2 mCentroid = { 0.0f, 0.0f };           ///< Mean pixel coordinate
+        glm::ivec2 mPixelMin = { 0, 0 };                ///< Top left pixel of the bounding rectangle
+        glm::ivec2 mPixelMax = { 0, 0 };                ///< Bottom right pixel of the bounding rectangle
+        glm::vec3 mPosition = { 0.0f, 0.0f, 0.0f };     ///< Mean 3D point in meters, relative to the camera
+        glm::vec3 mMin = { 0.0f, 0.0f, 0.0f };          ///< Minimum of the 3D bounds in meters, relative to the camera
+        glm::vec3 mMax = { 0.0f, 0.0f, 0.0f };          ///< Maximum of the 3D bounds in meters, relative to the camera
+    };
+
+    /**
+     * RealSenseBlobDetector
+     * Finds connected components of valid (non zero) pixels in 16 bit depth frames, usually the output of a background subtraction filter.
+     * Two 4-connected neighbours belong to the same blob when their depth differs by at most the maximum depth step,
+     * so a person in front of another person is split into two blobs.
+     * The frame is split into horizontal stripes that are labeled with union-find on the worker pool, every stripe accumulates
+     * the statistics of its own components. The components that touch a stripe boundary are merged afterwards.
+     * Buffers are only allocated when the resolution changes.
+     */
+    class NAPAPI RealSenseBlobDetector final
+    {
+    public:
+        /**
+         * Detection parameters
+         */
+        struct Parameters
+        {
+            int mMinPixels = 200;                       ///< Minimum amount of pixels of a blob, smaller components are discarded
+            uint16 mMaxDepthStep = 50;                  ///< Maximum depth difference of connected neighbours in depth units
+        };
+
+        /**
+         * Finds the blobs of a depth frame, the resolution is taken from the deprojection map
+         * @param depth depth values of the frame
+         * @param depthStride stride of the depth frame in bytes
+         * @param depthScale depth units in meters
+         * @param rays deprojection map of the depth stream
+         * @param parameters detection parameters
+         * @param pool worker pool to split the stripes over, nullptr labels the frame on the calling thread
+         * @param blobs receives the blobs, cleared first. Blob ids are not assigned, see RealSenseBlobTracker.
+         */
+        void detect(const uint16* depth, int depthStride, float depthScale, const RealSenseDeprojectionMap& rays,
+                    const Parameters& parameters, RealSenseWorkerPool* pool, std::vector<RealSenseBlob>& blobs);
+
+    private:
+        /**
+         * Running sums of a component
+         */
+        struct Accumulator
+        {
+            int mRoot = 0;
+            int mCount = 0;
+            double mDepth = 0.0;
+            glm::dvec2 mPixel = { 0.0, 0.0 };
+            glm::dvec3 mPoint = { 0.0, 0.0, 0.0 };
+            glm::ivec2 mPixelMin = { 0, 0 };
+            glm::ivec2 mPixelMax = { 0, 0 };
+            glm::vec3 mMin = { 0.0f, 0.0f, 0.0f };
+            glm::vec3 mMax = { 0.0f, 0.0f, 0.0f };
+        };
+
+        /**
+         * Rows labeled by one task and the components found in them
+         */
+        struct Stripe
+        {
+            int mBegin = 0;
+            int mEnd = 0;
+            std::vector<Accumulator> mComponents;
+        };
+
+        void labelStripe(Stripe& stripe, const uint16* depth, int depthStride, float depthScale, const RealSenseDeprojectionMap& rays, uint16 maxStep);
+
+        std::vector<int32> mParent;                     ///< Union-find parent of every pixel, -1 for invalid pixels
+        std::vector<int32> mSlot;                       ///< Index of the accumulator of a root pixel
+        std::vector<Stripe> mStripes;
+        std::vector<Accumulator> mMerged;
+        int mWidth = 0;
+        int mHeight = 0;
+    };
+
+    /**
+     * RealSenseBlobTracker
+     * Assigns ids to blobs by matching their 3D positions with the blobs of the previous frame.
+     * The closest pairs are matched first, a blob further away than the maximum distance from every unmatched blob gets a new id.
+     */
+    class NAPAPI RealSenseBlobTracker final
+    {
+    public:
+        /**
+         * Assigns the id and age of every blob
+         * @param blobs blobs of the current frame
+         * @param maxDistance maximum distance in meters a blob can move between frames
+         */
+        void track(std::vector<RealSenseBlob>& blobs, float maxDistance);
+
+        /**
+         * Forgets all tracked blobs
+         */
+        void reset()                                    { mTracks.clear(); }
+
+    private:
+        struct Track
+        {
+            int mID = 0;
+            int mAge = 0;
+            glm::vec3 mPosition = { 0.0f, 0.0f, 0.0f };
+        };
+
+        struct Candidate
+        {
+            float mDistance = 0.0f;
+            int mTrack = 0;
+            int mBlob = 0;
+        };
+
+        std::vector<Track> mTracks;
+        std::vector<Candidate> mCandidates;
+        std::vector<bool> mTrackMatched;
+        int mNextID = 0;
+    };
+}
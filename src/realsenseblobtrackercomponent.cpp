@@ -0,0 +1,105 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsenseblobtrackercomponent.h"
+#include "realsensedeprojection.h"
+#include "realsenseservice.h"
+
+#include <rs.hpp>
+#include <nap/core.h>
+#include <algorithm>
+
+RTTI_BEGIN_CLASS(nap::RealSenseBlobTrackerComponent)
+    RTTI_PROPERTY("MinPixels", &nap::RealSenseBlobTrackerComponent::mMinPixels, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MaxDepthStep", &nap::RealSenseBlobTrackerComponent::mMaxDepthStep, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MaxTrackDistance", &nap::RealSenseBlobTrackerComponent::mMaxTrackDistance, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseBlobTrackerComponentInstance)
+    RTTI_CONSTRUCTOR(nap::EntityInstance&, nap::Component&)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseBlobTrackerComponent
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseBlobTrackerComponent::RealSenseBlobTrackerComponent() = default;
+
+
+    RealSenseBlobTrackerComponent::~RealSenseBlobTrackerComponent() = default;
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseBlobTrackerComponentInstance::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseBlobTrackerComponentInstance::Impl
+    {
+    public:
+        RealSenseBlobDetector mDetector;
+        RealSenseBlobTracker mTracker;
+        RealSenseDeprojectionMap mRays;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseBlobTrackerComponentInstance
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseBlobTrackerComponentInstance::RealSenseBlobTrackerComponentInstance(EntityInstance& entity, Component& resource) :
+        RealSenseFrameSetListenerComponentInstance(entity, resource)
+    {}
+
+
+    RealSenseBlobTrackerComponentInstance::~RealSenseBlobTrackerComponentInstance() = default;
+
+
+    bool RealSenseBlobTrackerComponentInstance::onInit(utility::ErrorState& errorState)
+    {
+        mImpl = std::make_unique<Impl>();
+        mResource = getComponent<RealSenseBlobTrackerComponent>();
+        mPool = &getEntityInstance()->getCore()->getService<RealSenseService>()->getWorkerPool();
+
+        if(!errorState.check(mResource->mMinPixels > 0, "%s: min pixels must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        if(!errorState.check(mResource->mMaxDepthStep >= 0.0f && mResource->mMaxTrackDistance >= 0.0f,
+                             "%s: max depth step and max track distance can't be negative", mResource->mID.c_str()))
+            return false;
+
+        frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
+        return true;
+    }
+
+
+    void RealSenseBlobTrackerComponentInstance::update(double deltaTime)
+    {
+        if(mResults.update())
+            blobsUpdated.trigger(mResults.getReadBuffer());
+    }
+
+
+    void RealSenseBlobTrackerComponentInstance::onTrigger(const rs2::frameset& frameset)
+    {
+        auto depth = frameset.get_depth_frame();
+        if(!depth || depth.get_profile().format() != RS2_FORMAT_Z16)
+            return;
+
+        // rays only change with the stream profile
+        mImpl->mRays.update(depth.get_profile().as<rs2::video_stream_profile>());
+
+        float depth_units = depth.get_units();
+        RealSenseBlobDetector::Parameters parameters;
+        parameters.mMinPixels = mResource->mMinPixels;
+        parameters.mMaxDepthStep = static_cast<uint16>(std::min(65535.0f, mResource->mMaxDepthStep / depth_units + 0.5f));
+
+        auto& result = mResults.getWriteBuffer();
+        mImpl->mDetector.detect(static_cast<const uint16*>(depth.get_data()), depth.get_stride_in_bytes(), depth_units,
+                                mImpl->mRays, parameters, mPool, result.mBlobs);
+        mImpl->mTracker.track(result.mBlobs, mResource->mMaxTrackDistance);
+        result.mFrameNumber = depth.get_frame_number();
+        result.mTimestamp = depth.get_timestamp();
+        mResults.publish();
+    }
+}
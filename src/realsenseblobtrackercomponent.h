@@ -0,0 +1,113 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include "realsenseframesetlistenercomponent.h"
+#include "realsenseblobdetector.h"
+#include "realsensetriplebuffer.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseBlobTrackerComponentInstance;
+    class RealSenseWorkerPool;
+
+    /**
+     * Blobs found in a single depth frame
+     */
+    struct NAPAPI RealSenseBlobFrame
+    {
+        std::vector<RealSenseBlob> mBlobs;      ///< Blobs of the frame, with tracking ids
+        uint64 mFrameNumber = 0;                ///< Frame number of the depth frame
+        double mTimestamp = 0.0;                ///< Timestamp of the depth frame in milliseconds
+    };
+
+    /**
+     * RealSenseBlobTrackerComponent
+     * Finds and tracks blobs in the Z16 depth frames of a device at camera rate, see RealSenseBlobDetector and RealSenseBlobTracker.
+     * Every valid depth pixel is considered foreground: apply a RealSenseBackgroundSubtractFilter to the depth stream of the device first.
+     * Blobs are detected on the capture thread, split into stripes over the worker pool of the RealSenseService.
+     * The results are handed to the main thread through a lock-free triple buffer, the capture thread never waits for the main thread.
+     */
+    class NAPAPI RealSenseBlobTrackerComponent : public RealSenseFrameSetListenerComponent
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponent)
+    DECLARE_COMPONENT(RealSenseBlobTrackerComponent, RealSenseBlobTrackerComponentInstance)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseBlobTrackerComponent();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseBlobTrackerComponent();
+
+        // Properties
+        int mMinPixels = 200;                   ///< Property: 'MinPixels' minimum amount of pixels of a blob
+        float mMaxDepthStep = 0.05f;            ///< Property: 'MaxDepthStep' maximum depth difference in meters of connected neighbouring pixels
+        float mMaxTrackDistance = 0.3f;         ///< Property: 'MaxTrackDistance' maximum distance in meters a blob can move between frames and keep its id
+    };
+
+    /**
+     * RealSenseBlobTrackerComponentInstance
+     * Detects blobs on the capture thread and publishes them on update
+     */
+    class NAPAPI RealSenseBlobTrackerComponentInstance : public RealSenseFrameSetListenerComponentInstance
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponentInstance)
+    public:
+        /**
+         * Constructor
+         * @param entity reference to entity instance
+         * @param resource reference to component
+         */
+        RealSenseBlobTrackerComponentInstance(EntityInstance& entity, Component& resource);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseBlobTrackerComponentInstance();
+
+        /**
+         * Picks up the blobs of the latest processed frame, triggers blobsUpdated when new blobs are available
+         * @param deltaTime time since last update
+         */
+        void update(double deltaTime) override;
+
+        /**
+         * @return blobs of the latest frame picked up by update, only call from the main thread
+         */
+        const RealSenseBlobFrame& getBlobs() const  { return mResults.getReadBuffer(); }
+
+        // Signal triggered from update on the main thread when new blobs are available
+        Signal<const RealSenseBlobFrame&> blobsUpdated;
+
+    protected:
+        /**
+         * Internal init method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool onInit(utility::ErrorState& errorState) override;
+
+        /**
+         * Called upon receiving a new frameset, called from RealSense device
+         * @param frameset a new frameset
+         */
+        void onTrigger(const rs2::frameset& frameset);
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseBlobTrackerComponent* mResource = nullptr;
+        RealSenseWorkerPool* mPool = nullptr;
+        RealSenseTripleBuffer<RealSenseBlobFrame> mResults;
+    };
+}
@@ -0,0 +1,98 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsenseconversion.h"
+
+#include <rs.hpp>
+#include <cstdio>
+
+namespace nap
+{
+    namespace realsense
+    {
+        RealSenseCameraIntrincics toIntrinsics(const rs2_intrinsics& intrinsicsRS2)
+        {
+            RealSenseCameraIntrincics intrinsics{};
+            intrinsics.mHeight = intrinsicsRS2.height;
+            intrinsics.mWidth = intrinsicsRS2.width;
+            for(int i = 0;i < 5;i++)
+            {
+                intrinsics.mCoeffs[i] = intrinsicsRS2.coeffs[i];
+            }
+            intrinsics.mFX = intrinsicsRS2.fx;
+            intrinsics.mFY = intrinsicsRS2.fy;
+            intrinsics.mPPX = intrinsicsRS2.ppx;
+            intrinsics.mPPY = intrinsicsRS2.ppy;
+            intrinsics.mModel = static_cast<ERealSenseDistortionModels>(intrinsicsRS2.model);
+            return intrinsics;
+        }
+
+
+        RealSenseCameraExtrinsics toExtrinsics(const rs2_extrinsics& extrinsicsRS2)
+        {
+            RealSenseCameraExtrinsics extrinsics{};
+            for(int i = 0; i < 9; i++)
+                extrinsics.mRotation[i] = extrinsicsRS2.rotation[i];
+            for(int i = 0; i < 3; i++)
+                extrinsics.mTranslation[i] = extrinsicsRS2.translation[i];
+            return extrinsics;
+        }
+
+
+        /**
+         * @return the metadata value, -1 when the frame does not carry it
+         */
+        static int64 getMetadata(const rs2::frame& frame, rs2_frame_metadata_value value)
+        {
+            return frame.supports_frame_metadata(value) ? static_cast<int64>(frame.get_frame_metadata(value)) : -1;
+        }
+
+
+        RealSenseFrameInfo toFrameInfo(const rs2::frame& frame)
+        {
+            RealSenseFrameInfo info;
+            auto profile = frame.get_profile();
+            info.mStream = static_cast<ERealSenseStreamType>(profile.stream_type());
+            info.mStreamIndex = profile.stream_index();
+            info.mFrameNumber = static_cast<uint64>(frame.get_frame_number());
+            info.mTimestamp = frame.get_timestamp();
+            info.mHardwareTimestamp = getMetadata(frame, RS2_FRAME_METADATA_FRAME_TIMESTAMP);
+            info.mExposure = getMetadata(frame, RS2_FRAME_METADATA_ACTUAL_EXPOSURE);
+            info.mGain = getMetadata(frame, RS2_FRAME_METADATA_GAIN_LEVEL);
+            info.mLaserPower = getMetadata(frame, RS2_FRAME_METADATA_FRAME_LASER_POWER);
+            return info;
+        }
+
+
+        std::string escapeJSON(const std::string& text)
+        {
+            std::string result;
+            result.reserve(text.size());
+            for(char c : text)
+            {
+                switch(c)
+                {
+                case '"':   result += "\\\""; break;
+                case '\\':  result += "\\\\"; break;
+                case '\n':  result += "\\n"; break;
+                case '\r':  result += "\\r"; break;
+                case '\t':  result += "\\t"; break;
+                default:
+                    if(static_cast<unsigned char>(c) < 0x20)
+                    {
+                        char code[8];
+                        std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(c));
+                        result += code;
+                    }
+                    else
+                    {
+                        result += c;
+                    }
+                    break;
+                }
+            }
+            return result;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <string>
+
+// Local includes
+#include "realsensetypes.h"
+
+// forward declares
+struct rs2_intrinsics;
+struct rs2_extrinsics;
+
+namespace rs2
+{
+    class frame;
+}
+
+namespace nap
+{
+    namespace realsense
+    {
+        /**
+         * Converts librealsense intrinsics to RealSenseCameraIntrincics
+         * @param intrinsics the librealsense intrinsics
+         * @return the converted intrinsics
+         */
+        RealSenseCameraIntrincics toIntrinsics(const rs2_intrinsics& intrinsics);
+
+        /**
+         * Converts librealsense extrinsics to RealSenseCameraExtrinsics
+         * @param extrinsics the librealsense extrinsics
+         * @return the converted extrinsics
+         */
+        RealSenseCameraExtrinsics toExtrinsics(const rs2_extrinsics& extrinsics);
+
+        /**
+         * Reads the stream, frame counter, timestamps and the exposure, gain and laser power metadata of a frame
+         * @param frame the frame
+         * @return the frame info, the dropped frame count is left 0
+         */
+        RealSenseFrameInfo toFrameInfo(const rs2::frame& frame);
+
+        /**
+         * Escapes quotes, backslashes and control characters so the text can be stored in a JSON string
+         * @param text the text to escape
+         * @return the escaped text
+         */
+        std::string escapeJSON(const std::string& text);
+    }
+}
@@ -0,0 +1,203 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedeprojection.h"
+#include "realsenseconversion.h"
+
+#include <rs.hpp>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+namespace nap
+{
+    namespace realsense
+    {
+        glm::vec3 deprojectPixelToPoint(const RealSenseCameraIntrincics& intrinsics, const glm::vec2& pixel, float depth)
+        {
+            const float* coeffs = intrinsics.mCoeffs;
+            float x = (pixel.x - intrinsics.mPPX) / intrinsics.mFX;
+            float y = (pixel.y - intrinsics.mPPY) / intrinsics.mFY;
+
+            float xo = x;
+            float yo = y;
+
+            if(intrinsics.mModel == RS2_DISTORTION_INVERSE_BROWN_CONRADY)
+            {
+                // need to loop until convergence
+                // 10 iterations determined empirically
+                for(int i = 0; i < 10; i++)
+                {
+                    float r2 = x * x + y * y;
+                    float icdist = 1.0f / (1.0f + ((coeffs[4] * r2 + coeffs[1]) * r2 + coeffs[0]) * r2);
+                    float xq = x / icdist;
+                    float yq = y / icdist;
+                    float delta_x = 2 * coeffs[2] * xq * yq + coeffs[3] * (r2 + 2 * xq * xq);
+                    float delta_y = 2 * coeffs[3] * xq * yq + coeffs[2] * (r2 + 2 * yq * yq);
+                    x = (xo - delta_x) * icdist;
+                    y = (yo - delta_y) * icdist;
+                }
+            }
+            else if(intrinsics.mModel == RS2_DISTORTION_BROWN_CONRADY)
+            {
+                // need to loop until convergence
+                // 10 iterations determined empirically
+                for(int i = 0; i < 10; i++)
+                {
+                    float r2 = x * x + y * y;
+                    float icdist = 1.0f / (1.0f + ((coeffs[4] * r2 + coeffs[1]) * r2 + coeffs[0]) * r2);
+                    float delta_x = 2 * coeffs[2] * x * y + coeffs[3] * (r2 + 2 * x * x);
+                    float delta_y = 2 * coeffs[3] * x * y + coeffs[2] * (r2 + 2 * y * y);
+                    x = (xo - delta_x) * icdist;
+                    y = (yo - delta_y) * icdist;
+                }
+            }
+            else if(intrinsics.mModel == RS2_DISTORTION_KANNALA_BRANDT4)
+            {
+                float rd = std::max(std::sqrt(x * x + y * y), 0.00001f);
+                float theta = rd;
+                float theta2 = rd * rd;
+                for(int i = 0; i < 4; i++)
+                {
+                    float f = theta * (1 + theta2 * (coeffs[0] + theta2 * (coeffs[1] + theta2 * (coeffs[2] + theta2 * coeffs[3])))) - rd;
+                    if(std::abs(f) < 0.00001f)
+                        break;
+
+                    float df = 1 + theta2 * (3 * coeffs[0] + theta2 * (5 * coeffs[1] + theta2 * (7 * coeffs[2] + 9 * theta2 * coeffs[3])));
+                    theta -= f / df;
+                    theta2 = theta * theta;
+                }
+                float r = std::tan(theta);
+                x *= r / rd;
+                y *= r / rd;
+            }
+            else if(intrinsics.mModel == RS2_DISTORTION_FTHETA)
+            {
+                float rd = std::max(std::sqrt(x * x + y * y), 0.00001f);
+                float r = std::tan(coeffs[0] * rd) / std::atan(2 * std::tan(coeffs[0] / 2.0f));
+                x *= r / rd;
+                y *= r / rd;
+            }
+
+            return { depth * x, depth * y, depth };
+        }
+
+
+        glm::vec2 projectPointToPixel(const RealSenseCameraIntrincics& intrinsics, const glm::vec3& point)
+        {
+            const float* coeffs = intrinsics.mCoeffs;
+            float x = point.x / point.z;
+            float y = point.y / point.z;
+
+            if(intrinsics.mModel == RS2_DISTORTION_MODIFIED_BROWN_CONRADY ||
+               intrinsics.mModel == RS2_DISTORTION_INVERSE_BROWN_CONRADY)
+            {
+                float r2 = x * x + y * y;
+                float f = 1 + coeffs[0] * r2 + coeffs[1] * r2 * r2 + coeffs[4] * r2 * r2 * r2;
+                x *= f;
+                y *= f;
+                float dx = x + 2 * coeffs[2] * x * y + coeffs[3] * (r2 + 2 * x * x);
+                float dy = y + 2 * coeffs[3] * x * y + coeffs[2] * (r2 + 2 * y * y);
+                x = dx;
+                y = dy;
+            }
+            else if(intrinsics.mModel == RS2_DISTORTION_BROWN_CONRADY)
+            {
+                float r2 = x * x + y * y;
+                float f = 1 + coeffs[0] * r2 + coeffs[1] * r2 * r2 + coeffs[4] * r2 * r2 * r2;
+                float dx = x * f + 2 * coeffs[2] * x * y + coeffs[3] * (r2 + 2 * x * x);
+                float dy = y * f + 2 * coeffs[3] * x * y + coeffs[2] * (r2 + 2 * y * y);
+                x = dx;
+                y = dy;
+            }
+            else if(intrinsics.mModel == RS2_DISTORTION_FTHETA)
+            {
+                float r = std::max(std::sqrt(x * x + y * y), FLT_EPSILON);
+                float rd = 1.0f / coeffs[0] * std::atan(2 * r * std::tan(coeffs[0] / 2.0f));
+                x *= rd / r;
+                y *= rd / r;
+            }
+            else if(intrinsics.mModel == RS2_DISTORTION_KANNALA_BRANDT4)
+            {
+                float r = std::max(std::sqrt(x * x + y * y), FLT_EPSILON);
+                float theta = std::atan(r);
+                float theta2 = theta * theta;
+                float series = 1 + theta2 * (coeffs[0] + theta2 * (coeffs[1] + theta2 * (coeffs[2] + theta2 * coeffs[3])));
+                float rd = theta * series;
+                x *= rd / r;
+                y *= rd / r;
+            }
+
+            return { x * intrinsics.mFX + intrinsics.mPPX, y * intrinsics.mFY + intrinsics.mPPY };
+        }
+
+
+        glm::vec3 transformPoint(const RealSenseCameraExtrinsics& extrinsics, const glm::vec3& point)
+        {
+            const float* r = extrinsics.mRotation;
+            const float* t = extrinsics.mTranslation;
+            return { r[0] * point.x + r[3] * point.y + r[6] * point.z + t[0],
+                     r[1] * point.x + r[4] * point.y + r[7] * point.z + t[1],
+                     r[2] * point.x + r[5] * point.y + r[8] * point.z + t[2] };
+        }
+
+
+        bool hasProjectionDistortion(const RealSenseCameraIntrincics& intrinsics)
+        {
+            if(intrinsics.mModel == RS2_DISTORTION_NONE)
+                return false;
+
+            for(float coeff : intrinsics.mCoeffs)
+            {
+                if(coeff != 0.0f)
+                    return true;
+            }
+            return false;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDeprojectionMap
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseDeprojectionMap::update(const RealSenseCameraIntrincics& intrinsics, const glm::vec2& offset)
+    {
+        mIntrinsics = intrinsics;
+        mOffset = offset;
+        mProfileID = -1;
+
+        size_t count = static_cast<size_t>(intrinsics.mWidth) * static_cast<size_t>(intrinsics.mHeight);
+        mX.resize(count);
+        mY.resize(count);
+        for(int y = 0; y < intrinsics.mHeight; y++)
+        {
+            for(int x = 0; x < intrinsics.mWidth; x++)
+            {
+                glm::vec2 pixel = { static_cast<float>(x) + offset.x, static_cast<float>(y) + offset.y };
+                glm::vec3 ray = realsense::deprojectPixelToPoint(intrinsics, pixel, 1.0f);
+                size_t index = static_cast<size_t>(y) * intrinsics.mWidth + x;
+                mX[index] = ray.x;
+                mY[index] = ray.y;
+            }
+        }
+    }
+
+
+    bool RealSenseDeprojectionMap::update(const rs2::video_stream_profile& profile)
+    {
+        if(profile.unique_id() == mProfileID)
+            return false;
+
+        update(realsense::toIntrinsics(profile.get_intrinsics()));
+        mProfileID = profile.unique_id();
+        return true;
+    }
+
+
+    bool RealSenseDeprojectionMap::matches(const RealSenseCameraIntrincics& intrinsics, const glm::vec2& offset) const
+    {
+        return !mX.empty() && offset.x == mOffset.x && offset.y == mOffset.y &&
+            std::memcmp(&intrinsics, &mIntrinsics, sizeof(RealSenseCameraIntrincics)) == 0;
+    }
+}
@@ -0,0 +1,120 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Local includes
+#include "realsensetypes.h"
+
+// forward declares
+namespace rs2
+{
+    class video_stream_profile;
+}
+
+namespace nap
+{
+    namespace realsense
+    {
+        /**
+         * Computes the 3D point in meters of a pixel with the given depth, relative to the camera.
+         * Same math as deproject_pixel_to_point in the pointcloud vertex shader and rs2_deproject_pixel_to_point.
+         * @param intrinsics the camera intrinsics
+         * @param pixel pixel coordinates
+         * @param depth depth in meters
+         * @return 3D point relative to the camera
+         */
+        NAPAPI glm::vec3 deprojectPixelToPoint(const RealSenseCameraIntrincics& intrinsics, const glm::vec2& pixel, float depth);
+
+        /**
+         * Computes the pixel coordinates of a 3D point relative to the camera, same math as rs2_project_point_to_pixel
+         * @param intrinsics the camera intrinsics
+         * @param point 3D point relative to the camera
+         * @return pixel coordinates
+         */
+        NAPAPI glm::vec2 projectPointToPixel(const RealSenseCameraIntrincics& intrinsics, const glm::vec3& point);
+
+        /**
+         * Transforms a point from one camera to another
+         * @param extrinsics extrinsics from the source to the target camera
+         * @param point point relative to the source camera
+         * @return point relative to the target camera
+         */
+        NAPAPI glm::vec3 transformPoint(const RealSenseCameraExtrinsics& extrinsics, const glm::vec3& point);
+
+        /**
+         * @return true if projecting with the given intrinsics requires distortion, false if projection is a pinhole projection
+         */
+        NAPAPI bool hasProjectionDistortion(const RealSenseCameraIntrincics& intrinsics);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseDeprojectionMap
+     * Caches the undistorted ray of every pixel of a camera stream, a 3D point is the ray multiplied by the depth in meters.
+     * The rays are stored as separate x and y planes (z is always 1) so per-frame kernels vectorize.
+     * Rebuilding the map is only required when the intrinsics change.
+     */
+    class NAPAPI RealSenseDeprojectionMap final
+    {
+    public:
+        /**
+         * Computes the rays for every pixel, offset from the pixel coordinate
+         * @param intrinsics the camera intrinsics
+         * @param offset sub-pixel offset applied to every pixel coordinate, for example -0.5 for the top left pixel corner
+         */
+        void update(const RealSenseCameraIntrincics& intrinsics, const glm::vec2& offset = { 0.0f, 0.0f });
+
+        /**
+         * Computes the rays for the intrinsics of the given stream profile, only when the profile differs from the previous call.
+         * Frame callbacks call this for every frame, the rays are rebuilt when the stream is restarted or reconfigured.
+         * @param profile the video stream profile of the frame
+         * @return true if the rays were rebuilt
+         */
+        bool update(const rs2::video_stream_profile& profile);
+
+        /**
+         * @return true if the map was created for the given intrinsics and offset
+         */
+        bool matches(const RealSenseCameraIntrincics& intrinsics, const glm::vec2& offset = { 0.0f, 0.0f }) const;
+
+        /**
+         * @return x component of the rays, row major
+         */
+        const float* getX() const                   { return mX.data(); }
+
+        /**
+         * @return y component of the rays, row major
+         */
+        const float* getY() const                   { return mY.data(); }
+
+        /**
+         * @return width of the map in pixels
+         */
+        int getWidth() const                        { return mIntrinsics.mWidth; }
+
+        /**
+         * @return height of the map in pixels
+         */
+        int getHeight() const                       { return mIntrinsics.mHeight; }
+
+        /**
+         * @return the intrinsics the map was created for
+         */
+        const RealSenseCameraIntrincics& getIntrinsics() const { return mIntrinsics; }
+
+    private:
+        RealSenseCameraIntrincics mIntrinsics = {};
+        glm::vec2 mOffset = { 0.0f, 0.0f };
+        int mProfileID = -1;                        ///< Unique id of the stream profile the rays were computed for, -1 when set from intrinsics
+        std::vector<float> mX;
+        std::vector<float> mY;
+    };
+}
@@ -0,0 +1,193 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedepthcodec.h"
+
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+namespace nap
+{
+    namespace realsense
+    {
+        //////////////////////////////////////////////////////////////////////////
+        // Static functions
+        //////////////////////////////////////////////////////////////////////////
+
+        /**
+         * Writes variable length values as 4 bit nibbles, 3 value bits and a continuation bit, packed into 32 bit words
+         */
+        struct NibbleWriter
+        {
+            uint32* mOutput;
+            uint32 mWord = 0;
+            int mNibbles = 0;
+
+            void write(uint32 value)
+            {
+                do
+                {
+                    uint32 nibble = value & 0x7;
+                    value >>= 3;
+                    if(value != 0)
+                        nibble |= 0x8;
+
+                    mWord = (mWord << 4) | nibble;
+                    if(++mNibbles == 8)
+                    {
+                        *mOutput++ = mWord;
+                        mNibbles = 0;
+                        mWord = 0;
+                    }
+                }
+                while(value != 0);
+            }
+
+            void flush()
+            {
+                if(mNibbles != 0)
+                    *mOutput++ = mWord << (4 * (8 - mNibbles));
+            }
+        };
+
+
+        /**
+         * Reads values written by the NibbleWriter, fails instead of reading past the end of the input
+         */
+        struct NibbleReader
+        {
+            const uint8* mInput;
+            const uint8* mEnd;
+            uint32 mWord = 0;
+            int mNibbles = 0;
+
+            bool read(uint32& value)
+            {
+                value = 0;
+                int shift = 0;
+                uint32 nibble;
+                do
+                {
+                    if(mNibbles == 0)
+                    {
+                        if(mEnd - mInput < 4)
+                            return false;
+
+                        std::memcpy(&mWord, mInput, sizeof(uint32));
+                        mInput += 4;
+                        mNibbles = 8;
+                    }
+
+                    // 32 bit values need at most 11 nibbles
+                    if(shift > 30)
+                        return false;
+
+                    nibble = mWord >> 28;
+                    value |= (nibble & 0x7) << shift;
+                    mWord <<= 4;
+                    mNibbles--;
+                    shift += 3;
+                }
+                while(nibble & 0x8);
+                return true;
+            }
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        // RVL
+        //////////////////////////////////////////////////////////////////////////
+
+        size_t getRVLBound(int count)
+        {
+            // worst case every pixel is a zero run of 0, a run of 1 and a 17 bit delta: 8 nibbles
+            return static_cast<size_t>(count) * 4 + 8;
+        }
+
+
+        size_t compressRVL(const uint16* input, int count, uint8* output)
+        {
+            // output is not required to be 4 byte aligned, words are assembled in place when it is not
+            NibbleWriter writer;
+            std::vector<uint32> unaligned;
+            if(reinterpret_cast<uintptr_t>(output) % alignof(uint32) == 0)
+            {
+                writer.mOutput = reinterpret_cast<uint32*>(output);
+            }
+            else
+            {
+                unaligned.resize(getRVLBound(count) / 4);
+                writer.mOutput = unaligned.data();
+            }
+            uint32* begin = writer.mOutput;
+
+            const uint16* end = input + count;
+            int32 previous = 0;
+            while(input != end)
+            {
+                uint32 zeros = 0;
+                for(; input != end && *input == 0; input++)
+                    zeros++;
+                writer.write(zeros);
+
+                uint32 nonzeros = 0;
+                for(const uint16* it = input; it != end && *it != 0; it++)
+                    nonzeros++;
+                writer.write(nonzeros);
+
+                for(uint32 i = 0; i < nonzeros; i++)
+                {
+                    int32 current = *input++;
+                    int32 delta = current - previous;
+                    writer.write(static_cast<uint32>((delta << 1) ^ (delta >> 31)));
+                    previous = current;
+                }
+            }
+            writer.flush();
+
+            size_t size = (writer.mOutput - begin) * sizeof(uint32);
+            if(!unaligned.empty())
+                std::memcpy(output, unaligned.data(), size);
+            return size;
+        }
+
+
+        bool decompressRVL(const uint8* input, size_t size, uint16* output, int count)
+        {
+            NibbleReader reader;
+            reader.mInput = input;
+            reader.mEnd = input + size;
+
+            int32 previous = 0;
+            uint32 remaining = static_cast<uint32>(count);
+            while(remaining > 0)
+            {
+                uint32 zeros;
+                if(!reader.read(zeros) || zeros > remaining)
+                    return false;
+
+                std::memset(output, 0, zeros * sizeof(uint16));
+                output += zeros;
+                remaining -= zeros;
+
+                uint32 nonzeros;
+                if(!reader.read(nonzeros) || nonzeros > remaining)
+                    return false;
+
+                for(uint32 i = 0; i < nonzeros; i++)
+                {
+                    uint32 positive;
+                    if(!reader.read(positive))
+                        return false;
+
+                    int32 delta = static_cast<int32>(positive >> 1) ^ -static_cast<int32>(positive & 1);
+                    previous += delta;
+                    *output++ = static_cast<uint16>(previous);
+                }
+                remaining -= nonzeros;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <cstddef>
+
+namespace nap
+{
+    namespace realsense
+    {
+        /**
+         * Returns the maximum size in bytes of count RVL compressed depth values
+         * @param count amount of depth values
+         * @return maximum compressed size in bytes
+         */
+        NAPAPI size_t getRVLBound(int count);
+
+        /**
+         * Losslessly compresses 16 bit depth values with RVL (run length of zeros and variable length deltas, A. Wilson 2017).
+         * Runs of invalid (zero) depth cost a few bits and the deltas between neighbouring pixels are small, a typical depth frame compresses 3 to 5 times.
+         * @param input depth values
+         * @param count amount of depth values
+         * @param output receives the compressed data, must hold at least getRVLBound(count) bytes
+         * @return size of the compressed data in bytes, always a multiple of 4
+         */
+        NAPAPI size_t compressRVL(const uint16* input, int count, uint8* output);
+
+        /**
+         * Decompresses RVL compressed depth values
+         * @param input compressed data
+         * @param size size of the compressed data in bytes
+         * @param output receives the depth values
+         * @param count amount of depth values to decompress
+         * @return false if the data is corrupt or does not hold count values
+         */
+        NAPAPI bool decompressRVL(const uint8* input, size_t size, uint16* output, int count);
+    }
+}
@@ -0,0 +1,185 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedepthcolorizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define REALSENSE_COLORIZER_X64
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Control points of the jet color map, near is blue, far is dark red
+     */
+    static const float sColorMap[][3] =
+    {
+        { 0.0f, 0.0f, 255.0f },
+        { 0.0f, 255.0f, 255.0f },
+        { 255.0f, 255.0f, 0.0f },
+        { 255.0f, 0.0f, 0.0f },
+        { 50.0f, 0.0f, 0.0f }
+    };
+
+
+    static uint32 packRGBA(float r, float g, float b)
+    {
+        return static_cast<uint32>(r) |
+               (static_cast<uint32>(g) << 8) |
+               (static_cast<uint32>(b) << 16) |
+               (uint32(255) << 24);
+    }
+
+
+    static uint32 sampleColorMap(float t)
+    {
+        constexpr int segments = sizeof(sColorMap) / sizeof(sColorMap[0]) - 1;
+        t = std::max(0.0f, std::min(1.0f, t)) * static_cast<float>(segments);
+        int index = std::min(static_cast<int>(t), segments - 1);
+        float blend = t - static_cast<float>(index);
+        const float* a = sColorMap[index];
+        const float* b = sColorMap[index + 1];
+        return packRGBA(a[0] + (b[0] - a[0]) * blend,
+                        a[1] + (b[1] - a[1]) * blend,
+                        a[2] + (b[2] - a[2]) * blend);
+    }
+
+
+    static void colorizeScalar(const uint16* depth, uint32* rgba, size_t count, const uint32* table)
+    {
+        size_t i = 0;
+        for(; i + 4 <= count; i += 4)
+        {
+            rgba[i + 0] = table[depth[i + 0]];
+            rgba[i + 1] = table[depth[i + 1]];
+            rgba[i + 2] = table[depth[i + 2]];
+            rgba[i + 3] = table[depth[i + 3]];
+        }
+        for(; i < count; i++)
+            rgba[i] = table[depth[i]];
+    }
+
+
+#ifdef REALSENSE_COLORIZER_X64
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((target("avx2")))
+#endif
+    static void colorizeAVX2(const uint16* depth, uint32* rgba, size_t count, const uint32* table)
+    {
+        const auto* lut = reinterpret_cast<const int*>(table);
+        size_t i = 0;
+        for(; i + 16 <= count; i += 16)
+        {
+            __m256i depth_16 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(depth + i));
+            __m256i index_lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(depth_16));
+            __m256i index_hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(depth_16, 1));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i), _mm256_i32gather_epi32(lut, index_lo, 4));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i + 8), _mm256_i32gather_epi32(lut, index_hi, 4));
+        }
+        colorizeScalar(depth + i, rgba + i, count - i, table);
+    }
+
+
+    static bool hasAVX2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthColorizer
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDepthColorizer::RealSenseDepthColorizer() :
+        mLookupTable(sTableSize, 0), mHistogram(sTableSize, 0)
+    {
+        updateLookupTable();
+    }
+
+
+    void RealSenseDepthColorizer::setRange(float minDistance, float maxDistance, float depthScale)
+    {
+        float max_value = static_cast<float>(sTableSize - 1);
+        float min_depth = depthScale > 0.0f ? minDistance / depthScale : 0.0f;
+        float max_depth = depthScale > 0.0f ? maxDistance / depthScale : max_value;
+        mMinDepth = static_cast<uint16>(std::max(1.0f, std::min(min_depth, max_value)));
+        mMaxDepth = static_cast<uint16>(std::max(static_cast<float>(mMinDepth), std::min(max_depth, max_value)));
+    }
+
+
+    void RealSenseDepthColorizer::accumulate(const uint16* depth, size_t count, int step)
+    {
+        if(!mEqualize)
+            return;
+
+        step = std::max(1, step);
+        for(size_t i = 0; i < count; i += step)
+            mHistogram[depth[i]]++;
+    }
+
+
+    void RealSenseDepthColorizer::updateLookupTable()
+    {
+        // zero depth is invalid and always black
+        mLookupTable[0] = packRGBA(0.0f, 0.0f, 0.0f);
+
+        if(mEqualize)
+        {
+            // cumulative histogram of valid depth values within range
+            uint64 total = 0;
+            for(int i = mMinDepth; i <= mMaxDepth; i++)
+                total += mHistogram[i];
+
+            if(total > 0)
+            {
+                uint64 accumulated = 0;
+                for(int i = 1; i < sTableSize; i++)
+                {
+                    if(i >= mMinDepth && i <= mMaxDepth)
+                        accumulated += mHistogram[i];
+                    mLookupTable[i] = sampleColorMap(static_cast<float>(static_cast<double>(accumulated) / static_cast<double>(total)));
+                }
+                std::fill(mHistogram.begin(), mHistogram.end(), 0);
+                return;
+            }
+        }
+
+        // linear mapping of depth range
+        float range = static_cast<float>(std::max(1, mMaxDepth - mMinDepth));
+        for(int i = 1; i < sTableSize; i++)
+            mLookupTable[i] = sampleColorMap(static_cast<float>(i - mMinDepth) / range);
+        std::fill(mHistogram.begin(), mHistogram.end(), 0);
+    }
+
+
+    void RealSenseDepthColorizer::colorize(const uint16* depth, uint32* rgba, size_t count) const
+    {
+#ifdef REALSENSE_COLORIZER_X64
+        static const bool avx2 = hasAVX2();
+        if(avx2)
+        {
+            colorizeAVX2(depth, rgba, count, mLookupTable.data());
+            return;
+        }
+#endif
+        colorizeScalar(depth, rgba, count, mLookupTable.data());
+    }
+}
@@ -0,0 +1,86 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseDepthColorizer
+     * Maps 16 bit depth values to RGBA8 colors through a precomputed 64K entry lookup table.
+     * The lookup table maps the depth range onto a jet color map, either linearly or histogram equalized.
+     * When histogram equalization is enabled the histogram is accumulated from a subset of the pixels of every frame,
+     * call updateLookupTable() every couple of frames to rebuild the table from the accumulated histogram.
+     * Uses AVX2 gather instructions when supported by the CPU.
+     */
+    class NAPAPI RealSenseDepthColorizer final
+    {
+    public:
+        static constexpr int sTableSize = 65536; ///< Amount of entries in the lookup table, one for every 16 bit depth value
+
+        /**
+         * Constructor, creates a linear lookup table for the default range
+         */
+        RealSenseDepthColorizer();
+
+        /**
+         * Sets the depth range that is mapped onto the color map, depth outside this range is clamped
+         * @param minDistance minimum distance in meters
+         * @param maxDistance maximum distance in meters
+         * @param depthScale depth units of the depth frames in meters
+         */
+        void setRange(float minDistance, float maxDistance, float depthScale);
+
+        /**
+         * Enables or disables histogram equalization, takes effect after the next call to updateLookupTable()
+         * @param enable true to enable histogram equalization
+         */
+        void setHistogramEqualization(bool enable)                  { mEqualize = enable; }
+
+        /**
+         * @return if histogram equalization is enabled
+         */
+        bool getHistogramEqualization() const                       { return mEqualize; }
+
+        /**
+         * Accumulates every n-th depth value into the histogram, only when histogram equalization is enabled
+         * @param depth depth values
+         * @param count amount of depth values
+         * @param step accumulate every n-th depth value
+         */
+        void accumulate(const uint16* depth, size_t count, int step);
+
+        /**
+         * Rebuilds the lookup table from the depth range and, when equalization is enabled, the accumulated histogram.
+         * Clears the accumulated histogram.
+         */
+        void updateLookupTable();
+
+        /**
+         * Maps depth values to RGBA8 colors
+         * @param depth depth values
+         * @param rgba output colors, one 32 bit RGBA8 value per depth value
+         * @param count amount of depth values
+         */
+        void colorize(const uint16* depth, uint32* rgba, size_t count) const;
+
+        /**
+         * @return the lookup table, one RGBA8 value for every 16 bit depth value
+         */
+        const std::vector<uint32>& getLookupTable() const           { return mLookupTable; }
+
+    private:
+        std::vector<uint32> mLookupTable;
+        std::vector<uint32> mHistogram;
+        uint16 mMinDepth = 0;
+        uint16 mMaxDepth = sTableSize - 1;
+        bool mEqualize = true;
+    };
+}
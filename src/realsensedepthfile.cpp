@@ -0,0 +1,426 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedepthfile.h"
+#include "realsensedepthcodec.h"
+#include "realsenseworkerpool.h"
+
+#include <nap/logger.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static functions
+    //////////////////////////////////////////////////////////////////////////
+
+    static_assert(sizeof(RealSenseDepthFileHeader) == 64, "depth file header layout changed");
+
+    static constexpr uint32 sChunkMagic = 0x4b4e4843;      // 'CHNK'
+    static constexpr uint32 sIndexMagic = 0x58444e49;      // 'INDX'
+    static constexpr uint32 sFooterMagic = 0x45445352;     // 'RSDE'
+    static constexpr uint64 sMaxChunkSize = 1ull << 30;
+
+    /**
+     * Header in front of every chunk
+     */
+    struct ChunkHeader
+    {
+        uint32 mMagic;
+        uint32 mFrameCount;
+        uint64 mSize;
+    };
+
+    /**
+     * Last bytes of a file with index
+     */
+    struct Footer
+    {
+        uint64 mIndexOffset;
+        uint32 mMagic;
+        uint32 mReserved;
+    };
+
+
+    /**
+     * Appends the bytes of a value
+     */
+    template<typename T>
+    static void append(std::vector<uint8>& buffer, const T& value)
+    {
+        const auto* bytes = reinterpret_cast<const uint8*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+
+    /**
+     * Reads a value at position, advances position, returns false when out of bounds
+     */
+    template<typename T>
+    static bool extract(const std::vector<uint8>& buffer, size_t& position, T& value)
+    {
+        if(buffer.size() - position < sizeof(T))
+            return false;
+
+        std::memcpy(&value, buffer.data() + position, sizeof(T));
+        position += sizeof(T);
+        return true;
+    }
+
+
+    /**
+     * Reads a value from a stream
+     */
+    template<typename T>
+    static bool extract(std::ifstream& file, T& value)
+    {
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return static_cast<bool>(file);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthFileFrame
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseDepthFileFrame::encode(const uint16* depth, int width, int height, int bands, RealSenseWorkerPool* pool)
+    {
+        bands = std::max(1, std::min(bands, height));
+        size_t band_bound = realsense::getRVLBound(width * (height / bands + 1));
+
+        // compress every band into its own region of the data buffer, then close the gaps
+        mData.resize(band_bound * bands);
+        mBandSizes.resize(bands);
+        auto compress = [&](int band)
+        {
+            int begin = height * band / bands;
+            int end = height * (band + 1) / bands;
+            mBandSizes[band] = static_cast<uint32>(realsense::compressRVL(depth + begin * width, (end - begin) * width,
+                                                                          mData.data() + band * band_bound));
+        };
+
+        RealSenseWorkerPool::parallelFor(pool, bands, compress);
+
+        size_t size = mBandSizes[0];
+        for(int band = 1; band < bands; band++)
+        {
+            std::memmove(mData.data() + size, mData.data() + band * band_bound, mBandSizes[band]);
+            size += mBandSizes[band];
+        }
+        mData.resize(size);
+    }
+
+
+    bool RealSenseDepthFileFrame::decode(uint16* depth, int width, int height, RealSenseWorkerPool* pool) const
+    {
+        int bands = static_cast<int>(mBandSizes.size());
+        if(bands == 0 || bands > height)
+            return false;
+
+        std::vector<size_t> offsets(bands);
+        size_t size = 0;
+        for(int band = 0; band < bands; band++)
+        {
+            offsets[band] = size;
+            size += mBandSizes[band];
+        }
+        if(size > mData.size())
+            return false;
+
+        std::atomic<bool> valid = { true };
+        auto decompress = [&](int band)
+        {
+            int begin = height * band / bands;
+            int end = height * (band + 1) / bands;
+            if(!realsense::decompressRVL(mData.data() + offsets[band], mBandSizes[band], depth + begin * width, (end - begin) * width))
+                valid = false;
+        };
+
+        RealSenseWorkerPool::parallelFor(pool, bands, decompress);
+
+        return valid.load();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthFileWriter
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDepthFileWriter::~RealSenseDepthFileWriter()
+    {
+        utility::ErrorState error_state;
+        close(error_state);
+    }
+
+
+    bool RealSenseDepthFileWriter::open(const std::string& path, const RealSenseDepthFileHeader& header, int chunkFrames, utility::ErrorState& errorState)
+    {
+        if(!close(errorState))
+            return false;
+
+        mFile.open(path, std::ios::binary | std::ios::trunc);
+        if(!errorState.check(mFile.is_open(), "Unable to create depth recording %s", path.c_str()))
+            return false;
+
+        mPath = path;
+        mChunkFrames = std::max(1, chunkFrames);
+        mChunkFrameCount = 0;
+        mChunk.clear();
+        mIndex.clear();
+        mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        mBytesWritten = sizeof(header);
+        return errorState.check(static_cast<bool>(mFile), "Unable to write to depth recording %s", path.c_str());
+    }
+
+
+    bool RealSenseDepthFileWriter::write(const RealSenseDepthFileFrame& frame, utility::ErrorState& errorState)
+    {
+        if(!errorState.check(mFile.is_open(), "Depth recording is not open"))
+            return false;
+
+        if(mChunkFrameCount == 0)
+            mChunkTimestamp = frame.mTimestamp;
+
+        append(mChunk, frame.mFrameNumber);
+        append(mChunk, frame.mTimestamp);
+        append(mChunk, static_cast<uint32>(frame.mBandSizes.size()));
+        for(auto size : frame.mBandSizes)
+            append(mChunk, size);
+        mChunk.insert(mChunk.end(), frame.mData.begin(), frame.mData.end());
+
+        if(++mChunkFrameCount < static_cast<uint32>(mChunkFrames))
+            return true;
+
+        return flushChunk(errorState);
+    }
+
+
+    bool RealSenseDepthFileWriter::close(utility::ErrorState& errorState)
+    {
+        if(!mFile.is_open())
+            return true;
+
+        bool success = flushChunk(errorState);
+
+        // index and footer
+        std::vector<uint8> index;
+        append(index, sIndexMagic);
+        append(index, static_cast<uint32>(mIndex.size()));
+        for(const auto& entry : mIndex)
+        {
+            append(index, entry.mOffset);
+            append(index, entry.mTimestamp);
+        }
+        append(index, Footer{ mBytesWritten, sFooterMagic, 0 });
+        mFile.write(reinterpret_cast<const char*>(index.data()), index.size());
+        mBytesWritten += index.size();
+
+        success = errorState.check(static_cast<bool>(mFile), "Unable to write index of depth recording %s", mPath.c_str()) && success;
+        mFile.close();
+        return success;
+    }
+
+
+    bool RealSenseDepthFileWriter::flushChunk(utility::ErrorState& errorState)
+    {
+        if(mChunkFrameCount == 0)
+            return true;
+
+        mIndex.push_back({ mBytesWritten, mChunkTimestamp });
+        ChunkHeader header = { sChunkMagic, mChunkFrameCount, mChunk.size() };
+        mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        mFile.write(reinterpret_cast<const char*>(mChunk.data()), mChunk.size());
+        mBytesWritten += sizeof(header) + mChunk.size();
+
+        mChunk.clear();
+        mChunkFrameCount = 0;
+        return errorState.check(static_cast<bool>(mFile), "Unable to write to depth recording %s", mPath.c_str());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthFileReader
+    //////////////////////////////////////////////////////////////////////////
+
+    bool RealSenseDepthFileReader::open(const std::string& path, utility::ErrorState& errorState)
+    {
+        mFile.close();
+        mFile.clear();
+        mFile.open(path, std::ios::binary);
+        if(!errorState.check(mFile.is_open(), "Unable to open depth recording %s", path.c_str()))
+            return false;
+
+        mPath = path;
+        mIndex.clear();
+        mCurrentChunk = -1;
+        RealSenseDepthFileHeader expected;
+        if(!errorState.check(extract(mFile, mHeader) && std::memcmp(mHeader.mMagic, expected.mMagic, sizeof(expected.mMagic)) == 0,
+                             "%s is not a depth recording", path.c_str()))
+            return false;
+
+        if(!errorState.check(mHeader.mVersion == expected.mVersion, "%s: unsupported depth recording version %d", path.c_str(), mHeader.mVersion))
+            return false;
+
+        if(!errorState.check(mHeader.mWidth > 0 && mHeader.mHeight > 0, "%s: invalid frame size", path.c_str()))
+            return false;
+
+        return buildIndex(errorState);
+    }
+
+
+    double RealSenseDepthFileReader::getStartTimestamp() const
+    {
+        return mIndex.empty() ? 0.0 : mIndex.front().mTimestamp;
+    }
+
+
+    bool RealSenseDepthFileReader::seek(double timestamp, utility::ErrorState& errorState)
+    {
+        if(mIndex.empty())
+            return true;
+
+        // last chunk starting at or before timestamp
+        auto it = std::upper_bound(mIndex.begin(), mIndex.end(), timestamp,
+                                   [](double value, const IndexEntry& entry) { return value < entry.mTimestamp; });
+        int chunk = it == mIndex.begin() ? 0 : static_cast<int>(it - mIndex.begin()) - 1;
+        if(!loadChunk(chunk, errorState))
+            return false;
+
+        // skip frames before timestamp
+        while(mChunkFrame < mChunkFrameCount)
+        {
+            size_t position = mChunkPosition;
+            uint64 number;
+            double frame_timestamp;
+            if(!errorState.check(extract(mChunk, position, number) && extract(mChunk, position, frame_timestamp),
+                                 "%s: corrupt chunk %d", mPath.c_str(), chunk))
+                return false;
+
+            if(frame_timestamp >= timestamp)
+                return true;
+
+            RealSenseDepthFileFrame frame;
+            if(!read(frame, errorState))
+                return false;
+        }
+        return true;
+    }
+
+
+    bool RealSenseDepthFileReader::read(RealSenseDepthFileFrame& frame, utility::ErrorState& errorState)
+    {
+        // next chunk
+        while(mCurrentChunk < 0 || mChunkFrame >= mChunkFrameCount)
+        {
+            if(mCurrentChunk + 1 >= static_cast<int>(mIndex.size()))
+                return false;
+
+            if(!loadChunk(mCurrentChunk + 1, errorState))
+                return false;
+        }
+
+        uint32 bands;
+        if(!errorState.check(extract(mChunk, mChunkPosition, frame.mFrameNumber) &&
+                             extract(mChunk, mChunkPosition, frame.mTimestamp) &&
+                             extract(mChunk, mChunkPosition, bands) &&
+                             bands > 0 && bands <= static_cast<uint32>(mHeader.mHeight),
+                             "%s: corrupt frame in chunk %d", mPath.c_str(), mCurrentChunk))
+            return false;
+
+        frame.mBandSizes.resize(bands);
+        uint64 size = 0;
+        for(auto& band_size : frame.mBandSizes)
+        {
+            if(!errorState.check(extract(mChunk, mChunkPosition, band_size), "%s: corrupt frame in chunk %d", mPath.c_str(), mCurrentChunk))
+                return false;
+            size += band_size;
+        }
+
+        if(!errorState.check(size <= mChunk.size() - mChunkPosition, "%s: corrupt frame in chunk %d", mPath.c_str(), mCurrentChunk))
+            return false;
+
+        frame.mData.assign(mChunk.begin() + mChunkPosition, mChunk.begin() + mChunkPosition + size);
+        mChunkPosition += size;
+        mChunkFrame++;
+        return true;
+    }
+
+
+    bool RealSenseDepthFileReader::isEnd() const
+    {
+        return mIndex.empty() || (mCurrentChunk + 1 >= static_cast<int>(mIndex.size()) && mChunkFrame >= mChunkFrameCount);
+    }
+
+
+    bool RealSenseDepthFileReader::loadChunk(int chunk, utility::ErrorState& errorState)
+    {
+        mFile.clear();
+        mFile.seekg(mIndex[chunk].mOffset);
+
+        ChunkHeader header;
+        if(!errorState.check(extract(mFile, header) && header.mMagic == sChunkMagic && header.mSize <= sMaxChunkSize,
+                             "%s: corrupt chunk %d", mPath.c_str(), chunk))
+            return false;
+
+        mChunk.resize(header.mSize);
+        mFile.read(reinterpret_cast<char*>(mChunk.data()), header.mSize);
+        if(!errorState.check(static_cast<bool>(mFile), "%s: truncated chunk %d", mPath.c_str(), chunk))
+            return false;
+
+        mCurrentChunk = chunk;
+        mChunkFrameCount = header.mFrameCount;
+        mChunkFrame = 0;
+        mChunkPosition = 0;
+        return true;
+    }
+
+
+    bool RealSenseDepthFileReader::buildIndex(utility::ErrorState& errorState)
+    {
+        mFile.seekg(0, std::ios::end);
+        uint64 file_size = static_cast<uint64>(mFile.tellg());
+
+        // read the index written on close
+        Footer footer;
+        if(file_size >= sizeof(RealSenseDepthFileHeader) + sizeof(Footer))
+        {
+            mFile.seekg(file_size - sizeof(Footer));
+            uint32 magic, count;
+            if(extract(mFile, footer) && footer.mMagic == sFooterMagic && footer.mIndexOffset < file_size)
+            {
+                mFile.seekg(footer.mIndexOffset);
+                if(extract(mFile, magic) && magic == sIndexMagic && extract(mFile, count) &&
+                   footer.mIndexOffset + 8 + static_cast<uint64>(count) * sizeof(IndexEntry) <= file_size)
+                {
+                    mIndex.resize(count);
+                    bool valid = true;
+                    for(auto& entry : mIndex)
+                        valid = valid && extract(mFile, entry.mOffset) && extract(mFile, entry.mTimestamp);
+                    if(valid)
+                        return true;
+                }
+            }
+        }
+
+        // no index, the recording was not closed: scan the chunks
+        mIndex.clear();
+        mFile.clear();
+        uint64 offset = sizeof(RealSenseDepthFileHeader);
+        while(offset + sizeof(ChunkHeader) + 16 <= file_size)
+        {
+            mFile.seekg(offset);
+            ChunkHeader header;
+            uint64 number;
+            double timestamp;
+            if(!extract(mFile, header) || header.mMagic != sChunkMagic || offset + sizeof(ChunkHeader) + header.mSize > file_size ||
+               !extract(mFile, number) || !extract(mFile, timestamp))
+                break;
+
+            mIndex.push_back({ offset, timestamp });
+            offset += sizeof(ChunkHeader) + header.mSize;
+        }
+        mFile.clear();
+        nap::Logger::warn("%s: depth recording has no index, recovered %d chunks", mPath.c_str(), static_cast<int>(mIndex.size()));
+        return true;
+    }
+}
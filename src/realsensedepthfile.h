@@ -0,0 +1,212 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <utility/errorstate.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseWorkerPool;
+
+    /**
+     * Header of a depth recording, stored at the start of the file
+     */
+    struct NAPAPI RealSenseDepthFileHeader
+    {
+        char mMagic[4] = { 'R', 'S', 'D', 'R' };
+        uint32 mVersion = 1;
+        int32 mWidth = 0;               ///< Width of the depth frames in pixels
+        int32 mHeight = 0;              ///< Height of the depth frames in pixels
+        int32 mFps = 0;                 ///< Frame rate of the recorded stream
+        float mDepthScale = 0.0f;       ///< Meters per depth unit
+        float mPPX = 0.0f;              ///< Horizontal principal point in pixels
+        float mPPY = 0.0f;              ///< Vertical principal point in pixels
+        float mFX = 0.0f;               ///< Horizontal focal length in pixels
+        float mFY = 0.0f;               ///< Vertical focal length in pixels
+        int32 mModel = 0;               ///< ERealSenseDistortionModels
+        float mCoeffs[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; ///< Distortion coefficients
+    };
+
+    /**
+     * A compressed depth frame.
+     * The frame is split in horizontal bands of rows that are compressed independently, so bands are encoded and decoded in parallel.
+     */
+    struct NAPAPI RealSenseDepthFileFrame
+    {
+        uint64 mFrameNumber = 0;        ///< Frame number assigned by librealsense
+        double mTimestamp = 0.0;        ///< Frame timestamp in milliseconds
+        std::vector<uint32> mBandSizes; ///< Compressed size of every band in bytes
+        std::vector<uint8> mData;       ///< Compressed bands, back to back
+
+        /**
+         * Compresses depth values, replaces the bands of this frame
+         * @param depth depth values, row major
+         * @param width width in pixels
+         * @param height height in pixels
+         * @param bands amount of bands to split the frame in
+         * @param pool worker pool to compress the bands on, compresses on the calling thread when null
+         */
+        void encode(const uint16* depth, int width, int height, int bands, RealSenseWorkerPool* pool);
+
+        /**
+         * Decompresses the bands of this frame
+         * @param depth receives the depth values, must hold width * height values
+         * @param width width in pixels
+         * @param height height in pixels
+         * @param pool worker pool to decompress the bands on, decompresses on the calling thread when null
+         * @return false if the frame is corrupt
+         */
+        bool decode(uint16* depth, int width, int height, RealSenseWorkerPool* pool) const;
+    };
+
+    /**
+     * RealSenseDepthFileWriter
+     * Writes compressed depth frames to a chunked, seekable file.
+     * Frames are collected in chunks of 'chunkFrames' frames, a chunk is written in one go when full.
+     * An index of all chunks is appended on close, a file without index (for example after a crash) is still readable by scanning the chunks.
+     * All values are stored in host byte order, recordings can't be exchanged between little and big endian machines.
+     */
+    class NAPAPI RealSenseDepthFileWriter final
+    {
+    public:
+        /**
+         * Closes the file
+         */
+        ~RealSenseDepthFileWriter();
+
+        /**
+         * Creates the file and writes the header
+         * @param path path of the file
+         * @param header the header
+         * @param chunkFrames amount of frames per chunk
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool open(const std::string& path, const RealSenseDepthFileHeader& header, int chunkFrames, utility::ErrorState& errorState);
+
+        /**
+         * Appends a frame to the current chunk, writes the chunk when full
+         * @param frame the frame
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool write(const RealSenseDepthFileFrame& frame, utility::ErrorState& errorState);
+
+        /**
+         * Writes the remaining frames and the index, closes the file
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool close(utility::ErrorState& errorState);
+
+        /**
+         * @return if a file is open
+         */
+        bool isOpen() const                             { return mFile.is_open(); }
+
+        /**
+         * @return amount of bytes written to the file
+         */
+        uint64 getBytesWritten() const                  { return mBytesWritten; }
+
+    private:
+        bool flushChunk(utility::ErrorState& errorState);
+
+        struct IndexEntry
+        {
+            uint64 mOffset;
+            double mTimestamp;
+        };
+
+        std::ofstream mFile;
+        std::string mPath;
+        int mChunkFrames = 0;
+        uint32 mChunkFrameCount = 0;
+        double mChunkTimestamp = 0.0;
+        std::vector<uint8> mChunk;
+        std::vector<IndexEntry> mIndex;
+        uint64 mBytesWritten = 0;
+    };
+
+    /**
+     * RealSenseDepthFileReader
+     * Reads the frames of a file written by the RealSenseDepthFileWriter, one chunk in memory at a time.
+     */
+    class NAPAPI RealSenseDepthFileReader final
+    {
+    public:
+        /**
+         * Opens the file, reads the header and the chunk index
+         * @param path path of the file
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool open(const std::string& path, utility::ErrorState& errorState);
+
+        /**
+         * @return the header of the open file
+         */
+        const RealSenseDepthFileHeader& getHeader() const { return mHeader; }
+
+        /**
+         * @return amount of chunks in the file
+         */
+        int getChunkCount() const                       { return static_cast<int>(mIndex.size()); }
+
+        /**
+         * @return timestamp of the first frame in milliseconds, 0 when the file holds no frames
+         */
+        double getStartTimestamp() const;
+
+        /**
+         * Positions the reader at the first frame with a timestamp equal to or after timestamp
+         * @param timestamp timestamp in milliseconds
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool seek(double timestamp, utility::ErrorState& errorState);
+
+        /**
+         * Reads the next frame
+         * @param frame receives the frame
+         * @param errorState contains any errors
+         * @return false at the end of the file or on error, errorState holds the error
+         */
+        bool read(RealSenseDepthFileFrame& frame, utility::ErrorState& errorState);
+
+        /**
+         * @return true when all frames were read
+         */
+        bool isEnd() const;
+
+    private:
+        bool loadChunk(int chunk, utility::ErrorState& errorState);
+        bool buildIndex(utility::ErrorState& errorState);
+
+        struct IndexEntry
+        {
+            uint64 mOffset;
+            double mTimestamp;
+        };
+
+        std::ifstream mFile;
+        std::string mPath;
+        RealSenseDepthFileHeader mHeader;
+        std::vector<IndexEntry> mIndex;
+        std::vector<uint8> mChunk;
+        int mCurrentChunk = -1;
+        uint32 mChunkFrameCount = 0;
+        uint32 mChunkFrame = 0;
+        size_t mChunkPosition = 0;
+    };
+}
@@ -0,0 +1,82 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedepthmesh.h"
+#include "realsensedepthtriangulator.h"
+
+#include <renderservice.h>
+#include <renderglobals.h>
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseDepthMesh)
+    RTTI_CONSTRUCTOR(nap::Core&)
+    RTTI_PROPERTY("Columns", &nap::RealSenseDepthMesh::mColumns, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Rows", &nap::RealSenseDepthMesh::mRows, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("CullMode", &nap::RealSenseDepthMesh::mCullMode, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthMesh
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDepthMesh::RealSenseDepthMesh(Core& core) : mRenderService(core.getService<RenderService>()) {}
+
+
+    RealSenseDepthMesh::~RealSenseDepthMesh() = default;
+
+
+    bool RealSenseDepthMesh::init(utility::ErrorState& errorState)
+    {
+        if(!errorState.check(mColumns >= 2 && mRows >= 2, "%s: mesh needs at least 2 columns and 2 rows", mID.c_str()))
+            return false;
+
+        assert(mRenderService != nullptr);
+        mMeshInstance = std::make_unique<MeshInstance>(*mRenderService);
+
+        size_t vert_count = static_cast<size_t>(mColumns) * static_cast<size_t>(mRows);
+        std::vector<glm::vec3> vertices(vert_count);
+        std::vector<glm::vec3> normals(vert_count, { 0.0f, 0.0f, 1.0f });
+        std::vector<glm::vec3> uvs(vert_count);
+        std::vector<glm::vec4> colors(vert_count, { 1.0f, 1.0f, 1.0f, 1.0f });
+        for(int row = 0; row < mRows; row++)
+        {
+            for(int column = 0; column < mColumns; column++)
+            {
+                size_t idx = static_cast<size_t>(row) * static_cast<size_t>(mColumns) + column;
+                uvs[idx] = { (column + 0.5f) / mColumns, (row + 0.5f) / mRows, 0.0f };
+                vertices[idx] = { uvs[idx].x, uvs[idx].y, 0.0f };
+            }
+        }
+
+        auto& mesh = *mMeshInstance;
+        mesh.getOrCreateAttribute<glm::vec3>(vertexid::position).setData(vertices.data(), static_cast<int>(vert_count));
+        mesh.getOrCreateAttribute<glm::vec3>(vertexid::normal).setData(normals.data(), static_cast<int>(vert_count));
+        mesh.getOrCreateAttribute<glm::vec3>(vertexid::getUVName(0)).setData(uvs.data(), static_cast<int>(vert_count));
+        mesh.getOrCreateAttribute<glm::vec4>(vertexid::getColorName(0)).setData(colors.data(), static_cast<int>(vert_count));
+        mesh.setNumVertices(static_cast<int>(vert_count));
+        mesh.setDrawMode(EDrawMode::Triangles);
+        mesh.setUsage(EMemoryUsage::DynamicWrite);
+        mesh.setCullMode(mCullMode);
+        mesh.setPolygonMode(EPolygonMode::Fill);
+
+        // allocate the index buffer for every triangle of the grid, all degenerate until the first frame
+        std::vector<uint32> indices(RealSenseDepthTriangulator::getMaxIndexCount(mColumns, mRows), 0);
+        MeshShape& shape = mesh.createShape();
+        shape.setIndices(indices.data(), static_cast<int>(indices.size()));
+
+        return mesh.init(errorState);
+    }
+
+
+    bool RealSenseDepthMesh::setIndices(const std::vector<uint32>& indices, utility::ErrorState& errorState)
+    {
+        if(!errorState.check(indices.size() <= RealSenseDepthTriangulator::getMaxIndexCount(mColumns, mRows),
+                             "%s: more indices than triangles in the grid", mID.c_str()))
+            return false;
+
+        auto& index_buffer = mMeshInstance->getGPUMesh().getOrCreateIndexBuffer(0);
+        return index_buffer.setData(indices.empty() ? mEmpty : indices, errorState);
+    }
+}
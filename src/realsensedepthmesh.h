@@ -0,0 +1,72 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include <rtti/rtti.h>
+#include <nap/core.h>
+#include <mesh.h>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseDepthMesh
+     * Organized triangle mesh over a depth frame, a grid of columns x rows vertices.
+     * Vertex (column, row) has index row * columns + column and uv ((column + 0.5) / columns, (row + 0.5) / rows), the same vertex
+     * layout as RealSenseDepthTriangulator. Vertices are positioned from the depth texture by the shader, for example pointcloud.vert.
+     * The vertex buffers are static, the index buffer is allocated once for every triangle of the grid and only the index
+     * buffer is updated afterwards, see setIndices. Use a RealSenseDepthMeshComponent to triangulate the frames of a device.
+     */
+    class NAPAPI RealSenseDepthMesh : public IMesh
+    {
+    RTTI_ENABLE(IMesh)
+    public:
+        /**
+         * Constructor
+         * @param core reference to NAP core
+         */
+        RealSenseDepthMesh(Core& core);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseDepthMesh();
+
+        /**
+         * Initialization method, creates the mesh
+         * @param errorState contains any error
+         * @return true on success
+         */
+        virtual bool init(utility::ErrorState& errorState) override;
+
+        /**
+         * @return MeshInstance reference
+         */
+        virtual MeshInstance& getMeshInstance() override                    { return *mMeshInstance; }
+
+        /**
+         * @return const MeshInstance reference
+         */
+        virtual const MeshInstance& getMeshInstance() const override        { return *mMeshInstance; }
+
+        /**
+         * Uploads new triangles, only the index buffer is updated. Call from the main thread.
+         * @param indices 3 vertex indices per triangle, at most the amount of indices of every triangle of the grid
+         * @param errorState contains the error if the upload fails
+         * @return true on success
+         */
+        bool setIndices(const std::vector<uint32>& indices, utility::ErrorState& errorState);
+
+        int mColumns = 424;                                     ///< Property: 'Columns' amount of vertices along x
+        int mRows = 240;                                        ///< Property: 'Rows' amount of vertices along y
+        ECullMode mCullMode = ECullMode::None;                  ///< Property: 'CullMode' triangle cull mode, defaults to no culling
+
+    private:
+        RenderService* mRenderService = nullptr;
+        std::unique_ptr<MeshInstance> mMeshInstance;
+        std::vector<uint32> mEmpty = { 0, 0, 0 };               ///< Degenerate triangle uploaded when there are no triangles
+    };
+}
@@ -0,0 +1,85 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedepthmeshcomponent.h"
+#include "realsenseservice.h"
+
+#include <rs.hpp>
+#include <nap/core.h>
+#include <nap/logger.h>
+#include <algorithm>
+
+RTTI_BEGIN_CLASS(nap::RealSenseDepthMeshComponent)
+    RTTI_PROPERTY("Mesh", &nap::RealSenseDepthMeshComponent::mMesh, nap::rtti::EPropertyMetaData::Required)
+    RTTI_PROPERTY("MaxDepthStep", &nap::RealSenseDepthMeshComponent::mMaxDepthStep, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseDepthMeshComponentInstance)
+    RTTI_CONSTRUCTOR(nap::EntityInstance&, nap::Component&)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthMeshComponent
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDepthMeshComponent::RealSenseDepthMeshComponent() = default;
+
+
+    RealSenseDepthMeshComponent::~RealSenseDepthMeshComponent() = default;
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthMeshComponentInstance
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDepthMeshComponentInstance::RealSenseDepthMeshComponentInstance(EntityInstance& entity, Component& resource) :
+        RealSenseFrameSetListenerComponentInstance(entity, resource)
+    {}
+
+
+    RealSenseDepthMeshComponentInstance::~RealSenseDepthMeshComponentInstance() = default;
+
+
+    bool RealSenseDepthMeshComponentInstance::onInit(utility::ErrorState& errorState)
+    {
+        mResource = getComponent<RealSenseDepthMeshComponent>();
+        mMesh = mResource->mMesh.get();
+        mPool = &getEntityInstance()->getCore()->getService<RealSenseService>()->getWorkerPool();
+
+        if(!errorState.check(mResource->mMaxDepthStep >= 0.0f, "%s: max depth step can't be negative", mResource->mID.c_str()))
+            return false;
+
+        frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
+        return true;
+    }
+
+
+    void RealSenseDepthMeshComponentInstance::update(double deltaTime)
+    {
+        if(!mResults.update())
+            return;
+
+        utility::ErrorState error_state;
+        if(!mMesh->setIndices(mResults.getReadBuffer(), error_state))
+            nap::Logger::error("%s: %s", mResource->mID.c_str(), error_state.toString().c_str());
+    }
+
+
+    void RealSenseDepthMeshComponentInstance::onTrigger(const rs2::frameset& frameset)
+    {
+        auto depth = frameset.get_depth_frame();
+        if(!depth || depth.get_profile().format() != RS2_FORMAT_Z16)
+            return;
+
+        RealSenseDepthTriangulator::Parameters parameters;
+        parameters.mColumns = mMesh->mColumns;
+        parameters.mRows = mMesh->mRows;
+        parameters.mMaxDepthStep = static_cast<uint16>(std::min(65535.0f, mResource->mMaxDepthStep / depth.get_units() + 0.5f));
+
+        mTriangulator.triangulate(static_cast<const uint16*>(depth.get_data()), depth.get_stride_in_bytes(), depth.get_width(),
+                                  depth.get_height(), parameters, mPool, mResults.getWriteBuffer());
+        mResults.publish();
+    }
+}
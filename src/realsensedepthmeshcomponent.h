@@ -0,0 +1,99 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include "realsenseframesetlistenercomponent.h"
+#include "realsensedepthmesh.h"
+#include "realsensedepthtriangulator.h"
+#include "realsensetriplebuffer.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseDepthMeshComponentInstance;
+    class RealSenseWorkerPool;
+
+    /**
+     * RealSenseDepthMeshComponent
+     * Triangulates the Z16 depth frames of a device into the index buffer of a RealSenseDepthMesh, see RealSenseDepthTriangulator.
+     * Triangles are built on the capture thread, split over the worker pool of the RealSenseService, and handed to the
+     * main thread through a lock-free triple buffer. Only the index buffer of the mesh is uploaded on update.
+     * Render the mesh with a RealSenseRenderPointCloudComponent that uses the same mesh, its shader positions the vertices.
+     */
+    class NAPAPI RealSenseDepthMeshComponent : public RealSenseFrameSetListenerComponent
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponent)
+    DECLARE_COMPONENT(RealSenseDepthMeshComponent, RealSenseDepthMeshComponentInstance)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseDepthMeshComponent();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseDepthMeshComponent();
+
+        // Properties
+        ResourcePtr<RealSenseDepthMesh> mMesh;          ///< Property: 'Mesh' the mesh of which to update the triangles
+        float mMaxDepthStep = 0.05f;                    ///< Property: 'MaxDepthStep' maximum depth difference in meters within a triangle, larger differences are discontinuities
+    };
+
+    /**
+     * RealSenseDepthMeshComponentInstance
+     * Triangulates depth frames on the capture thread and uploads the triangles on update
+     */
+    class NAPAPI RealSenseDepthMeshComponentInstance : public RealSenseFrameSetListenerComponentInstance
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponentInstance)
+    public:
+        /**
+         * Constructor
+         * @param entity reference to entity instance
+         * @param resource reference to component
+         */
+        RealSenseDepthMeshComponentInstance(EntityInstance& entity, Component& resource);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseDepthMeshComponentInstance();
+
+        /**
+         * Uploads the triangles of the latest triangulated frame to the index buffer of the mesh
+         * @param deltaTime time since last update
+         */
+        void update(double deltaTime) override;
+
+        /**
+         * @return amount of triangles uploaded by the last update, only call from the main thread
+         */
+        int getTriangleCount() const                    { return static_cast<int>(mResults.getReadBuffer().size() / 3); }
+
+    protected:
+        /**
+         * Internal init method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool onInit(utility::ErrorState& errorState) override;
+
+        /**
+         * Called upon receiving a new frameset, called from RealSense device
+         * @param frameset a new frameset
+         */
+        void onTrigger(const rs2::frameset& frameset);
+
+    private:
+        RealSenseDepthMeshComponent* mResource = nullptr;
+        RealSenseDepthMesh* mMesh = nullptr;
+        RealSenseWorkerPool* mPool = nullptr;
+        RealSenseDepthTriangulator mTriangulator;
+        RealSenseTripleBuffer<std::vector<uint32>> mResults;
+    };
+}
@@ -0,0 +1,202 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedepthplayer.h"
+#include "realsensedepthfile.h"
+#include "realsenseservice.h"
+#include "realsensesoftwareframepool.h"
+
+#include <rs.hpp>
+#include <hpp/rs_internal.hpp>
+#include <nap/logger.h>
+#include <chrono>
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseDepthPlayer)
+    RTTI_CONSTRUCTOR(nap::RealSenseService&)
+    RTTI_PROPERTY("Path", &nap::RealSenseDepthPlayer::mPath, nap::rtti::EPropertyMetaData::Required)
+    RTTI_PROPERTY("Serial", &nap::RealSenseDepthPlayer::mSerial, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Loop", &nap::RealSenseDepthPlayer::mLoop, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Speed", &nap::RealSenseDepthPlayer::mSpeed, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthPlayer::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseDepthPlayer::Impl
+    {
+    public:
+        Impl() : mSensor(mDevice.add_sensor("Stereo Module")) { }
+
+        // Software camera the recording is played through
+        rs2::software_device mDevice;
+        rs2::software_sensor mSensor;
+        rs2::stream_profile mProfile;
+
+        // Recording, only used by the playback thread while playing
+        RealSenseDepthFileReader mReader;
+
+        // Recycled pixel buffers of the played frames, returned when librealsense releases a frame
+        RealSenseSoftwareFramePool mFramePool;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthPlayer
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDepthPlayer::RealSenseDepthPlayer(RealSenseService& service) : mService(service)
+    { }
+
+
+    RealSenseDepthPlayer::~RealSenseDepthPlayer() = default;
+
+
+    bool RealSenseDepthPlayer::init(utility::ErrorState& errorState)
+    {
+        if(!errorState.check(mSpeed > 0.0f, "%s: Speed must be higher than 0", mID.c_str()))
+            return false;
+
+        if(!errorState.check(!mSerial.empty(), "%s: no serial number", mID.c_str()))
+            return false;
+
+        mImpl = std::make_unique<Impl>();
+        if(!mImpl->mReader.open(mPath, errorState))
+            return false;
+
+        const auto& header = mImpl->mReader.getHeader();
+        try
+        {
+            rs2_intrinsics intrinsics = {};
+            intrinsics.width = header.mWidth;
+            intrinsics.height = header.mHeight;
+            intrinsics.ppx = header.mPPX;
+            intrinsics.ppy = header.mPPY;
+            intrinsics.fx = header.mFX;
+            intrinsics.fy = header.mFY;
+            intrinsics.model = static_cast<rs2_distortion>(header.mModel);
+            std::copy(std::begin(header.mCoeffs), std::end(header.mCoeffs), std::begin(intrinsics.coeffs));
+
+            int fps = header.mFps > 0 ? header.mFps : 30;
+            mImpl->mProfile = mImpl->mSensor.add_video_stream({ RS2_STREAM_DEPTH, 0, 0, header.mWidth, header.mHeight, fps,
+                                                                 static_cast<int>(sizeof(uint16)), RS2_FORMAT_Z16, intrinsics }, true);
+
+            // the depth units option makes the software sensor a depth sensor
+            mImpl->mSensor.add_read_only_option(RS2_OPTION_DEPTH_UNITS, header.mDepthScale);
+            mImpl->mDevice.register_info(RS2_CAMERA_INFO_NAME, "Depth Playback");
+            mImpl->mDevice.register_info(RS2_CAMERA_INFO_SERIAL_NUMBER, mSerial);
+            mImpl->mDevice.create_matcher(RS2_MATCHER_DEFAULT);
+        }
+        catch(const std::exception& e)
+        {
+            errorState.fail("%s: %s", mID.c_str(), e.what());
+            return false;
+        }
+
+        mService.addSoftwareDevice(mImpl->mDevice);
+        nap::Logger::info("%s: playing %s (%dx%d at %d fps) as %s", mID.c_str(), mPath.c_str(),
+                          header.mWidth, header.mHeight, header.mFps, mSerial.c_str());
+        return true;
+    }
+
+
+    void RealSenseDepthPlayer::onDestroy()
+    {
+        if(mImpl != nullptr)
+            mService.removeSoftwareDevice(mImpl->mDevice);
+    }
+
+
+    bool RealSenseDepthPlayer::start(utility::ErrorState& errorState)
+    {
+        if(!mImpl->mReader.seek(mImpl->mReader.getStartTimestamp(), errorState))
+            return false;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRun = true;
+        }
+        mPlaying.store(true);
+        mPlaybackThread = std::thread([this]{ play(); });
+        return true;
+    }
+
+
+    void RealSenseDepthPlayer::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRun = false;
+        }
+        mCondition.notify_all();
+        if(mPlaybackThread.joinable())
+            mPlaybackThread.join();
+        mPlaying.store(false);
+    }
+
+
+    void RealSenseDepthPlayer::play()
+    {
+        auto& reader = mImpl->mReader;
+        const auto& header = reader.getHeader();
+        auto& pool = mService.getWorkerPool();
+        size_t count = static_cast<size_t>(header.mWidth) * header.mHeight;
+
+        RealSenseDepthFileFrame frame;
+        double start_timestamp = -1.0;
+        auto start_time = std::chrono::steady_clock::now();
+        while(true)
+        {
+            utility::ErrorState error_state;
+            if(!reader.read(frame, error_state))
+            {
+                if(error_state.hasErrors())
+                {
+                    nap::Logger::error("%s: %s", mID.c_str(), error_state.toString().c_str());
+                    break;
+                }
+
+                // end of the recording
+                if(!mLoop || !reader.seek(reader.getStartTimestamp(), error_state))
+                    break;
+
+                start_timestamp = -1.0;
+                continue;
+            }
+
+            // librealsense owns the pixels once the frame is submitted
+            auto* pixels = static_cast<uint16*>(mImpl->mFramePool.acquire(count * sizeof(uint16)));
+            if(!frame.decode(pixels, header.mWidth, header.mHeight, &pool))
+            {
+                RealSenseSoftwareFramePool::release(pixels);
+                nap::Logger::warn("%s: skipping corrupt frame %llu", mID.c_str(), static_cast<unsigned long long>(frame.mFrameNumber));
+                continue;
+            }
+
+            // deliver at the recorded rate
+            if(start_timestamp < 0.0)
+            {
+                start_timestamp = frame.mTimestamp;
+                start_time = std::chrono::steady_clock::now();
+            }
+            auto due = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>((frame.mTimestamp - start_timestamp) / mSpeed));
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                if(mCondition.wait_until(lock, due, [this]{ return !mRun; }))
+                {
+                    RealSenseSoftwareFramePool::release(pixels);
+                    break;
+                }
+            }
+
+            mImpl->mSensor.on_video_frame({ pixels, &RealSenseSoftwareFramePool::release,
+                                            header.mWidth * static_cast<int>(sizeof(uint16)), static_cast<int>(sizeof(uint16)),
+                                            frame.mTimestamp, RS2_TIMESTAMP_DOMAIN_SYSTEM_TIME, static_cast<int>(frame.mFrameNumber),
+                                            mImpl->mProfile.get(), header.mDepthScale });
+        }
+        mPlaying.store(false);
+    }
+}
@@ -0,0 +1,96 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/device.h>
+#include <rtti/factory.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseService;
+
+    /**
+     * RealSenseDepthPlayer
+     * Plays back a depth recording made with a RealSenseDepthRecorder as a software camera.
+     * The player adds a software device with serial number 'Serial' to the RealSenseService on init,
+     * a RealSenseDevice with the same 'Serial' and a Z16 depth stream streams the recording like a physical camera.
+     * Frames are decompressed on the worker pool of the service and delivered at the recorded frame rate, scaled by 'Speed'.
+     * Start the player before the RealSenseDevice, or enable 'AllowFailure' on the device so it connects once the player is available.
+     */
+    class NAPAPI RealSenseDepthPlayer final : public Device
+    {
+    RTTI_ENABLE(Device)
+    public:
+        /**
+         * Constructor
+         * @param service reference to the RealSenseService
+         */
+        RealSenseDepthPlayer(RealSenseService& service);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseDepthPlayer();
+
+        /**
+         * Opens the recording and adds the software device to the service
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool init(utility::ErrorState& errorState) override;
+
+        /**
+         * Removes the software device from the service
+         */
+        void onDestroy() override;
+
+        /**
+         * Starts playback from the start of the recording
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool start(utility::ErrorState& errorState) override;
+
+        /**
+         * Stops playback
+         */
+        void stop() override;
+
+        /**
+         * @return if the player is playing, false when stopped or at the end of a recording without 'Loop'
+         */
+        bool isPlaying() const                      { return mPlaying.load(); }
+
+        std::string mPath;                          ///< Property: 'Path' path of the depth recording
+        std::string mSerial = "depth-playback";     ///< Property: 'Serial' serial number of the software device
+        bool mLoop = true;                          ///< Property: 'Loop' restart at the end of the recording
+        float mSpeed = 1.0f;                        ///< Property: 'Speed' playback speed, 1 is the recorded frame rate
+    private:
+        /**
+         * Playback thread function
+         */
+        void play();
+
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseService& mService;
+        std::thread mPlaybackThread;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mRun = false;                          ///< Guarded by mMutex
+        std::atomic<bool> mPlaying = { false };
+    };
+
+    using RealSenseDepthPlayerObjectCreator = rtti::ObjectCreator<RealSenseDepthPlayer, RealSenseService>;
+}
@@ -0,0 +1,295 @@
+#include "realsensedepthrecorder.h"
+#include "realsensedepthfile.h"
+#include "realsensedevice.h"
+#include "realsenseservice.h"
+
+#include <rs.hpp>
+#include <nap/core.h>
+#include <nap/logger.h>
+#include <chrono>
+
+RTTI_BEGIN_CLASS(nap::RealSenseDepthRecorder)
+    RTTI_PROPERTY("Path", &nap::RealSenseDepthRecorder::mPath, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("RecordOnStart", &nap::RealSenseDepthRecorder::mRecordOnStart, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Bands", &nap::RealSenseDepthRecorder::mBands, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("ChunkFrames", &nap::RealSenseDepthRecorder::mChunkFrames, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MaxQueuedFrames", &nap::RealSenseDepthRecorder::mMaxQueuedFrames, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseDepthRecorderInstance)
+    RTTI_CONSTRUCTOR(nap::EntityInstance&, nap::Component&)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthRecorder
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDepthRecorder::RealSenseDepthRecorder() = default;
+
+
+    RealSenseDepthRecorder::~RealSenseDepthRecorder() = default;
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthRecorderInstance::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseDepthRecorderInstance::Impl
+    {
+    public:
+        // Depth frames waiting to be compressed, guarded by mMutex
+        std::deque<rs2::frame> mRawFrames;
+
+        // Compressed frames waiting to be written, guarded by mMutex
+        std::deque<std::unique_ptr<RealSenseDepthFileFrame>> mEncodedFrames;
+
+        // Set by the encode thread when it exits, guarded by mMutex
+        bool mEncodeDone = false;
+
+        // Header taken from the first frame, set by the encode thread before the first encoded frame is queued
+        RealSenseDepthFileHeader mHeader;
+        bool mHeaderValid = false;
+
+        // Path of the recording and the writer, only used by the write thread while recording
+        std::string mPath;
+        RealSenseDepthFileWriter mWriter;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthRecorderInstance
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDepthRecorderInstance::RealSenseDepthRecorderInstance(EntityInstance& entity, Component& resource) :
+        RealSenseFrameSetListenerComponentInstance(entity, resource)
+    {}
+
+
+    RealSenseDepthRecorderInstance::~RealSenseDepthRecorderInstance()
+    {
+        stopRecording();
+    }
+
+
+    bool RealSenseDepthRecorderInstance::onInit(utility::ErrorState& errorState)
+    {
+        mImpl = std::make_unique<Impl>();
+        mResource = getComponent<RealSenseDepthRecorder>();
+        mPool = &getEntityInstance()->getCore()->getService<RealSenseService>()->getWorkerPool();
+
+        if(!errorState.check(mResource->mBands > 0, "%s: bands must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        if(!errorState.check(mResource->mMaxQueuedFrames > 0, "%s: max queued frames must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
+
+        if(mResource->mRecordOnStart)
+            return startRecording(mResource->mPath, errorState);
+
+        return true;
+    }
+
+
+    void RealSenseDepthRecorderInstance::destroy()
+    {
+        stopRecording();
+    }
+
+
+    bool RealSenseDepthRecorderInstance::startRecording(const std::string& path, utility::ErrorState& errorState)
+    {
+        if(!errorState.check(!path.empty(), "%s: no recording path", mResource->mID.c_str()))
+            return false;
+
+        stopRecording();
+
+        mImpl->mPath = path;
+        mImpl->mHeaderValid = false;
+        mImpl->mEncodeDone = false;
+        mStop = false;
+        mQueued = 0;
+        {
+            std::lock_guard<std::mutex> lock(mStatisticsMutex);
+            mStatistics = Statistics();
+        }
+
+        mRecording.store(true);
+        mEncodeThread = std::thread([this]{ encode(); });
+        mWriteThread = std::thread([this]{ write(); });
+        nap::Logger::info("%s: recording depth to %s", mResource->mID.c_str(), path.c_str());
+        return true;
+    }
+
+
+    void RealSenseDepthRecorderInstance::stopRecording()
+    {
+        if(!mEncodeThread.joinable())
+            return;
+
+        mRecording.store(false);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        mEncodeThread.join();
+        mWriteThread.join();
+
+        auto statistics = getStatistics();
+        nap::Logger::info("%s: recorded %llu frames to %s, %llu dropped, compression ratio %.2f, %.1f MB/s",
+                          mResource->mID.c_str(), static_cast<unsigned long long>(statistics.mFrames), mImpl->mPath.c_str(),
+                          static_cast<unsigned long long>(statistics.mDroppedFrames),
+                          statistics.getCompressionRatio(), statistics.getEncodeThroughput());
+    }
+
+
+    RealSenseDepthRecorderInstance::Statistics RealSenseDepthRecorderInstance::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mStatisticsMutex);
+        return mStatistics;
+    }
+
+
+    void RealSenseDepthRecorderInstance::onTrigger(const rs2::frameset& frameset)
+    {
+        if(!mRecording.load())
+            return;
+
+        auto depth = frameset.get_depth_frame();
+        if(!depth || depth.get_profile().format() != RS2_FORMAT_Z16)
+            return;
+
+        // never block the capture thread, drop the frame when compression or disk can't keep up
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(mQueued < mResource->mMaxQueuedFrames)
+            {
+                mImpl->mRawFrames.emplace_back(depth);
+                mQueued++;
+                mCondition.notify_all();
+                return;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mStatisticsMutex);
+        mStatistics.mDroppedFrames++;
+    }
+
+
+    void RealSenseDepthRecorderInstance::encode()
+    {
+        while(true)
+        {
+            rs2::frame frame;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]{ return mStop || !mImpl->mRawFrames.empty(); });
+                if(mImpl->mRawFrames.empty())
+                {
+                    mImpl->mEncodeDone = true;
+                    mCondition.notify_all();
+                    return;
+                }
+                frame = std::move(mImpl->mRawFrames.front());
+                mImpl->mRawFrames.pop_front();
+            }
+
+            auto video_frame = frame.as<rs2::video_frame>();
+            auto& header = mImpl->mHeader;
+            if(!mImpl->mHeaderValid)
+            {
+                auto profile = video_frame.get_profile().as<rs2::video_stream_profile>();
+                auto intrinsics = profile.get_intrinsics();
+                header.mWidth = video_frame.get_width();
+                header.mHeight = video_frame.get_height();
+                header.mFps = profile.fps();
+                header.mDepthScale = mDevice->getDepthScale();
+                header.mPPX = intrinsics.ppx;
+                header.mPPY = intrinsics.ppy;
+                header.mFX = intrinsics.fx;
+                header.mFY = intrinsics.fy;
+                header.mModel = intrinsics.model;
+                std::copy(std::begin(intrinsics.coeffs), std::end(intrinsics.coeffs), std::begin(header.mCoeffs));
+                mImpl->mHeaderValid = true;
+            }
+
+            // a recording holds a single resolution
+            if(video_frame.get_width() != header.mWidth || video_frame.get_height() != header.mHeight ||
+               video_frame.get_stride_in_bytes() != header.mWidth * static_cast<int>(sizeof(uint16)))
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mQueued--;
+                }
+                std::lock_guard<std::mutex> lock(mStatisticsMutex);
+                mStatistics.mDroppedFrames++;
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            auto encoded = std::make_unique<RealSenseDepthFileFrame>();
+            encoded->mFrameNumber = video_frame.get_frame_number();
+            encoded->mTimestamp = video_frame.get_timestamp();
+            encoded->encode(static_cast<const uint16*>(video_frame.get_data()), header.mWidth, header.mHeight, mResource->mBands, mPool);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lock(mStatisticsMutex);
+                mStatistics.mEncodeSeconds += seconds;
+                mStatistics.mRawBytes += video_frame.get_data_size();
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mImpl->mEncodedFrames.emplace_back(std::move(encoded));
+            mCondition.notify_all();
+        }
+    }
+
+
+    void RealSenseDepthRecorderInstance::write()
+    {
+        bool failed = false;
+        while(true)
+        {
+            std::unique_ptr<RealSenseDepthFileFrame> frame;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]{ return mImpl->mEncodeDone || !mImpl->mEncodedFrames.empty(); });
+                if(mImpl->mEncodedFrames.empty())
+                    break;
+
+                frame = std::move(mImpl->mEncodedFrames.front());
+                mImpl->mEncodedFrames.pop_front();
+            }
+
+            if(!failed)
+            {
+                auto start = std::chrono::steady_clock::now();
+                utility::ErrorState error_state;
+                if((!mImpl->mWriter.isOpen() && !mImpl->mWriter.open(mImpl->mPath, mImpl->mHeader, mResource->mChunkFrames, error_state)) ||
+                   !mImpl->mWriter.write(*frame, error_state))
+                {
+                    nap::Logger::error("%s: %s", mResource->mID.c_str(), error_state.toString().c_str());
+                    mRecording.store(false);
+                    failed = true;
+                }
+                else
+                {
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    std::lock_guard<std::mutex> lock(mStatisticsMutex);
+                    mStatistics.mFrames++;
+                    mStatistics.mCompressedBytes += frame->mData.size();
+                    mStatistics.mWriteSeconds += seconds;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueued--;
+        }
+
+        utility::ErrorState error_state;
+        if(!mImpl->mWriter.close(error_state))
+            nap::Logger::error("%s: %s", mResource->mID.c_str(), error_state.toString().c_str());
+    }
+}
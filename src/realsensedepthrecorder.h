@@ -0,0 +1,168 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include "realsenseframesetlistenercomponent.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseDepthRecorderInstance;
+    class RealSenseWorkerPool;
+    struct RealSenseDepthFileFrame;
+
+    /**
+     * RealSenseDepthRecorder
+     * Records the Z16 depth stream of a device to a compact, lossless depth recording (see RealSenseDepthFileWriter).
+     * Frames are compressed with RVL on the worker pool of the RealSenseService, split in 'Bands' bands of rows.
+     * Compressed frames are written in chunks of 'ChunkFrames' frames by a dedicated I/O thread.
+     * The capture thread never waits: frames are dropped when more than 'MaxQueuedFrames' frames wait to be compressed or written.
+     * Play recordings back with a RealSenseDepthPlayer.
+     */
+    class NAPAPI RealSenseDepthRecorder : public RealSenseFrameSetListenerComponent
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponent)
+    DECLARE_COMPONENT(RealSenseDepthRecorder, RealSenseDepthRecorderInstance)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseDepthRecorder();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseDepthRecorder();
+
+        // Properties
+        std::string mPath;                  ///< Property: 'Path' path of the recording, used when recording starts on init
+        bool mRecordOnStart = false;        ///< Property: 'RecordOnStart' start recording to 'Path' on init
+        int mBands = 8;                     ///< Property: 'Bands' amount of horizontal bands a frame is split in, bands are compressed in parallel
+        int mChunkFrames = 30;              ///< Property: 'ChunkFrames' amount of frames per chunk, seeking loads a single chunk
+        int mMaxQueuedFrames = 8;           ///< Property: 'MaxQueuedFrames' maximum amount of frames waiting to be compressed or written
+    };
+
+    /**
+     * RealSenseDepthRecorderInstance
+     * Compresses and writes the depth frames of the device while recording
+     */
+    class NAPAPI RealSenseDepthRecorderInstance : public RealSenseFrameSetListenerComponentInstance
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponentInstance)
+    public:
+        /**
+         * Recording statistics
+         */
+        struct NAPAPI Statistics
+        {
+            uint64 mFrames = 0;             ///< Amount of frames written
+            uint64 mDroppedFrames = 0;      ///< Amount of frames dropped because the queue was full
+            uint64 mRawBytes = 0;           ///< Uncompressed size of the written frames
+            uint64 mCompressedBytes = 0;    ///< Compressed size of the written frames
+            double mEncodeSeconds = 0.0;    ///< Total time spent compressing
+            double mWriteSeconds = 0.0;     ///< Total time spent writing
+
+            /**
+             * @return uncompressed size divided by compressed size
+             */
+            double getCompressionRatio() const { return mCompressedBytes == 0 ? 0.0 : static_cast<double>(mRawBytes) / mCompressedBytes; }
+
+            /**
+             * @return compression throughput in uncompressed MB per second
+             */
+            double getEncodeThroughput() const { return mEncodeSeconds <= 0.0 ? 0.0 : mRawBytes / mEncodeSeconds / 1000000.0; }
+        };
+
+        /**
+         * Constructor
+         * @param entity reference to entity instance
+         * @param resource reference to component
+         */
+        RealSenseDepthRecorderInstance(EntityInstance& entity, Component& resource);
+
+        /**
+         * Destructor, stops recording
+         */
+        virtual ~RealSenseDepthRecorderInstance();
+
+        /**
+         * Starts recording, the file is created on the first depth frame
+         * @param path path of the recording
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool startRecording(const std::string& path, utility::ErrorState& errorState);
+
+        /**
+         * Stops recording, waits until all queued frames are written and closes the file
+         */
+        void stopRecording();
+
+        /**
+         * @return if the recorder is recording
+         */
+        bool isRecording() const                    { return mRecording.load(); }
+
+        /**
+         * @return copy of the recording statistics, can be called from any thread
+         */
+        Statistics getStatistics() const;
+
+    protected:
+        /**
+         * Internal init method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool onInit(utility::ErrorState& errorState) override;
+
+        /**
+         * Stops recording
+         */
+        void destroy() override;
+
+        /**
+         * Called upon receiving a new frameset, called from RealSense device
+         * @param frameset a new frameset
+         */
+        void onTrigger(const rs2::frameset& frameset);
+
+    private:
+        /**
+         * Compresses queued frames on the worker pool
+         */
+        void encode();
+
+        /**
+         * Writes compressed frames to disk
+         */
+        void write();
+
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseDepthRecorder* mResource = nullptr;
+        RealSenseWorkerPool* mPool = nullptr;
+        std::atomic<bool> mRecording = { false };
+
+        std::thread mEncodeThread;
+        std::thread mWriteThread;
+        std::mutex mMutex;                          ///< Guards the queues and the stop flag
+        std::condition_variable mCondition;
+        bool mStop = false;
+        int mQueued = 0;                            ///< Frames waiting to be compressed or written
+
+        mutable std::mutex mStatisticsMutex;
+        Statistics mStatistics;
+    };
+}
@@ -0,0 +1,160 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedepthtriangulator.h"
+#include "realsenseworkerpool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Amount of row ranges per worker thread, more ranges than threads balances uneven rows
+     */
+    static constexpr int sRangesPerThread = 4;
+
+
+    /**
+     * @return true if all vertices are valid and within the maximum depth step of each other
+     */
+    static inline bool isContinuous(uint16 a, uint16 b, uint16 c, uint16 maxStep)
+    {
+        if(a == 0 || b == 0 || c == 0)
+            return false;
+        return std::max(a, std::max(b, c)) - std::min(a, std::min(b, c)) <= maxStep;
+    }
+
+
+    static inline int difference(uint16 a, uint16 b)
+    {
+        return a > b ? a - b : b - a;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDepthTriangulator
+    //////////////////////////////////////////////////////////////////////////
+
+    size_t RealSenseDepthTriangulator::getMaxIndexCount(int columns, int rows)
+    {
+        if(columns < 2 || rows < 2)
+            return 0;
+        return static_cast<size_t>(columns - 1) * static_cast<size_t>(rows - 1) * 6;
+    }
+
+
+    void RealSenseDepthTriangulator::triangulate(const uint16* depth, int depthStride, int width, int height, const Parameters& parameters,
+                                                 RealSenseWorkerPool* pool, std::vector<uint32>& indices)
+    {
+        indices.clear();
+        int columns = parameters.mColumns;
+        int rows = parameters.mRows;
+        if(columns < 2 || rows < 2 || width <= 0 || height <= 0)
+            return;
+
+        // vertex (column, row) samples the pixel under the center of its part of the frame
+        mGrid.resize(static_cast<size_t>(columns) * static_cast<size_t>(rows));
+        mSampleColumns.resize(columns);
+        for(int column = 0; column < columns; column++)
+            mSampleColumns[column] = std::min(width - 1, static_cast<int>((column + 0.5) * width / columns));
+
+        int threads = pool != nullptr ? pool->getThreadCount() + 1 : 1;
+        int ranges = std::max(1, std::min(rows - 1, threads * sRangesPerThread));
+        if(static_cast<int>(mTaskIndices.size()) != ranges)
+        {
+            mTaskIndices.resize(ranges);
+            mTaskCounts.resize(ranges);
+        }
+
+        RealSenseWorkerPool::parallelFor(pool, ranges, [&](int range)
+        {
+            int begin = static_cast<int>(static_cast<int64>(rows) * range / ranges);
+            int end = static_cast<int>(static_cast<int64>(rows) * (range + 1) / ranges);
+            for(int row = begin; row < end; row++)
+            {
+                int sample_row = std::min(height - 1, static_cast<int>((row + 0.5) * height / rows));
+                const auto* values = reinterpret_cast<const uint16*>(reinterpret_cast<const uint8*>(depth) + static_cast<size_t>(sample_row) * static_cast<size_t>(depthStride));
+                uint16* grid = mGrid.data() + static_cast<size_t>(row) * static_cast<size_t>(columns);
+                for(int column = 0; column < columns; column++)
+                    grid[column] = values[mSampleColumns[column]];
+            }
+        });
+
+        // triangles of the cell rows of every range
+        uint16 max_step = parameters.mMaxDepthStep;
+        int cell_rows = rows - 1;
+        RealSenseWorkerPool::parallelFor(pool, ranges, [&](int range)
+        {
+            int begin = static_cast<int>(static_cast<int64>(cell_rows) * range / ranges);
+            int end = static_cast<int>(static_cast<int64>(cell_rows) * (range + 1) / ranges);
+
+            // room for every triangle of the range, only grows
+            auto& task_indices = mTaskIndices[range];
+            size_t capacity = getMaxIndexCount(columns, end - begin + 1);
+            if(task_indices.size() < capacity)
+                task_indices.resize(capacity);
+            uint32* target = task_indices.data();
+            for(int row = begin; row < end; row++)
+            {
+                const uint16* top = mGrid.data() + static_cast<size_t>(row) * static_cast<size_t>(columns);
+                const uint16* bottom = top + columns;
+                uint32 top_index = static_cast<uint32>(row * columns);
+                uint32 bottom_index = top_index + static_cast<uint32>(columns);
+                for(int column = 0; column + 1 < columns; column++)
+                {
+                    // corners: a top left, b top right, c bottom left, d bottom right
+                    uint16 a = top[column], b = top[column + 1], c = bottom[column], d = bottom[column + 1];
+                    uint32 ia = top_index + column, ib = ia + 1, ic = bottom_index + column, id = ic + 1;
+                    bool split_ad = (a != 0 && d != 0) && (b == 0 || c == 0 || difference(a, d) <= difference(b, c));
+                    if(split_ad)
+                    {
+                        if(isContinuous(a, c, d, max_step))
+                        {
+                            target[0] = ia; target[1] = ic; target[2] = id;
+                            target += 3;
+                        }
+                        if(isContinuous(a, d, b, max_step))
+                        {
+                            target[0] = ia; target[1] = id; target[2] = ib;
+                            target += 3;
+                        }
+                    }
+                    else
+                    {
+                        if(isContinuous(a, c, b, max_step))
+                        {
+                            target[0] = ia; target[1] = ic; target[2] = ib;
+                            target += 3;
+                        }
+                        if(isContinuous(b, c, d, max_step))
+                        {
+                            target[0] = ib; target[1] = ic; target[2] = id;
+                            target += 3;
+                        }
+                    }
+                }
+            }
+            mTaskCounts[range] = static_cast<size_t>(target - task_indices.data());
+        });
+
+        // concatenate the ranges in row order
+        size_t count = 0;
+        for(size_t task_count : mTaskCounts)
+            count += task_count;
+        indices.resize(count);
+
+        uint32* target = indices.data();
+        for(int range = 0; range < ranges; range++)
+        {
+            if(mTaskCounts[range] > 0)
+                std::memcpy(target, mTaskIndices[range].data(), mTaskCounts[range] * sizeof(uint32));
+            target += mTaskCounts[range];
+        }
+    }
+}
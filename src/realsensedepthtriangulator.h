@@ -0,0 +1,65 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseWorkerPool;
+
+    /**
+     * RealSenseDepthTriangulator
+     * Builds the triangles of an organized mesh over a depth frame: a grid of columns x rows vertices, every vertex samples
+     * the depth pixel at the center of its part of the frame, the grid is usually coarser than the frame.
+     * Every grid cell is split into two triangles along the diagonal with the smallest depth difference. Triangles with an invalid
+     * vertex, or with vertices further apart in depth than the maximum depth step, span a discontinuity and are dropped.
+     * Only indices are produced, vertex positions are computed from the depth texture by the shader.
+     * Rows are split into tasks on the worker pool, every task collects its own indices.
+     * Buffers are only allocated when the grid grows.
+     */
+    class NAPAPI RealSenseDepthTriangulator final
+    {
+    public:
+        /**
+         * Triangulation parameters
+         */
+        struct Parameters
+        {
+            int mColumns = 424;                         ///< Amount of vertices along x
+            int mRows = 240;                            ///< Amount of vertices along y
+            uint16 mMaxDepthStep = 50;                  ///< Maximum depth difference of the vertices of a triangle in depth units
+        };
+
+        /**
+         * Computes the triangles of a depth frame
+         * @param depth depth values of the frame
+         * @param depthStride stride of the depth frame in bytes
+         * @param width width of the depth frame
+         * @param height height of the depth frame
+         * @param parameters triangulation parameters
+         * @param pool worker pool to split the rows over, nullptr triangulates on the calling thread
+         * @param indices receives 3 vertex indices per triangle, vertex (column, row) has index row * columns + column
+         */
+        void triangulate(const uint16* depth, int depthStride, int width, int height, const Parameters& parameters,
+                         RealSenseWorkerPool* pool, std::vector<uint32>& indices);
+
+        /**
+         * @return the maximum amount of indices of a grid
+         */
+        static size_t getMaxIndexCount(int columns, int rows);
+
+    private:
+        std::vector<uint16> mGrid;                      ///< Sampled depth per vertex, row major
+        std::vector<int> mSampleColumns;                ///< Depth frame column of every grid column
+        std::vector<std::vector<uint32>> mTaskIndices;  ///< Indices per task, sized for every triangle of the task
+        std::vector<size_t> mTaskCounts;                ///< Amount of indices written per task
+    };
+}
@@ -2,13 +2,22 @@
 #include "realsenseservice.h"
 #include "realsenseframesetlistenercomponent.h"
 #include "realsenseframesetfilter.h"
+#include "realsenseconversion.h"
+#include "realsensemetrics.h"
+#include "realsensetrace.h"
 
 // RealSense includes
 #include <rs.hpp>
+#include <chrono>
+#include <limits>
 
 RTTI_BEGIN_CLASS(nap::RealSenseStreamDescription)
     RTTI_PROPERTY("Format", &nap::RealSenseStreamDescription::mFormat, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("Stream", &nap::RealSenseStreamDescription::mStream, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Width", &nap::RealSenseStreamDescription::mWidth, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Height", &nap::RealSenseStreamDescription::mHeight, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Fps", &nap::RealSenseStreamDescription::mFps, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Auto", &nap::RealSenseStreamDescription::mAuto, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseDevice)
@@ -17,11 +26,284 @@ RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseDevice)
     RTTI_PROPERTY("MaxFrameSize", &nap::RealSenseDevice::mMaxFrameSize, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("Streams", &nap::RealSenseDevice::mStreams, nap::rtti::EPropertyMetaData::Embedded)
     RTTI_PROPERTY("Filters", &nap::RealSenseDevice::mFilters, nap::rtti::EPropertyMetaData::Embedded)
+    RTTI_PROPERTY("FrameBudget", &nap::RealSenseDevice::mFrameBudget, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("AllowFailure", &nap::RealSenseDevice::mAllowFailure, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("AsyncStart", &nap::RealSenseDevice::mAsyncStart, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MotionQueueSize", &nap::RealSenseDevice::mMotionQueueSize, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("FrameArenaSize", &nap::RealSenseDevice::mFrameArenaSize, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 namespace nap
 {
+    //////////////////////////////////////////////////////////////////////////
+    // Static functions
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * @return bytes per pixel of a video format as transferred over USB, 0 for compressed and motion formats
+     */
+    static float getBytesPerPixel(rs2_format format)
+    {
+        switch(format)
+        {
+        case RS2_FORMAT_Y8:
+        case RS2_FORMAT_RAW8:
+        case RS2_FORMAT_INVI:
+            return 1.0f;
+        case RS2_FORMAT_RAW10:
+        case RS2_FORMAT_W10:
+            return 1.25f;
+        case RS2_FORMAT_Z16:
+        case RS2_FORMAT_DISPARITY16:
+        case RS2_FORMAT_YUYV:
+        case RS2_FORMAT_UYVY:
+        case RS2_FORMAT_Y16:
+        case RS2_FORMAT_RAW16:
+        case RS2_FORMAT_Y10BPACK:
+        case RS2_FORMAT_Y8I:
+            return 2.0f;
+        case RS2_FORMAT_RGB8:
+        case RS2_FORMAT_BGR8:
+        case RS2_FORMAT_Y12I:
+            return 3.0f;
+        case RS2_FORMAT_RGBA8:
+        case RS2_FORMAT_BGRA8:
+        case RS2_FORMAT_DISPARITY32:
+        case RS2_FORMAT_DISTANCE:
+        case RS2_FORMAT_INZI:
+            return 4.0f;
+        case RS2_FORMAT_XYZ32F:
+            return 12.0f;
+        default:
+            return 0.0f;
+        }
+    }
+
+
+    /**
+     * @return estimated bandwidth of a video stream profile in Mbit/s
+     */
+    static double getBandwidth(const rs2::video_stream_profile& profile)
+    {
+        return static_cast<double>(profile.width()) * profile.height() * profile.fps() *
+               getBytesPerPixel(profile.format()) * 8.0 / 1000000.0;
+    }
+
+
+    /**
+     * @return true if the stream type carries images
+     */
+    static bool isVideoStream(ERealSenseStreamType stream)
+    {
+        return stream == ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH ||
+               stream == ERealSenseStreamType::REALSENSE_STREAMTYPE_COLOR ||
+               stream == ERealSenseStreamType::REALSENSE_STREAMTYPE_INFRARED ||
+               stream == ERealSenseStreamType::REALSENSE_STREAMTYPE_FISH_EYE ||
+               stream == ERealSenseStreamType::REALSENSE_STREAMTYPE_CONFIDENCE;
+    }
+
+
+    /**
+     * @return true if the stream type carries motion samples, these streams are read from the sensor directly
+     */
+    static bool isMotionStream(ERealSenseStreamType stream)
+    {
+        return stream == ERealSenseStreamType::REALSENSE_STREAMTYPE_GYRO ||
+               stream == ERealSenseStreamType::REALSENSE_STREAMTYPE_ACCEL;
+    }
+
+
+    /**
+     * Finds the sensor and profile of a motion stream description, prefers the default profile when fps is any
+     */
+    static bool selectMotionProfile(const rs2::device& device, const RealSenseStreamDescription& description,
+                                    rs2::sensor& sensor, rs2::stream_profile& profile)
+    {
+        bool found = false;
+        for(const auto& candidate_sensor : device.query_sensors())
+        {
+            for(const auto& candidate : candidate_sensor.get_stream_profiles())
+            {
+                if(candidate.stream_type() != static_cast<rs2_stream>(description.mStream) ||
+                   candidate.format() != static_cast<rs2_format>(description.mFormat) ||
+                   (description.mFps > 0 && candidate.fps() != description.mFps))
+                    continue;
+
+                if(!found || (candidate.is_default() && !profile.is_default()))
+                {
+                    sensor = candidate_sensor;
+                    profile = candidate;
+                    found = true;
+                }
+            }
+        }
+        return found;
+    }
+
+
+    /**
+     * @return true if a video profile can serve a stream description, auto descriptions hold minimums and fixed descriptions exact values
+     */
+    static bool matchesProfile(const rs2::video_stream_profile& profile, const RealSenseStreamDescription& description)
+    {
+        auto format = static_cast<rs2_format>(description.mFormat);
+        if(profile.stream_type() != static_cast<rs2_stream>(description.mStream) || (format != RS2_FORMAT_ANY && profile.format() != format))
+            return false;
+
+        if(description.mAuto)
+            return profile.width() >= description.mWidth && profile.height() >= description.mHeight && profile.fps() >= description.mFps;
+
+        return (description.mWidth <= 0 || profile.width() == description.mWidth) &&
+               (description.mHeight <= 0 || profile.height() == description.mHeight) &&
+               (description.mFps <= 0 || profile.fps() == description.mFps);
+    }
+
+
+    /**
+     * Selects the profiles of the auto video streams with the lowest summed estimated bandwidth.
+     * All streams of a sensor, such as depth and infrared of the stereo module, share the resolution and fps of the sensor.
+     * The profiles are therefore selected jointly per sensor: every resolution and fps of the sensor is tried and the
+     * combination with the lowest bandwidth that serves all streams of the sensor wins. Fixed streams on the same sensor
+     * constrain the resolution and fps, they keep their own settings.
+     * @param device the device to query
+     * @param descriptions the stream descriptions of the device
+     * @param profiles receives the selected profile of every auto video stream
+     * @param errorState contains the streams that could not be served
+     * @return true if a profile was found for every auto video stream
+     */
+    static bool selectProfiles(const rs2::device& device, const std::vector<ResourcePtr<RealSenseStreamDescription>>& descriptions,
+                               std::unordered_map<const RealSenseStreamDescription*, rs2::video_stream_profile>& profiles,
+                               utility::ErrorState& errorState)
+    {
+        struct Mode
+        {
+            int mWidth;
+            int mHeight;
+            int mFps;
+            bool operator==(const Mode& other) const { return mWidth == other.mWidth && mHeight == other.mHeight && mFps == other.mFps; }
+        };
+
+        std::vector<const RealSenseStreamDescription*> remaining;
+        for(const auto& description : descriptions)
+        {
+            if(isVideoStream(description->mStream))
+                remaining.emplace_back(description.get());
+        }
+
+        for(const auto& sensor : device.query_sensors())
+        {
+            std::vector<rs2::video_stream_profile> candidates;
+            std::vector<Mode> modes;
+            for(const auto& profile : sensor.get_stream_profiles())
+            {
+                if(!profile.is<rs2::video_stream_profile>())
+                    continue;
+
+                auto video = profile.as<rs2::video_stream_profile>();
+                Mode mode = { video.width(), video.height(), video.fps() };
+                if(std::find(modes.begin(), modes.end(), mode) == modes.end())
+                    modes.emplace_back(mode);
+                candidates.emplace_back(video);
+            }
+
+            // the streams served by this sensor, a stream type is served by the first sensor that offers it
+            std::vector<const RealSenseStreamDescription*> group;
+            for(auto it = remaining.begin(); it != remaining.end();)
+            {
+                auto stream = static_cast<rs2_stream>((*it)->mStream);
+                if(std::find_if(candidates.begin(), candidates.end(), [stream](const auto& candidate) { return candidate.stream_type() == stream; }) == candidates.end())
+                {
+                    ++it;
+                    continue;
+                }
+                group.emplace_back(*it);
+                it = remaining.erase(it);
+            }
+
+            if(std::none_of(group.begin(), group.end(), [](const auto* description) { return description->mAuto; }))
+                continue;
+
+            // prefer the smallest resolution on equal bandwidth, so an unknown format does not win by default
+            double lowest = std::numeric_limits<double>::max();
+            int lowest_area = std::numeric_limits<int>::max();
+            std::vector<rs2::video_stream_profile> selection(group.size());
+            std::vector<rs2::video_stream_profile> best;
+            for(const auto& mode : modes)
+            {
+                double bandwidth = 0.0;
+                bool served = true;
+                for(size_t i = 0; i < group.size() && served; i++)
+                {
+                    served = false;
+                    double stream_bandwidth = std::numeric_limits<double>::max();
+                    for(const auto& candidate : candidates)
+                    {
+                        if(!(Mode{ candidate.width(), candidate.height(), candidate.fps() } == mode) || !matchesProfile(candidate, *group[i]))
+                            continue;
+
+                        double candidate_bandwidth = getBandwidth(candidate);
+                        if(!served || candidate_bandwidth < stream_bandwidth)
+                        {
+                            stream_bandwidth = candidate_bandwidth;
+                            selection[i] = candidate;
+                            served = true;
+                        }
+                    }
+                    bandwidth += stream_bandwidth;
+                }
+
+                int area = mode.mWidth * mode.mHeight;
+                if(served && (bandwidth < lowest || (bandwidth == lowest && area < lowest_area)))
+                {
+                    lowest = bandwidth;
+                    lowest_area = area;
+                    best = selection;
+                }
+            }
+
+            if(best.empty())
+            {
+                std::string streams;
+                for(const auto* description : group)
+                    streams += (streams.empty() ? "" : ", ") + description->mID;
+                errorState.fail("No resolution and fps of sensor %s serves all of its streams: %s",
+                                sensor.supports(RS2_CAMERA_INFO_NAME) ? sensor.get_info(RS2_CAMERA_INFO_NAME) : "unknown", streams.c_str());
+                return false;
+            }
+
+            for(size_t i = 0; i < group.size(); i++)
+            {
+                if(group[i]->mAuto)
+                    profiles[group[i]] = best[i];
+            }
+        }
+
+        for(const auto* description : remaining)
+        {
+            if(!errorState.check(!description->mAuto, "%s: no sensor provides a %s stream", description->mID.c_str(),
+                                 rs2_stream_to_string(static_cast<rs2_stream>(description->mStream))))
+                return false;
+        }
+        return true;
+    }
+
+
+    /**
+     * @return the device with the given serial, or the first device when serial is empty, an empty device when not connected
+     */
+    static rs2::device findDevice(rs2::context& context, const std::string& serial)
+    {
+        for(auto&& device : context.query_devices())
+        {
+            if(serial.empty())
+                return device;
+
+            if(device.supports(RS2_CAMERA_INFO_SERIAL_NUMBER) && serial == device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER))
+                return device;
+        }
+        return rs2::device();
+    }
+
     //////////////////////////////////////////////////////////////////////////
     // RealSenseDevice::Impl
     //////////////////////////////////////////////////////////////////////////
@@ -29,6 +311,88 @@ namespace nap
     struct RealSenseDevice::Impl
     {
     public:
+        /**
+         * Metrics of a single input stream, counted before the device filters
+         */
+        struct StreamMetrics
+        {
+            RealSenseMetric* mFrames = nullptr;
+            RealSenseMetric* mBytes = nullptr;
+            RealSenseMetric* mDropped = nullptr;
+            unsigned long long mLastFrameNumber = 0;
+        };
+
+        /**
+         * Metrics of a single motion stream, updated from the sensor callback
+         */
+        struct MotionMetrics
+        {
+            RealSenseMetric* mSamples = nullptr;
+            RealSenseMetric* mDropped = nullptr;
+            RealSenseMetric* mQueueDepth = nullptr;
+        };
+
+        Impl(rs2::context& context) : mPipe(context) { }
+
+        /**
+         * Returns the metrics of the stream of a frame, the metrics are registered when the stream is seen for the first time
+         */
+        StreamMetrics& getStreamMetrics(const rs2::stream_profile& profile, RealSenseMetricsRegistry& registry, const std::string& source)
+        {
+            auto it = mStreamMetrics.find(profile.unique_id());
+            if(it != mStreamMetrics.end())
+                return it->second;
+
+            std::string name = profile.stream_name();
+            StreamMetrics metrics;
+            metrics.mFrames = &registry.getMetric(source, name + " frames", ERealSenseMetricType::Counter);
+            metrics.mBytes = &registry.getMetric(source, name + " bytes", ERealSenseMetricType::Counter);
+            metrics.mDropped = &registry.getMetric(source, name + " dropped", ERealSenseMetricType::Counter);
+            return mStreamMetrics.emplace(profile.unique_id(), metrics).first->second;
+        }
+
+        /**
+         * Stops and closes the motion sensors and the pipe that were started, stopping the streams of an unplugged camera can fail
+         */
+        void stopStreams(const std::string& id)
+        {
+            for(auto& sensor : mMotionSensors)
+            {
+                // a sensor that failed to start is only closed
+                try
+                {
+                    sensor.stop();
+                }
+                catch(const std::exception& e)
+                {
+                    nap::Logger::warn("%s: %s", id.c_str(), e.what());
+                }
+
+                try
+                {
+                    sensor.close();
+                }
+                catch(const std::exception& e)
+                {
+                    nap::Logger::warn("%s: %s", id.c_str(), e.what());
+                }
+            }
+            mMotionSensors.clear();
+
+            if(mPipeStarted)
+            {
+                try
+                {
+                    mPipe.stop();
+                }
+                catch(const std::exception& e)
+                {
+                    nap::Logger::warn("%s: %s", id.c_str(), e.what());
+                }
+                mPipeStarted = false;
+            }
+        }
+
         // Declare RealSense pipeline, encapsulating the actual device and sensors
         rs2::pipeline mPipe;
 
@@ -37,6 +401,41 @@ namespace nap
 
         // Pipe configuration
         rs2::config mConfig;
+
+        // Unique id of the last seen stream profile per stream type, used to detect intrinsics changes
+        std::unordered_map<ERealSenseStreamType, int> mProfileIDs;
+
+        // Motion sensors opened outside of the pipeline
+        std::vector<rs2::sensor> mMotionSensors;
+
+        // If the pipeline was started, false when only motion streams are requested
+        bool mPipeStarted = false;
+
+        // Metrics per input stream, keyed by the unique id of the stream profile, only accessed from the capture thread
+        std::unordered_map<int, StreamMetrics> mStreamMetrics;
+
+        // Metrics per motion stream, filled before the motion sensors are started
+        std::unordered_map<ERealSenseStreamType, MotionMetrics> mMotionMetrics;
+
+        // Metrics of the frameset hand-over
+        RealSenseMetric* mDelivered = nullptr;
+        RealSenseMetric* mFilterTime = nullptr;
+        RealSenseMetric* mListenerTime = nullptr;
+
+        // Metrics of the filter budget, the gauge is 1 while optional filters are skipped
+        RealSenseMetric* mDegrades = nullptr;
+        RealSenseMetric* mDegradedFrames = nullptr;
+        RealSenseMetric* mDegraded = nullptr;
+
+        // Metrics of the frame arenas
+        RealSenseMetric* mArenaUsage = nullptr;
+        RealSenseMetric* mArenaPeak = nullptr;
+        RealSenseMetric* mArenaLeased = nullptr;
+
+        // Metrics of the connection, the reconnect timer holds the time between a disconnect and streaming again
+        RealSenseMetric* mReconnects = nullptr;
+        RealSenseMetric* mDisconnects = nullptr;
+        RealSenseMetric* mReconnectTime = nullptr;
     };
 
     //////////////////////////////////////////////////////////////////////////
@@ -65,150 +464,492 @@ namespace nap
             return false;
         };
 
-        if(!mRun.load())
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        if(mState.load() != ERealSenseDeviceState::Stopped)
+            return handle_error("RealSenseDevice already started.");
+
+        // a stop cancelled an open that is still in progress, continue with that open instead of waiting for it
+        if(mOpening)
         {
-            // create implementation and framequeue
-            mImplementation = std::make_unique<Impl>();
-            mImplementation->mFrameQueue = rs2::frame_queue(mMaxFrameSize);
+            mStartTime = std::chrono::steady_clock::now();
+            mTimeToFirstFrame.store(-1.0);
+            mState.store(ERealSenseDeviceState::Connecting);
+            mService.registerDevice(*this);
+            return true;
+        }
 
-            // Check if serial is available
-            if(!mSerial.empty())
+        // check for duplicate stream descriptions
+        std::vector<ERealSenseStreamType> stream_types;
+        for(const auto &stream: mStreams)
+        {
+            auto stream_type = stream->mStream;
+            if(std::find_if(stream_types.begin(),
+                            stream_types.end(),
+                            [stream_type](ERealSenseStreamType other)
+                            { return stream_type == other; }) != stream_types.end())
             {
-                if(!mService.hasSerialNumber(mSerial))
-                {
-                    return handle_error(utility::stringFormat("Device with serial number %s is not connected", mSerial.c_str()));
-                }
+                return handle_error("Cannot open multiple streams of the same stream type!");
             }
+            stream_types.emplace_back(stream_type);
+        }
+
+        // the queues outlive reconnects, samples are drained from the main thread
+        mMotionQueues.clear();
+        for(const auto& stream : mStreams)
+        {
+            if(isMotionStream(stream->mStream))
+                mMotionQueues[stream->mStream] = std::make_unique<RealSenseMotionQueue>(mMotionQueueSize);
+        }
 
-            // set all streams in config
-            std::vector<ERealSenseStreamType> stream_types;
+        // the arenas outlive reconnects, leases handed out before a restart stay valid
+        if(mFrameArenas == nullptr)
+        {
+            if(mFrameArenaSize < 0)
+                return handle_error("Frame arena size can't be negative.");
+            mFrameArenas = std::make_unique<RealSenseFrameArenaPool>(static_cast<size_t>(mFrameArenaSize) * 1024);
+        }
+
+        mFilterBudget.configure(mID, mFrameBudget);
+        for(auto& filter : mFilters)
+            filter->setDegraded(false);
+
+        mStartTime = std::chrono::steady_clock::now();
+        mTimeToFirstFrame.store(-1.0);
+
+        // open the pipe on a separate thread
+        if(mAsyncStart)
+        {
+            mState.store(ERealSenseDeviceState::Connecting);
+            mService.registerDevice(*this);
+            mOpening = true;
+            mStartTask = std::async(std::launch::async, [this] { openAsync(false); });
+            return true;
+        }
+
+        utility::ErrorState open_error;
+        if(!open(open_error))
+        {
+            if(!mAllowFailure)
+                return handle_error(open_error.toString());
+
+            // the service starts the device when the camera is connected
+            mState.store(ERealSenseDeviceState::Disconnected);
+            mDisconnectTime = std::chrono::steady_clock::now();
+            mService.registerDevice(*this);
+            return handle_error(open_error.toString());
+        }
+
+        startCapture();
+        mService.registerDevice(*this);
+        return true;
+    }
+
+
+    bool RealSenseDevice::open(utility::ErrorState& errorState)
+    {
+        // create implementation and framequeue
+        mImplementation = std::make_unique<Impl>(mService.getContext());
+        mImplementation->mFrameQueue = rs2::frame_queue(mMaxFrameSize);
+
+        // metrics outlive reconnects, registering them again returns the existing metrics
+        auto& metrics = mService.getMetrics();
+        mImplementation->mDelivered = &metrics.getMetric(mID, "Framesets delivered", ERealSenseMetricType::Counter);
+        mImplementation->mFilterTime = &metrics.getMetric(mID, "Filter chain", ERealSenseMetricType::Timer);
+        mImplementation->mDegrades = &metrics.getMetric(mID, "Degrades", ERealSenseMetricType::Counter);
+        mImplementation->mDegradedFrames = &metrics.getMetric(mID, "Degraded frames", ERealSenseMetricType::Counter);
+        mImplementation->mDegraded = &metrics.getMetric(mID, "Degraded", ERealSenseMetricType::Gauge);
+        mImplementation->mDegraded->set(mFilterBudget.isDegraded() ? 1 : 0);
+        mImplementation->mListenerTime = &metrics.getMetric(mID, "Listeners", ERealSenseMetricType::Timer);
+        mImplementation->mArenaUsage = &metrics.getMetric(mID, "Arena bytes", ERealSenseMetricType::Gauge);
+        mImplementation->mArenaPeak = &metrics.getMetric(mID, "Arena peak bytes", ERealSenseMetricType::Gauge);
+        mImplementation->mArenaLeased = &metrics.getMetric(mID, "Arenas leased", ERealSenseMetricType::Gauge);
+        mImplementation->mReconnects = &metrics.getMetric(mID, "Reconnects", ERealSenseMetricType::Counter);
+        mImplementation->mDisconnects = &metrics.getMetric(mID, "Disconnects", ERealSenseMetricType::Counter);
+        mImplementation->mReconnectTime = &metrics.getMetric(mID, "Reconnect", ERealSenseMetricType::Timer);
+        for(const auto& entry : mMotionQueues)
+        {
+            std::string name = rs2_stream_to_string(static_cast<rs2_stream>(entry.first));
+            auto& motion_metrics = mImplementation->mMotionMetrics[entry.first];
+            motion_metrics.mSamples = &metrics.getMetric(mID, name + " samples", ERealSenseMetricType::Counter);
+            motion_metrics.mDropped = &metrics.getMetric(mID, name + " dropped", ERealSenseMetricType::Counter);
+            motion_metrics.mQueueDepth = &metrics.getMetric(mID, name + " queue", ERealSenseMetricType::Gauge);
+        }
+
+        // stops the streams that were started when open fails halfway, the motion callbacks must not outlive this implementation
+        struct StreamGuard
+        {
+            ~StreamGuard()          { if(!mOpened) mImplementation.stopStreams(mID); }
+            Impl& mImplementation;
+            const std::string& mID;
+            bool mOpened;
+        } stream_guard = { *mImplementation, mID, false };
+
+        // Check if serial is available
+        if(!mSerial.empty())
+        {
+            if(!errorState.check(mService.hasSerialNumber(mSerial), "Device with serial number %s is not connected", mSerial.c_str()))
+                return false;
+        }
+
+        try
+        {
+            // select the lowest bandwidth profiles of the device that will be opened, jointly per sensor
+            std::unordered_map<const RealSenseStreamDescription*, rs2::video_stream_profile> auto_profiles;
+            bool has_auto = std::any_of(mStreams.begin(), mStreams.end(), [](const auto& stream) { return stream->mAuto && isVideoStream(stream->mStream); });
+            if(has_auto)
+            {
+                auto rs2_device = findDevice(mService.getContext(), mSerial);
+                if(!errorState.check(rs2_device, "No RealSense device connected to select the stream profiles"))
+                    return false;
+
+                if(!selectProfiles(rs2_device, mStreams, auto_profiles, errorState))
+                    return false;
+            }
+
+            // set all streams in config, motion streams are opened on the sensor directly
+            int pipe_streams = 0;
             for(const auto &stream: mStreams)
             {
-                // check for duplicate stream descriptions
-                auto stream_type = stream->mStream;
-                if(std::find_if(stream_types.begin(),
-                                stream_types.end(),
-                                [stream_type](ERealSenseStreamType other)
-                                { return stream_type == other; }) != stream_types.end())
-                {
-                    return handle_error("Cannot open multiple streams of the same stream type!");
-                }
-                stream_types.emplace_back(stream_type);
+                if(isMotionStream(stream->mStream))
+                    continue;
 
-                // enable stream in config
+                pipe_streams++;
                 auto rs2_stream_type = static_cast<rs2_stream>(stream->mStream);
                 auto rs2_stream_format = static_cast<rs2_format>(stream->mFormat);
-                mImplementation->mConfig.enable_stream(rs2_stream_type, rs2_stream_format);
+                auto profile_it = auto_profiles.find(stream.get());
+                if(profile_it != auto_profiles.end())
+                {
+                    const auto& profile = profile_it->second;
+                    mImplementation->mConfig.enable_stream(rs2_stream_type, profile.stream_index(), profile.width(), profile.height(),
+                                                           profile.format(), profile.fps());
+                }
+                else
+                {
+                    mImplementation->mConfig.enable_stream(rs2_stream_type, -1, stream->mWidth, stream->mHeight, rs2_stream_format, stream->mFps);
+                }
             }
 
             // set serial in config
             if(!mSerial.empty())
                 mImplementation->mConfig.enable_device(mSerial);
 
-            try
+            // open pipe, without video streams the pipeline would enable its default streams
+            rs2::device device;
+            if(pipe_streams > 0)
             {
-                // open pipe
                 mImplementation->mPipe.start(mImplementation->mConfig);
+                mImplementation->mPipeStarted = true;
+                device = mImplementation->mPipe.get_active_profile().get_device();
+            }
+            else
+            {
+                device = findDevice(mService.getContext(), mSerial);
+                if(!errorState.check(device, "No RealSense device connected"))
+                    return false;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mActiveSerialMutex);
+                mActiveSerial = device.supports(RS2_CAMERA_INFO_SERIAL_NUMBER) ? device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER) : "";
+            }
 
-                // fetch camera intrinsics for each stream type
-                for(auto &stream: mStreams)
+            // log the selected profiles and their estimated USB bandwidth
+            double total_bandwidth = 0.0;
+            auto active_profiles = mImplementation->mPipeStarted ? mImplementation->mPipe.get_active_profile().get_streams() :
+                                                                   std::vector<rs2::stream_profile>();
+            for(const auto& profile : active_profiles)
+            {
+                if(profile.is<rs2::video_stream_profile>())
                 {
-                    if(stream->mStream == ERealSenseStreamType::REALSENSE_STREAMTYPE_COLOR)
-                    {
-                        auto intrinsics_rs2 = mImplementation->mPipe
-                                .get_active_profile()
-                                .get_stream(static_cast<rs2_stream>(stream->mStream))
-                                .as<rs2::video_stream_profile>()
-                                .get_intrinsics();
-
-                        RealSenseCameraIntrincics intrinsics{};
-                        intrinsics.mHeight = intrinsics_rs2.height;
-                        intrinsics.mWidth = intrinsics_rs2.width;
-                        for(int i = 0;i < 5;i++)
-                        {
-                            intrinsics.mCoeffs[i] = intrinsics_rs2.coeffs[i];
-                        }
-                        intrinsics.mFX = intrinsics_rs2.fx;
-                        intrinsics.mFY = intrinsics_rs2.fy;
-                        intrinsics.mPPX = intrinsics_rs2.ppx;
-                        intrinsics.mPPY = intrinsics_rs2.ppy;
-                        intrinsics.mModel = static_cast<ERealSenseDistortionModels>(intrinsics_rs2.model);
-                        mCameraIntrinsics.emplace(ERealSenseStreamType::REALSENSE_STREAMTYPE_COLOR, intrinsics);
-                    }else if(stream->mStream == ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH)
-                    {
-                        auto intrinsics_rs2 = mImplementation->mPipe
-                                .get_active_profile()
-                                .get_stream(static_cast<rs2_stream>(stream->mStream))
-                                .as<rs2::video_stream_profile>()
-                                .get_intrinsics();
-
-                        RealSenseCameraIntrincics intrinsics{};
-                        intrinsics.mHeight = intrinsics_rs2.height;
-                        intrinsics.mWidth = intrinsics_rs2.width;
-                        for(int i = 0;i < 5;i++)
-                        {
-                            intrinsics.mCoeffs[i] = intrinsics_rs2.coeffs[i];
-                        }
-                        intrinsics.mFX = intrinsics_rs2.fx;
-                        intrinsics.mFY = intrinsics_rs2.fy;
-                        intrinsics.mPPX = intrinsics_rs2.ppx;
-                        intrinsics.mPPY = intrinsics_rs2.ppy;
-                        intrinsics.mModel = static_cast<ERealSenseDistortionModels>(intrinsics_rs2.model);
-                        mCameraIntrinsics.emplace(ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH, intrinsics);
-
-                        mDepthScale = mImplementation->mPipe.get_active_profile()
-                                .get_device().first<rs2::depth_sensor>()
-                                .get_depth_scale();
-                    }
+                    auto video = profile.as<rs2::video_stream_profile>();
+                    double bandwidth = getBandwidth(video);
+                    total_bandwidth += bandwidth;
+                    nap::Logger::info("%s: %s %dx%d %s at %d fps, ~%.1f Mbit/s", mID.c_str(), video.stream_name().c_str(),
+                                      video.width(), video.height(), rs2_format_to_string(video.format()), video.fps(), bandwidth);
+                }
+                else
+                {
+                    nap::Logger::info("%s: %s %s at %d fps", mID.c_str(), profile.stream_name().c_str(),
+                                      rs2_format_to_string(profile.format()), profile.fps());
                 }
-            }catch(const rs2::error& e)
+            }
+            nap::Logger::info("%s: estimated USB bandwidth ~%.1f Mbit/s", mID.c_str(), total_bandwidth);
+
+            // open the motion streams, grouped per sensor, the sensor callback feeds the motion queues
+            std::vector<std::pair<rs2::sensor, std::vector<rs2::stream_profile>>> motion_sensors;
+            for(const auto& stream : mStreams)
             {
-                return handle_error(utility::stringFormat("RealSense error calling %s(%s)\n     %s,",
-                                                          e.get_failed_function().c_str(),
-                                                          e.get_failed_args().c_str(),
-                                                          e.what()));
+                if(!isMotionStream(stream->mStream))
+                    continue;
+
+                rs2::sensor sensor;
+                rs2::stream_profile profile;
+                if(!errorState.check(selectMotionProfile(device, *stream, sensor, profile), "%s: no %s %s profile at %d fps available",
+                                     stream->mID.c_str(), rs2_stream_to_string(static_cast<rs2_stream>(stream->mStream)),
+                                     rs2_format_to_string(static_cast<rs2_format>(stream->mFormat)), stream->mFps))
+                    return false;
+
+                auto it = std::find_if(motion_sensors.begin(), motion_sensors.end(), [&sensor](const auto& entry) { return entry.first == sensor; });
+                if(it == motion_sensors.end())
+                    it = motion_sensors.insert(motion_sensors.end(), { sensor, {} });
+                it->second.emplace_back(profile);
+                nap::Logger::info("%s: %s %s at %d fps", mID.c_str(), profile.stream_name().c_str(),
+                                  rs2_format_to_string(profile.format()), profile.fps());
             }
-            catch(const std::exception& e)
+
+            for(auto& entry : motion_sensors)
             {
-                return handle_error(e.what());
+                entry.first.open(entry.second);
+                mImplementation->mMotionSensors.emplace_back(entry.first);
+                entry.first.start([this](rs2::frame frame)
+                {
+                    auto motion = frame.as<rs2::motion_frame>();
+                    if(!motion)
+                        return;
+
+                    auto it = mMotionQueues.find(static_cast<ERealSenseStreamType>(motion.get_profile().stream_type()));
+                    if(it == mMotionQueues.end())
+                        return;
+
+                    auto data = motion.get_motion_data();
+                    RealSenseMotionSample sample;
+                    sample.mTimestamp = motion.get_timestamp();
+                    sample.mValue = { data.x, data.y, data.z };
+                    sample.mStream = it->first;
+
+                    auto& motion_metrics = mImplementation->mMotionMetrics.at(it->first);
+                    motion_metrics.mSamples->add();
+                    if(!it->second->push(sample))
+                        motion_metrics.mDropped->add();
+                    motion_metrics.mQueueDepth->set(it->second->getSize());
+                });
             }
 
-            mRun.store(true);
-            mCaptureTask = std::async(std::launch::async, [this] { process(); });
+            // fetch camera intrinsics for each stream type
+            std::lock_guard<std::mutex> lock(mIntrinsicsMutex);
+            mCameraIntrinsics.clear();
+            for(auto &stream: mStreams)
+            {
+                if(stream->mStream == ERealSenseStreamType::REALSENSE_STREAMTYPE_COLOR ||
+                   stream->mStream == ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH)
+                {
+                    auto intrinsics_rs2 = mImplementation->mPipe
+                            .get_active_profile()
+                            .get_stream(static_cast<rs2_stream>(stream->mStream))
+                            .as<rs2::video_stream_profile>()
+                            .get_intrinsics();
+                    mCameraIntrinsics[stream->mStream] = realsense::toIntrinsics(intrinsics_rs2);
+                }
 
-            return true;
+                if(stream->mStream == ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH)
+                {
+                    mDepthScale = device.first<rs2::depth_sensor>().get_depth_scale();
+                }
+            }
+        }catch(const rs2::error& e)
+        {
+            errorState.fail(utility::stringFormat("RealSense error calling %s(%s)\n     %s,",
+                                                  e.get_failed_function().c_str(),
+                                                  e.get_failed_args().c_str(),
+                                                  e.what()));
+            return false;
+        }
+        catch(const std::exception& e)
+        {
+            errorState.fail(e.what());
+            return false;
         }
 
-        return handle_error("RealSenseDevice already started.");
+        stream_guard.mOpened = true;
+        return true;
     }
 
 
-    float RealSenseDevice::getDepthScale() const
+    void RealSenseDevice::startCapture()
     {
-        return mDepthScale;
+        mRun.store(true);
+        mState.store(ERealSenseDeviceState::Streaming);
+        if(mImplementation->mPipeStarted)
+            mCaptureTask = std::async(std::launch::async, [this] { process(); });
     }
 
 
-    void RealSenseDevice::stop()
+    void RealSenseDevice::openAsync(bool reconnect)
+    {
+        // the state lock is not held while opening, stop cancels the open by leaving the connecting state
+        utility::ErrorState open_error;
+        bool opened = open(open_error);
+
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        mOpening = false;
+        if(mState.load() != ERealSenseDeviceState::Connecting)
+        {
+            if(opened)
+                close();
+            return;
+        }
+
+        if(!opened)
+        {
+            mState.store(ERealSenseDeviceState::Disconnected);
+            if(reconnect)
+            {
+                nap::Logger::warn("%s: reconnect failed: %s", mID.c_str(), open_error.toString().c_str());
+                return;
+            }
+
+            mDisconnectTime = std::chrono::steady_clock::now();
+            nap::Logger::error("%s: %s", mID.c_str(), open_error.toString().c_str());
+            return;
+        }
+
+        startCapture();
+        if(reconnect)
+        {
+            auto duration = std::chrono::steady_clock::now() - mDisconnectTime;
+            auto seconds = std::chrono::duration<double>(duration).count();
+            mLastReconnectTime.store(seconds);
+            mReconnectCount++;
+            mImplementation->mReconnects->add();
+            mImplementation->mReconnectTime->record(static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+            nap::Logger::info("%s: reconnected after %.2f seconds", mID.c_str(), seconds);
+        }
+    }
+
+
+    void RealSenseDevice::close()
     {
         if(mRun.load())
         {
             mRun.store(false);
             if(mCaptureTask.valid())
                 mCaptureTask.wait();
+        }
+
+        // also stops the streams of a device that was opened but never started capturing
+        if(mImplementation != nullptr)
+            mImplementation->stopStreams(mID);
+
+        std::lock_guard<std::mutex> lock(mActiveSerialMutex);
+        mActiveSerial.clear();
+    }
+
 
-            mImplementation->mPipe.stop();
+    void RealSenseDevice::disconnect()
+    {
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        if(mState.load() != ERealSenseDeviceState::Streaming)
+            return;
+
+        close();
+        mDisconnectTime = std::chrono::steady_clock::now();
+        mDisconnectCount++;
+        mImplementation->mDisconnects->add();
+        mState.store(ERealSenseDeviceState::Disconnected);
+        nap::Logger::warn("%s: camera disconnected, waiting for reconnect", mID.c_str());
+    }
+
+
+    bool RealSenseDevice::reconnect()
+    {
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        if(mState.load() != ERealSenseDeviceState::Disconnected || mOpening)
+            return false;
+
+        // the previous open task is done, replacing its future does not block
+        mState.store(ERealSenseDeviceState::Connecting);
+        mOpening = true;
+        mStartTask = std::async(std::launch::async, [this] { openAsync(true); });
+        return true;
+    }
+
+
+    float RealSenseDevice::getDepthScale() const
+    {
+        return mDepthScale.load();
+    }
+
+
+    std::unordered_map<ERealSenseStreamType, RealSenseCameraIntrincics> RealSenseDevice::getIntrincicsMap() const
+    {
+        std::lock_guard<std::mutex> lock(mIntrinsicsMutex);
+        return mCameraIntrinsics;
+    }
+
+
+    int RealSenseDevice::getMotionSamples(std::vector<RealSenseMotionSample>& samples)
+    {
+        // every queue is in order of arrival, merging the batches orders the gyro and accel samples by timestamp
+        size_t begin = samples.size();
+        for(auto& queue : mMotionQueues)
+        {
+            size_t middle = samples.size();
+            queue.second->pop(samples);
+            std::inplace_merge(samples.begin() + begin, samples.begin() + middle, samples.end(),
+                               [](const RealSenseMotionSample& a, const RealSenseMotionSample& b) { return a.mTimestamp < b.mTimestamp; });
         }
+        return static_cast<int>(samples.size() - begin);
+    }
+
+
+    uint64 RealSenseDevice::getDroppedMotionSampleCount() const
+    {
+        uint64 dropped = 0;
+        for(const auto& queue : mMotionQueues)
+            dropped += queue.second->getDroppedCount();
+        return dropped;
+    }
+
+
+    bool RealSenseDevice::getFrameInfo(ERealSenseStreamType stream, RealSenseFrameInfo& info) const
+    {
+        std::lock_guard<std::mutex> lock(mFrameInfoMutex);
+        auto it = mFrameInfos.find(stream);
+        if(it == mFrameInfos.end())
+            return false;
+
+        info = it->second;
+        return true;
+    }
+
+
+    RealSenseFrameArenaPool::Statistics RealSenseDevice::getFrameArenaStatistics() const
+    {
+        return mFrameArenas != nullptr ? mFrameArenas->getStatistics() : RealSenseFrameArenaPool::Statistics();
+    }
+
+
+    std::string RealSenseDevice::getActiveSerial() const
+    {
+        std::lock_guard<std::mutex> lock(mActiveSerialMutex);
+        return mActiveSerial;
+    }
+
+
+    void RealSenseDevice::stop()
+    {
+        // unregister first, the service no longer schedules reconnects
+        mService.unregisterDevice(*this);
+
+        // an open in progress is cancelled instead of awaited, the open task closes the device when it completes
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        if(!mOpening)
+            close();
+        mState.store(ERealSenseDeviceState::Stopped);
     }
 
     void RealSenseDevice::onDestroy()
     {
         stop();
+
+        // the open task references this device, a cancelled open can only be awaited
+        if(mStartTask.valid())
+            mStartTask.wait();
     }
 
 
     void RealSenseDevice::addFrameSetListener(RealSenseFrameSetListenerComponentInstance* frameSetListener)
     {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
         assert(std::find(mFrameSetListeners.begin(), mFrameSetListeners.end(), frameSetListener) == mFrameSetListeners.end()); // device already exists
         mFrameSetListeners.emplace_back(frameSetListener);
     }
@@ -216,28 +957,130 @@ namespace nap
 
     void RealSenseDevice::removeFrameSetListener(RealSenseFrameSetListenerComponentInstance* frameSetListener)
     {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
         auto it = std::find(mFrameSetListeners.begin(), mFrameSetListeners.end(), frameSetListener);
         assert(it != mFrameSetListeners.end()); // device does not exist
         mFrameSetListeners.erase(it);
     }
 
 
+    void RealSenseDevice::connectFrameSetSlot(Slot<const rs2::frameset&>& slot)
+    {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
+        mFrameSetProcessed.connect(slot);
+    }
+
+
+    void RealSenseDevice::disconnectFrameSetSlot(Slot<const rs2::frameset&>& slot)
+    {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
+        mFrameSetProcessed.disconnect(slot);
+    }
+
+
     void RealSenseDevice::process()
     {
+        RealSenseTrace::setThreadName(utility::stringFormat("%s capture", mID.c_str()));
         while(mRun.load())
         {
             rs2::frameset data;
             if(mImplementation->mPipe.poll_for_frames(&data))
             {
+                RealSenseTraceScope trace(mID.c_str(), "device");
+
+                // the arena is recycled when this context and all leases retained by filters and listeners are released
+                RealSenseFrameContext context(mFrameArenas->acquire());
+
+                // count the input frames and read their metadata before the filters,
+                // gaps in the frame numbers are frames dropped by the device or pipeline
+                for(const auto& frame : data)
+                {
+                    auto& stream_metrics = mImplementation->getStreamMetrics(frame.get_profile(), mService.getMetrics(), mID);
+                    auto info = realsense::toFrameInfo(frame);
+                    if(stream_metrics.mLastFrameNumber != 0 && info.mFrameNumber > stream_metrics.mLastFrameNumber + 1)
+                    {
+                        info.mDropped = static_cast<uint32>(info.mFrameNumber - stream_metrics.mLastFrameNumber - 1);
+                        stream_metrics.mDropped->add(info.mDropped);
+                    }
+                    stream_metrics.mLastFrameNumber = info.mFrameNumber;
+                    stream_metrics.mFrames->add();
+                    stream_metrics.mBytes->add(static_cast<uint64>(frame.get_data_size()));
+                    context.addFrameInfo(info);
+
+                    std::lock_guard<std::mutex> lock(mFrameInfoMutex);
+                    mFrameInfos[info.mStream] = info;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                bool degraded = mFilterBudget.isDegraded();
+                int skipped = 0;
                 for(auto& filter : mFilters)
                 {
-                    data = filter->process(data);
+                    if(degraded && filter->mOptional)
+                    {
+                        skipped++;
+                        continue;
+                    }
+                    data = filter->process(data, &context);
+                }
+
+                // enter or leave degraded mode based on the rolling execution time of the chain
+                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+                mImplementation->mFilterTime->record(static_cast<uint64>(duration.count()));
+                if(degraded)
+                    mImplementation->mDegradedFrames->add();
+                if(mFilterBudget.record(static_cast<uint64>(duration.count()), skipped))
+                {
+                    bool now_degraded = mFilterBudget.isDegraded();
+                    if(now_degraded)
+                        mImplementation->mDegrades->add();
+                    mImplementation->mDegraded->set(now_degraded ? 1 : 0);
+                    for(auto& filter : mFilters)
+                        filter->setDegraded(now_degraded);
                 }
 
+                // update intrinsics when the stream profile of a frame changed, for example by a crop filter
+                for(const auto& frame : data)
+                {
+                    auto stream_type = static_cast<ERealSenseStreamType>(frame.get_profile().stream_type());
+                    auto it = mImplementation->mProfileIDs.find(stream_type);
+                    if(it != mImplementation->mProfileIDs.end() && it->second == frame.get_profile().unique_id())
+                        continue;
+
+                    mImplementation->mProfileIDs[stream_type] = frame.get_profile().unique_id();
+                    if(auto video_profile = frame.get_profile().as<rs2::video_stream_profile>())
+                    {
+                        std::lock_guard<std::mutex> lock(mIntrinsicsMutex);
+                        mCameraIntrinsics[stream_type] = realsense::toIntrinsics(video_profile.get_intrinsics());
+                    }
+                }
+
+                if(mTimeToFirstFrame.load() < 0.0)
+                {
+                    auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime);
+                    mTimeToFirstFrame.store(duration.count());
+                    nap::Logger::info("%s: first frame received after %.2f seconds", mID.c_str(), duration.count());
+                }
+
+                // the scope includes waiting for the listener lock
+                RealSenseTraceScope listeners_trace("Listeners", "device");
+                std::lock_guard<std::mutex> lock(mListenerMutex);
+                auto listeners_start = std::chrono::steady_clock::now();
                 for(auto* frameset_listener : mFrameSetListeners)
                 {
-                    frameset_listener->trigger(data);
+                    frameset_listener->trigger(data, context);
                 }
+                mFrameSetProcessed.trigger(data);
+
+                auto listeners_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - listeners_start);
+                mImplementation->mListenerTime->record(static_cast<uint64>(listeners_duration.count()));
+                mImplementation->mDelivered->add();
+
+                // usage of the previous framesets, the arena of this frameset can still be leased
+                auto arena_statistics = mFrameArenas->getStatistics();
+                mImplementation->mArenaUsage->set(arena_statistics.mLastUsage);
+                mImplementation->mArenaPeak->set(arena_statistics.mPeakUsage);
+                mImplementation->mArenaLeased->set(static_cast<uint64>(arena_statistics.mLeased));
             }
         }
     }
@@ -12,10 +12,15 @@
 #include <thread>
 #include <future>
 #include <atomic>
+#include <mutex>
+#include <chrono>
 
 // Local includes
 #include "realsensetypes.h"
 #include "realsenseframesetlistenercomponent.h"
+#include "realsensefilterbudget.h"
+#include "realsensemotionqueue.h"
+#include "realsenseframearena.h"
 
 
 namespace nap
@@ -25,11 +30,17 @@ namespace nap
     // forward declares
     class RealSenseService;
     class RealSenseFrameSetListenerComponentInstance;
-    class RealSenseFrameSetAlignFilter;
+    class RealSenseFrameSetFilter;
 
     /**
      * RealSenseStreamDescription
      * Describes a stream that can be fetched by a RealSenseDevice
+     * Width, height and fps select the stream profile, 0 leaves the choice to librealsense.
+     * With 'Auto' enabled width, height and fps are minimums: the device queries the profiles of its sensors and
+     * picks the profile with the lowest estimated USB bandwidth that satisfies all of them.
+     * Streams of the same sensor, such as depth and infrared, share one resolution and fps: their profiles are selected together,
+     * minimizing the summed bandwidth, and fixed streams on that sensor constrain the choice.
+     * Auto selection only applies to video streams, motion streams are always enabled with the given fps.
      */
     class NAPAPI RealSenseStreamDescription final : public Resource
     {
@@ -37,14 +48,36 @@ namespace nap
     public:
         ERealSenseStreamFormat  mFormat     = ERealSenseStreamFormat::REALSENSE_FORMAT_RGBA8; ///< Property: 'Format' The stream format
         ERealSenseStreamType    mStream     = ERealSenseStreamType::REALSENSE_STREAMTYPE_COLOR; ///< Property: 'Stream' The stream type
+        int                     mWidth      = 0;        ///< Property: 'Width' width of the stream in pixels, minimum width in auto mode, 0 is any
+        int                     mHeight     = 0;        ///< Property: 'Height' height of the stream in pixels, minimum height in auto mode, 0 is any
+        int                     mFps        = 0;        ///< Property: 'Fps' frames per second, minimum fps in auto mode, 0 is any
+        bool                    mAuto       = false;    ///< Property: 'Auto' select the lowest bandwidth profile that meets width, height and fps
+    };
+
+    /**
+     * Connection state of a RealSenseDevice
+     */
+    enum class ERealSenseDeviceState : int
+    {
+        Stopped         = 0,    ///< Device is not started
+        Connecting      = 1,    ///< Device is opening the pipeline
+        Streaming       = 2,    ///< Device is streaming frames
+        Disconnected    = 3     ///< Device failed to start or was unplugged, the service restarts the device when it is connected
     };
 
     /**
      * RealSenseDevice
      * Interface to a RealSense camera or device. Tries to fetch a stream from the device.
+     * When the camera is unplugged, or fails to start while 'AllowFailure' is enabled, the device enters the disconnected state.
+     * The RealSenseService restarts the device on a background thread as soon as a matching camera is connected.
+     * With 'AsyncStart' enabled the pipe is opened on a separate thread, start returns immediately and multiple devices open concurrently.
+     * Listeners receive framesets once the device is streaming.
+     * Gyro and accel streams bypass the pipeline and framesets: the motion sensor is opened directly and its callback pushes
+     * every sample into a lock-free ring per stream, call getMotionSamples on the main thread to drain them in one batch.
      */
     class NAPAPI RealSenseDevice final : public Device
     {
+    friend class RealSenseService;
     RTTI_ENABLE(Device)
     public:
         /**
@@ -60,14 +93,16 @@ namespace nap
 
         /**
          * Opens a pipe with the realsense camera and tries to open streams as set in the stream descriptions property.
-         * Returns false on failure
+         * Returns false on failure. When 'AsyncStart' is enabled the pipe is opened on a separate thread and only the
+         * configuration is validated, a device that fails to open asynchronously enters the disconnected state.
          * @param errorState contains any errors on start
          * @return true on success
          */
         virtual bool start(utility::ErrorState& errorState) override final;
 
         /**
-         * Closes the pipe
+         * Closes the pipe. An asynchronous start or reconnect in progress is cancelled without waiting for it,
+         * the device is closed as soon as the camera finished opening.
          */
         virtual void stop() override final;
 
@@ -88,6 +123,19 @@ namespace nap
          */
         void removeFrameSetListener(RealSenseFrameSetListenerComponentInstance* frameSetListener);
 
+        /**
+         * Connects a slot that is called from the capture thread with every processed frameset.
+         * Can be called while the device is streaming.
+         * @param slot the slot to connect
+         */
+        void connectFrameSetSlot(Slot<const rs2::frameset&>& slot);
+
+        /**
+         * Disconnects a slot connected with connectFrameSetSlot, the slot is not called anymore after this call returns.
+         * @param slot the slot to disconnect
+         */
+        void disconnectFrameSetSlot(Slot<const rs2::frameset&>& slot);
+
         /**
          * Returns depth scale of realsense device
          * @return depth scale of realsense device
@@ -95,27 +143,147 @@ namespace nap
         float getDepthScale() const;
 
         /**
-         * Returns camera intrinsics map of all available camera intrinsics
-         * @return camera intrinsics map of all available camera intrinsics
+         * Returns camera intrinsics map of all available camera intrinsics.
+         * The intrinsics follow the frames that leave the device filters, a crop or decimation filter on the device
+         * therefore results in the intrinsics of the cropped or decimated stream. Can be called from any thread.
+         * @return copy of the camera intrinsics map of all available camera intrinsics
+         */
+        std::unordered_map<ERealSenseStreamType, RealSenseCameraIntrincics> getIntrincicsMap() const;
+
+        /**
+         * Returns the frame budget of the device filter chain, snapshots can be taken from any thread
+         * @return the frame budget of the device filter chain
+         */
+        const RealSenseFilterBudget& getFilterBudget() const { return mFilterBudget; }
+
+        /**
+         * Returns the metadata of the last frame of a stream received by the capture thread, can be called from any thread.
+         * The info is read before the device filters run, the frame counter and dropped count describe the camera stream.
+         * @param stream the stream type
+         * @param info receives the frame info
+         * @return false when no frame of the stream was received yet
+         */
+        bool getFrameInfo(ERealSenseStreamType stream, RealSenseFrameInfo& info) const;
+
+        /**
+         * Returns the usage statistics of the per frameset arenas handed to filters and listeners, can be called from any thread.
+         * A growing grow count means 'FrameArenaSize' is too small for the derived data of a frameset.
+         * @return frame arena statistics
+         */
+        RealSenseFrameArenaPool::Statistics getFrameArenaStatistics() const;
+
+        /**
+         * Appends all gyro and accel samples received since the previous call, ordered by timestamp.
+         * Only call from one thread, usually the main thread once per frame.
+         * @param samples receives the motion samples
+         * @return amount of appended samples
+         */
+        int getMotionSamples(std::vector<RealSenseMotionSample>& samples);
+
+        /**
+         * @return amount of motion samples dropped because they were not drained in time, can be called from any thread
+         */
+        uint64 getDroppedMotionSampleCount() const;
+
+        /**
+         * @return current connection state, can be called from any thread
+         */
+        ERealSenseDeviceState getState() const { return mState.load(); }
+
+        /**
+         * @return serial number of the camera the device is streaming from, empty when not streaming. Can be called from any thread.
          */
-        const std::unordered_map<ERealSenseStreamType, RealSenseCameraIntrincics>& getIntrincicsMap() const
-        { return mCameraIntrinsics; }
+        std::string getActiveSerial() const;
+
+        /**
+         * @return amount of times the device was restarted after a disconnect
+         */
+        int getReconnectCount() const { return mReconnectCount.load(); }
+
+        /**
+         * @return amount of times the camera of a streaming device was unplugged
+         */
+        int getDisconnectCount() const { return mDisconnectCount.load(); }
+
+        /**
+         * @return time in seconds between the last disconnect and the device streaming again
+         */
+        double getLastReconnectTime() const { return mLastReconnectTime.load(); }
+
+        /**
+         * @return time in seconds between the call to start and the first received frameset, -1 when no frameset was received yet
+         */
+        double getTimeToFirstFrame() const { return mTimeToFirstFrame.load(); }
 
         // properties
         std::string mSerial;    ///< Property: 'Serial' Serial of the device, keep empty to assign first available device
         int mMaxFrameSize = 5;  ///< Property: 'MaxFrameSize' maximum frame size of frame queue
         std::vector<ResourcePtr<RealSenseStreamDescription>> mStreams; ///< Property: 'Streams' stream descriptions of streams to fetch from device
-        std::vector<ResourcePtr<RealSenseFrameSetAlignFilter>> mFilters; ///< Property: 'Filters' filters applied to frameset before frameset is signalled to any listeners
+        std::vector<ResourcePtr<RealSenseFrameSetFilter>> mFilters; ///< Property: 'Filters' filters applied to frameset before frameset is signalled to any listeners
+        int mFrameBudget = 0;   ///< Property: 'FrameBudget' time budget of the filter chain per frame in microseconds, optional filters are skipped when exceeded, 0 disables
         bool mAllowFailure = false; ///< Property: 'AllowFailure' allow failure of this device on initialization
+        bool mAsyncStart = false; ///< Property: 'AsyncStart' open the device on a separate thread, start does not wait for the camera
+        int mMotionQueueSize = 1024; ///< Property: 'MotionQueueSize' maximum amount of queued samples per motion stream
+        int mFrameArenaSize = 256; ///< Property: 'FrameArenaSize' initial size of the per frameset arena in kilobytes, the arena grows when exceeded
     private:
         /**
          * Threaded process function
          */
         void process();
 
+        /**
+         * Opens the pipe and the motion sensors, streams that were started are stopped again on failure.
+         * Does not start the capture thread. Must not run concurrently with close, either guarded by mStateMutex
+         * or from the open task while the device is connecting.
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool open(utility::ErrorState& errorState);
+
+        /**
+         * Starts the capture thread of an opened device and enters the streaming state, state must be guarded by mStateMutex
+         */
+        void startCapture();
+
+        /**
+         * Open task of an asynchronous start or a reconnect. Opens the device without holding mStateMutex,
+         * when stop was called in the meantime the device is closed again.
+         * @param reconnect true when reconnecting a disconnected device
+         */
+        void openAsync(bool reconnect);
+
+        /**
+         * Stops the capture thread and closes the pipe and the motion sensors, state must be guarded by mStateMutex
+         */
+        void close();
+
+        /**
+         * Closes a streaming device of which the camera was unplugged, called from the reconnect thread of the service
+         */
+        void disconnect();
+
+        /**
+         * Opens a disconnected device again on the open task, called from the reconnect thread of the service.
+         * Returns immediately, the device enters the streaming state when the open succeeds.
+         * @return true when the reconnect was scheduled
+         */
+        bool reconnect();
+
         std::future<void>		mCaptureTask;
+        std::future<void>       mStartTask;
+        bool                    mOpening = false;   ///< If the open task is in progress, guarded by mStateMutex
         std::atomic_bool        mRun = { false };
-        float                   mDepthScale = 0.0f ;
+        std::chrono::steady_clock::time_point mStartTime;
+        std::atomic<double>     mTimeToFirstFrame = { -1.0 };
+        std::atomic<ERealSenseDeviceState> mState = { ERealSenseDeviceState::Stopped };
+        std::mutex              mStateMutex;
+        std::string             mActiveSerial;
+        mutable std::mutex      mActiveSerialMutex;
+        std::chrono::steady_clock::time_point mDisconnectTime;
+        std::atomic<int>        mReconnectCount = { 0 };
+        std::atomic<int>        mDisconnectCount = { 0 };
+        std::atomic<double>     mLastReconnectTime = { 0.0 };
+        std::atomic<float>      mDepthScale = { 0.0f };
 
         RealSenseService&       mService;
 
@@ -123,7 +291,15 @@ namespace nap
         std::unique_ptr<Impl>   mImplementation;
 
         std::vector<RealSenseFrameSetListenerComponentInstance*> mFrameSetListeners;
+        Signal<const rs2::frameset&> mFrameSetProcessed;
+        std::mutex mListenerMutex;
         std::unordered_map<ERealSenseStreamType, RealSenseCameraIntrincics> mCameraIntrinsics;
+        mutable std::mutex mIntrinsicsMutex;
+        RealSenseFilterBudget mFilterBudget;
+        std::unordered_map<ERealSenseStreamType, std::unique_ptr<RealSenseMotionQueue>> mMotionQueues;
+        std::unique_ptr<RealSenseFrameArenaPool> mFrameArenas;
+        std::unordered_map<ERealSenseStreamType, RealSenseFrameInfo> mFrameInfos;
+        mutable std::mutex mFrameInfoMutex;
     };
 
     using RealSenseDeviceObjectCreator = rtti::ObjectCreator<RealSenseDevice, RealSenseService>;
@@ -0,0 +1,377 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensedevicegroup.h"
+#include "realsenseservice.h"
+#include "realsenseworkerpool.h"
+#include "realsensedeprojection.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <rs.hpp>
+#include <deque>
+#include <cstring>
+
+RTTI_BEGIN_ENUM(nap::ERealSenseTimestampDomain)
+    RTTI_ENUM_VALUE(nap::ERealSenseTimestampDomain::Global, "Global"),
+    RTTI_ENUM_VALUE(nap::ERealSenseTimestampDomain::Hardware, "Hardware")
+RTTI_END_ENUM
+
+RTTI_BEGIN_CLASS(nap::RealSenseDeviceGroupMember)
+    RTTI_PROPERTY("Device", &nap::RealSenseDeviceGroupMember::mDevice, nap::rtti::EPropertyMetaData::Required)
+    RTTI_PROPERTY("Translation", &nap::RealSenseDeviceGroupMember::mTranslation, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Rotation", &nap::RealSenseDeviceGroupMember::mRotation, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseDeviceGroup)
+    RTTI_CONSTRUCTOR(nap::RealSenseService&)
+    RTTI_PROPERTY("Members", &nap::RealSenseDeviceGroup::mMembers, nap::rtti::EPropertyMetaData::Embedded)
+    RTTI_PROPERTY("TimestampDomain", &nap::RealSenseDeviceGroup::mTimestampDomain, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Tolerance", &nap::RealSenseDeviceGroup::mTolerance, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("QueueSize", &nap::RealSenseDeviceGroup::mQueueSize, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("FusePointCloud", &nap::RealSenseDeviceGroup::mFusePointCloud, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("PointStep", &nap::RealSenseDeviceGroup::mPointStep, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDeviceGroupMember
+    //////////////////////////////////////////////////////////////////////////
+
+    glm::mat4 RealSenseDeviceGroupMember::getTransform() const
+    {
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), mTranslation);
+        transform = glm::rotate(transform, glm::radians(mRotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+        transform = glm::rotate(transform, glm::radians(mRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::rotate(transform, glm::radians(mRotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+        return transform;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDeviceGroup::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseDeviceGroup::Impl
+    {
+    public:
+        /**
+         * Queued frameset and its timestamp in milliseconds
+         */
+        struct QueuedFrameSet
+        {
+            rs2::frameset mFrameSet;
+            double mTimestamp;
+        };
+
+        /**
+         * State of a single member
+         */
+        struct Member
+        {
+            Member(const std::function<void(const rs2::frameset&)>& callback) : mSlot(callback) { }
+
+            RealSenseDevice* mDevice = nullptr;
+            Slot<const rs2::frameset&> mSlot;
+            std::deque<QueuedFrameSet> mQueue;      ///< Guarded by mMutex
+            uint64 mDrops = 0;                      ///< Guarded by mMutex
+            glm::mat4 mTransform;
+            RealSenseDeprojectionMap mMap;          ///< Only accessed while generating the point cloud
+            size_t mOffset = 0;
+            size_t mCount = 0;
+        };
+
+        std::vector<std::unique_ptr<Member>> mMembers;
+
+        // Matching state
+        mutable std::mutex mMutex;
+        uint64 mGroups = 0;
+        uint64 mDroppedFrameSets = 0;
+        uint64 mDroppedPointClouds = 0;
+        double mLastSkew = 0.0;
+        double mMaxSkew = 0.0;
+        double mTotalSkew = 0.0;
+
+        // Point cloud generation, one group at a time
+        std::mutex mFuseMutex;
+        std::vector<glm::vec3> mBuildPoints;
+
+        // Last fused point cloud
+        std::mutex mPointsMutex;
+        std::vector<glm::vec3> mPoints;
+        bool mPointsAvailable = false;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Returns the timestamp of the depth frame, or first frame, of the frameset in milliseconds
+     */
+    static double getTimestamp(const rs2::frameset& frameset, ERealSenseTimestampDomain domain)
+    {
+        rs2::frame frame = frameset.get_depth_frame();
+        if(!frame)
+            frame = frameset[0];
+
+        if(domain == ERealSenseTimestampDomain::Hardware && frame.supports_frame_metadata(RS2_FRAME_METADATA_SENSOR_TIMESTAMP))
+            return static_cast<double>(frame.get_frame_metadata(RS2_FRAME_METADATA_SENSOR_TIMESTAMP)) / 1000.0;
+
+        return frame.get_timestamp();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseDeviceGroup
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseDeviceGroup::RealSenseDeviceGroup(RealSenseService& service) : mService(service)
+    { }
+
+
+    RealSenseDeviceGroup::~RealSenseDeviceGroup() = default;
+
+
+    bool RealSenseDeviceGroup::init(utility::ErrorState& errorState)
+    {
+        if(!errorState.check(!mMembers.empty(), "%s: group has no members", mID.c_str()))
+            return false;
+
+        if(!errorState.check(mTolerance > 0.0f, "%s: Tolerance must be higher than 0", mID.c_str()))
+            return false;
+
+        if(!errorState.check(mQueueSize > 0, "%s: QueueSize must be higher than 0", mID.c_str()))
+            return false;
+
+        if(!errorState.check(mPointStep > 0, "%s: PointStep must be higher than 0", mID.c_str()))
+            return false;
+
+        mImpl = std::make_unique<Impl>();
+        for(size_t i = 0; i < mMembers.size(); i++)
+        {
+            for(size_t j = 0; j < i; j++)
+            {
+                if(!errorState.check(mMembers[i]->mDevice != mMembers[j]->mDevice, "%s: device %s is a member more than once",
+                                     mID.c_str(), mMembers[i]->mDevice->mID.c_str()))
+                    return false;
+            }
+
+            int index = static_cast<int>(i);
+            auto member = std::make_unique<Impl::Member>([this, index](const rs2::frameset& frameset) { onFrameSet(index, frameset); });
+            member->mDevice = mMembers[i]->mDevice.get();
+            member->mTransform = mMembers[i]->getTransform();
+            mImpl->mMembers.emplace_back(std::move(member));
+        }
+
+        return true;
+    }
+
+
+    bool RealSenseDeviceGroup::start(utility::ErrorState& errorState)
+    {
+        for(auto& member : mImpl->mMembers)
+            member->mDevice->connectFrameSetSlot(member->mSlot);
+        return true;
+    }
+
+
+    void RealSenseDeviceGroup::stop()
+    {
+        for(auto& member : mImpl->mMembers)
+            member->mDevice->disconnectFrameSetSlot(member->mSlot);
+
+        // wait for a point cloud in progress
+        std::lock_guard<std::mutex> fuse_lock(mImpl->mFuseMutex);
+        std::lock_guard<std::mutex> lock(mImpl->mMutex);
+        for(auto& member : mImpl->mMembers)
+            member->mQueue.clear();
+    }
+
+
+    void RealSenseDeviceGroup::onFrameSet(int member, const rs2::frameset& frameset)
+    {
+        if(!frameset || frameset.size() == 0)
+            return;
+
+        double tolerance = static_cast<double>(mTolerance);
+        std::vector<rs2::frameset> group;
+        {
+            std::lock_guard<std::mutex> lock(mImpl->mMutex);
+            auto& queue = mImpl->mMembers[member]->mQueue;
+            if(queue.size() >= static_cast<size_t>(mQueueSize))
+            {
+                queue.pop_front();
+                mImpl->mMembers[member]->mDrops++;
+                mImpl->mDroppedFrameSets++;
+            }
+            queue.push_back({ frameset, getTimestamp(frameset, mTimestampDomain) });
+
+            while(true)
+            {
+                // every member needs a queued frameset
+                double newest = 0.0;
+                bool complete = true;
+                for(auto& entry : mImpl->mMembers)
+                {
+                    if(entry->mQueue.empty())
+                    {
+                        complete = false;
+                        break;
+                    }
+                    newest = std::max(newest, entry->mQueue.front().mTimestamp);
+                }
+
+                if(!complete)
+                    break;
+
+                // drop framesets that are too old to ever match the newest frameset
+                bool dropped = false;
+                for(auto& entry : mImpl->mMembers)
+                {
+                    while(!entry->mQueue.empty() && entry->mQueue.front().mTimestamp < newest - tolerance)
+                    {
+                        entry->mQueue.pop_front();
+                        entry->mDrops++;
+                        mImpl->mDroppedFrameSets++;
+                        dropped = true;
+                    }
+                }
+
+                if(dropped)
+                    continue;
+
+                // all framesets are within tolerance
+                double oldest = newest;
+                group.reserve(mImpl->mMembers.size());
+                for(auto& entry : mImpl->mMembers)
+                {
+                    oldest = std::min(oldest, entry->mQueue.front().mTimestamp);
+                    group.emplace_back(entry->mQueue.front().mFrameSet);
+                    entry->mQueue.pop_front();
+                }
+
+                double skew = newest - oldest;
+                mImpl->mGroups++;
+                mImpl->mLastSkew = skew;
+                mImpl->mMaxSkew = std::max(mImpl->mMaxSkew, skew);
+                mImpl->mTotalSkew += skew;
+                break;
+            }
+        }
+
+        if(group.empty())
+            return;
+
+        frameGroupReceived.trigger(group);
+        if(mFusePointCloud)
+            fusePointCloud(group);
+    }
+
+
+    void RealSenseDeviceGroup::fusePointCloud(const std::vector<rs2::frameset>& group)
+    {
+        // skip this group when another capture thread is still fusing the previous group
+        std::unique_lock<std::mutex> fuse_lock(mImpl->mFuseMutex, std::try_to_lock);
+        if(!fuse_lock.owns_lock())
+        {
+            std::lock_guard<std::mutex> lock(mImpl->mMutex);
+            mImpl->mDroppedPointClouds++;
+            return;
+        }
+
+        // reserve a region of the build buffer per member
+        const int step = mPointStep;
+        std::vector<rs2::depth_frame> depth_frames;
+        depth_frames.reserve(group.size());
+        size_t total = 0;
+        for(size_t i = 0; i < group.size(); i++)
+        {
+            rs2::depth_frame depth = group[i].get_depth_frame();
+            auto& member = *mImpl->mMembers[i];
+            member.mOffset = total;
+            member.mCount = 0;
+            if(depth)
+                total += static_cast<size_t>((depth.get_width() + step - 1) / step) * static_cast<size_t>((depth.get_height() + step - 1) / step);
+            depth_frames.emplace_back(depth);
+        }
+        mImpl->mBuildPoints.resize(total);
+
+        // deproject one member per task
+        mService.getWorkerPool().parallelFor(static_cast<int>(group.size()), [&](int index)
+        {
+            auto& member = *mImpl->mMembers[index];
+            const rs2::depth_frame& depth = depth_frames[index];
+            if(!depth)
+                return;
+
+            member.mMap.update(depth.get_profile().as<rs2::video_stream_profile>());
+
+            const auto* data = static_cast<const uint8*>(depth.get_data());
+            const size_t stride = static_cast<size_t>(depth.get_stride_in_bytes());
+            const float scale = depth.get_units();
+            const int width = depth.get_width();
+            const int height = depth.get_height();
+            const glm::mat4& transform = member.mTransform;
+            glm::vec3* out = mImpl->mBuildPoints.data() + member.mOffset;
+            size_t count = 0;
+            for(int y = 0; y < height; y += step)
+            {
+                const auto* depth_row = reinterpret_cast<const uint16*>(data + static_cast<size_t>(y) * stride);
+                size_t row = static_cast<size_t>(y) * width;
+                for(int x = 0; x < width; x += step)
+                {
+                    uint16 value = depth_row[x];
+                    if(value == 0)
+                        continue;
+
+                    float z = static_cast<float>(value) * scale;
+                    glm::vec4 world = transform * glm::vec4(member.mMap.getX()[row + x] * z, member.mMap.getY()[row + x] * z, z, 1.0f);
+                    out[count++] = glm::vec3(world.x, world.y, world.z);
+                }
+            }
+            member.mCount = count;
+        });
+
+        // pack the member regions
+        size_t write = 0;
+        for(auto& member : mImpl->mMembers)
+        {
+            if(member->mOffset != write && member->mCount > 0)
+                std::memmove(mImpl->mBuildPoints.data() + write, mImpl->mBuildPoints.data() + member->mOffset, member->mCount * sizeof(glm::vec3));
+            write += member->mCount;
+        }
+        mImpl->mBuildPoints.resize(write);
+
+        std::lock_guard<std::mutex> lock(mImpl->mPointsMutex);
+        std::swap(mImpl->mBuildPoints, mImpl->mPoints);
+        mImpl->mPointsAvailable = true;
+    }
+
+
+    bool RealSenseDeviceGroup::fetchPointCloud(std::vector<glm::vec3>& points)
+    {
+        std::lock_guard<std::mutex> lock(mImpl->mPointsMutex);
+        if(!mImpl->mPointsAvailable)
+            return false;
+
+        std::swap(points, mImpl->mPoints);
+        mImpl->mPointsAvailable = false;
+        return true;
+    }
+
+
+    RealSenseDeviceGroup::Statistics RealSenseDeviceGroup::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mImpl->mMutex);
+        Statistics statistics;
+        statistics.mGroups = mImpl->mGroups;
+        statistics.mDroppedFrameSets = mImpl->mDroppedFrameSets;
+        statistics.mDroppedPointClouds = mImpl->mDroppedPointClouds;
+        statistics.mLastSkew = mImpl->mLastSkew;
+        statistics.mMaxSkew = mImpl->mMaxSkew;
+        statistics.mAverageSkew = mImpl->mGroups > 0 ? mImpl->mTotalSkew / static_cast<double>(mImpl->mGroups) : 0.0;
+        for(const auto& member : mImpl->mMembers)
+            statistics.mMemberDrops.emplace_back(member->mDrops);
+        return statistics;
+    }
+}
@@ -0,0 +1,150 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/device.h>
+#include <nap/resourceptr.h>
+#include <nap/signalslot.h>
+#include <rtti/factory.h>
+#include <glm/glm.hpp>
+#include <mutex>
+
+// Local includes
+#include "realsensedevice.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseService;
+
+    /**
+     * Timestamp used to match framesets of different devices
+     */
+    enum class ERealSenseTimestampDomain : int
+    {
+        Global      = 0,    ///< Frame timestamp in the global time domain, requires the global time option of the devices (on by default)
+        Hardware    = 1     ///< Sensor timestamp from the frame metadata, only comparable between devices that are hardware synchronized
+    };
+
+    /**
+     * RealSenseDeviceGroupMember
+     * A device in a RealSenseDeviceGroup and the placement of its camera in world space
+     */
+    class NAPAPI RealSenseDeviceGroupMember final : public Resource
+    {
+    RTTI_ENABLE(Resource)
+    public:
+        /**
+         * @return transform from camera space to world space
+         */
+        glm::mat4 getTransform() const;
+
+        ResourcePtr<RealSenseDevice> mDevice;           ///< Property: 'Device' the device
+        glm::vec3 mTranslation = { 0.0f, 0.0f, 0.0f };  ///< Property: 'Translation' position of the camera in world space in meters
+        glm::vec3 mRotation = { 0.0f, 0.0f, 0.0f };     ///< Property: 'Rotation' rotation of the camera in degrees around the x, y and z axis, applied in that order
+    };
+
+    /**
+     * RealSenseDeviceGroup
+     * Collects the framesets of multiple devices and matches them by timestamp into frame groups.
+     * A group holds one frameset per member, all within 'Tolerance' milliseconds of each other.
+     * Framesets that can't be matched are dropped, frameGroupReceived is triggered for every complete group.
+     * When 'FusePointCloud' is enabled the depth frames of every group are deprojected into a single packed world-space
+     * point cloud, one member per worker thread of the RealSenseService.
+     */
+    class NAPAPI RealSenseDeviceGroup final : public Device
+    {
+    RTTI_ENABLE(Device)
+    public:
+        /**
+         * Matching statistics
+         */
+        struct NAPAPI Statistics
+        {
+            uint64 mGroups = 0;                     ///< Amount of matched frame groups
+            uint64 mDroppedFrameSets = 0;           ///< Amount of framesets dropped because there was no match within tolerance or the queue was full
+            uint64 mDroppedPointClouds = 0;         ///< Amount of groups without fused point cloud because the previous cloud was still being generated
+            double mLastSkew = 0.0;                 ///< Timestamp difference between the first and last frameset of the last group in milliseconds
+            double mMaxSkew = 0.0;                  ///< Largest timestamp difference of all groups in milliseconds
+            double mAverageSkew = 0.0;              ///< Average timestamp difference of all groups in milliseconds
+            std::vector<uint64> mMemberDrops;       ///< Dropped framesets per member
+        };
+
+        /**
+         * Constructor
+         * @param service reference to the RealSenseService
+         */
+        RealSenseDeviceGroup(RealSenseService& service);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseDeviceGroup();
+
+        /**
+         * Initialization method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool init(utility::ErrorState& errorState) override;
+
+        /**
+         * Starts receiving framesets from the member devices
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool start(utility::ErrorState& errorState) override;
+
+        /**
+         * Stops receiving framesets from the member devices and clears all queued framesets
+         */
+        void stop() override;
+
+        /**
+         * Moves the last fused point cloud into points, when a new point cloud is available.
+         * The previous content of points is recycled as buffer for the next point cloud, reuse the same vector to avoid allocations.
+         * Points are in world space, in meters, ordered by member.
+         * @param points receives the point cloud
+         * @return true when a new point cloud was available
+         */
+        bool fetchPointCloud(std::vector<glm::vec3>& points);
+
+        /**
+         * @return copy of the matching statistics, can be called from any thread
+         */
+        Statistics getStatistics() const;
+
+        // Signal triggered from the capture thread of one of the devices with every frame group, one frameset per member in member order
+        Signal<const std::vector<rs2::frameset>&> frameGroupReceived;
+
+        // Properties
+        std::vector<ResourcePtr<RealSenseDeviceGroupMember>> mMembers; ///< Property: 'Members' the devices in the group
+        ERealSenseTimestampDomain mTimestampDomain = ERealSenseTimestampDomain::Global; ///< Property: 'TimestampDomain' timestamp used for matching
+        float mTolerance = 20.0f;       ///< Property: 'Tolerance' maximum timestamp difference within a group in milliseconds
+        int mQueueSize = 4;             ///< Property: 'QueueSize' maximum amount of unmatched framesets queued per member
+        bool mFusePointCloud = true;    ///< Property: 'FusePointCloud' generate a fused world-space point cloud for every group
+        int mPointStep = 2;             ///< Property: 'PointStep' deproject every n-th pixel horizontally and vertically
+    private:
+        /**
+         * Called from the capture thread of a member device
+         */
+        void onFrameSet(int member, const rs2::frameset& frameset);
+
+        /**
+         * Deprojects the depth frames of a group into the fused point cloud
+         */
+        void fusePointCloud(const std::vector<rs2::frameset>& group);
+
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseService& mService;
+    };
+
+    using RealSenseDeviceGroupObjectCreator = rtti::ObjectCreator<RealSenseDeviceGroup, RealSenseService>;
+}
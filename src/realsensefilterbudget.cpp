@@ -0,0 +1,95 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensefilterbudget.h"
+#include "realsenseconversion.h"
+
+#include <nap/logger.h>
+#include <utility/stringutils.h>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFilterBudget::Snapshot
+    //////////////////////////////////////////////////////////////////////////
+
+    std::string RealSenseFilterBudget::Snapshot::toJSON(const std::string& name) const
+    {
+        return utility::stringFormat("{ \"name\": \"%s\", \"budget_us\": %d, \"avg_us\": %.3f, \"degraded\": %s, "
+                                     "\"frames\": %llu, \"degraded_frames\": %llu, \"degrade_count\": %llu, "
+                                     "\"restore_count\": %llu, \"skipped_filters\": %llu }",
+                                     realsense::escapeJSON(name).c_str(), mBudget, mAverageTime, mDegraded ? "true" : "false",
+                                     static_cast<unsigned long long>(mFrames),
+                                     static_cast<unsigned long long>(mDegradedFrames),
+                                     static_cast<unsigned long long>(mDegradeCount),
+                                     static_cast<unsigned long long>(mRestoreCount),
+                                     static_cast<unsigned long long>(mSkippedFilters));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFilterBudget
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseFilterBudget::configure(const std::string& name, int budget)
+    {
+        mName = name;
+        mBudget = budget;
+        mAverageTime = 0.0;
+        mRestoreFrames = 0;
+        mDegraded.store(false);
+    }
+
+
+    bool RealSenseFilterBudget::record(uint64 duration, int skippedFilters)
+    {
+        bool degraded = mDegraded.load(std::memory_order_relaxed);
+        mFrames.fetch_add(1, std::memory_order_relaxed);
+        mSkippedFilters.fetch_add(static_cast<uint64>(skippedFilters), std::memory_order_relaxed);
+        if(degraded)
+            mDegradedFrames.fetch_add(1, std::memory_order_relaxed);
+
+        double time = static_cast<double>(duration) / 1000.0;
+        mAverageTime = mFrames.load(std::memory_order_relaxed) == 1 ? time : mAverageTime + (time - mAverageTime) * sSmoothing;
+        mAverageTimeNs.store(static_cast<uint64>(mAverageTime * 1000.0), std::memory_order_relaxed);
+
+        if(!isEnabled())
+            return false;
+
+        if(!degraded)
+        {
+            if(mAverageTime <= static_cast<double>(mBudget))
+                return false;
+
+            mDegraded.store(true, std::memory_order_relaxed);
+            mDegradeCount.fetch_add(1, std::memory_order_relaxed);
+            mRestoreFrames = 0;
+            nap::Logger::info("%s: filter chain over budget (%.0f us > %d us), skipping optional filters", mName.c_str(), mAverageTime, mBudget);
+            return true;
+        }
+
+        mRestoreFrames = mAverageTime < static_cast<double>(mBudget) * sRestoreRatio ? mRestoreFrames + 1 : 0;
+        if(mRestoreFrames < sRestoreFrames)
+            return false;
+
+        mDegraded.store(false, std::memory_order_relaxed);
+        mRestoreCount.fetch_add(1, std::memory_order_relaxed);
+        nap::Logger::info("%s: filter chain back within budget (%.0f us < %d us), restoring optional filters", mName.c_str(), mAverageTime, mBudget);
+        return true;
+    }
+
+
+    RealSenseFilterBudget::Snapshot RealSenseFilterBudget::getSnapshot() const
+    {
+        Snapshot snapshot;
+        snapshot.mFrames = mFrames.load(std::memory_order_relaxed);
+        snapshot.mDegradedFrames = mDegradedFrames.load(std::memory_order_relaxed);
+        snapshot.mDegradeCount = mDegradeCount.load(std::memory_order_relaxed);
+        snapshot.mRestoreCount = mRestoreCount.load(std::memory_order_relaxed);
+        snapshot.mSkippedFilters = mSkippedFilters.load(std::memory_order_relaxed);
+        snapshot.mAverageTime = static_cast<double>(mAverageTimeNs.load(std::memory_order_relaxed)) / 1000.0;
+        snapshot.mBudget = mBudget;
+        snapshot.mDegraded = mDegraded.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+}
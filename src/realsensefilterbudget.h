@@ -0,0 +1,102 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <atomic>
+#include <string>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseFilterBudget
+     * Tracks the rolling execution time of a filter chain against a frame budget in microseconds.
+     * The chain enters degraded mode when the rolling time exceeds the budget, in degraded mode the chain skips optional filters
+     * and filters lower their quality. The chain leaves degraded mode when the rolling time stays below
+     * sRestoreRatio of the budget for sRestoreFrames consecutive frames.
+     * Every transition is logged and counted, snapshots of the counters can be taken from any thread.
+     */
+    class NAPAPI RealSenseFilterBudget final
+    {
+    public:
+        static constexpr double sSmoothing = 0.1;       ///< Weight of the last frame in the rolling execution time
+        static constexpr double sRestoreRatio = 0.7;    ///< Fraction of the budget the rolling time must stay below to leave degraded mode
+        static constexpr int sRestoreFrames = 30;       ///< Amount of consecutive frames below the restore threshold to leave degraded mode
+
+        /**
+         * Copy of the budget counters at a certain point in time
+         */
+        struct NAPAPI Snapshot
+        {
+            uint64 mFrames = 0;                     ///< Amount of processed frames
+            uint64 mDegradedFrames = 0;             ///< Amount of frames processed in degraded mode
+            uint64 mDegradeCount = 0;               ///< Amount of times the chain entered degraded mode
+            uint64 mRestoreCount = 0;               ///< Amount of times the chain left degraded mode
+            uint64 mSkippedFilters = 0;             ///< Total amount of skipped optional filter executions
+            double mAverageTime = 0.0;              ///< Rolling execution time of the chain in microseconds
+            int mBudget = 0;                        ///< Frame budget in microseconds, 0 when disabled
+            bool mDegraded = false;                 ///< If the chain is currently in degraded mode
+
+            /**
+             * Serializes the snapshot into a JSON object
+             * @param name name of the filter chain, stored as 'name' in the JSON object
+             * @return JSON object as string
+             */
+            std::string toJSON(const std::string& name) const;
+        };
+
+        /**
+         * Sets the name used when logging transitions and the frame budget, leaves degraded mode
+         * @param name name of the filter chain
+         * @param budget frame budget in microseconds, 0 disables the budget
+         */
+        void configure(const std::string& name, int budget);
+
+        /**
+         * @return if a budget is set
+         */
+        bool isEnabled() const                              { return mBudget > 0; }
+
+        /**
+         * @return name of the filter chain
+         */
+        const std::string& getName() const                  { return mName; }
+
+        /**
+         * @return if the chain is in degraded mode, optional filters should be skipped
+         */
+        bool isDegraded() const                             { return mDegraded.load(std::memory_order_relaxed); }
+
+        /**
+         * Records the execution time of the filter chain, call once per frame from the thread that runs the chain.
+         * @param duration execution time of the chain in nanoseconds
+         * @param skippedFilters amount of optional filters skipped this frame
+         * @return true if the chain entered or left degraded mode
+         */
+        bool record(uint64 duration, int skippedFilters);
+
+        /**
+         * @return copy of the current counters, can be called from any thread
+         */
+        Snapshot getSnapshot() const;
+
+    private:
+        std::string mName;
+        int mBudget = 0;
+        double mAverageTime = 0.0;
+        int mRestoreFrames = 0;
+
+        std::atomic<bool> mDegraded = { false };
+        std::atomic<uint64> mFrames = { 0 };
+        std::atomic<uint64> mDegradedFrames = { 0 };
+        std::atomic<uint64> mDegradeCount = { 0 };
+        std::atomic<uint64> mRestoreCount = { 0 };
+        std::atomic<uint64> mSkippedFilters = { 0 };
+        std::atomic<uint64> mAverageTimeNs = { 0 };
+    };
+}
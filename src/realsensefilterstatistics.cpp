@@ -0,0 +1,160 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensefilterstatistics.h"
+#include "realsenseconversion.h"
+
+#include <utility/stringutils.h>
+#include <algorithm>
+#include <cmath>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    static int getBucketIndex(uint64 microseconds)
+    {
+        int index = 0;
+        while(microseconds > 1 && index < RealSenseFilterStatistics::sBucketCount - 1)
+        {
+            microseconds >>= 1;
+            index++;
+        }
+        return index;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFilterStatistics::Snapshot
+    //////////////////////////////////////////////////////////////////////////
+
+    double RealSenseFilterStatistics::Snapshot::getAverageTime() const
+    {
+        return mCount > 0 ? mTotalTime / static_cast<double>(mCount) : 0.0;
+    }
+
+
+    double RealSenseFilterStatistics::Snapshot::getPercentileTime(float percentile) const
+    {
+        uint64 total = 0;
+        for(auto count : mBuckets)
+            total += count;
+
+        if(total == 0)
+            return 0.0;
+
+        auto target = static_cast<uint64>(std::ceil(static_cast<double>(total) * percentile));
+        uint64 accumulated = 0;
+        for(int i = 0; i < sBucketCount; i++)
+        {
+            accumulated += mBuckets[i];
+            if(accumulated >= target)
+                return static_cast<double>(uint64(1) << (i + 1));
+        }
+        return mMaxTime;
+    }
+
+
+    std::string RealSenseFilterStatistics::Snapshot::toJSON(const std::string& name) const
+    {
+        std::string buckets;
+        for(int i = 0; i < sBucketCount; i++)
+        {
+            if(i > 0)
+                buckets += ", ";
+            buckets += std::to_string(mBuckets[i]);
+        }
+
+        return utility::stringFormat("{ \"name\": \"%s\", \"count\": %llu, \"new_frames\": %llu, \"allocations\": %llu, "
+                                     "\"total_us\": %.3f, \"avg_us\": %.3f, \"min_us\": %.3f, \"max_us\": %.3f, \"last_us\": %.3f, "
+                                     "\"p50_us\": %.1f, \"p99_us\": %.1f, "
+                                     "\"input\": [%d, %d], \"output\": [%d, %d], \"histogram_log2_us\": [%s] }",
+                                     realsense::escapeJSON(name).c_str(),
+                                     static_cast<unsigned long long>(mCount),
+                                     static_cast<unsigned long long>(mNewFrames),
+                                     static_cast<unsigned long long>(mAllocations),
+                                     mTotalTime, getAverageTime(), mMinTime, mMaxTime, mLastTime,
+                                     getPercentileTime(0.5f), getPercentileTime(0.99f),
+                                     mInputWidth, mInputHeight, mOutputWidth, mOutputHeight,
+                                     buckets.c_str());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFilterStatistics
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseFilterStatistics::record(uint64 duration, int inputWidth, int inputHeight, int outputWidth, int outputHeight, bool newFrame)
+    {
+        mCount.fetch_add(1, std::memory_order_relaxed);
+        mTotalTime.fetch_add(duration, std::memory_order_relaxed);
+        mLastTime.store(duration, std::memory_order_relaxed);
+        if(newFrame)
+            mNewFrames.fetch_add(1, std::memory_order_relaxed);
+
+        uint64 current_min = mMinTime.load(std::memory_order_relaxed);
+        while(duration < current_min && !mMinTime.compare_exchange_weak(current_min, duration, std::memory_order_relaxed)) {}
+
+        uint64 current_max = mMaxTime.load(std::memory_order_relaxed);
+        while(duration > current_max && !mMaxTime.compare_exchange_weak(current_max, duration, std::memory_order_relaxed)) {}
+
+        mInputWidth.store(inputWidth, std::memory_order_relaxed);
+        mInputHeight.store(inputHeight, std::memory_order_relaxed);
+        mOutputWidth.store(outputWidth, std::memory_order_relaxed);
+        mOutputHeight.store(outputHeight, std::memory_order_relaxed);
+
+        mBuckets[getBucketIndex(duration / 1000)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    void RealSenseFilterStatistics::recordOutput(const void* data)
+    {
+        if(std::find(mBuffers.begin(), mBuffers.end(), data) != mBuffers.end())
+            return;
+
+        // the frame source recycles a bounded amount of buffers, remembering the most recent ones is enough
+        mAllocations.fetch_add(1, std::memory_order_relaxed);
+        if(mBuffers.size() < sMaxBuffers)
+        {
+            mBuffers.emplace_back(data);
+            return;
+        }
+        mBuffers[mNextBuffer] = data;
+        mNextBuffer = (mNextBuffer + 1) % sMaxBuffers;
+    }
+
+
+    RealSenseFilterStatistics::Snapshot RealSenseFilterStatistics::getSnapshot() const
+    {
+        Snapshot snapshot;
+        snapshot.mCount = mCount.load(std::memory_order_relaxed);
+        snapshot.mNewFrames = mNewFrames.load(std::memory_order_relaxed);
+        snapshot.mAllocations = mAllocations.load(std::memory_order_relaxed);
+        snapshot.mTotalTime = static_cast<double>(mTotalTime.load(std::memory_order_relaxed)) / 1000.0;
+        snapshot.mMaxTime = static_cast<double>(mMaxTime.load(std::memory_order_relaxed)) / 1000.0;
+        snapshot.mLastTime = static_cast<double>(mLastTime.load(std::memory_order_relaxed)) / 1000.0;
+        snapshot.mMinTime = snapshot.mCount > 0 ? static_cast<double>(mMinTime.load(std::memory_order_relaxed)) / 1000.0 : 0.0;
+        snapshot.mInputWidth = mInputWidth.load(std::memory_order_relaxed);
+        snapshot.mInputHeight = mInputHeight.load(std::memory_order_relaxed);
+        snapshot.mOutputWidth = mOutputWidth.load(std::memory_order_relaxed);
+        snapshot.mOutputHeight = mOutputHeight.load(std::memory_order_relaxed);
+        for(int i = 0; i < sBucketCount; i++)
+            snapshot.mBuckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+
+    void RealSenseFilterStatistics::reset()
+    {
+        mCount.store(0, std::memory_order_relaxed);
+        mNewFrames.store(0, std::memory_order_relaxed);
+        mAllocations.store(0, std::memory_order_relaxed);
+        mTotalTime.store(0, std::memory_order_relaxed);
+        mMinTime.store(std::numeric_limits<uint64>::max(), std::memory_order_relaxed);
+        mMaxTime.store(0, std::memory_order_relaxed);
+        mLastTime.store(0, std::memory_order_relaxed);
+        for(auto& bucket : mBuckets)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,116 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <atomic>
+#include <array>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseFilterStatistics
+     * Lock-free execution time histogram of a single RealSense filter.
+     * Samples are recorded from the thread that runs the filter, snapshots can be taken from any thread (usually the main thread).
+     * Bucket i holds all durations in the range [2^i, 2^(i+1)) microseconds, except bucket 0 which holds all durations below 2 microseconds.
+     */
+    class NAPAPI RealSenseFilterStatistics final
+    {
+    public:
+        static constexpr int sBucketCount = 24; ///< Amount of histogram buckets, last bucket holds everything above ~8 seconds
+
+        /**
+         * Copy of the statistics at a certain point in time
+         */
+        struct NAPAPI Snapshot
+        {
+            uint64 mCount = 0;                      ///< Amount of processed frames
+            uint64 mNewFrames = 0;                  ///< Amount of processed frames for which the filter returned a different frame than its input
+            uint64 mAllocations = 0;                ///< Amount of output frame buffers the filter allocated, output frames in recycled buffers are not counted
+            double mTotalTime = 0.0;                ///< Total execution time in microseconds
+            double mMinTime = 0.0;                  ///< Minimum execution time in microseconds
+            double mMaxTime = 0.0;                  ///< Maximum execution time in microseconds
+            double mLastTime = 0.0;                 ///< Execution time of the last processed frame in microseconds
+            int mInputWidth = 0;                    ///< Width of the last input frame
+            int mInputHeight = 0;                   ///< Height of the last input frame
+            int mOutputWidth = 0;                   ///< Width of the last output frame
+            int mOutputHeight = 0;                  ///< Height of the last output frame
+            std::array<uint64, sBucketCount> mBuckets = {}; ///< Execution time histogram
+
+            /**
+             * @return average execution time in microseconds, 0 when no frames have been processed
+             */
+            double getAverageTime() const;
+
+            /**
+             * Returns an estimate of the given percentile based on the histogram, the upper bound of the bucket the percentile falls in
+             * @param percentile the percentile, between 0 and 1
+             * @return estimated execution time in microseconds
+             */
+            double getPercentileTime(float percentile) const;
+
+            /**
+             * Serializes the snapshot into a JSON object
+             * @param name name of the filter, stored as 'name' in the JSON object
+             * @return JSON object as string
+             */
+            std::string toJSON(const std::string& name) const;
+        };
+
+        /**
+         * Records a single filter execution, lock-free
+         * @param duration execution time in nanoseconds
+         * @param inputWidth width of the input frame
+         * @param inputHeight height of the input frame
+         * @param outputWidth width of the output frame
+         * @param outputHeight height of the output frame
+         * @param newFrame true if the filter returned a different frame than its input, not necessarily a newly allocated one
+         */
+        void record(uint64 duration, int inputWidth, int inputHeight, int outputWidth, int outputHeight, bool newFrame);
+
+        /**
+         * Records an output frame the filter allocated from its frame source.
+         * Counted as allocation when the buffer was not recycled, buffers are recognized by address.
+         * Call from the thread that runs the filter.
+         * @param data pixel data of the output frame
+         */
+        void recordOutput(const void* data);
+
+        /**
+         * @return copy of the current statistics, can be called from any thread
+         */
+        Snapshot getSnapshot() const;
+
+        /**
+         * Clears all recorded statistics
+         */
+        void reset();
+
+    private:
+        std::atomic<uint64> mCount = { 0 };
+        std::atomic<uint64> mNewFrames = { 0 };
+        std::atomic<uint64> mAllocations = { 0 };
+        std::atomic<uint64> mTotalTime = { 0 };
+        std::atomic<uint64> mMinTime = { std::numeric_limits<uint64>::max() };
+        std::atomic<uint64> mMaxTime = { 0 };
+        std::atomic<uint64> mLastTime = { 0 };
+        std::atomic<int> mInputWidth = { 0 };
+        std::atomic<int> mInputHeight = { 0 };
+        std::atomic<int> mOutputWidth = { 0 };
+        std::atomic<int> mOutputHeight = { 0 };
+        std::array<std::atomic<uint64>, sBucketCount> mBuckets = {};
+
+        // addresses of the most recent output buffers, only used by the thread that runs the filter
+        static constexpr size_t sMaxBuffers = 64;
+        std::vector<const void*> mBuffers;
+        size_t mNextBuffer = 0;
+    };
+}
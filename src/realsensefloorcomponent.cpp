@@ -0,0 +1,127 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensefloorcomponent.h"
+#include "realsensedeprojection.h"
+
+#include <rs.hpp>
+
+RTTI_BEGIN_CLASS(nap::RealSenseFloorComponent)
+    RTTI_PROPERTY("SampleStep", &nap::RealSenseFloorComponent::mSampleStep, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Iterations", &nap::RealSenseFloorComponent::mIterations, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Threshold", &nap::RealSenseFloorComponent::mThreshold, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("UpVector", &nap::RealSenseFloorComponent::mUpVector, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MaxAngle", &nap::RealSenseFloorComponent::mMaxAngle, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MinInlierRatio", &nap::RealSenseFloorComponent::mMinInlierRatio, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseFloorComponentInstance)
+    RTTI_CONSTRUCTOR(nap::EntityInstance&, nap::Component&)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFloorComponent
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseFloorComponent::RealSenseFloorComponent() = default;
+
+
+    RealSenseFloorComponent::~RealSenseFloorComponent() = default;
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFloorComponentInstance::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseFloorComponentInstance::Impl
+    {
+    public:
+        RealSenseFloorEstimator mEstimator;
+        RealSenseDeprojectionMap mRays;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFloorComponentInstance
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseFloorComponentInstance::RealSenseFloorComponentInstance(EntityInstance& entity, Component& resource) :
+        RealSenseFrameSetListenerComponentInstance(entity, resource)
+    {}
+
+
+    RealSenseFloorComponentInstance::~RealSenseFloorComponentInstance() = default;
+
+
+    bool RealSenseFloorComponentInstance::onInit(utility::ErrorState& errorState)
+    {
+        mImpl = std::make_unique<Impl>();
+        mResource = getComponent<RealSenseFloorComponent>();
+
+        if(!errorState.check(mResource->mSampleStep > 0 && mResource->mIterations > 0,
+                             "%s: sample step and iterations must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        if(!errorState.check(mResource->mThreshold > 0.0f, "%s: threshold must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        if(!errorState.check(glm::length(mResource->mUpVector) > 0.0f, "%s: up vector can't be zero", mResource->mID.c_str()))
+            return false;
+
+        mParameters.mSampleStep = mResource->mSampleStep;
+        mParameters.mIterations = mResource->mIterations;
+        mParameters.mThreshold = mResource->mThreshold;
+        mParameters.mUp = mResource->mUpVector;
+        mParameters.mMaxAngle = mResource->mMaxAngle;
+        mParameters.mMinInlierRatio = mResource->mMinInlierRatio;
+
+        frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
+        return true;
+    }
+
+
+    RealSenseFloorPlane RealSenseFloorComponentInstance::getPlane() const
+    {
+        std::lock_guard<std::mutex> lock(mPlaneMutex);
+        return mPlane;
+    }
+
+
+    bool RealSenseFloorComponentInstance::isValid() const
+    {
+        std::lock_guard<std::mutex> lock(mPlaneMutex);
+        return mPlane.mValid;
+    }
+
+
+    glm::mat4 RealSenseFloorComponentInstance::getCameraTransform() const
+    {
+        std::lock_guard<std::mutex> lock(mPlaneMutex);
+        return mCameraTransform;
+    }
+
+
+    void RealSenseFloorComponentInstance::onTrigger(const rs2::frameset& frameset)
+    {
+        auto depth = frameset.get_depth_frame();
+        if(!depth || depth.get_profile().format() != RS2_FORMAT_Z16)
+            return;
+
+        // rays only change with the stream profile
+        mImpl->mRays.update(depth.get_profile().as<rs2::video_stream_profile>());
+
+        if(mReset.exchange(false))
+            mImpl->mEstimator.reset();
+
+        const auto& plane = mImpl->mEstimator.update(static_cast<const uint16*>(depth.get_data()), depth.get_stride_in_bytes(),
+                                                     depth.get_units(), mImpl->mRays, mParameters);
+
+        // an invalid plane keeps the transform of the last valid plane
+        glm::mat4 transform = plane.mValid ? plane.getCameraTransform() : glm::mat4(1.0f);
+        std::lock_guard<std::mutex> lock(mPlaneMutex);
+        if(plane.mValid || !mPlane.mValid)
+            mCameraTransform = transform;
+        mPlane = plane;
+    }
+}
@@ -0,0 +1,121 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include "realsenseframesetlistenercomponent.h"
+#include "realsensefloorplane.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseFloorComponentInstance;
+
+    /**
+     * RealSenseFloorComponent
+     * Estimates the floor plane from the Z16 depth frames of a device, see RealSenseFloorEstimator.
+     * The plane is cached and refined with a bounded amount of RANSAC hypotheses per frame on the capture thread.
+     * The resulting camera to floor transform can be used by other components, for example the RealSenseHeightMapComponent
+     * and the RealSenseRenderPointCloudComponent.
+     * The up vector is the expected floor normal in camera space (x right, y down, z forward):
+     * (0, -1, 0) for a level camera, (0, 0, -1) for a camera looking straight down.
+     */
+    class NAPAPI RealSenseFloorComponent : public RealSenseFrameSetListenerComponent
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponent)
+    DECLARE_COMPONENT(RealSenseFloorComponent, RealSenseFloorComponentInstance)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseFloorComponent();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseFloorComponent();
+
+        // Properties
+        int mSampleStep = 8;                                ///< Property: 'SampleStep' distance in pixels between sampled depth pixels
+        int mIterations = 16;                               ///< Property: 'Iterations' amount of RANSAC hypotheses tested per frame
+        float mThreshold = 0.02f;                           ///< Property: 'Threshold' maximum distance in meters of a floor point to the plane
+        glm::vec3 mUpVector = { 0.0f, -1.0f, 0.0f };        ///< Property: 'UpVector' expected floor normal in camera space
+        float mMaxAngle = 45.0f;                            ///< Property: 'MaxAngle' maximum angle in degrees between the floor normal and the up vector
+        float mMinInlierRatio = 0.1f;                       ///< Property: 'MinInlierRatio' minimum fraction of sampled points on the floor
+    };
+
+    /**
+     * RealSenseFloorComponentInstance
+     * Refines the floor plane on the capture thread, the plane can be read from any thread
+     */
+    class NAPAPI RealSenseFloorComponentInstance : public RealSenseFrameSetListenerComponentInstance
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponentInstance)
+    public:
+        /**
+         * Constructor
+         * @param entity reference to entity instance
+         * @param resource reference to component
+         */
+        RealSenseFloorComponentInstance(EntityInstance& entity, Component& resource);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseFloorComponentInstance();
+
+        /**
+         * @return the latest floor plane, thread safe
+         */
+        RealSenseFloorPlane getPlane() const;
+
+        /**
+         * @return true if a floor plane was found, thread safe
+         */
+        bool isValid() const;
+
+        /**
+         * Returns the transform from camera space to floor space of the last valid plane, identity until a plane is found. Thread safe.
+         * Floor space has the y axis pointing up, the floor at y = 0 and the camera above the origin.
+         * @return camera to floor transform
+         */
+        glm::mat4 getCameraTransform() const;
+
+        /**
+         * Discards the cached plane, the estimation starts from scratch on the next frame. Thread safe.
+         */
+        void reset()                                        { mReset = true; }
+
+    protected:
+        /**
+         * Internal init method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool onInit(utility::ErrorState& errorState) override;
+
+        /**
+         * Called upon receiving a new frameset, called from RealSense device
+         * @param frameset a new frameset
+         */
+        void onTrigger(const rs2::frameset& frameset);
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseFloorComponent* mResource = nullptr;
+        RealSenseFloorEstimator::Parameters mParameters;
+        std::atomic<bool> mReset = { false };
+
+        mutable std::mutex mPlaneMutex;
+        RealSenseFloorPlane mPlane;                         ///< Latest plane, guarded by mPlaneMutex
+        glm::mat4 mCameraTransform = glm::mat4(1.0f);       ///< Transform of the latest plane, guarded by mPlaneMutex
+    };
+}
@@ -0,0 +1,240 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensefloorplane.h"
+#include "realsensedeprojection.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Minimum relative score of a refined plane, a least squares fit can lose a few inliers at the threshold border
+     */
+    static constexpr float sRefineTolerance = 0.98f;
+
+
+    /**
+     * Computes the plane through three points, oriented so the camera is above it
+     */
+    static bool fromPoints(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, RealSenseFloorPlane& plane)
+    {
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        if(length < 1e-6f)
+            return false;
+
+        plane.mNormal = normal / length;
+        plane.mDistance = -glm::dot(plane.mNormal, a);
+        if(plane.mDistance < 0.0f)
+        {
+            plane.mNormal = -plane.mNormal;
+            plane.mDistance = -plane.mDistance;
+        }
+        return true;
+    }
+
+
+    static bool isUpright(const RealSenseFloorPlane& plane, const glm::vec3& up, float cosMaxAngle)
+    {
+        return glm::dot(plane.mNormal, up) >= cosMaxAngle;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFloorPlane
+    //////////////////////////////////////////////////////////////////////////
+
+    glm::mat4 RealSenseFloorPlane::getCameraTransform() const
+    {
+        // floor x axis: camera x axis projected onto the floor, camera z axis when looking along x
+        glm::vec3 y = mNormal;
+        glm::vec3 x = glm::vec3(1.0f, 0.0f, 0.0f) - y * y.x;
+        if(glm::length(x) < 1e-3f)
+            x = glm::vec3(0.0f, 0.0f, 1.0f) - y * y.z;
+        x = glm::normalize(x);
+        glm::vec3 z = glm::cross(x, y);
+
+        // rows are the floor axes, the camera is at height distance above the origin
+        glm::mat4 transform(1.0f);
+        for(int column = 0; column < 3; column++)
+        {
+            transform[column][0] = x[column];
+            transform[column][1] = y[column];
+            transform[column][2] = z[column];
+        }
+        transform[3] = glm::vec4(0.0f, mDistance, 0.0f, 1.0f);
+        return transform;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFloorEstimator
+    //////////////////////////////////////////////////////////////////////////
+
+    const RealSenseFloorPlane& RealSenseFloorEstimator::update(const uint16* depth, int depthStride, float depthScale,
+                                                               const RealSenseDeprojectionMap& rays, const Parameters& parameters)
+    {
+        // sample the frame on a grid, the grid offset cycles so every pixel is visited over time
+        int step = std::max(parameters.mSampleStep, 1);
+        int offset = mFrame++ % step;
+        int width = rays.getWidth();
+        int height = rays.getHeight();
+        const float* ray_x = rays.getX();
+        const float* ray_y = rays.getY();
+        mSamples.clear();
+        for(int row = offset; row < height; row += step)
+        {
+            const auto* values = reinterpret_cast<const uint16*>(reinterpret_cast<const uint8*>(depth) + static_cast<size_t>(row) * static_cast<size_t>(depthStride));
+            size_t row_offset = static_cast<size_t>(row) * static_cast<size_t>(width);
+            for(int x = offset; x < width; x += step)
+            {
+                if(values[x] == 0)
+                    continue;
+
+                float z = values[x] * depthScale;
+                mSamples.emplace_back(ray_x[row_offset + x] * z, ray_y[row_offset + x] * z, z);
+            }
+        }
+
+        if(mSamples.size() < 3)
+        {
+            mPlane.mValid = false;
+            mPlane.mInlierRatio = 0.0f;
+            return mPlane;
+        }
+
+        glm::vec3 up = glm::length(parameters.mUp) > 0.0f ? glm::normalize(parameters.mUp) : glm::vec3(0.0f, -1.0f, 0.0f);
+        float cos_max_angle = std::cos(glm::radians(parameters.mMaxAngle));
+
+        // the cached plane is the hypothesis to beat
+        RealSenseFloorPlane best;
+        int best_score = 0;
+        mInliers.clear();
+        if(mPlane.mValid && isUpright(mPlane, up, cos_max_angle))
+        {
+            best = mPlane;
+            best_score = countInliers(best, parameters.mThreshold, &mInliers);
+        }
+
+        // half of the hypotheses are drawn from the cached inliers, the other half from all samples to escape a wrong plane
+        std::uniform_int_distribution<int> all_samples(0, static_cast<int>(mSamples.size()) - 1);
+        bool seeded = mInliers.size() >= 3;
+        std::uniform_int_distribution<int> seed_samples(0, seeded ? static_cast<int>(mInliers.size()) - 1 : 0);
+        for(int i = 0; i < parameters.mIterations; i++)
+        {
+            bool from_seed = seeded && (i % 2) == 0;
+            auto pick = [&]() { return from_seed ? mSamples[mInliers[seed_samples(mRandom)]] : mSamples[all_samples(mRandom)]; };
+
+            RealSenseFloorPlane candidate;
+            if(!fromPoints(pick(), pick(), pick(), candidate) || !isUpright(candidate, up, cos_max_angle))
+                continue;
+
+            int score = countInliers(candidate, parameters.mThreshold, nullptr);
+            if(score > best_score)
+            {
+                best = candidate;
+                best_score = score;
+            }
+        }
+
+        if(best_score < 3)
+        {
+            mPlane.mValid = false;
+            mPlane.mInlierRatio = 0.0f;
+            return mPlane;
+        }
+
+        // least squares refinement on the inliers of the best hypothesis
+        countInliers(best, parameters.mThreshold, &mCandidateInliers);
+        RealSenseFloorPlane refined = best;
+        if(refine(refined, mCandidateInliers) && isUpright(refined, up, cos_max_angle))
+        {
+            int score = countInliers(refined, parameters.mThreshold, nullptr);
+            if(score >= static_cast<int>(best_score * sRefineTolerance))
+            {
+                best = refined;
+                best_score = score;
+            }
+        }
+
+        best.mInlierRatio = static_cast<float>(best_score) / static_cast<float>(mSamples.size());
+        best.mValid = best.mInlierRatio >= parameters.mMinInlierRatio;
+        mPlane = best;
+        return mPlane;
+    }
+
+
+    int RealSenseFloorEstimator::countInliers(const RealSenseFloorPlane& plane, float threshold, std::vector<int>* inliers) const
+    {
+        if(inliers != nullptr)
+            inliers->clear();
+
+        int count = 0;
+        int sample_count = static_cast<int>(mSamples.size());
+        for(int i = 0; i < sample_count; i++)
+        {
+            if(std::abs(plane.getHeight(mSamples[i])) > threshold)
+                continue;
+
+            count++;
+            if(inliers != nullptr)
+                inliers->emplace_back(i);
+        }
+        return count;
+    }
+
+
+    bool RealSenseFloorEstimator::refine(RealSenseFloorPlane& plane, const std::vector<int>& inliers) const
+    {
+        if(inliers.size() < 3)
+            return false;
+
+        // fit the height above the plane as h = a * u + b * v + c, with u and v spanning the plane
+        glm::vec3 n = plane.mNormal;
+        glm::vec3 u = std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+        u = glm::normalize(u - n * glm::dot(n, u));
+        glm::vec3 v = glm::cross(n, u);
+
+        double suu = 0.0, suv = 0.0, su = 0.0, svv = 0.0, sv = 0.0, count = 0.0;
+        double suh = 0.0, svh = 0.0, sh = 0.0;
+        for(int index : inliers)
+        {
+            const glm::vec3& point = mSamples[index];
+            double pu = glm::dot(u, point);
+            double pv = glm::dot(v, point);
+            double ph = plane.getHeight(point);
+            suu += pu * pu; suv += pu * pv; su += pu;
+            svv += pv * pv; sv += pv; count += 1.0;
+            suh += pu * ph; svh += pv * ph; sh += ph;
+        }
+
+        // solve the symmetric normal equations with Cramer's rule
+        double det = suu * (svv * count - sv * sv) - suv * (suv * count - sv * su) + su * (suv * sv - svv * su);
+        if(std::abs(det) < 1e-12)
+            return false;
+
+        double a = (suh * (svv * count - sv * sv) - suv * (svh * count - sv * sh) + su * (svh * sv - svv * sh)) / det;
+        double b = (suu * (svh * count - sh * sv) - suh * (suv * count - sv * su) + su * (suv * sh - svh * su)) / det;
+        double c = (suu * (svv * sh - sv * svh) - suv * (suv * sh - svh * su) + suh * (suv * sv - svv * su)) / det;
+
+        // n.p + d - a * u.p - b * v.p - c = 0
+        glm::vec3 normal = n - u * static_cast<float>(a) - v * static_cast<float>(b);
+        float length = glm::length(normal);
+        if(length < 1e-6f)
+            return false;
+
+        plane.mNormal = normal / length;
+        plane.mDistance = (plane.mDistance - static_cast<float>(c)) / length;
+        if(plane.mDistance < 0.0f)
+        {
+            plane.mNormal = -plane.mNormal;
+            plane.mDistance = -plane.mDistance;
+        }
+        return true;
+    }
+}
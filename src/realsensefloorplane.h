@@ -0,0 +1,100 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseDeprojectionMap;
+
+    /**
+     * Floor plane in camera space (x right, y down, z forward, in meters).
+     * A point p lies on the plane when dot(normal, p) + distance = 0, the camera is above the floor: distance is its height.
+     */
+    struct NAPAPI RealSenseFloorPlane
+    {
+        glm::vec3 mNormal = { 0.0f, -1.0f, 0.0f };      ///< Unit normal pointing up, away from the floor
+        float mDistance = 0.0f;                         ///< Height of the camera above the floor in meters
+        float mInlierRatio = 0.0f;                      ///< Fraction of the sampled points on the plane
+        bool mValid = false;                            ///< If a plane was found
+
+        /**
+         * @return height of a camera space point above the floor in meters
+         */
+        float getHeight(const glm::vec3& point) const   { return glm::dot(mNormal, point) + mDistance; }
+
+        /**
+         * Returns the transform from camera space to floor space.
+         * Floor space has the y axis along the normal, the origin below the camera and the x axis along the camera x axis projected onto the floor.
+         * @return camera to floor transform
+         */
+        glm::mat4 getCameraTransform() const;
+    };
+
+    /**
+     * RealSenseFloorEstimator
+     * Estimates the dominant floor plane of depth frames with RANSAC on a subsampled set of points.
+     * The estimate is cached and refined incrementally: every frame the cached plane is scored again, a bounded amount of hypotheses
+     * is tested, half of them drawn from the points near the cached plane, and the best plane is refined with a least squares fit of its inliers.
+     * Planes of which the normal deviates more than the maximum angle from the expected up vector, such as walls, are rejected.
+     */
+    class NAPAPI RealSenseFloorEstimator final
+    {
+    public:
+        /**
+         * Estimation parameters
+         */
+        struct Parameters
+        {
+            int mSampleStep = 8;                        ///< Distance in pixels between sampled points
+            int mIterations = 16;                       ///< Amount of hypotheses tested per frame
+            float mThreshold = 0.02f;                   ///< Maximum distance in meters of an inlier to the plane
+            glm::vec3 mUp = { 0.0f, -1.0f, 0.0f };      ///< Expected floor normal in camera space
+            float mMaxAngle = 45.0f;                    ///< Maximum angle in degrees between the floor normal and the expected up vector
+            float mMinInlierRatio = 0.1f;               ///< Minimum fraction of sampled points on the floor of a valid plane
+        };
+
+        /**
+         * Refines the floor plane with a new depth frame
+         * @param depth depth values of the frame
+         * @param depthStride stride of the depth frame in bytes
+         * @param depthScale depth units in meters
+         * @param rays deprojection map of the depth stream
+         * @param parameters estimation parameters
+         * @return the current floor plane
+         */
+        const RealSenseFloorPlane& update(const uint16* depth, int depthStride, float depthScale, const RealSenseDeprojectionMap& rays,
+                                          const Parameters& parameters);
+
+        /**
+         * Discards the cached plane, the next update starts from scratch
+         */
+        void reset()                                    { mPlane = RealSenseFloorPlane(); }
+
+        /**
+         * @return the current floor plane
+         */
+        const RealSenseFloorPlane& getPlane() const     { return mPlane; }
+
+    private:
+        int countInliers(const RealSenseFloorPlane& plane, float threshold, std::vector<int>* inliers) const;
+        bool refine(RealSenseFloorPlane& plane, const std::vector<int>& inliers) const;
+
+        RealSenseFloorPlane mPlane;
+        std::vector<glm::vec3> mSamples;
+        std::vector<int> mInliers;
+        std::vector<int> mCandidateInliers;
+        std::mt19937 mRandom;
+        int mFrame = 0;
+    };
+}
@@ -0,0 +1,230 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsenseframearena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameArena
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseFrameArena::RealSenseFrameArena(size_t capacity)
+    {
+        if(capacity > 0)
+            addBlock(capacity);
+    }
+
+
+    void* RealSenseFrameArena::allocate(size_t size, size_t alignment)
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+        while(true)
+        {
+            // the remainder of a block that is too small is skipped
+            for(; mBlock < mBlocks.size(); mBlock++, mOffset = 0)
+            {
+                auto& block = mBlocks[mBlock];
+                auto base = reinterpret_cast<uintptr_t>(block.mData.get());
+                size_t offset = ((base + mOffset + alignment - 1) & ~(alignment - 1)) - base;
+                if(offset + size > block.mSize)
+                    continue;
+
+                mUsed += offset + size - mOffset;
+                mOffset = offset + size;
+                return block.mData.get() + offset;
+            }
+
+            // grow by at least the current capacity to keep the amount of blocks low
+            addBlock(std::max(mCapacity, size + alignment));
+            mGrowCount++;
+        }
+    }
+
+
+    void RealSenseFrameArena::reset()
+    {
+        if(mBlocks.size() > 1)
+        {
+            size_t capacity = mCapacity;
+            mBlocks.clear();
+            mCapacity = 0;
+            addBlock(capacity);
+        }
+        mBlock = 0;
+        mOffset = 0;
+        mUsed = 0;
+    }
+
+
+    void RealSenseFrameArena::addBlock(size_t size)
+    {
+        Block block;
+        block.mData = std::make_unique<uint8[]>(size);
+        block.mSize = size;
+        mBlocks.emplace_back(std::move(block));
+        mCapacity += size;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameArenaLease
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseFrameArenaLease::RealSenseFrameArenaLease(RealSenseFrameArena& arena) : mArena(&arena)
+    {
+        mArena->mReferences.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    RealSenseFrameArenaLease::RealSenseFrameArenaLease(const RealSenseFrameArenaLease& other) : mArena(other.mArena)
+    {
+        if(mArena != nullptr)
+            mArena->mReferences.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    RealSenseFrameArenaLease::RealSenseFrameArenaLease(RealSenseFrameArenaLease&& other) noexcept : mArena(other.mArena)
+    {
+        other.mArena = nullptr;
+    }
+
+
+    RealSenseFrameArenaLease& RealSenseFrameArenaLease::operator=(const RealSenseFrameArenaLease& other)
+    {
+        if(other.mArena != nullptr)
+            other.mArena->mReferences.fetch_add(1, std::memory_order_relaxed);
+        release();
+        mArena = other.mArena;
+        return *this;
+    }
+
+
+    RealSenseFrameArenaLease& RealSenseFrameArenaLease::operator=(RealSenseFrameArenaLease&& other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            mArena = other.mArena;
+            other.mArena = nullptr;
+        }
+        return *this;
+    }
+
+
+    RealSenseFrameArenaLease::~RealSenseFrameArenaLease()
+    {
+        release();
+    }
+
+
+    void RealSenseFrameArenaLease::release()
+    {
+        // the last lease makes all writes to the arena visible to the thread that recycles it
+        if(mArena != nullptr && mArena->mReferences.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            RealSenseFrameArenaPool::recycle(*mArena);
+        mArena = nullptr;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameArenaPool
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseFrameArenaPool::State
+    {
+        std::mutex mMutex;
+        std::vector<std::unique_ptr<RealSenseFrameArena>> mArenas;
+        std::vector<RealSenseFrameArena*> mFree;
+        size_t mCapacity = 0;
+        Statistics mStatistics;
+    };
+
+
+    RealSenseFrameArenaPool::RealSenseFrameArenaPool(size_t capacity) : mState(std::make_shared<State>())
+    {
+        mState->mCapacity = capacity;
+    }
+
+
+    RealSenseFrameArenaPool::~RealSenseFrameArenaPool() = default;
+
+
+    RealSenseFrameArenaLease RealSenseFrameArenaPool::acquire()
+    {
+        std::lock_guard<std::mutex> lock(mState->mMutex);
+        RealSenseFrameArena* arena = nullptr;
+        if(mState->mFree.empty())
+        {
+            mState->mArenas.emplace_back(std::make_unique<RealSenseFrameArena>(mState->mCapacity));
+            mState->mFree.reserve(mState->mArenas.size());
+            arena = mState->mArenas.back().get();
+            mState->mStatistics.mArenas++;
+            mState->mStatistics.mCapacity += arena->getCapacity();
+        }
+        else
+        {
+            arena = mState->mFree.back();
+            mState->mFree.pop_back();
+        }
+
+        // a leased arena keeps the state alive, the pool can be destroyed while consumers still hold leases
+        arena->mOwner = mState;
+        arena->mLeasedCapacity = arena->getCapacity();
+        mState->mStatistics.mLeased++;
+        return RealSenseFrameArenaLease(*arena);
+    }
+
+
+    RealSenseFrameArenaPool::Statistics RealSenseFrameArenaPool::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mState->mMutex);
+        return mState->mStatistics;
+    }
+
+
+    void RealSenseFrameArenaPool::recycle(RealSenseFrameArena& arena)
+    {
+        // released after the lock, destroys the state and all arenas when the pool is already gone
+        std::shared_ptr<void> state;
+        state.swap(arena.mOwner);
+        auto* owner = static_cast<State*>(state.get());
+        std::lock_guard<std::mutex> lock(owner->mMutex);
+
+        auto& statistics = owner->mStatistics;
+        statistics.mFrames++;
+        statistics.mLastUsage = arena.getUsed();
+        statistics.mPeakUsage = std::max(statistics.mPeakUsage, arena.getUsed());
+        statistics.mCapacity += arena.getCapacity() - arena.mLeasedCapacity;
+        statistics.mGrowCount += arena.mGrowCount;
+        statistics.mLeased--;
+
+        arena.reset();
+        arena.mGrowCount = 0;
+        owner->mFree.emplace_back(&arena);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameContext
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseFrameContext::addFrameInfo(const RealSenseFrameInfo& info)
+    {
+        if(mFrameInfoCount < sMaxFrameInfos)
+            mFrameInfos[mFrameInfoCount++] = info;
+    }
+
+
+    const RealSenseFrameInfo* RealSenseFrameContext::getFrameInfo(ERealSenseStreamType stream, int index) const
+    {
+        for(int i = 0; i < mFrameInfoCount; i++)
+        {
+            if(mFrameInfos[i].mStream == stream && (index < 0 || mFrameInfos[i].mStreamIndex == index))
+                return &mFrameInfos[i];
+        }
+        return nullptr;
+    }
+}
@@ -0,0 +1,272 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Local includes
+#include "realsensetypes.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseFrameArenaPool;
+
+    /**
+     * RealSenseFrameArena
+     * Bump allocator for data derived from a single frameset, such as points, blobs or masks.
+     * Allocations are never freed individually, all memory is released at once when the arena is recycled.
+     * When an allocation does not fit, a new block is added. On recycle the blocks are merged into one block of the
+     * combined size, after a few frames the arena is large enough and allocations cost no heap traffic.
+     * An arena is not thread safe, allocate from one thread at a time.
+     */
+    class NAPAPI RealSenseFrameArena final
+    {
+        friend class RealSenseFrameArenaPool;
+        friend class RealSenseFrameArenaLease;
+    public:
+        /**
+         * Constructor
+         * @param capacity initial capacity in bytes
+         */
+        RealSenseFrameArena(size_t capacity);
+
+        /**
+         * Allocates uninitialized memory that stays valid until the arena is recycled
+         * @param size size in bytes
+         * @param alignment alignment in bytes, must be a power of two
+         * @return the memory
+         */
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        /**
+         * Allocates uninitialized memory for count elements of type T, T must be trivially destructible
+         * @param count amount of elements
+         * @return the elements
+         */
+        template<typename T>
+        T* allocate(size_t count)               { return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+
+        /**
+         * Releases all allocations and merges the blocks, only call when no allocation is referenced anymore
+         */
+        void reset();
+
+        /**
+         * @return amount of allocated bytes since the last reset, including alignment padding
+         */
+        size_t getUsed() const                  { return mUsed; }
+
+        /**
+         * @return total size of all blocks in bytes
+         */
+        size_t getCapacity() const              { return mCapacity; }
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<uint8[]> mData;
+            size_t mSize = 0;
+        };
+
+        void addBlock(size_t size);
+
+        std::vector<Block> mBlocks;
+        size_t mBlock = 0;
+        size_t mOffset = 0;
+        size_t mUsed = 0;
+        size_t mCapacity = 0;
+        uint64 mGrowCount = 0;
+        size_t mLeasedCapacity = 0;
+
+        // references of leases, the arena returns to mOwner when the last lease is released
+        std::atomic<int> mReferences = { 0 };
+        std::shared_ptr<void> mOwner;
+    };
+
+
+    /**
+     * Standard library allocator that allocates from a RealSenseFrameArena, deallocation is a no-op.
+     * Reserve containers up front, every reallocation leaves the previous storage unused until the arena is recycled.
+     */
+    template<typename T>
+    class RealSenseArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        RealSenseArenaAllocator(RealSenseFrameArena& arena) : mArena(&arena)                 { }
+
+        template<typename U>
+        RealSenseArenaAllocator(const RealSenseArenaAllocator<U>& other) : mArena(other.mArena) { }
+
+        T* allocate(size_t count)               { return mArena->allocate<T>(count); }
+        void deallocate(T*, size_t)             { }
+
+        template<typename U>
+        bool operator==(const RealSenseArenaAllocator<U>& other) const                      { return mArena == other.mArena; }
+
+        template<typename U>
+        bool operator!=(const RealSenseArenaAllocator<U>& other) const                      { return mArena != other.mArena; }
+
+        RealSenseFrameArena* mArena;
+    };
+
+    /**
+     * Vector that allocates from a RealSenseFrameArena
+     */
+    template<typename T>
+    using RealSenseArenaVector = std::vector<T, RealSenseArenaAllocator<T>>;
+
+
+    /**
+     * RealSenseFrameArenaLease
+     * Reference counted handle to an arena acquired from a RealSenseFrameArenaPool.
+     * The arena is reset and returned to the pool when the last lease is released, copying a lease does not allocate.
+     */
+    class NAPAPI RealSenseFrameArenaLease final
+    {
+        friend class RealSenseFrameArenaPool;
+    public:
+        RealSenseFrameArenaLease() = default;
+        RealSenseFrameArenaLease(const RealSenseFrameArenaLease& other);
+        RealSenseFrameArenaLease(RealSenseFrameArenaLease&& other) noexcept;
+        RealSenseFrameArenaLease& operator=(const RealSenseFrameArenaLease& other);
+        RealSenseFrameArenaLease& operator=(RealSenseFrameArenaLease&& other) noexcept;
+        ~RealSenseFrameArenaLease();
+
+        /**
+         * Releases the lease, the lease is empty afterwards
+         */
+        void release();
+
+        /**
+         * @return the arena, nullptr when the lease is empty
+         */
+        RealSenseFrameArena* get() const        { return mArena; }
+
+        RealSenseFrameArena* operator->() const { return mArena; }
+        RealSenseFrameArena& operator*() const  { return *mArena; }
+        explicit operator bool() const          { return mArena != nullptr; }
+
+    private:
+        RealSenseFrameArenaLease(RealSenseFrameArena& arena);
+
+        RealSenseFrameArena* mArena = nullptr;
+    };
+
+
+    /**
+     * RealSenseFrameArenaPool
+     * Pool of frame arenas, a RealSenseDevice acquires one arena per frameset.
+     * Arenas that are still leased when the pool is destroyed stay valid until they are released.
+     * Acquire and statistics can be called from any thread.
+     */
+    class NAPAPI RealSenseFrameArenaPool final
+    {
+        friend class RealSenseFrameArenaLease;
+    public:
+        /**
+         * Arena usage statistics of the pool
+         */
+        struct Statistics
+        {
+            uint64 mFrames = 0;         ///< Amount of recycled arenas
+            size_t mLastUsage = 0;      ///< Bytes used by the last recycled arena
+            size_t mPeakUsage = 0;      ///< Maximum bytes used by a single arena
+            size_t mCapacity = 0;       ///< Total capacity of all arenas in bytes
+            int mArenas = 0;            ///< Amount of created arenas
+            int mLeased = 0;            ///< Amount of arenas currently leased
+            uint64 mGrowCount = 0;      ///< Amount of blocks added because an allocation did not fit, each one is a heap allocation
+        };
+
+        /**
+         * Constructor
+         * @param capacity initial capacity of every arena in bytes
+         */
+        RealSenseFrameArenaPool(size_t capacity);
+
+        /**
+         * Destructor
+         */
+        ~RealSenseFrameArenaPool();
+
+        /**
+         * Returns a free arena, a new arena is created when all arenas are leased
+         * @return lease of the arena
+         */
+        RealSenseFrameArenaLease acquire();
+
+        /**
+         * @return usage statistics of all arenas
+         */
+        Statistics getStatistics() const;
+
+    private:
+        struct State;
+        static void recycle(RealSenseFrameArena& arena);
+
+        std::shared_ptr<State> mState;
+    };
+
+
+    /**
+     * RealSenseFrameContext
+     * Per frameset context handed to filters and listeners while a RealSenseDevice processes a frameset.
+     * Holds the metadata of every frame of the frameset, extracted once on the capture thread before the filters run.
+     * Derived data can be allocated from the frame arena instead of the heap. The arena is recycled when the
+     * device is done with the frameset and all retained leases are released: consumers that keep derived data
+     * after their callback returns, for example to finish work on another thread, must retain the arena.
+     */
+    class NAPAPI RealSenseFrameContext final
+    {
+    public:
+        /**
+         * Constructor
+         * @param arena lease of the arena of this frameset
+         */
+        RealSenseFrameContext(RealSenseFrameArenaLease arena) : mArena(std::move(arena))      { }
+
+        /**
+         * @return the arena of this frameset, valid until the callback returns unless retained
+         */
+        RealSenseFrameArena& getArena()         { return *mArena; }
+
+        /**
+         * Keeps the arena of this frameset alive until the returned lease is released
+         * @return lease of the arena
+         */
+        RealSenseFrameArenaLease retain() const { return mArena; }
+
+        /**
+         * Adds the metadata of a frame of the frameset, called by the device. Frames beyond the maximum are ignored.
+         * @param info the frame info
+         */
+        void addFrameInfo(const RealSenseFrameInfo& info);
+
+        /**
+         * Returns the metadata of a frame of the frameset
+         * @param stream stream type of the frame
+         * @param index stream index of the frame, -1 matches any index
+         * @return the frame info, nullptr when the frameset has no frame of the stream
+         */
+        const RealSenseFrameInfo* getFrameInfo(ERealSenseStreamType stream, int index = -1) const;
+
+        static constexpr int sMaxFrameInfos = 8;    ///< Maximum amount of frames in a frameset with metadata
+
+    private:
+        RealSenseFrameArenaLease mArena;
+        RealSenseFrameInfo mFrameInfos[sMaxFrameInfos];
+        int mFrameInfoCount = 0;
+    };
+}
@@ -1,10 +1,23 @@
 
 #include "realsenseframefilter.h"
 #include "realsensedevice.h"
+#include "realsensedepthcolorizer.h"
+#include "realsensebackgroundmodel.h"
+#include "realsenseservice.h"
+#include "realsenseworkerpool.h"
+#include "realsensetrace.h"
+#include "realsenseframearena.h"
 
 #include <rs.hpp>
+#include <chrono>
+#include <cstring>
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseFrameFilter)
+    RTTI_PROPERTY("Optional", &nap::RealSenseFrameFilter::mOptional, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseFrameKernelFilter)
+    RTTI_PROPERTY("PoolSize", &nap::RealSenseFrameKernelFilter::mPoolSize, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS(nap::RealSenseSpatialFilter)
@@ -15,9 +28,28 @@ RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS(nap::RealSenseDecFilter)
         RTTI_PROPERTY("Magnitude", &nap::RealSenseDecFilter::mMagnitude, nap::rtti::EPropertyMetaData::Default)
+        RTTI_PROPERTY("DegradedMagnitude", &nap::RealSenseDecFilter::mDegradedMagnitude, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS(nap::RealSenseColorizeFilter)
+    RTTI_PROPERTY("HistogramEqualization", &nap::RealSenseColorizeFilter::mHistogramEqualization, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("HistogramInterval", &nap::RealSenseColorizeFilter::mHistogramInterval, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MinDistance", &nap::RealSenseColorizeFilter::mMinDistance, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MaxDistance", &nap::RealSenseColorizeFilter::mMaxDistance, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS(nap::RealSenseCropFilter)
+    RTTI_PROPERTY("X", &nap::RealSenseCropFilter::mX, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Y", &nap::RealSenseCropFilter::mY, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Width", &nap::RealSenseCropFilter::mWidth, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Height", &nap::RealSenseCropFilter::mHeight, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseBackgroundSubtractFilter)
+    RTTI_CONSTRUCTOR(nap::RealSenseService&)
+    RTTI_PROPERTY("Threshold", &nap::RealSenseBackgroundSubtractFilter::mThreshold, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("LearningRate", &nap::RealSenseBackgroundSubtractFilter::mLearningRate, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("LearnFrames", &nap::RealSenseBackgroundSubtractFilter::mLearnFrames, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 namespace nap
@@ -31,6 +63,169 @@ namespace nap
 
     RealSenseFrameFilter::~RealSenseFrameFilter() = default;
 
+
+    rs2::frame RealSenseFrameFilter::process(const rs2::frame& frame, RealSenseFrameContext* context)
+    {
+        RealSenseTraceScope trace(mID.c_str(), "filter");
+        auto start = std::chrono::steady_clock::now();
+        mFrameContext = context;
+        rs2::frame result = onProcess(frame);
+        mFrameContext = nullptr;
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        int input_width = 0, input_height = 0;
+        if(auto video_frame = frame.as<rs2::video_frame>())
+        {
+            input_width = video_frame.get_width();
+            input_height = video_frame.get_height();
+        }
+
+        int output_width = 0, output_height = 0;
+        if(auto video_frame = result.as<rs2::video_frame>())
+        {
+            output_width = video_frame.get_width();
+            output_height = video_frame.get_height();
+        }
+
+        mStatistics.record(static_cast<uint64>(duration.count()), input_width, input_height,
+                           output_width, output_height, result.get() != frame.get());
+        return result;
+    }
+
+
+    void RealSenseFrameFilter::setDegraded(bool degraded)
+    {
+        if(degraded == mDegraded)
+            return;
+
+        mDegraded = degraded;
+        onDegrade(degraded);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameKernelFilter::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseFrameKernelFilter::Impl
+    {
+    public:
+        Impl(RealSenseFrameKernelFilter& filter) :
+            mFilter([this](rs2::frame frame, rs2::frame_source& source){ apply(frame, source); }),
+            mResource(filter) { }
+
+        /**
+         * Called from the processing block, runs the kernel on the video frame and hands the output back to the frame source
+         */
+        void apply(rs2::frame& frame, rs2::frame_source& source)
+        {
+            auto video_frame = frame.as<rs2::video_frame>();
+            if(!video_frame)
+            {
+                source.frame_ready(frame);
+                return;
+            }
+
+            auto profile = video_frame.get_profile().as<rs2::video_stream_profile>();
+            RealSenseFrameView input;
+            input.mData = static_cast<uint8*>(const_cast<void*>(video_frame.get_data()));
+            input.mWidth = video_frame.get_width();
+            input.mHeight = video_frame.get_height();
+            input.mStride = video_frame.get_stride_in_bytes();
+            input.mBytesPerPixel = video_frame.get_bytes_per_pixel();
+            input.mFormat = static_cast<ERealSenseStreamFormat>(profile.format());
+            bool depth = frame.is<rs2::depth_frame>();
+            if(depth)
+                input.mDepthUnits = frame.as<rs2::depth_frame>().get_units();
+            if(auto* context = mResource.getFrameContext())
+                input.mInfo = context->getFrameInfo(static_cast<ERealSenseStreamType>(profile.stream_type()), profile.stream_index());
+
+            RealSenseFrameView output = input;
+            output.mData = nullptr;
+            if(!mResource.onConfigure(input, output) || output.mWidth <= 0 || output.mHeight <= 0 || output.mBytesPerPixel <= 0)
+            {
+                source.frame_ready(frame);
+                return;
+            }
+            output.mStride = output.mWidth * output.mBytesPerPixel;
+
+            // the input profile is reused when the layout is unchanged, otherwise a profile is created when the layout changes
+            rs2::stream_profile target_profile = profile;
+            if(output.mFormat != input.mFormat || output.mWidth != input.mWidth || output.mHeight != input.mHeight ||
+               output.mOffsetX != 0 || output.mOffsetY != 0)
+            {
+                if(profile.unique_id() != mSourceProfileID || output.mFormat != mLayout.mFormat || output.mWidth != mLayout.mWidth ||
+                   output.mHeight != mLayout.mHeight || output.mOffsetX != mLayout.mOffsetX || output.mOffsetY != mLayout.mOffsetY)
+                {
+                    rs2_intrinsics intrinsics = profile.get_intrinsics();
+                    intrinsics.width = output.mWidth;
+                    intrinsics.height = output.mHeight;
+                    intrinsics.ppx -= static_cast<float>(output.mOffsetX);
+                    intrinsics.ppy -= static_cast<float>(output.mOffsetY);
+                    mTargetProfile = profile.clone(profile.stream_type(), profile.stream_index(), static_cast<rs2_format>(output.mFormat),
+                                                   output.mWidth, output.mHeight, intrinsics);
+                    mSourceProfileID = profile.unique_id();
+                    mLayout = output;
+                }
+                target_profile = mTargetProfile;
+            }
+
+            // a depth frame stays a depth frame as long as the format is unchanged, the frame source expects bits per pixel
+            depth = depth && output.mFormat == input.mFormat;
+            output.mDepthUnits = depth ? input.mDepthUnits : 0.0f;
+            auto frame_type = depth ? RS2_EXTENSION_DEPTH_FRAME : RS2_EXTENSION_VIDEO_FRAME;
+            auto result = source.allocate_video_frame(target_profile, frame, output.mBytesPerPixel * 8, output.mWidth, output.mHeight,
+                                                      output.mStride, frame_type);
+            output.mData = static_cast<uint8*>(const_cast<void*>(result.get_data()));
+            mResource.getStatistics().recordOutput(output.mData);
+            mResource.onFilter(input, output);
+            source.frame_ready(result);
+        }
+
+        rs2::filter mFilter;
+        RealSenseFrameKernelFilter& mResource;
+        rs2::stream_profile mTargetProfile;
+        int mSourceProfileID = -1;
+        RealSenseFrameView mLayout;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameKernelFilter
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseFrameKernelFilter::RealSenseFrameKernelFilter() = default;
+
+
+    RealSenseFrameKernelFilter::~RealSenseFrameKernelFilter() = default;
+
+
+    bool RealSenseFrameKernelFilter::init(utility::ErrorState& errorState)
+    {
+        if(!errorState.check(mPoolSize > 0, "%s: pool size must be positive", mID.c_str()))
+            return false;
+
+        try
+        {
+            mKernel = std::make_unique<Impl>(*this);
+
+            // the frame source of the processing block recycles up to this amount of output frames
+            if(mKernel->mFilter.supports(RS2_OPTION_FRAMES_QUEUE_SIZE))
+                mKernel->mFilter.set_option(RS2_OPTION_FRAMES_QUEUE_SIZE, static_cast<float>(mPoolSize));
+        }catch(std::exception& e)
+        {
+            errorState.fail(e.what());
+            return false;
+        }
+
+        return true;
+    }
+
+
+    rs2::frame RealSenseFrameKernelFilter::onProcess(const rs2::frame& frame)
+    {
+        return mKernel->mFilter.process(frame);
+    }
+
+
     //////////////////////////////////////////////////////////////////////////
     // RealSenseSpatialFilter::Impl
     //////////////////////////////////////////////////////////////////////////
@@ -68,7 +263,7 @@ namespace nap
         return true;
     }
 
-    rs2::frame RealSenseSpatialFilter::process(const rs2::frame& frame)
+    rs2::frame RealSenseSpatialFilter::onProcess(const rs2::frame& frame)
     {
         return mImpl->mSpatFilter.filter::process(frame);
     }
@@ -98,6 +293,9 @@ namespace nap
         mImpl = std::make_unique<Impl>();
         try
         {
+            // validate the degraded magnitude against the option range before applying the regular magnitude
+            if(mDegradedMagnitude > 0.0f)
+                mImpl->mDecFilter.set_option(RS2_OPTION_FILTER_MAGNITUDE, mDegradedMagnitude);
             mImpl->mDecFilter.set_option(RS2_OPTION_FILTER_MAGNITUDE, mMagnitude);
         }catch(std::exception& e)
         {
@@ -108,11 +306,20 @@ namespace nap
         return true;
     }
 
-    rs2::frame RealSenseDecFilter::process(const rs2::frame& frame)
+    rs2::frame RealSenseDecFilter::onProcess(const rs2::frame& frame)
     {
         return mImpl->mDecFilter.filter::process(frame);
     }
 
+
+    void RealSenseDecFilter::onDegrade(bool degraded)
+    {
+        if(mDegradedMagnitude <= 0.0f)
+            return;
+
+        mImpl->mDecFilter.set_option(RS2_OPTION_FILTER_MAGNITUDE, degraded ? mDegradedMagnitude : mMagnitude);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     // RealSenseColorizeFilter::Impl
     //////////////////////////////////////////////////////////////////////////
@@ -120,11 +327,16 @@ namespace nap
     struct RealSenseColorizeFilter::Impl
     {
     public:
-        rs2::colorizer mColorizer;
+        static constexpr int sHistogramStep = 7; ///< Accumulate every n-th pixel, odd to avoid sampling the same columns every row
+
+        RealSenseDepthColorizer mColorizer;
+        float mDepthUnits = 0.0f;
+        int mFrameCount = 0;
+        bool mTableInitialized = false;
     };
 
     //////////////////////////////////////////////////////////////////////////
-    // RealSenseDecFilter
+    // RealSenseColorizeFilter
     //////////////////////////////////////////////////////////////////////////
 
     RealSenseColorizeFilter::RealSenseColorizeFilter() = default;
@@ -135,13 +347,204 @@ namespace nap
 
     bool RealSenseColorizeFilter::init(utility::ErrorState &errorState)
     {
+        if(!errorState.check(mMinDistance >= 0.0f && mMaxDistance > mMinDistance, "%s: invalid distance range", mID.c_str()))
+            return false;
+
+        if(!RealSenseFrameKernelFilter::init(errorState))
+            return false;
+
         mImpl = std::make_unique<Impl>();
+        mImpl->mColorizer.setHistogramEqualization(mHistogramEqualization);
+        return true;
+    }
+
+
+    bool RealSenseColorizeFilter::onConfigure(const RealSenseFrameView& input, RealSenseFrameView& output)
+    {
+        if(input.mFormat != ERealSenseStreamFormat::REALSENSE_FORMAT_Z16 || input.mDepthUnits <= 0.0f)
+            return false;
+
+        output.mFormat = ERealSenseStreamFormat::REALSENSE_FORMAT_RGBA8;
+        output.mBytesPerPixel = 4;
         return true;
     }
 
 
-    rs2::frame RealSenseColorizeFilter::process(const rs2::frame& frame)
+    void RealSenseColorizeFilter::onFilter(const RealSenseFrameView& input, RealSenseFrameView& output)
     {
-        return mImpl->mColorizer.process(frame);
+        // depth units can differ per device
+        auto& colorizer = mImpl->mColorizer;
+        if(input.mDepthUnits != mImpl->mDepthUnits)
+        {
+            mImpl->mDepthUnits = input.mDepthUnits;
+            colorizer.setRange(mMinDistance, mMaxDistance, input.mDepthUnits);
+            colorizer.updateLookupTable();
+        }
+
+        // rows are processed separately, input and output can have a different stride
+        const size_t width = static_cast<size_t>(input.mWidth);
+        const size_t step = static_cast<size_t>(Impl::sHistogramStep);
+
+        // accumulate a subset of the histogram every frame, rebuild the table every interval
+        if(colorizer.getHistogramEqualization())
+        {
+            // continue the sampling pattern across rows, as if the frame was contiguous
+            for(int y = 0; y < input.mHeight; y++)
+            {
+                size_t offset = (step - (static_cast<size_t>(y) * width) % step) % step;
+                if(offset < width)
+                    colorizer.accumulate(input.getRow<const uint16>(y) + offset, width - offset, Impl::sHistogramStep);
+            }
+
+            if(++mImpl->mFrameCount >= std::max(1, mHistogramInterval) || !mImpl->mTableInitialized)
+            {
+                colorizer.updateLookupTable();
+                mImpl->mFrameCount = 0;
+                mImpl->mTableInitialized = true;
+            }
+        }
+
+        for(int y = 0; y < input.mHeight; y++)
+            colorizer.colorize(input.getRow<const uint16>(y), output.getRow<uint32>(y), width);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseCropFilter
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseCropFilter::RealSenseCropFilter() = default;
+
+
+    RealSenseCropFilter::~RealSenseCropFilter() = default;
+
+
+    bool RealSenseCropFilter::init(utility::ErrorState& errorState)
+    {
+        if(!errorState.check(mWidth > 0 && mHeight > 0, "%s: region of interest must have a positive width and height", mID.c_str()))
+            return false;
+
+        if(!errorState.check(mX >= 0 && mY >= 0, "%s: region of interest offset must be positive", mID.c_str()))
+            return false;
+
+        return RealSenseFrameKernelFilter::init(errorState);
+    }
+
+
+    bool RealSenseCropFilter::onConfigure(const RealSenseFrameView& input, RealSenseFrameView& output)
+    {
+        // clamp region of interest to frame
+        int x = std::max(0, std::min(mX, input.mWidth - 1));
+        int y = std::max(0, std::min(mY, input.mHeight - 1));
+        int width = std::min(mWidth, input.mWidth - x);
+        int height = std::min(mHeight, input.mHeight - y);
+        if(width <= 0 || height <= 0 || (width == input.mWidth && height == input.mHeight))
+            return false;
+
+        output.mOffsetX = x;
+        output.mOffsetY = y;
+        output.mWidth = width;
+        output.mHeight = height;
+        return true;
+    }
+
+
+    void RealSenseCropFilter::onFilter(const RealSenseFrameView& input, RealSenseFrameView& output)
+    {
+        size_t offset = static_cast<size_t>(output.mOffsetX) * static_cast<size_t>(input.mBytesPerPixel);
+        size_t size = static_cast<size_t>(output.mWidth) * static_cast<size_t>(output.mBytesPerPixel);
+        for(int row = 0; row < output.mHeight; row++)
+            std::memcpy(output.getRow<uint8>(row), input.getRow<const uint8>(row + output.mOffsetY) + offset, size);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseBackgroundSubtractFilter::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseBackgroundSubtractFilter::Impl
+    {
+    public:
+        Impl(RealSenseWorkerPool& pool) : mPool(pool) { }
+
+        RealSenseWorkerPool& mPool;
+        RealSenseBackgroundModel mModel;
+        std::vector<uint8> mBackMask;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseBackgroundSubtractFilter
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseBackgroundSubtractFilter::RealSenseBackgroundSubtractFilter(RealSenseService& service) : mService(service)
+    { }
+
+
+    RealSenseBackgroundSubtractFilter::~RealSenseBackgroundSubtractFilter() = default;
+
+
+    bool RealSenseBackgroundSubtractFilter::init(utility::ErrorState& errorState)
+    {
+        if(!errorState.check(mThreshold > 0.0f, "%s: threshold must be positive", mID.c_str()))
+            return false;
+
+        if(!errorState.check(mLearningRate >= 0.0f, "%s: learning rate can't be negative", mID.c_str()))
+            return false;
+
+        if(!errorState.check(mLearnFrames > 0, "%s: amount of learn frames must be positive", mID.c_str()))
+            return false;
+
+        if(!RealSenseFrameKernelFilter::init(errorState))
+            return false;
+
+        mImpl = std::make_unique<Impl>(mService.getWorkerPool());
+        mImpl->mModel.reset(mLearnFrames);
+        return true;
+    }
+
+
+    bool RealSenseBackgroundSubtractFilter::getMask(std::vector<uint8>& mask, int& width, int& height) const
+    {
+        std::lock_guard<std::mutex> lock(mMaskMutex);
+        if(mMask.empty())
+            return false;
+
+        mask = mMask;
+        width = mMaskWidth;
+        height = mMaskHeight;
+        return true;
+    }
+
+
+    bool RealSenseBackgroundSubtractFilter::onConfigure(const RealSenseFrameView& input, RealSenseFrameView& output)
+    {
+        return input.mFormat == ERealSenseStreamFormat::REALSENSE_FORMAT_Z16 && input.mDepthUnits > 0.0f;
+    }
+
+
+    void RealSenseBackgroundSubtractFilter::onFilter(const RealSenseFrameView& input, RealSenseFrameView& output)
+    {
+        auto& model = mImpl->mModel;
+        model.resize(input.mWidth, input.mHeight);
+        if(mReset.exchange(false))
+            model.reset(mLearnFrames);
+
+        // thresholds in depth units of the frame, a positive learning rate always moves the model
+        RealSenseBackgroundModel::Parameters parameters;
+        parameters.mThreshold = static_cast<uint16>(std::min(65535.0f, mThreshold / input.mDepthUnits + 0.5f));
+        parameters.mStep = mLearningRate > 0.0f ?
+                           static_cast<uint16>(std::max(1.0f, std::min(65535.0f, mLearningRate / input.mDepthUnits + 0.5f))) : 0;
+
+        auto& back_mask = mImpl->mBackMask;
+        back_mask.resize(static_cast<size_t>(input.mWidth) * static_cast<size_t>(input.mHeight));
+        int count = model.process(input.getRow<const uint16>(0), input.mStride, output.getRow<uint16>(0), back_mask.data(), parameters, &mImpl->mPool);
+
+        // publish the mask, swapping buffers of equal size does not allocate
+        {
+            std::lock_guard<std::mutex> lock(mMaskMutex);
+            mMask.swap(back_mask);
+            mMaskWidth = input.mWidth;
+            mMaskHeight = input.mHeight;
+        }
+        mForegroundCount.store(count);
+        mLearning.store(model.isLearning());
     }
 }
@@ -6,11 +6,15 @@
 
 // External Includes
 #include <rtti/rtti.h>
+#include <rtti/factory.h>
 #include <nap/resourceptr.h>
+#include <atomic>
+#include <mutex>
 
 // Local includes
 #include "realsensetypes.h"
 #include "realsenseframesetlistenercomponent.h"
+#include "realsensefilterstatistics.h"
 
 // rs2 forward declares
 namespace rs2
@@ -22,9 +26,16 @@ namespace nap
 {
     //////////////////////////////////////////////////////////////////////////
 
+    // forward declares
+    class RealSenseService;
+    class RealSenseFrameContext;
+
     /**
      * RealSenseFrameFilter
      * Base class of a frame filter that can be applied to a frame out of a rs2::frameset
+     * Override onProcess to implement the filter. Every call to process is timed and recorded in the filter statistics.
+     * When the owning filter chain exceeds its frame budget the filter is put in degraded mode,
+     * optional filters are skipped and other filters can lower their quality by overriding onDegrade.
      */
     class NAPAPI RealSenseFrameFilter : public Resource
     {
@@ -42,11 +53,148 @@ namespace nap
 
         /**
          * Process function, returns processed frame and takes a rs2::frame as input
+         * Calls onProcess and records execution time, input and output resolution in the filter statistics
          * @param frame frame to process
+         * @param context context of the frameset the frame belongs to, nullptr when the filter runs outside of a device
          * @return processed frame
          */
-        virtual rs2::frame process(const rs2::frame& frame) = 0;
+        rs2::frame process(const rs2::frame& frame, RealSenseFrameContext* context = nullptr);
+
+        /**
+         * Returns the execution statistics of this filter, snapshots can be taken from any thread
+         * @return the execution statistics of this filter
+         */
+        const RealSenseFilterStatistics& getStatistics() const { return mStatistics; }
+
+        /**
+         * Returns the execution statistics of this filter, snapshots can be taken from any thread
+         * @return the execution statistics of this filter
+         */
+        RealSenseFilterStatistics& getStatistics() { return mStatistics; }
+
+        /**
+         * Enables or disables degraded mode, called by the owning filter chain from the thread that runs the chain.
+         * Calls onDegrade when the mode changes.
+         * @param degraded true to enter degraded mode
+         */
+        void setDegraded(bool degraded);
+
+        /**
+         * @return if the filter is in degraded mode
+         */
+        bool isDegraded() const { return mDegraded; }
+
+        // Properties
+        bool mOptional = false; ///< Property: 'Optional' skip this filter while the owning filter chain is over its frame budget
+    protected:
+        /**
+         * Override to implement the filter, returns processed frame and takes a rs2::frame as input
+         * @param frame frame to process
+         * @return processed frame
+         */
+        virtual rs2::frame onProcess(const rs2::frame& frame) = 0;
+
+        /**
+         * Override to lower or restore the quality of the filter when the owning filter chain enters or leaves degraded mode
+         * @param degraded true when entering degraded mode
+         */
+        virtual void onDegrade(bool /*degraded*/) { }
+
+        /**
+         * Returns the context of the frameset that is processed, only valid from within onProcess.
+         * Derived data can be allocated from the frame arena of the context.
+         * @return the frame context, nullptr when the filter runs outside of a device
+         */
+        RealSenseFrameContext* getFrameContext() const { return mFrameContext; }
     private:
+        RealSenseFilterStatistics mStatistics;
+        bool mDegraded = false;
+        RealSenseFrameContext* mFrameContext = nullptr;
+    };
+
+    /**
+     * RealSenseFrameView
+     * Pixels and layout of a video frame handed to the kernel of a RealSenseFrameKernelFilter
+     */
+    struct NAPAPI RealSenseFrameView
+    {
+        uint8* mData = nullptr;     ///< First pixel of the frame, read only for input views
+        int mWidth = 0;             ///< Width in pixels
+        int mHeight = 0;            ///< Height in pixels
+        int mStride = 0;            ///< Size of a row in bytes
+        int mBytesPerPixel = 0;     ///< Size of a pixel in bytes
+        ERealSenseStreamFormat mFormat = ERealSenseStreamFormat::REALSENSE_FORMAT_ANY; ///< Pixel format
+        float mDepthUnits = 0.0f;   ///< Meters per depth unit of depth frames, 0 otherwise
+        int mOffsetX = 0;           ///< Horizontal offset of the output in the input frame in pixels, shifts the principal point of the output
+        int mOffsetY = 0;           ///< Vertical offset of the output in the input frame in pixels, shifts the principal point of the output
+        const RealSenseFrameInfo* mInfo = nullptr; ///< Metadata of the camera frame, nullptr when the filter runs outside of a device
+
+        /**
+         * @return pointer to the first pixel of a row
+         */
+        template<typename T>
+        T* getRow(int row) const    { return reinterpret_cast<T*>(mData + static_cast<size_t>(row) * static_cast<size_t>(mStride)); }
+    };
+
+    /**
+     * RealSenseFrameKernelFilter
+     * Base class of a frame filter that implements its processing as a kernel on plain pixel buffers.
+     * Override onConfigure to describe the output frame and onFilter to fill it, the base class wraps the rs2::processing_block,
+     * creates the output stream profile and allocates the output frame.
+     * Output frames are allocated from the frame source of the processing block, which recycles the buffers of released frames
+     * of the same size. The output profile is only recreated when the output layout changes, in steady state a filter does not allocate.
+     * At most 'PoolSize' output frames can be in flight, frames are dropped when consumers hold on to more frames.
+     * Subclasses that override init must call RealSenseFrameKernelFilter::init.
+     */
+    class NAPAPI RealSenseFrameKernelFilter : public RealSenseFrameFilter
+    {
+    RTTI_ENABLE(RealSenseFrameFilter)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseFrameKernelFilter();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseFrameKernelFilter();
+
+        /**
+         * Initialization method, creates the processing block
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool init(utility::ErrorState& errorState) override;
+
+        // Properties
+        int mPoolSize = 16;     ///< Property: 'PoolSize' maximum amount of output frames in flight, buffers of released frames are reused
+    protected:
+        /**
+         * Called for every video frame, describes the output frame. The output is initialized with the layout of the input,
+         * change width, height, format, bytes per pixel or offset to produce a different frame. Data and stride are set by the base class.
+         * @param input the input frame
+         * @param output the output frame layout
+         * @return false to pass the input frame through untouched
+         */
+        virtual bool onConfigure(const RealSenseFrameView& /*input*/, RealSenseFrameView& /*output*/) { return true; }
+
+        /**
+         * Implements the filter, reads the input frame and writes every pixel of the output frame
+         * @param input the input frame
+         * @param output the output frame
+         */
+        virtual void onFilter(const RealSenseFrameView& input, RealSenseFrameView& output) = 0;
+
+        /**
+         * Runs the processing block
+         * @param frame frame to process
+         * @return processed frame
+         */
+        rs2::frame onProcess(const rs2::frame& frame) override final;
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> mKernel;
     };
 
     /**
@@ -75,17 +223,17 @@ namespace nap
          */
         bool init(utility::ErrorState& errorState) override;
 
+        // Properties
+        float mMagnitude = 2.0f; ///< Property: 'Magnitude' Magnitude value
+        float mSmoothAlpha = 0.5f; ///< Property: 'SmoothAlpha' SmoothAlpha value
+        float mSmoothDelta = 20.0f; ///< Property: 'SmoothDelta' SmoothDelta value
+    protected:
         /**
          * Process function, returns processed frame and takes a rs2::frame as input
          * @param frame frame to process
          * @return processed frame
          */
-        rs2::frame process(const rs2::frame& frame) override;
-
-        // Properties
-        float mMagnitude = 2.0f; ///< Property: 'Magnitude' Magnitude value
-        float mSmoothAlpha = 0.5f; ///< Property: 'SmoothAlpha' SmoothAlpha value
-        float mSmoothDelta = 20.0f; ///< Property: 'SmoothDelta' SmoothDelta value
+        rs2::frame onProcess(const rs2::frame& frame) override;
     private:
         struct Impl;
         std::unique_ptr<Impl> mImpl;
@@ -117,15 +265,22 @@ namespace nap
          */
         bool init(utility::ErrorState& errorState) override;
 
+        // Properties
+        float mMagnitude = 3.0f; ///< Property: 'Magnitude' Magnitude value
+        float mDegradedMagnitude = 0.0f; ///< Property: 'DegradedMagnitude' Magnitude value while the filter chain is over budget, 0 keeps 'Magnitude'
+    protected:
         /**
          * Process function, returns processed frame and takes a rs2::frame as input
          * @param frame frame to process
          * @return processed frame
          */
-        rs2::frame process(const rs2::frame& frame) override;
+        rs2::frame onProcess(const rs2::frame& frame) override;
 
-        // Properties
-        float mMagnitude = 3.0f; ///< Property: 'Magnitude' Magnitude value
+        /**
+         * Switches to 'DegradedMagnitude' in degraded mode and back to 'Magnitude' when restored
+         * @param degraded true when entering degraded mode
+         */
+        void onDegrade(bool degraded) override;
     private:
         struct Impl;
         std::unique_ptr<Impl> mImpl;
@@ -133,12 +288,14 @@ namespace nap
 
     /**
      * RealSenseColorizeFilter
-     * Process a depth frame and returns a colored depth frame using a rs2::colorizer
-     * Also see : https://intelrealsense.github.io/librealsense/doxygen/classrs2_1_1colorizer.html
+     * Process a Z16 depth frame and returns a RGBA8 colored depth frame.
+     * Depth is mapped onto a jet color map through a precomputed 64K entry lookup table, see RealSenseDepthColorizer.
+     * When histogram equalization is enabled the lookup table is rebuilt from a sampled depth histogram every 'HistogramInterval' frames.
+     * The output frame can be uploaded directly into a RGBA8 render texture.
      */
-    class NAPAPI RealSenseColorizeFilter : public RealSenseFrameFilter
+    class NAPAPI RealSenseColorizeFilter : public RealSenseFrameKernelFilter
     {
-    RTTI_ENABLE(RealSenseFrameFilter)
+    RTTI_ENABLE(RealSenseFrameKernelFilter)
     public:
         /**
          * Constructor
@@ -157,14 +314,155 @@ namespace nap
          */
         bool init(utility::ErrorState& errorState) override;
 
+        // Properties
+        bool mHistogramEqualization = true; ///< Property: 'HistogramEqualization' map depth histogram equalized instead of linear
+        int mHistogramInterval = 15;        ///< Property: 'HistogramInterval' amount of frames in between lookup table updates when equalizing
+        float mMinDistance = 0.3f;          ///< Property: 'MinDistance' minimum distance in meters mapped onto the color map
+        float mMaxDistance = 4.0f;          ///< Property: 'MaxDistance' maximum distance in meters mapped onto the color map
+    protected:
         /**
-         * Process function, returns processed frame and takes a rs2::frame as input
-         * @param frame frame to process
-         * @return processed frame
+         * Colorizes Z16 depth frames into RGBA8 frames of the same size, other frames are passed through
          */
-        rs2::frame process(const rs2::frame& frame) override;
+        bool onConfigure(const RealSenseFrameView& input, RealSenseFrameView& output) override;
+
+        /**
+         * Colorizes the depth frame
+         */
+        void onFilter(const RealSenseFrameView& input, RealSenseFrameView& output) override;
     private:
         struct Impl;
         std::unique_ptr<Impl> mImpl;
     };
+
+    /**
+     * RealSenseCropFilter
+     * Crops a video frame to a pixel region of interest, the output frame only contains the region of interest.
+     * The intrinsics of the output stream profile are adjusted to the region of interest (the principal point shifts),
+     * place this filter in a RealSenseFrameSetStreamFilter of the RealSenseDevice to make the adjusted intrinsics
+     * available through RealSenseDevice::getIntrincicsMap.
+     * The region of interest is clamped to the frame.
+     */
+    class NAPAPI RealSenseCropFilter : public RealSenseFrameKernelFilter
+    {
+    RTTI_ENABLE(RealSenseFrameKernelFilter)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseCropFilter();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseCropFilter();
+
+        /**
+         * Initialization method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool init(utility::ErrorState& errorState) override;
+
+        // Properties
+        int mX = 0;             ///< Property: 'X' horizontal offset of the region of interest in pixels
+        int mY = 0;             ///< Property: 'Y' vertical offset of the region of interest in pixels
+        int mWidth = 640;       ///< Property: 'Width' width of the region of interest in pixels
+        int mHeight = 480;      ///< Property: 'Height' height of the region of interest in pixels
+    protected:
+        /**
+         * Clamps the region of interest to the frame, frames that fit the region are passed through
+         */
+        bool onConfigure(const RealSenseFrameView& input, RealSenseFrameView& output) override;
+
+        /**
+         * Copies the region of interest
+         */
+        void onFilter(const RealSenseFrameView& input, RealSenseFrameView& output) override;
+    };
+
+    /**
+     * RealSenseBackgroundSubtractFilter
+     * Separates people and objects from a static background in Z16 depth frames, see RealSenseBackgroundModel.
+     * The model learns the background during the first 'LearnFrames' frames, afterwards the output depth frame only contains
+     * foreground pixels and all background pixels are 0, so point clouds and blob detection downstream only process the foreground.
+     * The foreground mask of the last frame can be fetched from any thread with getMask.
+     * Rows are split into tiles over the worker pool of the RealSenseService, buffers are only allocated when the resolution changes.
+     * Place this filter after decimation or crop filters, the model is relearned when the resolution changes.
+     */
+    class NAPAPI RealSenseBackgroundSubtractFilter : public RealSenseFrameKernelFilter
+    {
+    RTTI_ENABLE(RealSenseFrameKernelFilter)
+    public:
+        /**
+         * Constructor
+         * @param service reference to the RealSenseService
+         */
+        RealSenseBackgroundSubtractFilter(RealSenseService& service);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseBackgroundSubtractFilter();
+
+        /**
+         * Initialization method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool init(utility::ErrorState& errorState) override;
+
+        /**
+         * Clears the background model, the model is learned again from the next 'LearnFrames' frames. Can be called from any thread.
+         */
+        void resetBackground()                      { mReset.store(true); }
+
+        /**
+         * @return if the background model is still learning, can be called from any thread
+         */
+        bool isLearning() const                     { return mLearning.load(); }
+
+        /**
+         * @return amount of foreground pixels of the last frame, can be called from any thread
+         */
+        int getForegroundCount() const              { return mForegroundCount.load(); }
+
+        /**
+         * Copies the foreground mask of the last frame, 255 for foreground and 0 for background pixels. Can be called from any thread.
+         * @param mask receives the mask, tightly packed
+         * @param width receives the width of the mask
+         * @param height receives the height of the mask
+         * @return false when no frame was processed yet
+         */
+        bool getMask(std::vector<uint8>& mask, int& width, int& height) const;
+
+        // Properties
+        float mThreshold = 0.05f;       ///< Property: 'Threshold' minimum distance in meters in front of the background of a foreground pixel
+        float mLearningRate = 0.002f;   ///< Property: 'LearningRate' maximum change of the background in meters per frame, absorbs slow changes of the scene
+        int mLearnFrames = 30;          ///< Property: 'LearnFrames' amount of frames the background is learned from after start or reset
+    protected:
+        /**
+         * Only processes Z16 depth frames, other frames are passed through
+         */
+        bool onConfigure(const RealSenseFrameView& input, RealSenseFrameView& output) override;
+
+        /**
+         * Writes the foreground of the depth frame and publishes the mask
+         */
+        void onFilter(const RealSenseFrameView& input, RealSenseFrameView& output) override;
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseService& mService;
+        std::atomic<bool> mReset = { false };
+        std::atomic<bool> mLearning = { true };
+        std::atomic<int> mForegroundCount = { 0 };
+
+        mutable std::mutex mMaskMutex;
+        std::vector<uint8> mMask;       ///< Mask of the last frame, guarded by mMaskMutex
+        int mMaskWidth = 0;
+        int mMaskHeight = 0;
+    };
+
+    using RealSenseBackgroundSubtractFilterObjectCreator = rtti::ObjectCreator<RealSenseBackgroundSubtractFilter, RealSenseService>;
 }
@@ -1,15 +1,29 @@
 #include "realsenseframesetfilter.h"
 #include "realsensedevice.h"
+#include "realsenseframefilter.h"
+#include "realsenseservice.h"
+#include "realsensealignengine.h"
+#include "realsenseconversion.h"
+#include "realsenseworkerpool.h"
+#include "realsensetrace.h"
 
 #include <rs.hpp>
+#include <chrono>
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseFrameSetFilter)
+    RTTI_PROPERTY("Optional", &nap::RealSenseFrameSetFilter::mOptional, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
-RTTI_BEGIN_CLASS(nap::RealSenseFrameSetAlignFilter)
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseFrameSetAlignFilter)
+    RTTI_CONSTRUCTOR(nap::RealSenseService&)
     RTTI_PROPERTY("Align To", &nap::RealSenseFrameSetAlignFilter::mStreamType, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
+RTTI_BEGIN_CLASS(nap::RealSenseFrameSetStreamFilter)
+    RTTI_PROPERTY("StreamType", &nap::RealSenseFrameSetStreamFilter::mStreamType, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Filters", &nap::RealSenseFrameSetStreamFilter::mFilters, nap::rtti::EPropertyMetaData::Embedded)
+RTTI_END_CLASS
+
 namespace nap
 {
     //////////////////////////////////////////////////////////////////////////
@@ -21,6 +35,68 @@ namespace nap
 
     RealSenseFrameSetFilter::~RealSenseFrameSetFilter() = default;
 
+
+    /**
+     * Returns the resolution of the depth frame in the frameset, or of the first video frame when there is no depth frame
+     */
+    static void getFrameSetResolution(const rs2::frameset& frameset, int& width, int& height)
+    {
+        width = 0;
+        height = 0;
+        if(!frameset)
+            return;
+
+        rs2::video_frame video_frame = frameset.get_depth_frame();
+        if(!video_frame)
+        {
+            for(const auto& frame : frameset)
+            {
+                if(frame.is<rs2::video_frame>())
+                {
+                    video_frame = frame.as<rs2::video_frame>();
+                    break;
+                }
+            }
+        }
+
+        if(video_frame)
+        {
+            width = video_frame.get_width();
+            height = video_frame.get_height();
+        }
+    }
+
+
+    rs2::frameset RealSenseFrameSetFilter::process(const rs2::frameset& frameset, RealSenseFrameContext* context)
+    {
+        RealSenseTraceScope trace(mID.c_str(), "filter");
+        auto start = std::chrono::steady_clock::now();
+        mFrameContext = context;
+        rs2::frameset result = onProcess(frameset);
+        mFrameContext = nullptr;
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        int input_width, input_height;
+        getFrameSetResolution(frameset, input_width, input_height);
+
+        int output_width, output_height;
+        getFrameSetResolution(result, output_width, output_height);
+
+        mStatistics.record(static_cast<uint64>(duration.count()), input_width, input_height,
+                           output_width, output_height, result.get() != frameset.get());
+        return result;
+    }
+
+
+    void RealSenseFrameSetFilter::setDegraded(bool degraded)
+    {
+        if(degraded == mDegraded)
+            return;
+
+        mDegraded = degraded;
+        onDegrade(degraded);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     // RealSenseFrameSetAlignFilter::Impl
     //////////////////////////////////////////////////////////////////////////
@@ -28,17 +104,182 @@ namespace nap
     struct RealSenseFrameSetAlignFilter::Impl
     {
     public:
-        Impl(rs2_stream streamType) :
-                mAlign(streamType){}
+        /**
+         * Cached alignment of one depth stream profile to one other stream profile
+         */
+        struct Alignment
+        {
+            int mDepthID = -1;
+            int mOtherID = -1;
+            bool mDepthToOther = true;
+            RealSenseAlignEngine mEngine;
+            rs2::stream_profile mProfile;   ///< Profile of the aligned output frame
+        };
+
+        /**
+         * Maximum amount of cached alignments, the cache is cleared when stream profiles keep changing
+         */
+        static constexpr size_t sMaxAlignments = 8;
+
+        Impl(RealSenseFrameSetAlignFilter& filter, RealSenseWorkerPool& pool) :
+            mFilter([this](rs2::frame frame, rs2::frame_source& source){ alignFrameSet(frame, source); }),
+            mResource(filter), mPool(pool) { }
+
+        /**
+         * Returns the cached alignment for the given profiles, computes the alignment when the profiles are new
+         */
+        Alignment& getAlignment(const rs2::video_stream_profile& depthProfile, const rs2::video_stream_profile& otherProfile, bool depthToOther)
+        {
+            for(auto& alignment : mAlignments)
+            {
+                if(alignment->mDepthID == depthProfile.unique_id() && alignment->mOtherID == otherProfile.unique_id() &&
+                   alignment->mDepthToOther == depthToOther)
+                    return *alignment;
+            }
+
+            if(mAlignments.size() >= sMaxAlignments)
+                mAlignments.clear();
+
+            auto alignment = std::make_unique<Alignment>();
+            alignment->mDepthID = depthProfile.unique_id();
+            alignment->mOtherID = otherProfile.unique_id();
+            alignment->mDepthToOther = depthToOther;
+
+            rs2_intrinsics depth_intrinsics = depthProfile.get_intrinsics();
+            rs2_intrinsics other_intrinsics = otherProfile.get_intrinsics();
+            alignment->mEngine.configure(realsense::toIntrinsics(depth_intrinsics),
+                                         realsense::toIntrinsics(other_intrinsics),
+                                         realsense::toExtrinsics(depthProfile.get_extrinsics_to(otherProfile)));
+
+            // the aligned frame takes over the viewport of the stream it is aligned to
+            const rs2::video_stream_profile& source = depthToOther ? depthProfile : otherProfile;
+            const rs2::video_stream_profile& target = depthToOther ? otherProfile : depthProfile;
+            const rs2_intrinsics& target_intrinsics = depthToOther ? other_intrinsics : depth_intrinsics;
+            alignment->mProfile = source.clone(source.stream_type(), source.stream_index(), source.format(),
+                                               target_intrinsics.width, target_intrinsics.height, target_intrinsics);
+
+            rs2_extrinsics identity = { { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+            alignment->mProfile.register_extrinsics_to(target, identity);
+
+            mAlignments.emplace_back(std::move(alignment));
+            return *mAlignments.back();
+        }
+
+        /**
+         * Returns true when the rows of the frame are tightly packed
+         */
+        static bool isPacked(const rs2::video_frame& frame)
+        {
+            return frame.get_stride_in_bytes() == frame.get_width() * frame.get_bytes_per_pixel();
+        }
+
+        /**
+         * Called from the processing block, aligns the frames and composes a new frameset
+         */
+        void alignFrameSet(rs2::frame& frame, rs2::frame_source& source)
+        {
+            auto frameset = frame.as<rs2::frameset>();
+            if(!frameset)
+            {
+                source.frame_ready(frame);
+                return;
+            }
+
+            rs2::depth_frame depth = frameset.get_depth_frame();
+            if(!depth || !isPacked(depth))
+            {
+                source.frame_ready(frame);
+                return;
+            }
+
+            auto align_to = static_cast<rs2_stream>(mResource.mStreamType);
+            auto depth_profile = depth.get_profile().as<rs2::video_stream_profile>();
+            auto* depth_data = reinterpret_cast<const uint16*>(depth.get_data());
+            float depth_scale = depth.get_units();
+
+            mFrames.clear();
+            if(align_to == RS2_STREAM_DEPTH)
+            {
+                // resample all other video frames into the depth viewport
+                for(auto stream_frame : frameset)
+                {
+                    auto video_frame = stream_frame.as<rs2::video_frame>();
+                    if(!video_frame || stream_frame.get_profile().stream_type() == RS2_STREAM_DEPTH || !isPacked(video_frame))
+                    {
+                        mFrames.emplace_back(stream_frame);
+                        continue;
+                    }
+
+                    auto other_profile = video_frame.get_profile().as<rs2::video_stream_profile>();
+                    Alignment& alignment = getAlignment(depth_profile, other_profile, false);
+                    int bpp = video_frame.get_bytes_per_pixel();
+                    auto aligned = source.allocate_video_frame(alignment.mProfile, video_frame, bpp * 8,
+                                                               depth.get_width(), depth.get_height(), depth.get_width() * bpp);
+                    if(!aligned)
+                    {
+                        mFrames.emplace_back(stream_frame);
+                        continue;
+                    }
 
-        rs2::align mAlign;
+                    mResource.getStatistics().recordOutput(aligned.get_data());
+                    alignment.mEngine.alignOtherToDepth(depth_data, depth_scale,
+                                                        reinterpret_cast<const uint8*>(video_frame.get_data()), bpp,
+                                                        reinterpret_cast<uint8*>(const_cast<void*>(aligned.get_data())), &mPool);
+                    mFrames.emplace_back(aligned);
+                }
+            }
+            else
+            {
+                // reproject the depth frame into the viewport of the first frame of the requested stream
+                rs2::video_frame target = rs2::frame();
+                for(auto stream_frame : frameset)
+                {
+                    if(stream_frame.get_profile().stream_type() == align_to && stream_frame.is<rs2::video_frame>())
+                    {
+                        target = stream_frame.as<rs2::video_frame>();
+                        break;
+                    }
+                }
+
+                if(!target)
+                {
+                    source.frame_ready(frame);
+                    return;
+                }
+
+                auto target_profile = target.get_profile().as<rs2::video_stream_profile>();
+                Alignment& alignment = getAlignment(depth_profile, target_profile, true);
+                auto aligned = source.allocate_video_frame(alignment.mProfile, depth, 16,
+                                                           target.get_width(), target.get_height(), target.get_width() * 2,
+                                                           RS2_EXTENSION_DEPTH_FRAME);
+                if(!aligned)
+                {
+                    source.frame_ready(frame);
+                    return;
+                }
+
+                mResource.getStatistics().recordOutput(aligned.get_data());
+                alignment.mEngine.alignDepthToOther(depth_data, depth_scale,
+                                                    reinterpret_cast<uint16*>(const_cast<void*>(aligned.get_data())), &mPool);
+                for(auto stream_frame : frameset)
+                    mFrames.emplace_back(stream_frame.get_profile().stream_type() == RS2_STREAM_DEPTH ? aligned : stream_frame);
+            }
+            source.frame_ready(source.allocate_composite_frame(mFrames));
+        }
+
+        rs2::filter mFilter;
+        RealSenseFrameSetAlignFilter& mResource;
+        RealSenseWorkerPool& mPool;
+        std::vector<std::unique_ptr<Alignment>> mAlignments;
+        std::vector<rs2::frame> mFrames;
     };
 
     //////////////////////////////////////////////////////////////////////////
     // RealSenseFrameSetAlignFilter
     //////////////////////////////////////////////////////////////////////////
 
-    RealSenseFrameSetAlignFilter::RealSenseFrameSetAlignFilter() = default;
+    RealSenseFrameSetAlignFilter::RealSenseFrameSetAlignFilter(RealSenseService& service) : mService(service)
+    { }
 
 
     RealSenseFrameSetAlignFilter::~RealSenseFrameSetAlignFilter() = default;
@@ -48,7 +289,82 @@ namespace nap
     {
         try
         {
-            mImpl = std::make_unique<Impl>(static_cast<rs2_stream>(mStreamType));
+            mImpl = std::make_unique<Impl>(*this, mService.getWorkerPool());
+        }catch(std::exception& e)
+        {
+            errorState.fail(e.what());
+            return false;
+        }
+
+        return true;
+    }
+
+
+    rs2::frameset RealSenseFrameSetAlignFilter::onProcess(const rs2::frameset& frameset)
+    {
+        return mImpl->mFilter.process(frameset);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameSetStreamFilter::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseFrameSetStreamFilter::Impl
+    {
+    public:
+        Impl(RealSenseFrameSetStreamFilter& filter) :
+            mFilter([this](rs2::frame frame, rs2::frame_source& source){ filterFrameSet(frame, source); }),
+            mResource(filter) { }
+
+        /**
+         * Called from the processing block, filters the frame of the configured stream type and composes a new frameset
+         */
+        void filterFrameSet(rs2::frame& frame, rs2::frame_source& source)
+        {
+            auto frameset = frame.as<rs2::frameset>();
+            if(!frameset)
+            {
+                source.frame_ready(frame);
+                return;
+            }
+
+            mFrames.clear();
+            for(auto stream_frame : frameset)
+            {
+                if(stream_frame.get_profile().stream_type() == static_cast<rs2_stream>(mResource.mStreamType))
+                {
+                    for(auto& filter : mResource.mFilters)
+                    {
+                        if(mResource.isDegraded() && filter->mOptional)
+                            continue;
+                        stream_frame = filter->process(stream_frame, mResource.getFrameContext());
+                    }
+                }
+                mFrames.emplace_back(stream_frame);
+            }
+            source.frame_ready(source.allocate_composite_frame(mFrames));
+        }
+
+        rs2::filter mFilter;
+        RealSenseFrameSetStreamFilter& mResource;
+        std::vector<rs2::frame> mFrames;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameSetStreamFilter
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseFrameSetStreamFilter::RealSenseFrameSetStreamFilter() = default;
+
+
+    RealSenseFrameSetStreamFilter::~RealSenseFrameSetStreamFilter() = default;
+
+
+    bool RealSenseFrameSetStreamFilter::init(utility::ErrorState& errorState)
+    {
+        try
+        {
+            mImpl = std::make_unique<Impl>(*this);
         }catch(std::exception& e)
         {
             errorState.fail(e.what());
@@ -59,8 +375,15 @@ namespace nap
     }
 
 
-    rs2::frameset RealSenseFrameSetAlignFilter::process(const rs2::frameset& frameset)
+    rs2::frameset RealSenseFrameSetStreamFilter::onProcess(const rs2::frameset& frameset)
+    {
+        return mImpl->mFilter.process(frameset);
+    }
+
+
+    void RealSenseFrameSetStreamFilter::onDegrade(bool degraded)
     {
-        return mImpl->mAlign.filter::process(frameset);
+        for(auto& filter : mFilters)
+            filter->setDegraded(degraded);
     }
 }
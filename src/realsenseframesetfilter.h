@@ -6,11 +6,13 @@
 
 // External Includes
 #include <rtti/rtti.h>
+#include <rtti/factory.h>
 #include <nap/resourceptr.h>
 
 // Local includes
 #include "realsensetypes.h"
 #include "realsenseframesetlistenercomponent.h"
+#include "realsensefilterstatistics.h"
 
 namespace rs2
 {
@@ -21,9 +23,17 @@ namespace nap
 {
     //////////////////////////////////////////////////////////////////////////
 
+    // forward declares
+    class RealSenseFrameFilter;
+    class RealSenseService;
+    class RealSenseFrameContext;
+
     /**
      * RealSenseFrameSetFilter
-     * RealSenseFrameSetFilter base class, overidde process to apply filtering on rs2::framesets
+     * RealSenseFrameSetFilter base class, override onProcess to apply filtering on rs2::framesets
+     * Every call to process is timed and recorded in the filter statistics.
+     * When the owning filter chain exceeds its frame budget the filter is put in degraded mode,
+     * optional filters are skipped and other filters can lower their quality by overriding onDegrade.
      */
     class NAPAPI RealSenseFrameSetFilter : public Resource
     {
@@ -41,16 +51,72 @@ namespace nap
 
         /**
          * Process function, returns processed rs2::frameset
+         * Calls onProcess and records execution time, input and output resolution in the filter statistics
          * @param frameset frameset to filter
+         * @param context context of the frameset, nullptr when the filter runs outside of a device
          * @return processed frameset
          */
-        virtual rs2::frameset process(const rs2::frameset& frameset) = 0;
+        rs2::frameset process(const rs2::frameset& frameset, RealSenseFrameContext* context = nullptr);
+
+        /**
+         * Returns the execution statistics of this filter, snapshots can be taken from any thread
+         * @return the execution statistics of this filter
+         */
+        const RealSenseFilterStatistics& getStatistics() const { return mStatistics; }
+
+        /**
+         * Returns the execution statistics of this filter, snapshots can be taken from any thread
+         * @return the execution statistics of this filter
+         */
+        RealSenseFilterStatistics& getStatistics() { return mStatistics; }
+
+        /**
+         * Enables or disables degraded mode, called by the owning filter chain from the thread that runs the chain.
+         * Calls onDegrade when the mode changes.
+         * @param degraded true to enter degraded mode
+         */
+        void setDegraded(bool degraded);
+
+        /**
+         * @return if the filter is in degraded mode
+         */
+        bool isDegraded() const { return mDegraded; }
+
+        // Properties
+        bool mOptional = false; ///< Property: 'Optional' skip this filter while the owning filter chain is over its frame budget
+    protected:
+        /**
+         * Override to implement the filter, returns processed rs2::frameset
+         * @param frameset frameset to filter
+         * @return processed frameset
+         */
+        virtual rs2::frameset onProcess(const rs2::frameset& frameset) = 0;
+
+        /**
+         * Override to lower or restore the quality of the filter when the owning filter chain enters or leaves degraded mode
+         * @param degraded true when entering degraded mode
+         */
+        virtual void onDegrade(bool /*degraded*/) { }
+
+        /**
+         * Returns the context of the frameset that is processed, only valid from within onProcess.
+         * Derived data can be allocated from the frame arena of the context.
+         * @return the frame context, nullptr when the filter runs outside of a device
+         */
+        RealSenseFrameContext* getFrameContext() const { return mFrameContext; }
     private:
+        RealSenseFilterStatistics mStatistics;
+        bool mDegraded = false;
+        RealSenseFrameContext* mFrameContext = nullptr;
     };
 
     /**
      * RealSenseFrameSetAlignFilter
-     * RealSenseFrameSetAlignFilter aligns one frame to another frame within the frameset according to given streamtype
+     * RealSenseFrameSetAlignFilter aligns one frame to another frame within the frameset according to given streamtype.
+     * When aligning to depth, all other video frames are resampled into the depth viewport.
+     * When aligning to another stream, the depth frame is reprojected into the viewport of that stream.
+     * The per-pixel rays and camera transform are computed once per stream configuration,
+     * per frame only the projection is evaluated, split into rows over the worker pool of the RealSenseService.
      */
     class NAPAPI RealSenseFrameSetAlignFilter : public RealSenseFrameSetFilter
     {
@@ -58,20 +124,60 @@ namespace nap
     public:
         /**
          * Constructor
+         * @param service reference to the RealSenseService
          */
-        RealSenseFrameSetAlignFilter();
+        RealSenseFrameSetAlignFilter(RealSenseService& service);
 
         /**
          * Destructor
          */
         virtual ~RealSenseFrameSetAlignFilter();
 
+        /**
+         * Initialization method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool init(utility::ErrorState& errorState) override;
+
+        // Properties
+        ERealSenseStreamType mStreamType = ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH; ///< Property: 'Align To' StreamType to align frames to
+    protected:
         /**
          * Process function, returns processed rs2::frameset
          * @param frameset frameset to filter
          * @return processed frameset
          */
-        rs2::frameset process(const rs2::frameset& frameset) override;
+        rs2::frameset onProcess(const rs2::frameset& frameset) override;
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseService& mService;
+    };
+
+    using RealSenseFrameSetAlignFilterObjectCreator = rtti::ObjectCreator<RealSenseFrameSetAlignFilter, RealSenseService>;
+
+    /**
+     * RealSenseFrameSetStreamFilter
+     * Applies a chain of frame filters to the frame of one stream type within the frameset.
+     * All other frames are passed through untouched. Use this filter on a RealSenseDevice to filter, decimate or crop
+     * a stream before it reaches other frameset filters (such as alignment) and all frameset listeners.
+     * In degraded mode optional frame filters are skipped and all other frame filters are put in degraded mode.
+     */
+    class NAPAPI RealSenseFrameSetStreamFilter : public RealSenseFrameSetFilter
+    {
+    RTTI_ENABLE(RealSenseFrameSetFilter)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseFrameSetStreamFilter();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseFrameSetStreamFilter();
 
         /**
          * Initialization method
@@ -81,7 +187,21 @@ namespace nap
         bool init(utility::ErrorState& errorState) override;
 
         // Properties
-        ERealSenseStreamType mStreamType = ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH; ///< Property: 'Align To' StreamType to align frames to
+        ERealSenseStreamType mStreamType = ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH; ///< Property: 'StreamType' StreamType of the frame to filter
+        std::vector<ResourcePtr<RealSenseFrameFilter>> mFilters; ///< Property: 'Filters' the filters to apply to the frame
+    protected:
+        /**
+         * Process function, returns processed rs2::frameset
+         * @param frameset frameset to filter
+         * @return processed frameset
+         */
+        rs2::frameset onProcess(const rs2::frameset& frameset) override;
+
+        /**
+         * Forwards degraded mode to the frame filters
+         * @param degraded true when entering degraded mode
+         */
+        void onDegrade(bool degraded) override;
     private:
         struct Impl;
         std::unique_ptr<Impl> mImpl;
@@ -1,5 +1,6 @@
 #include "realsenseframesetlistenercomponent.h"
 #include "realsensedevice.h"
+#include "realsensetrace.h"
 
 #include <rs.hpp>
 
@@ -58,8 +59,17 @@ namespace nap
     }
 
 
-    void RealSenseFrameSetListenerComponentInstance::trigger(const rs2::frameset &frameset)
+    bool RealSenseFrameSetListenerComponentInstance::isDeviceStreaming() const
     {
+        return mDevice->getState() == ERealSenseDeviceState::Streaming;
+    }
+
+
+    void RealSenseFrameSetListenerComponentInstance::trigger(const rs2::frameset &frameset, RealSenseFrameContext& context)
+    {
+        RealSenseTraceScope trace(getComponent<RealSenseFrameSetListenerComponent>()->mID.c_str(), "listener");
+        mFrameContext = &context;
         frameSetReceived.trigger(frameset);
+        mFrameContext = nullptr;
     }
 }
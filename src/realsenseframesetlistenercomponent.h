@@ -28,6 +28,7 @@ namespace nap
     class RealSenseDevice;
     class RealSenseStreamDescription;
     class RealSenseFrameSetListenerComponentInstance;
+    class RealSenseFrameContext;
 
     /**
      * RealSenseFrameSetListenerComponent is the resource of RealSenseFrameSetListenerComponentInstance
@@ -85,6 +86,19 @@ namespace nap
          */
         virtual void onDestroy() override final;
 
+        /**
+         * Returns true if the device is streaming, false while the device is still starting or disconnected
+         * @return if the device is streaming
+         */
+        bool isDeviceStreaming() const;
+
+        /**
+         * Returns the context of the received frameset, only valid from within a frameSetReceived callback.
+         * Derived data can be allocated from the frame arena of the context, retain the arena to use the data after the callback returns.
+         * @return the frame context, nullptr outside of a frameSetReceived callback
+         */
+        RealSenseFrameContext* getFrameContext() const { return mFrameContext; }
+
         // Signal triggered on new frame from process thread of RealSenseDevice
         Signal<const rs2::frameset&> frameSetReceived;
     protected:
@@ -103,10 +117,14 @@ namespace nap
         /**
          * Called from RealSenseDevice, triggers frameSetReceived signal
          * @param frameset the frameset
+         * @param context context of the frameset
          */
-        void trigger(const rs2::frameset& frameset);
+        void trigger(const rs2::frameset& frameset, RealSenseFrameContext& context);
 
         // pointer to RealSenseDevice
         RealSenseDevice* mDevice;
+
+        // context of the frameset while frameSetReceived is triggered
+        RealSenseFrameContext* mFrameContext = nullptr;
     };
 }
@@ -0,0 +1,151 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsenseheightmap.h"
+#include "realsensedeprojection.h"
+#include "realsenseworkerpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    static bool isEqual(const RealSenseCameraIntrincics& a, const RealSenseCameraIntrincics& b)
+    {
+        return a.mWidth == b.mWidth && a.mHeight == b.mHeight && a.mPPX == b.mPPX && a.mPPY == b.mPPY &&
+               a.mFX == b.mFX && a.mFY == b.mFY && a.mModel == b.mModel && std::memcmp(a.mCoeffs, b.mCoeffs, sizeof(a.mCoeffs)) == 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseHeightMapBuilder
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseHeightMapBuilder::setCameraTransform(const glm::mat4& cameraToFloor)
+    {
+        for(int column = 0; column < 3; column++)
+        {
+            for(int row = 0; row < 3; row++)
+                mRotation[column * 3 + row] = cameraToFloor[column][row];
+            mTranslation[column] = cameraToFloor[3][column];
+        }
+        mRaysDirty = true;
+    }
+
+
+    void RealSenseHeightMapBuilder::updateRays(const RealSenseDeprojectionMap& rays)
+    {
+        mIntrinsics = rays.getIntrinsics();
+        size_t count = static_cast<size_t>(rays.getWidth()) * static_cast<size_t>(rays.getHeight());
+        mRayX.resize(count);
+        mRayY.resize(count);
+        mRayZ.resize(count);
+
+        // rotate the camera space ray (x, y, 1) into floor space
+        const float* r = mRotation;
+        const float* x = rays.getX();
+        const float* y = rays.getY();
+        for(size_t i = 0; i < count; i++)
+        {
+            mRayX[i] = r[0] * x[i] + r[3] * y[i] + r[6];
+            mRayY[i] = r[1] * x[i] + r[4] * y[i] + r[7];
+            mRayZ[i] = r[2] * x[i] + r[5] * y[i] + r[8];
+        }
+        mRaysDirty = false;
+    }
+
+
+    void RealSenseHeightMapBuilder::build(const uint16* depth, int depthStride, float depthScale, const RealSenseDeprojectionMap& rays,
+                                          const Parameters& parameters, RealSenseWorkerPool* pool, RealSenseHeightMap& heightMap)
+    {
+        if(mRaysDirty || !isEqual(mIntrinsics, rays.getIntrinsics()))
+            updateRays(rays);
+
+        // configure the grid
+        int columns = std::max(1, static_cast<int>(std::ceil(parameters.mSize.x / parameters.mCellSize)));
+        int rows = std::max(1, static_cast<int>(std::ceil(parameters.mSize.y / parameters.mCellSize)));
+        size_t cells = static_cast<size_t>(columns) * static_cast<size_t>(rows);
+        heightMap.mColumns = columns;
+        heightMap.mRows = rows;
+        heightMap.mCellSize = parameters.mCellSize;
+        heightMap.mOrigin = parameters.mOrigin;
+        heightMap.mHeights.resize(cells);
+        heightMap.mOccupancy.resize(cells);
+        heightMap.mCounts.resize(cells);
+
+        int width = rays.getWidth();
+        int height = rays.getHeight();
+        int threads = pool != nullptr ? pool->getThreadCount() + 1 : 1;
+        int tasks = std::max(1, std::min(height, threads));
+        if(static_cast<int>(mPartials.size()) != tasks)
+            mPartials.resize(tasks);
+
+        // project the rows of every task into its own grid
+        float inverse_cell = 1.0f / parameters.mCellSize;
+        RealSenseWorkerPool::parallelFor(pool, tasks, [&](int task)
+        {
+            auto& partial = mPartials[task];
+            partial.mHeights.assign(cells, -std::numeric_limits<float>::max());
+            partial.mCounts.assign(cells, 0);
+            float* heights = partial.mHeights.data();
+            uint32* counts = partial.mCounts.data();
+
+            int begin = static_cast<int>(static_cast<int64>(height) * task / tasks);
+            int end = static_cast<int>(static_cast<int64>(height) * (task + 1) / tasks);
+            for(int row = begin; row < end; row++)
+            {
+                const auto* values = reinterpret_cast<const uint16*>(reinterpret_cast<const uint8*>(depth) + static_cast<size_t>(row) * static_cast<size_t>(depthStride));
+                size_t offset = static_cast<size_t>(row) * static_cast<size_t>(width);
+                const float* ray_x = mRayX.data() + offset;
+                const float* ray_y = mRayY.data() + offset;
+                const float* ray_z = mRayZ.data() + offset;
+                for(int x = 0; x < width; x++)
+                {
+                    if(values[x] == 0)
+                        continue;
+
+                    float z = values[x] * depthScale;
+                    float point_y = ray_y[x] * z + mTranslation[1];
+                    if(point_y < parameters.mMinHeight || point_y > parameters.mMaxHeight)
+                        continue;
+
+                    float column = (ray_x[x] * z + mTranslation[0] - parameters.mOrigin.x) * inverse_cell;
+                    float cell_row = (ray_z[x] * z + mTranslation[2] - parameters.mOrigin.y) * inverse_cell;
+                    if(column < 0.0f || cell_row < 0.0f || column >= columns || cell_row >= rows)
+                        continue;
+
+                    size_t cell = static_cast<size_t>(cell_row) * static_cast<size_t>(columns) + static_cast<size_t>(column);
+                    heights[cell] = std::max(heights[cell], point_y);
+                    counts[cell]++;
+                }
+            }
+        });
+
+        // merge the partial grids, split into ranges of cells
+        int ranges = std::max(1, std::min(static_cast<int>(cells), threads));
+        RealSenseWorkerPool::parallelFor(pool, ranges, [&](int range)
+        {
+            size_t begin = cells * range / ranges;
+            size_t end = cells * (range + 1) / ranges;
+            for(size_t cell = begin; cell < end; cell++)
+            {
+                float max_height = -std::numeric_limits<float>::max();
+                uint32 count = 0;
+                for(const auto& partial : mPartials)
+                {
+                    max_height = std::max(max_height, partial.mHeights[cell]);
+                    count += partial.mCounts[cell];
+                }
+                heightMap.mHeights[cell] = count > 0 ? max_height : 0.0f;
+                heightMap.mCounts[cell] = count;
+                heightMap.mOccupancy[cell] = count >= static_cast<uint32>(std::max(parameters.mMinPoints, 1)) ? 255 : 0;
+            }
+        });
+    }
+}
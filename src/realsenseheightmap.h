@@ -0,0 +1,109 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Local includes
+#include "realsensetypes.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseDeprojectionMap;
+    class RealSenseWorkerPool;
+
+    /**
+     * Top-down projection of a depth frame onto a floor grid.
+     * Floor space has the y axis pointing up and the floor at y = 0, cells span the x and z axes.
+     * Cell (column, row) covers x in [origin.x + column * cellSize, +cellSize) and z in [origin.y + row * cellSize, +cellSize).
+     */
+    struct NAPAPI RealSenseHeightMap
+    {
+        std::vector<float> mHeights;            ///< Highest point of every cell in meters, 0 for empty cells, row major
+        std::vector<uint8> mOccupancy;          ///< 255 for occupied cells and 0 for free cells, row major
+        std::vector<uint32> mCounts;            ///< Amount of points per cell, row major
+        int mColumns = 0;                       ///< Amount of cells along the x axis
+        int mRows = 0;                          ///< Amount of cells along the z axis
+        float mCellSize = 0.0f;                 ///< Size of a cell in meters
+        glm::vec2 mOrigin = { 0.0f, 0.0f };     ///< Floor x and z coordinate of the corner of the first cell
+        uint64 mFrameNumber = 0;                ///< Frame number of the depth frame
+        double mTimestamp = 0.0;                ///< Timestamp of the depth frame in milliseconds
+    };
+
+    /**
+     * RealSenseHeightMapBuilder
+     * Projects every valid depth pixel into floor space and keeps the maximum height and the amount of points per cell.
+     * The rays of all pixels are rotated into floor space once per camera transform and stream configuration,
+     * per pixel only a scale by depth, a translation and a cell lookup remain. No point buffer is created.
+     * Rows are split into tasks on the worker pool, every task fills its own partial grid, the partial grids are merged in parallel.
+     * Buffers are only allocated when the grid, resolution or amount of worker threads changes.
+     */
+    class NAPAPI RealSenseHeightMapBuilder final
+    {
+    public:
+        /**
+         * Grid configuration
+         */
+        struct Parameters
+        {
+            glm::vec2 mOrigin = { -2.0f, -2.0f };   ///< Floor x and z coordinate of the corner of the grid in meters
+            glm::vec2 mSize = { 4.0f, 4.0f };       ///< Extent of the grid along x and z in meters
+            float mCellSize = 0.05f;                ///< Size of a cell in meters
+            float mMinHeight = 0.05f;               ///< Points below this height are ignored, removes the floor
+            float mMaxHeight = 2.5f;                ///< Points above this height are ignored
+            int mMinPoints = 4;                     ///< Minimum amount of points of an occupied cell
+        };
+
+        /**
+         * Sets the transform from camera space (x right, y down, z forward, in meters) to floor space.
+         * Rebuilds the rotated rays on the next call to build.
+         * @param cameraToFloor camera to floor transform
+         */
+        void setCameraTransform(const glm::mat4& cameraToFloor);
+
+        /**
+         * Projects a depth frame onto the grid
+         * @param depth depth values of the frame
+         * @param depthStride stride of the depth frame in bytes
+         * @param depthScale depth units in meters
+         * @param rays deprojection map of the depth stream
+         * @param parameters grid configuration
+         * @param pool worker pool to split the rows over, nullptr projects the frame on the calling thread
+         * @param heightMap receives the result, buffers keep their capacity
+         */
+        void build(const uint16* depth, int depthStride, float depthScale, const RealSenseDeprojectionMap& rays,
+                   const Parameters& parameters, RealSenseWorkerPool* pool, RealSenseHeightMap& heightMap);
+
+    private:
+        /**
+         * Grid of a single task
+         */
+        struct Partial
+        {
+            std::vector<float> mHeights;
+            std::vector<uint32> mCounts;
+        };
+
+        void updateRays(const RealSenseDeprojectionMap& rays);
+
+        float mRotation[9] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };   ///< Column major
+        float mTranslation[3] = { 0.0f, 0.0f, 0.0f };
+        bool mRaysDirty = true;
+
+        // rays rotated into floor space, row major planes
+        std::vector<float> mRayX;
+        std::vector<float> mRayY;
+        std::vector<float> mRayZ;
+        RealSenseCameraIntrincics mIntrinsics = {};         ///< Intrinsics the rotated rays were computed for
+
+        std::vector<Partial> mPartials;
+    };
+}
@@ -0,0 +1,211 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsenseheightmapcomponent.h"
+#include "realsensedeprojection.h"
+#include "realsenseservice.h"
+
+#include <rs.hpp>
+#include <nap/core.h>
+#include <cmath>
+
+RTTI_BEGIN_CLASS(nap::RealSenseHeightMapComponent)
+    RTTI_PROPERTY("Origin", &nap::RealSenseHeightMapComponent::mOrigin, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Size", &nap::RealSenseHeightMapComponent::mSize, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("CellSize", &nap::RealSenseHeightMapComponent::mCellSize, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MinHeight", &nap::RealSenseHeightMapComponent::mMinHeight, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MaxHeight", &nap::RealSenseHeightMapComponent::mMaxHeight, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MinPoints", &nap::RealSenseHeightMapComponent::mMinPoints, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("CameraPosition", &nap::RealSenseHeightMapComponent::mCameraPosition, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("CameraRotation", &nap::RealSenseHeightMapComponent::mCameraRotation, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Floor", &nap::RealSenseHeightMapComponent::mFloor, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("CreateTextures", &nap::RealSenseHeightMapComponent::mCreateTextures, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseHeightMapComponentInstance)
+    RTTI_CONSTRUCTOR(nap::EntityInstance&, nap::Component&)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static functions
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * @return transform of a camera at position, rotated around x, then y, then z by rotation in degrees
+     */
+    static glm::mat4 composeTransform(const glm::vec3& position, const glm::vec3& rotation)
+    {
+        float cx = std::cos(glm::radians(rotation.x)), sx = std::sin(glm::radians(rotation.x));
+        float cy = std::cos(glm::radians(rotation.y)), sy = std::sin(glm::radians(rotation.y));
+        float cz = std::cos(glm::radians(rotation.z)), sz = std::sin(glm::radians(rotation.z));
+
+        // columns of Rz * Ry * Rx
+        glm::mat4 transform(1.0f);
+        transform[0] = { cz * cy, sz * cy, -sy, 0.0f };
+        transform[1] = { cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0.0f };
+        transform[2] = { cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0.0f };
+        transform[3] = { position.x, position.y, position.z, 1.0f };
+        return transform;
+    }
+
+
+    /**
+     * Creates a dynamic render texture of the given size and format
+     */
+    static std::unique_ptr<RenderTexture2D> createTexture(Core& core, int width, int height, RenderTexture2D::EFormat format, utility::ErrorState& errorState)
+    {
+        auto texture = std::make_unique<RenderTexture2D>(core);
+        texture->mWidth = width;
+        texture->mHeight = height;
+        texture->mClearColor = { 0, 0, 0, 0 };
+        texture->mColorSpace = EColorSpace::Linear;
+        texture->mFormat = format;
+        texture->mUsage = ETextureUsage::DynamicWrite;
+        if(!texture->init(errorState))
+            return nullptr;
+        return texture;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseHeightMapComponent
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseHeightMapComponent::RealSenseHeightMapComponent() = default;
+
+
+    RealSenseHeightMapComponent::~RealSenseHeightMapComponent() = default;
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseHeightMapComponentInstance::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseHeightMapComponentInstance::Impl
+    {
+    public:
+        RealSenseHeightMapBuilder mBuilder;
+        RealSenseDeprojectionMap mRays;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseHeightMapComponentInstance
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseHeightMapComponentInstance::RealSenseHeightMapComponentInstance(EntityInstance& entity, Component& resource) :
+        RealSenseFrameSetListenerComponentInstance(entity, resource)
+    {}
+
+
+    RealSenseHeightMapComponentInstance::~RealSenseHeightMapComponentInstance() = default;
+
+
+    bool RealSenseHeightMapComponentInstance::onInit(utility::ErrorState& errorState)
+    {
+        mImpl = std::make_unique<Impl>();
+        mResource = getComponent<RealSenseHeightMapComponent>();
+        mPool = &getEntityInstance()->getCore()->getService<RealSenseService>()->getWorkerPool();
+
+        if(!errorState.check(mResource->mCellSize > 0.0f && mResource->mSize.x > 0.0f && mResource->mSize.y > 0.0f,
+                             "%s: cell size and grid size must be positive", mResource->mID.c_str()))
+            return false;
+
+        if(!errorState.check(mResource->mMaxHeight > mResource->mMinHeight, "%s: max height must be larger than min height", mResource->mID.c_str()))
+            return false;
+
+        mParameters.mOrigin = mResource->mOrigin;
+        mParameters.mSize = mResource->mSize;
+        mParameters.mCellSize = mResource->mCellSize;
+        mParameters.mMinHeight = mResource->mMinHeight;
+        mParameters.mMaxHeight = mResource->mMaxHeight;
+        mParameters.mMinPoints = mResource->mMinPoints;
+        mCameraTransform = composeTransform(mResource->mCameraPosition, mResource->mCameraRotation);
+
+        if(mResource->mCreateTextures)
+        {
+            int columns = std::max(1, static_cast<int>(std::ceil(mParameters.mSize.x / mParameters.mCellSize)));
+            int rows = std::max(1, static_cast<int>(std::ceil(mParameters.mSize.y / mParameters.mCellSize)));
+            auto& core = *getEntityInstance()->getCore();
+            mHeightTexture = createTexture(core, columns, rows, RenderTexture2D::EFormat::R32, errorState);
+            if(mHeightTexture == nullptr)
+                return false;
+
+            mOccupancyTexture = createTexture(core, columns, rows, RenderTexture2D::EFormat::R8, errorState);
+            if(mOccupancyTexture == nullptr)
+                return false;
+        }
+
+        frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
+        return true;
+    }
+
+
+    void RealSenseHeightMapComponentInstance::update(double deltaTime)
+    {
+        if(!mResults.update())
+            return;
+
+        const auto& height_map = mResults.getReadBuffer();
+        if(mHeightTexture != nullptr)
+        {
+            mHeightTexture->update(height_map.mHeights.data(), mHeightTexture->getDescriptor());
+            mOccupancyTexture->update(height_map.mOccupancy.data(), mOccupancyTexture->getDescriptor());
+        }
+        heightMapUpdated.trigger(height_map);
+    }
+
+
+    void RealSenseHeightMapComponentInstance::setCameraTransform(const glm::mat4& cameraToFloor)
+    {
+        std::lock_guard<std::mutex> lock(mTransformMutex);
+        mCameraTransform = cameraToFloor;
+        mTransformChanged = true;
+    }
+
+
+    glm::mat4 RealSenseHeightMapComponentInstance::getCameraTransform() const
+    {
+        std::lock_guard<std::mutex> lock(mTransformMutex);
+        return mCameraTransform;
+    }
+
+
+    void RealSenseHeightMapComponentInstance::onTrigger(const rs2::frameset& frameset)
+    {
+        auto depth = frameset.get_depth_frame();
+        if(!depth || depth.get_profile().format() != RS2_FORMAT_Z16)
+            return;
+
+        // rays only change with the stream profile
+        mImpl->mRays.update(depth.get_profile().as<rs2::video_stream_profile>());
+
+        // follow the floor plane, the builder only rebuilds its rays when the transform changes
+        if(mFloor.get() != nullptr && mFloor->isValid())
+        {
+            glm::mat4 floor_transform = mFloor->getCameraTransform();
+            std::lock_guard<std::mutex> lock(mTransformMutex);
+            if(floor_transform != mCameraTransform)
+            {
+                mCameraTransform = floor_transform;
+                mTransformChanged = true;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mTransformMutex);
+            if(mTransformChanged)
+            {
+                mImpl->mBuilder.setCameraTransform(mCameraTransform);
+                mTransformChanged = false;
+            }
+        }
+
+        auto& result = mResults.getWriteBuffer();
+        mImpl->mBuilder.build(static_cast<const uint16*>(depth.get_data()), depth.get_stride_in_bytes(), depth.get_units(),
+                              mImpl->mRays, mParameters, mPool, result);
+        result.mFrameNumber = depth.get_frame_number();
+        result.mTimestamp = depth.get_timestamp();
+        mResults.publish();
+    }
+}
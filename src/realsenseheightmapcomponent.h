@@ -0,0 +1,154 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include "realsenseframesetlistenercomponent.h"
+#include "realsenseheightmap.h"
+#include "realsensefloorcomponent.h"
+#include "realsensetriplebuffer.h"
+
+#include <cassert>
+#include <mutex>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseHeightMapComponentInstance;
+    class RealSenseWorkerPool;
+
+    /**
+     * RealSenseHeightMapComponent
+     * Projects the Z16 depth frames of a device top-down onto a floor grid, see RealSenseHeightMapBuilder.
+     * Every frame produces a height map (highest point per cell) and an occupancy grid (cells with at least 'MinPoints' points).
+     * The camera to floor transform is set with 'CameraPosition' and 'CameraRotation', or at runtime with setCameraTransform.
+     * When a 'Floor' component is set the transform follows the estimated floor plane as soon as it is found.
+     * Camera space has x pointing right, y down and z forward, floor space has y pointing up and the floor at y = 0.
+     * The grid is built on the capture thread, split over the worker pool of the RealSenseService, and handed to the
+     * main thread through a lock-free triple buffer. With 'CreateTextures' enabled the height map is uploaded to a R32 texture
+     * and the occupancy grid to a R8 texture on update.
+     */
+    class NAPAPI RealSenseHeightMapComponent : public RealSenseFrameSetListenerComponent
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponent)
+    DECLARE_COMPONENT(RealSenseHeightMapComponent, RealSenseHeightMapComponentInstance)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseHeightMapComponent();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseHeightMapComponent();
+
+        // Properties
+        glm::vec2 mOrigin = { -2.0f, -2.0f };           ///< Property: 'Origin' floor x and z coordinate in meters of the corner of the grid
+        glm::vec2 mSize = { 4.0f, 4.0f };               ///< Property: 'Size' extent of the grid along x and z in meters
+        float mCellSize = 0.05f;                        ///< Property: 'CellSize' size of a cell in meters
+        float mMinHeight = 0.05f;                       ///< Property: 'MinHeight' points below this height in meters are ignored
+        float mMaxHeight = 2.5f;                        ///< Property: 'MaxHeight' points above this height in meters are ignored
+        int mMinPoints = 4;                             ///< Property: 'MinPoints' minimum amount of points of an occupied cell
+        glm::vec3 mCameraPosition = { 0.0f, 0.0f, 0.0f }; ///< Property: 'CameraPosition' position of the camera in floor space in meters
+        glm::vec3 mCameraRotation = { 0.0f, 0.0f, 0.0f }; ///< Property: 'CameraRotation' rotation of the camera in degrees, applied around x, then y, then z
+        ComponentPtr<RealSenseFloorComponent> mFloor;   ///< Property: 'Floor' optional floor component that provides the camera to floor transform
+        bool mCreateTextures = false;                   ///< Property: 'CreateTextures' upload the height map and occupancy grid to render textures
+    };
+
+    /**
+     * RealSenseHeightMapComponentInstance
+     * Builds the height map on the capture thread and publishes it on update
+     */
+    class NAPAPI RealSenseHeightMapComponentInstance : public RealSenseFrameSetListenerComponentInstance
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponentInstance)
+    public:
+        /**
+         * Constructor
+         * @param entity reference to entity instance
+         * @param resource reference to component
+         */
+        RealSenseHeightMapComponentInstance(EntityInstance& entity, Component& resource);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseHeightMapComponentInstance();
+
+        /**
+         * Picks up the latest height map, uploads the textures and triggers heightMapUpdated when a new height map is available
+         * @param deltaTime time since last update
+         */
+        void update(double deltaTime) override;
+
+        /**
+         * @return height map picked up by the last update, only call from the main thread
+         */
+        const RealSenseHeightMap& getHeightMap() const  { return mResults.getReadBuffer(); }
+
+        /**
+         * Sets the transform from camera space to floor space, applied from the next frame. Can be called from any thread.
+         * Overridden by the estimated floor plane when a 'Floor' component is set.
+         * @param cameraToFloor camera to floor transform
+         */
+        void setCameraTransform(const glm::mat4& cameraToFloor);
+
+        /**
+         * @return the transform from camera space to floor space, can be called from any thread
+         */
+        glm::mat4 getCameraTransform() const;
+
+        /**
+         * @return if the height map and occupancy textures are created
+         */
+        bool hasTextures() const                        { return mHeightTexture != nullptr; }
+
+        /**
+         * @return R32 texture with the height of every cell in meters, only valid when 'CreateTextures' is enabled
+         */
+        RenderTexture2D& getHeightTexture()             { assert(mHeightTexture != nullptr); return *mHeightTexture; }
+
+        /**
+         * @return R8 texture with the occupancy of every cell, only valid when 'CreateTextures' is enabled
+         */
+        RenderTexture2D& getOccupancyTexture()          { assert(mOccupancyTexture != nullptr); return *mOccupancyTexture; }
+
+        // Signal triggered from update on the main thread when a new height map is available
+        Signal<const RealSenseHeightMap&> heightMapUpdated;
+
+    protected:
+        /**
+         * Internal init method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool onInit(utility::ErrorState& errorState) override;
+
+        /**
+         * Called upon receiving a new frameset, called from RealSense device
+         * @param frameset a new frameset
+         */
+        void onTrigger(const rs2::frameset& frameset);
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        ComponentInstancePtr<RealSenseFloorComponent> mFloor = { this, &RealSenseHeightMapComponent::mFloor };
+        RealSenseHeightMapComponent* mResource = nullptr;
+        RealSenseWorkerPool* mPool = nullptr;
+        RealSenseHeightMapBuilder::Parameters mParameters;
+        RealSenseTripleBuffer<RealSenseHeightMap> mResults;
+
+        mutable std::mutex mTransformMutex;
+        glm::mat4 mCameraTransform;                     ///< Guarded by mTransformMutex
+        bool mTransformChanged = true;                  ///< Guarded by mTransformMutex
+
+        std::unique_ptr<RenderTexture2D> mHeightTexture;
+        std::unique_ptr<RenderTexture2D> mOccupancyTexture;
+    };
+}
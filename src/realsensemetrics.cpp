@@ -0,0 +1,130 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensemetrics.h"
+#include "realsenseconversion.h"
+
+#include <utility/stringutils.h>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Minimum time in between rate updates, shorter intervals make the rate of a 30 fps stream jump when sampled at 60 fps
+     */
+    static constexpr std::chrono::milliseconds sRateInterval(500);
+
+
+    static const char* toString(ERealSenseMetricType type)
+    {
+        switch(type)
+        {
+        case ERealSenseMetricType::Gauge:
+            return "gauge";
+        case ERealSenseMetricType::Timer:
+            return "timer";
+        default:
+            return "counter";
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseMetricsRegistry::Sample
+    //////////////////////////////////////////////////////////////////////////
+
+    std::string RealSenseMetricsRegistry::Sample::toJSON() const
+    {
+        return utility::stringFormat("{ \"source\": \"%s\", \"name\": \"%s\", \"type\": \"%s\", \"value\": %llu, \"count\": %llu, "
+                                     "\"rate\": %.3f, \"avg_us\": %.3f }",
+                                     realsense::escapeJSON(mSource).c_str(), realsense::escapeJSON(mName).c_str(), toString(mType),
+                                     static_cast<unsigned long long>(mValue),
+                                     static_cast<unsigned long long>(mCount),
+                                     mRate, mAverage);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseMetricsRegistry
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseMetric& RealSenseMetricsRegistry::getMetric(const std::string& source, const std::string& name, ERealSenseMetricType type)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for(auto& entry : mEntries)
+        {
+            if(entry.mSource == source && entry.mName == name)
+                return *entry.mMetric;
+        }
+
+        Entry entry;
+        entry.mSource = source;
+        entry.mName = name;
+        entry.mMetric = std::make_unique<RealSenseMetric>(type);
+        mEntries.emplace_back(std::move(entry));
+        return *mEntries.back().mMetric;
+    }
+
+
+    void RealSenseMetricsRegistry::getSnapshot(std::vector<Sample>& samples)
+    {
+        samples.clear();
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto now = std::chrono::steady_clock::now();
+        bool update = now - mPreviousUpdate >= sRateInterval;
+        double seconds = std::chrono::duration<double>(now - mPreviousUpdate).count();
+        if(update)
+            mPreviousUpdate = now;
+
+        samples.reserve(mEntries.size());
+        for(auto& entry : mEntries)
+        {
+            Sample sample;
+            sample.mSource = entry.mSource;
+            sample.mName = entry.mName;
+            sample.mType = entry.mMetric->getType();
+            sample.mValue = entry.mMetric->getValue();
+            sample.mCount = entry.mMetric->getCount();
+
+            if(update && sample.mType != ERealSenseMetricType::Gauge)
+            {
+                uint64 value = sample.mValue - entry.mPreviousValue;
+                uint64 count = sample.mCount - entry.mPreviousCount;
+                if(sample.mType == ERealSenseMetricType::Counter)
+                {
+                    entry.mRate = static_cast<double>(value) / seconds;
+                }
+                else
+                {
+                    entry.mRate = static_cast<double>(count) / seconds;
+                    entry.mAverage = count > 0 ? static_cast<double>(value) / static_cast<double>(count) / 1000.0 : 0.0;
+                }
+                entry.mPreviousValue = sample.mValue;
+                entry.mPreviousCount = sample.mCount;
+            }
+
+            sample.mRate = entry.mRate;
+            sample.mAverage = entry.mAverage;
+            samples.emplace_back(std::move(sample));
+        }
+    }
+
+
+    std::string RealSenseMetricsRegistry::toJSON()
+    {
+        std::vector<Sample> samples;
+        getSnapshot(samples);
+
+        std::string json = "[\n";
+        for(size_t i = 0; i < samples.size(); i++)
+        {
+            json += "    " + samples[i].toJSON();
+            json += i + 1 < samples.size() ? ",\n" : "\n";
+        }
+        json += "]\n";
+        return json;
+    }
+}
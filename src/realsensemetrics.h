@@ -0,0 +1,158 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Kind of value a RealSenseMetric holds
+     */
+    enum class ERealSenseMetricType : int
+    {
+        Counter     = 0,    ///< Monotonically increasing total, reported as total and rate per second
+        Gauge       = 1,    ///< Value that goes up and down, for example a queue depth
+        Timer       = 2     ///< Accumulated durations, reported as average duration
+    };
+
+    /**
+     * RealSenseMetric
+     * Single lock-free value of the RealSenseMetricsRegistry.
+     * Updates are relaxed atomic operations and can be made from any thread, a metric without readers costs no more than the update itself.
+     */
+    class NAPAPI RealSenseMetric final
+    {
+    public:
+        /**
+         * Constructor
+         * @param type kind of value
+         */
+        RealSenseMetric(ERealSenseMetricType type) : mType(type)        { }
+
+        /**
+         * Increases a counter
+         * @param value amount to add
+         */
+        void add(uint64 value = 1)                      { mValue.fetch_add(value, std::memory_order_relaxed); }
+
+        /**
+         * Sets the value of a gauge
+         * @param value the new value
+         */
+        void set(uint64 value)                          { mValue.store(value, std::memory_order_relaxed); }
+
+        /**
+         * Records a duration of a timer
+         * @param nanoseconds the duration in nanoseconds
+         */
+        void record(uint64 nanoseconds)
+        {
+            mValue.fetch_add(nanoseconds, std::memory_order_relaxed);
+            mCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @return kind of value
+         */
+        ERealSenseMetricType getType() const            { return mType; }
+
+        /**
+         * @return total of a counter, value of a gauge or total recorded nanoseconds of a timer
+         */
+        uint64 getValue() const                         { return mValue.load(std::memory_order_relaxed); }
+
+        /**
+         * @return amount of recorded durations of a timer, 0 for other metrics
+         */
+        uint64 getCount() const                         { return mCount.load(std::memory_order_relaxed); }
+
+    private:
+        ERealSenseMetricType mType;
+        std::atomic<uint64> mValue = { 0 };
+        std::atomic<uint64> mCount = { 0 };
+    };
+
+    /**
+     * RealSenseMetricsRegistry
+     * Module-wide collection of named metrics, owned by the RealSenseService.
+     * Metrics are grouped by source, usually the id of the device or component that updates them.
+     * Producers register a metric once, outside of their frame loop, and keep the returned reference: registration takes a lock, updates do not.
+     * Metrics are never removed, a reference stays valid for the lifetime of the registry.
+     * Rates and averages are computed by taking snapshots, usually once per frame on the main thread.
+     */
+    class NAPAPI RealSenseMetricsRegistry final
+    {
+    public:
+        /**
+         * State of a single metric at the time of a snapshot
+         */
+        struct NAPAPI Sample
+        {
+            std::string mSource;                        ///< Device or component that updates the metric
+            std::string mName;                          ///< Name of the metric
+            ERealSenseMetricType mType = ERealSenseMetricType::Counter;  ///< Kind of value
+            uint64 mValue = 0;                          ///< Total of a counter, value of a gauge or total recorded nanoseconds of a timer
+            uint64 mCount = 0;                          ///< Amount of recorded durations of a timer
+            double mRate = 0.0;                         ///< Counter: increase per second. Timer: recorded durations per second.
+            double mAverage = 0.0;                      ///< Timer: average recorded duration in microseconds
+
+            /**
+             * Serializes the sample into a JSON object
+             * @return JSON object as string
+             */
+            std::string toJSON() const;
+        };
+
+        /**
+         * Returns the metric with the given source and name, the metric is created when it does not exist.
+         * Can be called from any thread.
+         * @param source device or component that updates the metric
+         * @param name name of the metric
+         * @param type kind of value, ignored when the metric already exists
+         * @return the metric, valid for the lifetime of the registry
+         */
+        RealSenseMetric& getMetric(const std::string& source, const std::string& name, ERealSenseMetricType type);
+
+        /**
+         * Takes a snapshot of all metrics in order of registration.
+         * Rates and averages are updated at most every half second and cover the time since the previous update,
+         * snapshots taken in between return the previous rates. Can be called from any thread.
+         * @param samples receives the samples, cleared first
+         */
+        void getSnapshot(std::vector<Sample>& samples);
+
+        /**
+         * Serializes a snapshot of all metrics into a JSON array
+         * @return JSON array of metrics
+         */
+        std::string toJSON();
+
+    private:
+        struct Entry
+        {
+            std::string mSource;
+            std::string mName;
+            std::unique_ptr<RealSenseMetric> mMetric;
+            uint64 mPreviousValue = 0;
+            uint64 mPreviousCount = 0;
+            double mRate = 0.0;
+            double mAverage = 0.0;
+        };
+
+        std::vector<Entry> mEntries;                    ///< Guarded by mMutex
+        std::chrono::steady_clock::time_point mPreviousUpdate = std::chrono::steady_clock::now();
+        std::mutex mMutex;
+    };
+}
@@ -0,0 +1,142 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensemetricsgui.h"
+#include "realsenseservice.h"
+#include "realsenseframefilter.h"
+#include "realsenseframesetfilter.h"
+
+#include <nap/core.h>
+#include <nap/resourcemanager.h>
+#include <utility/stringutils.h>
+#include <imgui/imgui.h>
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseMetricsGUI)
+    RTTI_CONSTRUCTOR(nap::RealSenseService&)
+    RTTI_PROPERTY("ShowFilters", &nap::RealSenseMetricsGUI::mShowFilters, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Formats a value with an SI suffix, counters hold frames as well as bytes
+     */
+    static std::string formatQuantity(double value)
+    {
+        static const char* suffixes[] = { "", "k", "M", "G", "T" };
+        int suffix = 0;
+        while(value >= 1000.0 && suffix < 4)
+        {
+            value /= 1000.0;
+            suffix++;
+        }
+        return suffix == 0 && value == static_cast<double>(static_cast<uint64>(value)) ?
+            utility::stringFormat("%llu", static_cast<unsigned long long>(value)) :
+            utility::stringFormat("%.2f %s", value, suffixes[suffix]);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseMetricsGUI
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseMetricsGUI::RealSenseMetricsGUI(RealSenseService& service) : mService(service)
+    { }
+
+
+    void RealSenseMetricsGUI::show(bool newWindow)
+    {
+        if(newWindow)
+            ImGui::Begin(mID.c_str());
+
+        mService.getMetrics().getSnapshot(mSamples);
+
+        // group the samples by source, in order of registration
+        std::vector<const std::string*> sources;
+        for(const auto& sample : mSamples)
+        {
+            bool found = false;
+            for(const auto* source : sources)
+                found |= *source == sample.mSource;
+            if(!found)
+                sources.emplace_back(&sample.mSource);
+        }
+
+        if(sources.empty())
+            ImGui::TextDisabled("No metrics registered");
+
+        for(const auto* source : sources)
+        {
+            if(!ImGui::TreeNodeEx(source->c_str(), ImGuiTreeNodeFlags_DefaultOpen))
+                continue;
+
+            ImGui::Columns(3, source->c_str(), false);
+            for(const auto& sample : mSamples)
+            {
+                if(sample.mSource != *source)
+                    continue;
+
+                ImGui::Text("%s", sample.mName.c_str());
+                ImGui::NextColumn();
+                switch(sample.mType)
+                {
+                case ERealSenseMetricType::Counter:
+                    ImGui::Text("%s", formatQuantity(static_cast<double>(sample.mValue)).c_str());
+                    ImGui::NextColumn();
+                    ImGui::Text("%s/s", formatQuantity(sample.mRate).c_str());
+                    break;
+                case ERealSenseMetricType::Gauge:
+                    ImGui::Text("%s", formatQuantity(static_cast<double>(sample.mValue)).c_str());
+                    ImGui::NextColumn();
+                    break;
+                case ERealSenseMetricType::Timer:
+                    ImGui::Text("%.1f us", sample.mAverage);
+                    ImGui::NextColumn();
+                    ImGui::Text("%.1f/s", sample.mRate);
+                    break;
+                }
+                ImGui::NextColumn();
+            }
+            ImGui::Columns(1);
+            ImGui::TreePop();
+        }
+
+        if(mShowFilters)
+            showFilters();
+
+        if(newWindow)
+            ImGui::End();
+    }
+
+
+    void RealSenseMetricsGUI::showFilters()
+    {
+        if(!ImGui::TreeNodeEx("Filters", ImGuiTreeNodeFlags_DefaultOpen))
+            return;
+
+        ImGui::Columns(3, "Filters", false);
+        auto show_filter = [](const std::string& name, const RealSenseFilterStatistics::Snapshot& snapshot)
+        {
+            ImGui::Text("%s", name.c_str());
+            ImGui::NextColumn();
+            ImGui::Text("%.1f us", snapshot.getAverageTime());
+            ImGui::NextColumn();
+            ImGui::Text("p99 %.0f us", snapshot.getPercentileTime(0.99f));
+            ImGui::NextColumn();
+        };
+
+        auto* resource_manager = mService.getCore().getResourceManager();
+        for(const auto& filter : resource_manager->getObjects<RealSenseFrameFilter>())
+            show_filter(filter->mID, filter->getStatistics().getSnapshot());
+
+        for(const auto& filter : resource_manager->getObjects<RealSenseFrameSetFilter>())
+            show_filter(filter->mID, filter->getStatistics().getSnapshot());
+
+        ImGui::Columns(1);
+        ImGui::TreePop();
+    }
+}
@@ -0,0 +1,55 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/resource.h>
+#include <rtti/factory.h>
+#include <vector>
+
+// Local includes
+#include "realsensemetrics.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseService;
+
+    /**
+     * RealSenseMetricsGUI
+     * ImGui panel that shows the metrics registry of the RealSenseService, grouped by device or component:
+     * input and delivered frame rates, dropped frames, queue depths, filter chain and upload times and throughput.
+     * Optionally lists the execution time of every loaded frame and frameset filter.
+     * Metrics are only read while the panel is shown, call show from the main thread in between the begin and end of an ImGui frame.
+     */
+    class NAPAPI RealSenseMetricsGUI : public Resource
+    {
+    RTTI_ENABLE(Resource)
+    public:
+        /**
+         * Constructor
+         * @param service reference to the RealSenseService
+         */
+        RealSenseMetricsGUI(RealSenseService& service);
+
+        /**
+         * Draws the metrics
+         * @param newWindow when true the metrics are drawn in a separate window titled 'mID', otherwise in the current window
+         */
+        void show(bool newWindow = true);
+
+        bool mShowFilters = true;       ///< Property: 'ShowFilters' also show the execution time of all loaded frame and frameset filters
+
+    private:
+        void showFilters();
+
+        RealSenseService& mService;
+        std::vector<RealSenseMetricsRegistry::Sample> mSamples;
+    };
+
+    using RealSenseMetricsGUIObjectCreator = rtti::ObjectCreator<RealSenseMetricsGUI, RealSenseService>;
+}
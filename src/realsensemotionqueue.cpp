@@ -0,0 +1,47 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensemotionqueue.h"
+
+#include <algorithm>
+
+namespace nap
+{
+    RealSenseMotionQueue::RealSenseMotionQueue(int capacity)
+    {
+        size_t size = 2;
+        while(size < static_cast<size_t>(std::max(capacity, 2)))
+            size <<= 1;
+
+        mSamples.resize(size);
+        mMask = size - 1;
+    }
+
+
+    bool RealSenseMotionQueue::push(const RealSenseMotionSample& sample)
+    {
+        size_t write = mWrite.load(std::memory_order_relaxed);
+        if(write - mRead.load(std::memory_order_acquire) >= mSamples.size())
+        {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        mSamples[write & mMask] = sample;
+        mWrite.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+
+    int RealSenseMotionQueue::pop(std::vector<RealSenseMotionSample>& samples)
+    {
+        size_t read = mRead.load(std::memory_order_relaxed);
+        size_t write = mWrite.load(std::memory_order_acquire);
+        for(size_t i = read; i != write; i++)
+            samples.emplace_back(mSamples[i & mMask]);
+
+        mRead.store(write, std::memory_order_release);
+        return static_cast<int>(write - read);
+    }
+}
@@ -0,0 +1,75 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <vector>
+
+// Local includes
+#include "realsensetypes.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * A single gyro or accelerometer sample
+     */
+    struct NAPAPI RealSenseMotionSample
+    {
+        double mTimestamp = 0.0;                ///< Hardware timestamp of the sample in milliseconds
+        glm::vec3 mValue = { 0.0f, 0.0f, 0.0f };  ///< Angular velocity in rad/s for gyro, acceleration in m/s^2 for accel
+        ERealSenseStreamType mStream = ERealSenseStreamType::REALSENSE_STREAMTYPE_GYRO; ///< Gyro or accel
+    };
+
+    /**
+     * RealSenseMotionQueue
+     * Lock-free single producer, single consumer ring of motion samples.
+     * The sensor callback pushes samples, one other thread pops them in batches. When the ring is full new samples are dropped and counted.
+     */
+    class NAPAPI RealSenseMotionQueue final
+    {
+    public:
+        /**
+         * Constructor
+         * @param capacity maximum amount of queued samples, rounded up to a power of two
+         */
+        RealSenseMotionQueue(int capacity);
+
+        /**
+         * Adds a sample, only call from the producer thread
+         * @param sample the sample to add
+         * @return false when the ring is full and the sample was dropped
+         */
+        bool push(const RealSenseMotionSample& sample);
+
+        /**
+         * Appends all queued samples to samples, only call from the consumer thread
+         * @param samples receives the samples in order of arrival
+         * @return amount of appended samples
+         */
+        int pop(std::vector<RealSenseMotionSample>& samples);
+
+        /**
+         * @return amount of samples dropped because the ring was full
+         */
+        uint64 getDroppedCount() const          { return mDropped.load(std::memory_order_relaxed); }
+
+        /**
+         * @return amount of queued samples, can be called from any thread
+         */
+        size_t getSize() const                  { return mWrite.load(std::memory_order_relaxed) - mRead.load(std::memory_order_relaxed); }
+
+    private:
+        std::vector<RealSenseMotionSample> mSamples;
+        size_t mMask = 0;
+        alignas(64) std::atomic<size_t> mWrite = { 0 };
+        alignas(64) std::atomic<size_t> mRead = { 0 };
+        std::atomic<uint64> mDropped = { 0 };
+    };
+}
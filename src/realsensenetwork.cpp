@@ -0,0 +1,308 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensenetwork.h"
+
+#include <rtti/rtti.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+RTTI_BEGIN_ENUM(nap::ERealSenseNetworkProtocol)
+    RTTI_ENUM_VALUE(nap::ERealSenseNetworkProtocol::UDP, "UDP"),
+    RTTI_ENUM_VALUE(nap::ERealSenseNetworkProtocol::TCP, "TCP")
+RTTI_END_ENUM
+
+namespace nap
+{
+    static constexpr uint32 sMaxMessageSize = 64 * 1024 * 1024;
+
+    namespace realsense
+    {
+        int64 getNetworkTime()
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseFrameAssembler
+    //////////////////////////////////////////////////////////////////////////
+
+    bool RealSenseFrameAssembler::add(const uint8* datagram, size_t size, std::vector<uint8>& message)
+    {
+        RealSenseNetworkFragmentHeader header;
+        RealSenseNetworkFragmentHeader expected;
+        if(size < sizeof(header))
+            return false;
+
+        std::memcpy(&header, datagram, sizeof(header));
+        size_t fragment_bytes = size - sizeof(header);
+        if(header.mMagic != expected.mMagic || header.mFragmentSize == 0 || header.mMessageSize == 0 || header.mMessageSize > sMaxMessageSize ||
+           header.mOffset % header.mFragmentSize != 0 || header.mOffset + fragment_bytes > header.mMessageSize)
+            return false;
+
+        // a restarted sender starts a new session with new message ids, messages of the previous session can't complete anymore
+        if(!mHasSession || header.mSessionID != mSessionID)
+        {
+            mDropped += mPending.size();
+            reset();
+            mSessionID = header.mSessionID;
+            mHasSession = true;
+        }
+
+        // late fragment of a message older than the last delivered message, ids wrap around
+        if(mHasCompleted && static_cast<int32>(header.mMessageID - mLastCompleted) <= 0)
+            return false;
+
+        // find or start the message, the oldest message is dropped when all slots are in use
+        auto it = std::find_if(mPending.begin(), mPending.end(), [&header](const Message& msg) { return msg.mID == header.mMessageID; });
+        if(it == mPending.end())
+        {
+            if(static_cast<int>(mPending.size()) >= mMaxPending)
+            {
+                auto oldest = std::min_element(mPending.begin(), mPending.end(), [](const Message& a, const Message& b)
+                {
+                    return static_cast<int32>(a.mID - b.mID) < 0;
+                });
+                mPending.erase(oldest);
+                mDropped++;
+            }
+
+            Message msg;
+            msg.mID = header.mMessageID;
+            msg.mData.resize(header.mMessageSize);
+            msg.mFragments.assign((header.mMessageSize + header.mFragmentSize - 1) / header.mFragmentSize, false);
+            mPending.emplace_back(std::move(msg));
+            it = mPending.end() - 1;
+        }
+
+        auto& msg = *it;
+        size_t fragment = header.mOffset / header.mFragmentSize;
+        if(msg.mData.size() != header.mMessageSize || fragment >= msg.mFragments.size() || msg.mFragments[fragment])
+            return false;
+
+        std::memcpy(msg.mData.data() + header.mOffset, datagram + sizeof(header), fragment_bytes);
+        msg.mFragments[fragment] = true;
+        if(++msg.mReceived < msg.mFragments.size())
+            return false;
+
+        // complete, every older message can't be delivered anymore
+        mLastCompleted = msg.mID;
+        mHasCompleted = true;
+        message.swap(msg.mData);
+        mPending.erase(it);
+        auto older = std::remove_if(mPending.begin(), mPending.end(), [this](const Message& pending)
+        {
+            return static_cast<int32>(pending.mID - mLastCompleted) <= 0;
+        });
+        mDropped += mPending.end() - older;
+        mPending.erase(older, mPending.end());
+        return true;
+    }
+
+
+    void RealSenseFrameAssembler::reset()
+    {
+        mPending.clear();
+        mHasSession = false;
+        mHasCompleted = false;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseSocket
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseSocket::~RealSenseSocket()
+    {
+        close();
+    }
+
+#ifndef _WIN32
+    bool RealSenseSocket::create(ERealSenseNetworkProtocol protocol, utility::ErrorState& errorState)
+    {
+        close();
+        mSocket = ::socket(AF_INET, protocol == ERealSenseNetworkProtocol::UDP ? SOCK_DGRAM : SOCK_STREAM, 0);
+        if(!errorState.check(mSocket >= 0, "Unable to create socket: %s", std::strerror(errno)))
+            return false;
+
+        // large buffers absorb the burst of fragments of a single frame
+        int buffer_size = 8 * 1024 * 1024;
+        setsockopt(mSocket, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+        setsockopt(mSocket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+        if(protocol == ERealSenseNetworkProtocol::TCP)
+        {
+            int enable = 1;
+            setsockopt(mSocket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+        return true;
+    }
+
+
+    bool RealSenseSocket::connect(ERealSenseNetworkProtocol protocol, const std::string& host, int port, utility::ErrorState& errorState)
+    {
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = protocol == ERealSenseNetworkProtocol::UDP ? SOCK_DGRAM : SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if(!errorState.check(getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) == 0 && result != nullptr,
+                             "Unable to resolve host %s", host.c_str()))
+            return false;
+
+        bool success = create(protocol, errorState);
+        if(success && ::connect(mSocket, result->ai_addr, result->ai_addrlen) != 0)
+        {
+            errorState.fail("Unable to connect to %s:%d: %s", host.c_str(), port, std::strerror(errno));
+            close();
+            success = false;
+        }
+        freeaddrinfo(result);
+        return success;
+    }
+
+
+    bool RealSenseSocket::bind(ERealSenseNetworkProtocol protocol, int port, utility::ErrorState& errorState)
+    {
+        if(!create(protocol, errorState))
+            return false;
+
+        int enable = 1;
+        setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(static_cast<uint16>(port));
+        if(!errorState.check(::bind(mSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0,
+                             "Unable to bind to port %d: %s", port, std::strerror(errno)))
+        {
+            close();
+            return false;
+        }
+
+        if(protocol == ERealSenseNetworkProtocol::TCP && !errorState.check(::listen(mSocket, 1) == 0, "Unable to listen on port %d", port))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+
+    bool RealSenseSocket::accept(RealSenseSocket& client, int timeout)
+    {
+        if(!wait(timeout))
+            return false;
+
+        int socket = ::accept(mSocket, nullptr, nullptr);
+        if(socket < 0)
+            return false;
+
+        client.close();
+        client.mSocket = socket;
+        int enable = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        return true;
+    }
+
+
+    bool RealSenseSocket::send(const void* data, size_t size)
+    {
+        const auto* bytes = static_cast<const uint8*>(data);
+        while(size > 0)
+        {
+            ssize_t sent = ::send(mSocket, bytes, size, MSG_NOSIGNAL);
+            if(sent < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+
+    int RealSenseSocket::receive(void* data, size_t capacity, int timeout)
+    {
+        if(!wait(timeout))
+            return 0;
+
+        ssize_t received = ::recv(mSocket, data, capacity, 0);
+        return received > 0 ? static_cast<int>(received) : -1;
+    }
+
+
+    int RealSenseSocket::receiveAll(void* data, size_t size, int timeout)
+    {
+        auto* bytes = static_cast<uint8*>(data);
+        size_t remaining = size;
+        while(remaining > 0)
+        {
+            // only the first byte may time out, a partial message must complete
+            int received = receive(bytes, remaining, remaining == size ? timeout : 1000);
+            if(received == 0 && remaining == size)
+                return 0;
+
+            if(received <= 0)
+                return -1;
+
+            bytes += received;
+            remaining -= static_cast<size_t>(received);
+        }
+        return static_cast<int>(size);
+    }
+
+
+    void RealSenseSocket::close()
+    {
+        if(mSocket >= 0)
+            ::close(mSocket);
+        mSocket = -1;
+    }
+
+
+    bool RealSenseSocket::wait(int timeout)
+    {
+        pollfd descriptor = { mSocket, POLLIN, 0 };
+        return ::poll(&descriptor, 1, timeout) > 0;
+    }
+#else
+    bool RealSenseSocket::create(ERealSenseNetworkProtocol protocol, utility::ErrorState& errorState)
+    {
+        errorState.fail("Network streaming is not supported on this platform");
+        return false;
+    }
+
+    bool RealSenseSocket::connect(ERealSenseNetworkProtocol protocol, const std::string& host, int port, utility::ErrorState& errorState)
+    {
+        return create(protocol, errorState);
+    }
+
+    bool RealSenseSocket::bind(ERealSenseNetworkProtocol protocol, int port, utility::ErrorState& errorState)
+    {
+        return create(protocol, errorState);
+    }
+
+    bool RealSenseSocket::accept(RealSenseSocket& client, int timeout)         { return false; }
+    bool RealSenseSocket::send(const void* data, size_t size)                  { return false; }
+    int RealSenseSocket::receive(void* data, size_t capacity, int timeout)     { return -1; }
+    int RealSenseSocket::receiveAll(void* data, size_t size, int timeout)      { return -1; }
+    void RealSenseSocket::close()                                               { }
+    bool RealSenseSocket::wait(int timeout)                                     { return false; }
+#endif
+}
@@ -0,0 +1,227 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <utility/errorstate.h>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Transport used to stream frames between a RealSenseStreamSender and a RealSenseStreamReceiver
+     */
+    enum class ERealSenseNetworkProtocol : int
+    {
+        UDP     = 0,    ///< Frames are fragmented into datagrams, a frame of which a fragment is lost is dropped as a whole
+        TCP     = 1     ///< Frames are sent as length prefixed messages, the sender drops frames while the connection is congested
+    };
+
+    /**
+     * Payload encoding of a streamed frame
+     */
+    enum class ERealSenseNetworkCodec : uint16
+    {
+        Raw     = 0,    ///< Pixels as delivered by the camera
+        RVL     = 1     ///< Z16 depth compressed with RVL in bands, see RealSenseDepthFileFrame
+    };
+
+    /**
+     * Header of a streamed frame message, followed by mBandCount band sizes and the payload
+     */
+    struct NAPAPI RealSenseNetworkFrameHeader
+    {
+        uint32 mMagic = 0x464e5352;     ///< 'RSNF'
+        uint16 mVersion = 1;
+        ERealSenseNetworkCodec mCodec = ERealSenseNetworkCodec::Raw;
+        int32 mStreamType = 0;          ///< rs2_stream
+        int32 mFormat = 0;              ///< rs2_format
+        int32 mWidth = 0;               ///< Width in pixels
+        int32 mHeight = 0;              ///< Height in pixels
+        int32 mBytesPerPixel = 0;       ///< Bytes per pixel
+        int32 mFps = 0;                 ///< Frame rate of the stream
+        uint64 mFrameNumber = 0;        ///< Frame number assigned by librealsense
+        double mTimestamp = 0.0;        ///< Frame timestamp in milliseconds
+        int64 mSendTime = 0;            ///< Wall clock time the frame was sent in microseconds, used to measure latency
+        float mDepthScale = 0.0f;       ///< Meters per depth unit, 0 for other streams
+        float mPPX = 0.0f;              ///< Horizontal principal point in pixels
+        float mPPY = 0.0f;              ///< Vertical principal point in pixels
+        float mFX = 0.0f;               ///< Horizontal focal length in pixels
+        float mFY = 0.0f;               ///< Vertical focal length in pixels
+        int32 mModel = 0;               ///< rs2_distortion
+        float mCoeffs[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; ///< Distortion coefficients
+        uint32 mBandCount = 0;          ///< Amount of RVL bands, 0 for raw frames
+        uint32 mPayloadSize = 0;        ///< Size of the payload in bytes
+    };
+
+    /**
+     * Header of a UDP datagram carrying a fragment of a frame message
+     */
+    struct NAPAPI RealSenseNetworkFragmentHeader
+    {
+        uint32 mMagic = 0x504e5352;     ///< 'RSNP'
+        uint32 mSessionID = 0;          ///< Random id of the sender connection, message ids restart when it changes
+        uint32 mMessageID = 0;          ///< Sequence number of the message within the session
+        uint32 mMessageSize = 0;        ///< Size of the complete message in bytes
+        uint32 mOffset = 0;             ///< Offset of this fragment in the message
+        uint32 mFragmentSize = 0;       ///< Size of every fragment of the message except the last
+    };
+
+    namespace realsense
+    {
+        /**
+         * @return wall clock time in microseconds, comparable between machines with synchronized clocks
+         */
+        NAPAPI int64 getNetworkTime();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseFrameAssembler
+     * Reassembles frame messages from UDP fragments.
+     * At most 'maxPending' messages are assembled at the same time, the oldest incomplete message is dropped when a newer message starts.
+     * Fragments of messages older than the last completed message are ignored, so late frames never overtake newer frames.
+     * A fragment of another session, sent by a restarted sender, drops all incomplete messages and starts the new session.
+     */
+    class NAPAPI RealSenseFrameAssembler final
+    {
+    public:
+        /**
+         * Constructor
+         * @param maxPending maximum amount of messages assembled at the same time
+         */
+        RealSenseFrameAssembler(int maxPending = 4) : mMaxPending(maxPending) { }
+
+        /**
+         * Adds a received datagram
+         * @param datagram the datagram
+         * @param size size of the datagram in bytes
+         * @param message receives the completed message, swapped with the assembly buffer
+         * @return true when the datagram completed a message
+         */
+        bool add(const uint8* datagram, size_t size, std::vector<uint8>& message);
+
+        /**
+         * @return amount of messages dropped because fragments were lost or arrived too late
+         */
+        uint64 getDroppedCount() const              { return mDropped; }
+
+        /**
+         * Drops all incomplete messages
+         */
+        void reset();
+
+    private:
+        struct Message
+        {
+            uint32 mID = 0;
+            uint32 mReceived = 0;
+            std::vector<uint8> mData;
+            std::vector<bool> mFragments;
+        };
+
+        int mMaxPending;
+        std::vector<Message> mPending;
+        uint32 mSessionID = 0;
+        bool mHasSession = false;
+        uint32 mLastCompleted = 0;
+        bool mHasCompleted = false;
+        uint64 mDropped = 0;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseSocket
+     * Minimal blocking socket with timeouts, for the network streaming components.
+     * Only available on platforms with BSD sockets, every call fails on Windows.
+     */
+    class NAPAPI RealSenseSocket final
+    {
+    public:
+        RealSenseSocket() = default;
+        RealSenseSocket(const RealSenseSocket&) = delete;
+        RealSenseSocket& operator=(const RealSenseSocket&) = delete;
+
+        /**
+         * Closes the socket
+         */
+        ~RealSenseSocket();
+
+        /**
+         * Creates a socket connected to a remote host. UDP sockets only set the default destination.
+         * @param protocol the protocol
+         * @param host host name or address
+         * @param port port number
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool connect(ERealSenseNetworkProtocol protocol, const std::string& host, int port, utility::ErrorState& errorState);
+
+        /**
+         * Creates a socket bound to a local port, TCP sockets listen for connections
+         * @param protocol the protocol
+         * @param port port number
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool bind(ERealSenseNetworkProtocol protocol, int port, utility::ErrorState& errorState);
+
+        /**
+         * Accepts a connection on a listening TCP socket
+         * @param client receives the connection
+         * @param timeout maximum time to wait in milliseconds
+         * @return true if a connection was accepted
+         */
+        bool accept(RealSenseSocket& client, int timeout);
+
+        /**
+         * Sends data, a datagram for UDP sockets, all bytes for TCP sockets
+         * @param data the data
+         * @param size size in bytes
+         * @return false on error or when the connection was closed
+         */
+        bool send(const void* data, size_t size);
+
+        /**
+         * Receives a datagram (UDP) or the available bytes (TCP)
+         * @param data receives the data
+         * @param capacity size of data in bytes
+         * @param timeout maximum time to wait in milliseconds
+         * @return amount of bytes received, 0 on timeout, -1 on error or when the connection was closed
+         */
+        int receive(void* data, size_t capacity, int timeout);
+
+        /**
+         * Receives exactly size bytes from a TCP socket
+         * @param data receives the data
+         * @param size amount of bytes to receive
+         * @param timeout maximum time to wait for the first byte in milliseconds
+         * @return size on success, 0 on timeout before the first byte, -1 on error or when the connection was closed
+         */
+        int receiveAll(void* data, size_t size, int timeout);
+
+        /**
+         * Closes the socket
+         */
+        void close();
+
+        /**
+         * @return if the socket is open
+         */
+        bool isOpen() const                         { return mSocket >= 0; }
+
+    private:
+        bool create(ERealSenseNetworkProtocol protocol, utility::ErrorState& errorState);
+        bool wait(int timeout);
+
+        int mSocket = -1;
+    };
+}
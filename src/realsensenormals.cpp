@@ -0,0 +1,371 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensenormals.h"
+#include "realsensedeprojection.h"
+#include "realsenseframearena.h"
+#include "realsenseworkerpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define REALSENSE_NORMALS_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Amount of row or column ranges per worker thread, more ranges than threads balances uneven rows
+     */
+    static constexpr int sRangesPerThread = 4;
+
+
+    /**
+     * Integral images and arguments of a frame shared by all tasks
+     */
+    struct FrameArguments
+    {
+        const uint8* mDepth = nullptr;
+        int mDepthStride = 0;
+        float mDepthScale = 0.0f;
+        const float* mRayX = nullptr;
+        const float* mRayY = nullptr;
+        double* mSums[4] = { nullptr, nullptr, nullptr, nullptr };     ///< x, y, z and count
+        glm::vec4* mNormals = nullptr;
+        int mWidth = 0;
+        int mHeight = 0;
+        int mStride = 0;                                                ///< Row stride of the integral images, width + 1
+        int mRadius = 0;
+        double mMaxDepthChange = 0.0;
+    };
+
+
+    /**
+     * Sum of an integral image over columns [x0, x1) and rows [y0, y1)
+     */
+    static inline double rectSum(const double* sums, int stride, int x0, int y0, int x1, int y1)
+    {
+        return (sums[y1 * stride + x1] - sums[y0 * stride + x1]) - (sums[y1 * stride + x0] - sums[y0 * stride + x0]);
+    }
+
+
+    /**
+     * Computes the normal from the horizontal and vertical gradient of a pixel, oriented towards the camera
+     */
+    static inline glm::vec4 toNormal(const glm::dvec3& dx, const glm::dvec3& dy, const glm::vec3& point, double maxDepthChange)
+    {
+        if(std::abs(dx.z) > maxDepthChange || std::abs(dy.z) > maxDepthChange)
+            return glm::vec4(0.0f);
+
+        // cross(dy, dx)
+        double nx = dy.y * dx.z - dy.z * dx.y;
+        double ny = dy.z * dx.x - dy.x * dx.z;
+        double nz = dy.x * dx.y - dy.y * dx.x;
+        double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        if(length <= 0.0)
+            return glm::vec4(0.0f);
+
+        glm::vec3 normal(static_cast<float>(nx / length), static_cast<float>(ny / length), static_cast<float>(nz / length));
+        if(glm::dot(normal, point) > 0.0f)
+            normal = -normal;
+        return glm::vec4(normal, 1.0f);
+    }
+
+
+    /**
+     * Computes the normal of a pixel, windows are clipped against the image border
+     */
+    static glm::vec4 computeNormal(const FrameArguments& args, int x, int y, const glm::vec3& point)
+    {
+        int r = args.mRadius;
+        int x0 = std::max(x - r, 0);
+        int x1 = std::min(x + r + 1, args.mWidth);
+        int y0 = std::max(y - r, 0);
+        int y1 = std::min(y + r + 1, args.mHeight);
+        if(x0 == x || x1 == x + 1 || y0 == y || y1 == y + 1)
+            return glm::vec4(0.0f);
+
+        // halves of the window: left, right, top and bottom
+        const int rects[4][4] = { { x0, y0, x, y1 }, { x + 1, y0, x1, y1 }, { x0, y0, x1, y }, { x0, y + 1, x1, y1 } };
+        glm::dvec3 means[4];
+        for(int i = 0; i < 4; i++)
+        {
+            const int* rect = rects[i];
+            double count = rectSum(args.mSums[3], args.mStride, rect[0], rect[1], rect[2], rect[3]);
+            if(count <= 0.0)
+                return glm::vec4(0.0f);
+
+            double inverse = 1.0 / count;
+            means[i] = glm::dvec3(rectSum(args.mSums[0], args.mStride, rect[0], rect[1], rect[2], rect[3]) * inverse,
+                                  rectSum(args.mSums[1], args.mStride, rect[0], rect[1], rect[2], rect[3]) * inverse,
+                                  rectSum(args.mSums[2], args.mStride, rect[0], rect[1], rect[2], rect[3]) * inverse);
+        }
+        return toNormal(means[1] - means[0], means[3] - means[2], point, args.mMaxDepthChange);
+    }
+
+
+    /**
+     * Writes the prefix sums of a depth row into row + 1 of the integral images
+     */
+    static void accumulateRow(const FrameArguments& args, int row)
+    {
+        const auto* values = reinterpret_cast<const uint16*>(args.mDepth + static_cast<size_t>(row) * static_cast<size_t>(args.mDepthStride));
+        size_t ray_offset = static_cast<size_t>(row) * static_cast<size_t>(args.mWidth);
+        size_t offset = static_cast<size_t>(row + 1) * static_cast<size_t>(args.mStride);
+        double* sum_x = args.mSums[0] + offset;
+        double* sum_y = args.mSums[1] + offset;
+        double* sum_z = args.mSums[2] + offset;
+        double* count = args.mSums[3] + offset;
+
+        double sx = 0.0, sy = 0.0, sz = 0.0, n = 0.0;
+        sum_x[0] = sum_y[0] = sum_z[0] = count[0] = 0.0;
+        for(int x = 0; x < args.mWidth; x++)
+        {
+            if(values[x] != 0)
+            {
+                double z = values[x] * args.mDepthScale;
+                sx += args.mRayX[ray_offset + x] * z;
+                sy += args.mRayY[ray_offset + x] * z;
+                sz += z;
+                n += 1.0;
+            }
+            sum_x[x + 1] = sx;
+            sum_y[x + 1] = sy;
+            sum_z[x + 1] = sz;
+            count[x + 1] = n;
+        }
+    }
+
+
+    /**
+     * Adds every row of the integral images to the next row, for columns [begin, end)
+     */
+    static void accumulateColumns(const FrameArguments& args, int begin, int end)
+    {
+        for(double* sums : args.mSums)
+        {
+            for(int row = 1; row <= args.mHeight; row++)
+            {
+                double* current = sums + static_cast<size_t>(row) * static_cast<size_t>(args.mStride);
+                const double* previous = current - args.mStride;
+                int x = begin;
+#ifdef REALSENSE_NORMALS_SSE2
+                for(; x + 2 <= end; x += 2)
+                    _mm_storeu_pd(current + x, _mm_add_pd(_mm_loadu_pd(current + x), _mm_loadu_pd(previous + x)));
+#endif
+                for(; x < end; x++)
+                    current[x] += previous[x];
+            }
+        }
+    }
+
+
+#ifdef REALSENSE_NORMALS_SSE2
+    /**
+     * Sums of an integral image over the four half windows of two neighbouring pixels.
+     * The half windows share their corners: 12 loads per image instead of 16.
+     */
+    struct HalfWindowsSSE2
+    {
+        __m128d mLeft, mRight, mTop, mBottom;
+    };
+
+
+    static inline HalfWindowsSSE2 halfWindowSumsSSE2(const double* sums, int rowTop, int rowCenter, int rowBelow, int rowBottom,
+                                                     int left, int x, int right)
+    {
+        const double* top = sums + rowTop;
+        const double* center = sums + rowCenter;
+        const double* below = sums + rowBelow;
+        const double* bottom = sums + rowBottom;
+
+        __m128d top_left = _mm_loadu_pd(top + left), top_x = _mm_loadu_pd(top + x);
+        __m128d top_next = _mm_loadu_pd(top + x + 1), top_right = _mm_loadu_pd(top + right);
+        __m128d bottom_left = _mm_loadu_pd(bottom + left), bottom_x = _mm_loadu_pd(bottom + x);
+        __m128d bottom_next = _mm_loadu_pd(bottom + x + 1), bottom_right = _mm_loadu_pd(bottom + right);
+
+        HalfWindowsSSE2 result;
+        result.mLeft = _mm_sub_pd(_mm_sub_pd(bottom_x, top_x), _mm_sub_pd(bottom_left, top_left));
+        result.mRight = _mm_sub_pd(_mm_sub_pd(bottom_right, top_right), _mm_sub_pd(bottom_next, top_next));
+        result.mTop = _mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(center + right), top_right), _mm_sub_pd(_mm_loadu_pd(center + left), top_left));
+        result.mBottom = _mm_sub_pd(_mm_sub_pd(bottom_right, _mm_loadu_pd(below + right)), _mm_sub_pd(bottom_left, _mm_loadu_pd(below + left)));
+        return result;
+    }
+
+
+    /**
+     * Computes the gradients of two neighbouring interior pixels at once, the window of both pixels lies within the image.
+     * Returns false when a half window of either pixel has no valid points, those are handled by the scalar path.
+     */
+    static bool computeGradientsSSE2(const FrameArguments& args, int x, int y, glm::dvec3* dx, glm::dvec3* dy)
+    {
+        int r = args.mRadius;
+        int stride = args.mStride;
+        int row_top = (y - r) * stride, row_center = y * stride, row_below = (y + 1) * stride, row_bottom = (y + r + 1) * stride;
+        int left = x - r, right = x + r + 1;
+
+        HalfWindowsSSE2 count = halfWindowSumsSSE2(args.mSums[3], row_top, row_center, row_below, row_bottom, left, x, right);
+        const __m128d zero = _mm_setzero_pd();
+        __m128d empty = _mm_or_pd(_mm_or_pd(_mm_cmple_pd(count.mLeft, zero), _mm_cmple_pd(count.mRight, zero)),
+                                  _mm_or_pd(_mm_cmple_pd(count.mTop, zero), _mm_cmple_pd(count.mBottom, zero)));
+        if(_mm_movemask_pd(empty) != 0)
+            return false;
+
+        const __m128d one = _mm_set1_pd(1.0);
+        __m128d inverse_left = _mm_div_pd(one, count.mLeft), inverse_right = _mm_div_pd(one, count.mRight);
+        __m128d inverse_top = _mm_div_pd(one, count.mTop), inverse_bottom = _mm_div_pd(one, count.mBottom);
+
+        alignas(16) double lanes[2];
+        for(int channel = 0; channel < 3; channel++)
+        {
+            HalfWindowsSSE2 sums = halfWindowSumsSSE2(args.mSums[channel], row_top, row_center, row_below, row_bottom, left, x, right);
+            _mm_store_pd(lanes, _mm_sub_pd(_mm_mul_pd(sums.mRight, inverse_right), _mm_mul_pd(sums.mLeft, inverse_left)));
+            dx[0][channel] = lanes[0];
+            dx[1][channel] = lanes[1];
+            _mm_store_pd(lanes, _mm_sub_pd(_mm_mul_pd(sums.mBottom, inverse_bottom), _mm_mul_pd(sums.mTop, inverse_top)));
+            dy[0][channel] = lanes[0];
+            dy[1][channel] = lanes[1];
+        }
+        return true;
+    }
+#endif
+
+
+    /**
+     * Computes the normals of a row
+     */
+    static void computeRow(const FrameArguments& args, int row)
+    {
+        const auto* values = reinterpret_cast<const uint16*>(args.mDepth + static_cast<size_t>(row) * static_cast<size_t>(args.mDepthStride));
+        size_t offset = static_cast<size_t>(row) * static_cast<size_t>(args.mWidth);
+        glm::vec4* normals = args.mNormals + offset;
+        auto get_point = [&](int x)
+        {
+            float z = values[x] * args.mDepthScale;
+            return glm::vec3(args.mRayX[offset + x] * z, args.mRayY[offset + x] * z, z);
+        };
+
+        int x = 0;
+#ifdef REALSENSE_NORMALS_SSE2
+        // interior pixels, both windows within the image
+        int r = args.mRadius;
+        if(row >= r && row + r < args.mHeight)
+        {
+            for(; x < r; x++)
+                normals[x] = values[x] != 0 ? computeNormal(args, x, row, get_point(x)) : glm::vec4(0.0f);
+
+            glm::dvec3 dx[2], dy[2];
+            for(; x + 1 + r < args.mWidth; x += 2)
+            {
+                if(values[x] == 0 || values[x + 1] == 0 || !computeGradientsSSE2(args, x, row, dx, dy))
+                {
+                    normals[x] = values[x] != 0 ? computeNormal(args, x, row, get_point(x)) : glm::vec4(0.0f);
+                    normals[x + 1] = values[x + 1] != 0 ? computeNormal(args, x + 1, row, get_point(x + 1)) : glm::vec4(0.0f);
+                    continue;
+                }
+                normals[x] = toNormal(dx[0], dy[0], get_point(x), args.mMaxDepthChange);
+                normals[x + 1] = toNormal(dx[1], dy[1], get_point(x + 1), args.mMaxDepthChange);
+            }
+        }
+#endif
+        for(; x < args.mWidth; x++)
+            normals[x] = values[x] != 0 ? computeNormal(args, x, row, get_point(x)) : glm::vec4(0.0f);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseNormalEstimator
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseNormalEstimator::estimate(const uint16* depth, int depthStride, float depthScale, const RealSenseDeprojectionMap& rays,
+                                            const Parameters& parameters, RealSenseWorkerPool* pool, std::vector<glm::vec4>& normals,
+                                            RealSenseFrameArena* arena)
+    {
+        int width = rays.getWidth();
+        int height = rays.getHeight();
+        normals.resize(static_cast<size_t>(std::max(width, 0)) * static_cast<size_t>(std::max(height, 0)));
+        if(width <= 0 || height <= 0)
+            return;
+
+        FrameArguments args;
+        size_t count = static_cast<size_t>(width + 1) * static_cast<size_t>(height + 1);
+        if(arena != nullptr)
+        {
+            // the integral images are scratch of this frame, the own buffers are no longer needed
+            if(!mSumX.empty())
+            {
+                for(auto* sums : { &mSumX, &mSumY, &mSumZ, &mCount })
+                    std::vector<double>().swap(*sums);
+                mWidth = mHeight = 0;
+            }
+
+            // arena memory is uninitialized, the first row of the integral images must be zero
+            for(auto& sums : args.mSums)
+            {
+                sums = static_cast<double*>(arena->allocate(count * sizeof(double), 64));
+                std::fill(sums, sums + width + 1, 0.0);
+            }
+        }
+        else
+        {
+            if(mWidth != width || mHeight != height)
+            {
+                mWidth = width;
+                mHeight = height;
+
+                // the first row of the integral images stays zero
+                for(auto* sums : { &mSumX, &mSumY, &mSumZ, &mCount })
+                    sums->assign(count, 0.0);
+            }
+            args.mSums[0] = mSumX.data();
+            args.mSums[1] = mSumY.data();
+            args.mSums[2] = mSumZ.data();
+            args.mSums[3] = mCount.data();
+        }
+
+        args.mDepth = reinterpret_cast<const uint8*>(depth);
+        args.mDepthStride = depthStride;
+        args.mDepthScale = depthScale;
+        args.mRayX = rays.getX();
+        args.mRayY = rays.getY();
+        args.mNormals = normals.data();
+        args.mWidth = width;
+        args.mHeight = height;
+        args.mStride = width + 1;
+        args.mRadius = std::max(parameters.mWindowRadius, 1);
+        args.mMaxDepthChange = parameters.mMaxDepthChange;
+
+        int threads = pool != nullptr ? pool->getThreadCount() + 1 : 1;
+        int row_ranges = std::max(1, std::min(height, threads * sRangesPerThread));
+        auto for_rows = [&args, row_ranges](int range, void (*process)(const FrameArguments&, int))
+        {
+            int begin = static_cast<int>(static_cast<int64>(args.mHeight) * range / row_ranges);
+            int end = static_cast<int>(static_cast<int64>(args.mHeight) * (range + 1) / row_ranges);
+            for(int row = begin; row < end; row++)
+                process(args, row);
+        };
+
+        // prefix sums of the rows
+        RealSenseWorkerPool::parallelFor(pool, row_ranges, [&](int range) { for_rows(range, accumulateRow); });
+
+        // accumulate the rows in column bands, every band is a multiple of two columns wide
+        int pairs = (args.mStride + 1) / 2;
+        int bands = std::max(1, std::min(pairs, threads * sRangesPerThread));
+        RealSenseWorkerPool::parallelFor(pool, bands, [&](int band)
+        {
+            int begin = static_cast<int>(static_cast<int64>(pairs) * band / bands) * 2;
+            int end = std::min(static_cast<int>(static_cast<int64>(pairs) * (band + 1) / bands) * 2, args.mStride);
+            accumulateColumns(args, begin, end);
+        });
+
+        // normals of the rows
+        RealSenseWorkerPool::parallelFor(pool, row_ranges, [&](int range) { for_rows(range, computeRow); });
+    }
+}
@@ -0,0 +1,70 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseDeprojectionMap;
+    class RealSenseFrameArena;
+    class RealSenseWorkerPool;
+
+    /**
+     * RealSenseNormalEstimator
+     * Estimates the surface normal of every pixel of a 16 bit depth frame from the deprojected points of a square window around it.
+     * The normal is the cross product of the horizontal and vertical gradient: the difference between the mean point of the
+     * right and left half of the window, and of the bottom and top half. Means are read from integral images of the points,
+     * the cost per pixel does not depend on the window radius.
+     * The integral images are built in three passes on the worker pool: prefix sums of rows, accumulation of column bands
+     * and the normals of rows. Interior pixels are processed two at a time with SSE2 on x64.
+     * The integral images are allocated from the frame arena when one is given, otherwise the estimator keeps its own
+     * buffers, which are only allocated when the resolution changes.
+     */
+    class NAPAPI RealSenseNormalEstimator final
+    {
+    public:
+        /**
+         * Estimation parameters
+         */
+        struct Parameters
+        {
+            int mWindowRadius = 4;                  ///< Half size of the window in pixels, the window spans 2 * radius + 1 pixels
+            float mMaxDepthChange = 0.05f;          ///< Maximum depth difference in meters between opposite halves of the window, larger differences are edges
+        };
+
+        /**
+         * Estimates the normals of a depth frame, the resolution is taken from the deprojection map
+         * @param depth depth values of the frame
+         * @param depthStride stride of the depth frame in bytes
+         * @param depthScale depth units in meters
+         * @param rays deprojection map of the depth stream
+         * @param parameters estimation parameters
+         * @param pool worker pool to split the passes over, nullptr estimates the normals on the calling thread
+         * @param normals receives a normal per pixel in camera space, row major. Normals face the camera and have w set to 1,
+         * pixels without a normal (invalid depth, edges and the image border) are set to 0.
+         * @param arena arena of the frameset to allocate the integral images from, nullptr uses the buffers of the estimator
+         */
+        void estimate(const uint16* depth, int depthStride, float depthScale, const RealSenseDeprojectionMap& rays,
+                      const Parameters& parameters, RealSenseWorkerPool* pool, std::vector<glm::vec4>& normals,
+                      RealSenseFrameArena* arena = nullptr);
+
+    private:
+        // integral images of the point coordinates and the amount of valid points, (width + 1) * (height + 1) row major.
+        // Only used when no frame arena is given.
+        std::vector<double> mSumX;
+        std::vector<double> mSumY;
+        std::vector<double> mSumZ;
+        std::vector<double> mCount;
+        int mWidth = 0;
+        int mHeight = 0;
+    };
+}
@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensenormalscomponent.h"
+#include "realsensedeprojection.h"
+#include "realsenseframearena.h"
+#include "realsenseservice.h"
+
+#include <rs.hpp>
+#include <nap/core.h>
+#include <nap/logger.h>
+
+RTTI_BEGIN_CLASS(nap::RealSenseNormalsComponent)
+    RTTI_PROPERTY("WindowRadius", &nap::RealSenseNormalsComponent::mWindowRadius, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("MaxDepthChange", &nap::RealSenseNormalsComponent::mMaxDepthChange, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("CreateTexture", &nap::RealSenseNormalsComponent::mCreateTexture, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseNormalsComponentInstance)
+    RTTI_CONSTRUCTOR(nap::EntityInstance&, nap::Component&)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseNormalsComponent
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseNormalsComponent::RealSenseNormalsComponent() = default;
+
+
+    RealSenseNormalsComponent::~RealSenseNormalsComponent() = default;
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseNormalsComponentInstance::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseNormalsComponentInstance::Impl
+    {
+    public:
+        RealSenseNormalEstimator mEstimator;
+        RealSenseDeprojectionMap mRays;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseNormalsComponentInstance
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseNormalsComponentInstance::RealSenseNormalsComponentInstance(EntityInstance& entity, Component& resource) :
+        RealSenseFrameSetListenerComponentInstance(entity, resource)
+    {}
+
+
+    RealSenseNormalsComponentInstance::~RealSenseNormalsComponentInstance() = default;
+
+
+    bool RealSenseNormalsComponentInstance::onInit(utility::ErrorState& errorState)
+    {
+        mImpl = std::make_unique<Impl>();
+        mResource = getComponent<RealSenseNormalsComponent>();
+        mPool = &getEntityInstance()->getCore()->getService<RealSenseService>()->getWorkerPool();
+
+        if(!errorState.check(mResource->mWindowRadius > 0, "%s: window radius must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        if(!errorState.check(mResource->mMaxDepthChange > 0.0f, "%s: max depth change must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        mParameters.mWindowRadius = mResource->mWindowRadius;
+        mParameters.mMaxDepthChange = mResource->mMaxDepthChange;
+
+        // the texture is created on the first frame, when the resolution is known
+        if(mResource->mCreateTexture)
+            mNormalTexture = std::make_unique<RenderTexture2D>(*getEntityInstance()->getCore());
+
+        frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
+        return true;
+    }
+
+
+    void RealSenseNormalsComponentInstance::update(double deltaTime)
+    {
+        if(!mResults.update())
+            return;
+
+        const auto& normals = mResults.getReadBuffer();
+        if(mNormalTexture != nullptr)
+        {
+            // ensure dimensions are the same
+            glm::vec2 tex_size = mNormalTexture->getSize();
+            if(normals.mWidth != tex_size.x || normals.mHeight != tex_size.y)
+            {
+                mNormalTexture->mWidth = normals.mWidth;
+                mNormalTexture->mHeight = normals.mHeight;
+                mNormalTexture->mClearColor = { 0, 0, 0, 0 };
+                mNormalTexture->mColorSpace = EColorSpace::Linear;
+                mNormalTexture->mFormat = RenderTexture2D::EFormat::RGBA32;
+                mNormalTexture->mUsage = ETextureUsage::DynamicWrite;
+
+                utility::ErrorState error_state;
+                mTextureInitialized = mNormalTexture->init(error_state);
+                if(!mTextureInitialized)
+                    nap::Logger::error("%s: %s", mResource->mID.c_str(), error_state.toString().c_str());
+            }
+
+            if(mTextureInitialized)
+                mNormalTexture->update(normals.mNormals.data(), mNormalTexture->getDescriptor());
+        }
+        normalsUpdated.trigger(normals);
+    }
+
+
+    void RealSenseNormalsComponentInstance::onTrigger(const rs2::frameset& frameset)
+    {
+        auto depth = frameset.get_depth_frame();
+        if(!depth || depth.get_profile().format() != RS2_FORMAT_Z16)
+            return;
+
+        // rays only change with the stream profile
+        mImpl->mRays.update(depth.get_profile().as<rs2::video_stream_profile>());
+
+        // the integral images are only needed while estimating, allocate them from the arena of the frameset
+        auto* context = getFrameContext();
+        auto& result = mResults.getWriteBuffer();
+        mImpl->mEstimator.estimate(static_cast<const uint16*>(depth.get_data()), depth.get_stride_in_bytes(), depth.get_units(),
+                                   mImpl->mRays, mParameters, mPool, result.mNormals, context != nullptr ? &context->getArena() : nullptr);
+        result.mWidth = mImpl->mRays.getWidth();
+        result.mHeight = mImpl->mRays.getHeight();
+        result.mFrameNumber = depth.get_frame_number();
+        result.mTimestamp = depth.get_timestamp();
+        mResults.publish();
+    }
+}
@@ -0,0 +1,131 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include "realsenseframesetlistenercomponent.h"
+#include "realsensenormals.h"
+#include "realsensetriplebuffer.h"
+
+#include <cassert>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseNormalsComponentInstance;
+    class RealSenseWorkerPool;
+
+    /**
+     * Surface normals of a single depth frame
+     */
+    struct NAPAPI RealSenseNormalFrame
+    {
+        std::vector<glm::vec4> mNormals;        ///< Normal per pixel in camera space with w set to 1, zero for pixels without a normal, row major
+        int mWidth = 0;                         ///< Width of the depth frame
+        int mHeight = 0;                        ///< Height of the depth frame
+        uint64 mFrameNumber = 0;                ///< Frame number of the depth frame
+        double mTimestamp = 0.0;                ///< Timestamp of the depth frame in milliseconds
+    };
+
+    /**
+     * RealSenseNormalsComponent
+     * Estimates a surface normal for every pixel of the Z16 depth frames of a device, see RealSenseNormalEstimator.
+     * Normals are estimated on the capture thread, split over the worker pool of the RealSenseService, and handed to the
+     * main thread through a lock-free triple buffer. With 'CreateTexture' enabled the normals are uploaded to a RGBA32 texture
+     * on update, which the RealSenseRenderPointCloudComponent uses to shade the points.
+     */
+    class NAPAPI RealSenseNormalsComponent : public RealSenseFrameSetListenerComponent
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponent)
+    DECLARE_COMPONENT(RealSenseNormalsComponent, RealSenseNormalsComponentInstance)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseNormalsComponent();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseNormalsComponent();
+
+        // Properties
+        int mWindowRadius = 4;                  ///< Property: 'WindowRadius' half size of the window in pixels, does not affect performance
+        float mMaxDepthChange = 0.05f;          ///< Property: 'MaxDepthChange' maximum depth difference in meters within a window, larger differences are edges
+        bool mCreateTexture = false;            ///< Property: 'CreateTexture' upload the normals to a render texture
+    };
+
+    /**
+     * RealSenseNormalsComponentInstance
+     * Estimates normals on the capture thread and publishes them on update
+     */
+    class NAPAPI RealSenseNormalsComponentInstance : public RealSenseFrameSetListenerComponentInstance
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponentInstance)
+    public:
+        /**
+         * Constructor
+         * @param entity reference to entity instance
+         * @param resource reference to component
+         */
+        RealSenseNormalsComponentInstance(EntityInstance& entity, Component& resource);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseNormalsComponentInstance();
+
+        /**
+         * Picks up the latest normals, uploads the texture and triggers normalsUpdated when new normals are available
+         * @param deltaTime time since last update
+         */
+        void update(double deltaTime) override;
+
+        /**
+         * @return normals picked up by the last update, only call from the main thread
+         */
+        const RealSenseNormalFrame& getNormals() const  { return mResults.getReadBuffer(); }
+
+        /**
+         * @return if the normal texture is created and holds the latest normals
+         */
+        bool hasTexture() const                         { return mTextureInitialized; }
+
+        /**
+         * @return RGBA32 texture with the camera space normal of every pixel, only valid when hasTexture() returns true
+         */
+        RenderTexture2D& getNormalTexture()             { assert(mTextureInitialized); return *mNormalTexture; }
+
+        // Signal triggered from update on the main thread when new normals are available
+        Signal<const RealSenseNormalFrame&> normalsUpdated;
+
+    protected:
+        /**
+         * Internal init method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool onInit(utility::ErrorState& errorState) override;
+
+        /**
+         * Called upon receiving a new frameset, called from RealSense device
+         * @param frameset a new frameset
+         */
+        void onTrigger(const rs2::frameset& frameset);
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseNormalsComponent* mResource = nullptr;
+        RealSenseWorkerPool* mPool = nullptr;
+        RealSenseNormalEstimator::Parameters mParameters;
+        RealSenseTripleBuffer<RealSenseNormalFrame> mResults;
+
+        std::unique_ptr<RenderTexture2D> mNormalTexture;
+        bool mTextureInitialized = false;
+    };
+}
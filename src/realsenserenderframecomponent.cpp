@@ -1,13 +1,19 @@
 #include "realsenserenderframecomponent.h"
 #include "realsensedevice.h"
 #include "realsenseframefilter.h"
+#include "realsenseservice.h"
+#include "realsensemetrics.h"
+#include "realsensetrace.h"
+#include "realsenseframearena.h"
 
 #include <rs.hpp>
+#include <chrono>
 
 RTTI_BEGIN_CLASS(nap::RealSenseRenderFrameComponent)
     RTTI_PROPERTY("Format", &nap::RealSenseRenderFrameComponent::mFormat, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("StreamType", &nap::RealSenseRenderFrameComponent::mStreamType, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("Filters", &nap::RealSenseRenderFrameComponent::mFilters, nap::rtti::EPropertyMetaData::Embedded)
+    RTTI_PROPERTY("FrameBudget", &nap::RealSenseRenderFrameComponent::mFrameBudget, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseRenderFrameComponentInstance)
@@ -34,6 +40,26 @@ namespace nap
     public:
         // Frame queue
         rs2::frame_queue mFrameQueue;
+
+        // Metadata of the last enqueued frames, matched to the polled frame by frame number
+        static constexpr int sPendingInfoCount = 4;
+        RealSenseFrameInfo mPendingInfos[sPendingInfoCount];
+        int mNextPendingInfo = 0;
+        std::mutex mInfoMutex;
+
+        // Metrics of the frame hand-over and texture upload, frames are overwritten when the queue is full before the main thread polls
+        RealSenseMetric* mEnqueued = nullptr;
+        RealSenseMetric* mOverwritten = nullptr;
+        RealSenseMetric* mQueueDepth = nullptr;
+        RealSenseMetric* mUploaded = nullptr;
+        RealSenseMetric* mUploadBytes = nullptr;
+        RealSenseMetric* mUploadTime = nullptr;
+
+        // Metrics of the filter chain and its budget, the gauge is 1 while optional filters are skipped
+        RealSenseMetric* mFilterTime = nullptr;
+        RealSenseMetric* mDegrades = nullptr;
+        RealSenseMetric* mDegradedFrames = nullptr;
+        RealSenseMetric* mDegraded = nullptr;
     };
 
     //////////////////////////////////////////////////////////////////////////
@@ -53,8 +79,22 @@ namespace nap
     bool RealSenseRenderFrameComponentInstance::onInit(utility::ErrorState &errorState)
     {
         mImplementation = std::make_unique<Impl>();
-
         mResource = getComponent<RealSenseRenderFrameComponent>();
+
+        auto* service = getEntityInstance()->getCore()->getService<RealSenseService>();
+        auto& metrics = service->getMetrics();
+        mImplementation->mEnqueued = &metrics.getMetric(mResource->mID, "Frames enqueued", ERealSenseMetricType::Counter);
+        mImplementation->mOverwritten = &metrics.getMetric(mResource->mID, "Frames overwritten", ERealSenseMetricType::Counter);
+        mImplementation->mQueueDepth = &metrics.getMetric(mResource->mID, "Frame queue", ERealSenseMetricType::Gauge);
+        mImplementation->mUploaded = &metrics.getMetric(mResource->mID, "Frames uploaded", ERealSenseMetricType::Counter);
+        mImplementation->mUploadBytes = &metrics.getMetric(mResource->mID, "Upload bytes", ERealSenseMetricType::Counter);
+        mImplementation->mUploadTime = &metrics.getMetric(mResource->mID, "Upload", ERealSenseMetricType::Timer);
+        mImplementation->mFilterTime = &metrics.getMetric(mResource->mID, "Filter chain", ERealSenseMetricType::Timer);
+        mImplementation->mDegrades = &metrics.getMetric(mResource->mID, "Degrades", ERealSenseMetricType::Counter);
+        mImplementation->mDegradedFrames = &metrics.getMetric(mResource->mID, "Degraded frames", ERealSenseMetricType::Counter);
+        mImplementation->mDegraded = &metrics.getMetric(mResource->mID, "Degraded", ERealSenseMetricType::Gauge);
+        mImplementation->mDegraded->set(0);
+
         mFormat = mResource->mFormat;
         mStreamType = mResource->mStreamType;
 
@@ -69,6 +109,8 @@ namespace nap
         {
             mFilters.emplace_back(filter.get());
         }
+        mFilterBudget.configure(mResource->mID, mResource->mFrameBudget);
+        service->registerFilterBudget(mFilterBudget);
 
         frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
 
@@ -78,19 +120,35 @@ namespace nap
 
     void RealSenseRenderFrameComponentInstance::destroy()
     {
-
+        getEntityInstance()->getCore()->getService<RealSenseService>()->unregisterFilterBudget(mFilterBudget);
     }
 
 
     void RealSenseRenderFrameComponentInstance::update(double deltaTime)
     {
+        RealSenseTraceScope trace(mResource->mID.c_str(), "render");
         rs2::frame frame;
         if(mImplementation->mFrameQueue.poll_for_frame(&frame))
         {
             assert(frame.is<rs2::video_frame>());
+            mImplementation->mQueueDepth->set(static_cast<uint64>(mImplementation->mFrameQueue.size()));
 
             const auto &video_frame = frame.as<rs2::video_frame>();
 
+            // filters keep the frame number of the camera frame
+            {
+                auto frame_number = static_cast<uint64>(video_frame.get_frame_number());
+                std::lock_guard<std::mutex> lock(mImplementation->mInfoMutex);
+                for(const auto& info : mImplementation->mPendingInfos)
+                {
+                    if(info.mFrameNumber == frame_number && info.mStream == mStreamType)
+                    {
+                        mFrameInfo = info;
+                        break;
+                    }
+                }
+            }
+
             // Ensure dimensions are the same
             glm::vec2 tex_size = mRenderTexture->getSize();
 
@@ -110,7 +168,13 @@ namespace nap
             if(mTextureInitialized)
             {
                 // Update texture on GPU
+                RealSenseTraceScope upload_trace("Upload", "render");
+                auto start = std::chrono::steady_clock::now();
                 mRenderTexture->update(video_frame.get_data(), mRenderTexture->getDescriptor());
+                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+                mImplementation->mUploadTime->record(static_cast<uint64>(duration.count()));
+                mImplementation->mUploadBytes->add(static_cast<uint64>(video_frame.get_data_size()));
+                mImplementation->mUploaded->add();
             }
 
         }
@@ -124,11 +188,49 @@ namespace nap
             if(frame.get_profile().stream_type()==static_cast<rs2_stream>(mStreamType))
             {
                 rs2::frame process_frame = frame;
+                auto start = std::chrono::steady_clock::now();
+                bool degraded = mFilterBudget.isDegraded();
+                int skipped = 0;
                 for(auto* filter : mFilters)
                 {
-                    process_frame = filter->process(process_frame);
+                    if(degraded && filter->mOptional)
+                    {
+                        skipped++;
+                        continue;
+                    }
+                    process_frame = filter->process(process_frame, getFrameContext());
+                }
+
+                // enter or leave degraded mode based on the rolling execution time of the chain
+                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+                mImplementation->mFilterTime->record(static_cast<uint64>(duration.count()));
+                if(degraded)
+                    mImplementation->mDegradedFrames->add();
+                if(mFilterBudget.record(static_cast<uint64>(duration.count()), skipped))
+                {
+                    bool now_degraded = mFilterBudget.isDegraded();
+                    if(now_degraded)
+                        mImplementation->mDegrades->add();
+                    mImplementation->mDegraded->set(now_degraded ? 1 : 0);
+                    for(auto* filter : mFilters)
+                        filter->setDegraded(now_degraded);
+                }
+                const auto* context = getFrameContext();
+                const auto* info = context != nullptr ? context->getFrameInfo(mStreamType, frame.get_profile().stream_index()) : nullptr;
+                if(info != nullptr)
+                {
+                    std::lock_guard<std::mutex> lock(mImplementation->mInfoMutex);
+                    mImplementation->mPendingInfos[mImplementation->mNextPendingInfo] = *info;
+                    mImplementation->mNextPendingInfo = (mImplementation->mNextPendingInfo + 1) % Impl::sPendingInfoCount;
                 }
-                mImplementation->mFrameQueue.enqueue(process_frame);
+
+                // a full queue drops its oldest frame, the main thread can poll in between so the count is approximate
+                auto& queue = mImplementation->mFrameQueue;
+                if(queue.size() >= queue.capacity())
+                    mImplementation->mOverwritten->add();
+                queue.enqueue(process_frame);
+                mImplementation->mEnqueued->add();
+                mImplementation->mQueueDepth->set(static_cast<uint64>(queue.size()));
             }
         }
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "realsenseframesetlistenercomponent.h"
+#include "realsensefilterbudget.h"
 
 namespace nap
 {
@@ -33,6 +34,7 @@ namespace nap
         ERealSenseStreamType mStreamType = ERealSenseStreamType::REALSENSE_STREAMTYPE_COLOR; ///< Property: 'StreamType' stream type of the stream to render
         RenderTexture2D::EFormat mFormat = RenderTexture2D::EFormat::RGBA8; ///< Property: 'Format' the render texture format
         std::vector<ResourcePtr<RealSenseFrameFilter>> mFilters; ///< Property: 'Filter' the filters to apply to the frame before rendering
+        int mFrameBudget = 0; ///< Property: 'FrameBudget' time budget of the filter chain per frame in microseconds, optional filters are skipped when exceeded, 0 disables
     };
 
     /**
@@ -66,6 +68,19 @@ namespace nap
          */
         bool isRenderTextureInitialized() const{ return mTextureInitialized; }
 
+        /**
+         * Returns the frame budget of the filter chain, snapshots can be taken from any thread
+         * @return the frame budget of the filter chain
+         */
+        const RealSenseFilterBudget& getFilterBudget() const{ return mFilterBudget; }
+
+        /**
+         * Returns the metadata of the frame in the render texture, read on the capture thread when the frame was received.
+         * Only call from the main thread, the info is updated together with the render texture.
+         * @return the frame info, default when no frame was uploaded yet
+         */
+        const RealSenseFrameInfo& getFrameInfo() const{ return mFrameInfo; }
+
     protected:
         /**
          * Internal init method
@@ -101,5 +116,7 @@ namespace nap
         std::unique_ptr<Impl> mImplementation;
 
         std::vector<RealSenseFrameFilter*> mFilters;
+        RealSenseFilterBudget mFilterBudget;
+        RealSenseFrameInfo mFrameInfo;
     };
 }
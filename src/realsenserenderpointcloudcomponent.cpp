@@ -13,6 +13,8 @@ RTTI_BEGIN_CLASS(nap::RealSenseRenderPointCloudComponent)
     RTTI_PROPERTY("PointSize", &nap::RealSenseRenderPointCloudComponent::mPointSize, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("DepthRenderer", &nap::RealSenseRenderPointCloudComponent::mDepthRenderer, nap::rtti::EPropertyMetaData::Required)
     RTTI_PROPERTY("ColorRenderer", &nap::RealSenseRenderPointCloudComponent::mColorRenderer, nap::rtti::EPropertyMetaData::Required)
+    RTTI_PROPERTY("Floor", &nap::RealSenseRenderPointCloudComponent::mFloor, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Normals", &nap::RealSenseRenderPointCloudComponent::mNormals, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseRenderPointCloudComponentInstance)
@@ -82,12 +84,24 @@ namespace nap
         auto* color_sampler = material_instance.getOrCreateSampler<Sampler2DInstance>("color_texture");
         color_sampler->setTexture(mColorRenderer->getRenderTexture());
 
-        // obtain camera intrinsics from depth camera
-        const auto& camera_intrinsics = mDevice->getIntrincicsMap();
-        const auto& intrinsics = camera_intrinsics.find(ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH)->second;
+        // assign normals, the sampler is bound to the depth texture when there are no normals to shade with
+        bool shade = mNormals.get() != nullptr && mNormals->hasTexture();
+        auto* normal_sampler = material_instance.getOrCreateSampler<Sampler2DInstance>("normal_texture");
+        normal_sampler->setTexture(shade ? mNormals->getNormalTexture() : mDepthRenderer->getRenderTexture());
 
-        // obtain depth scale
+        // obtain camera intrinsics from depth camera, these follow any crop or decimation filter on the device
+        const auto camera_intrinsics = mDevice->getIntrincicsMap();
+        auto intrinsics_it = camera_intrinsics.find(ERealSenseStreamType::REALSENSE_STREAMTYPE_DEPTH);
+        mReady = intrinsics_it != camera_intrinsics.end();
+        if(!mReady)
+            return;
+        const auto& intrinsics = intrinsics_it->second;
+
+        // obtain depth scale, unknown until the device streams
         float depth_scale = mDevice->getDepthScale();
+        mReady = depth_scale > 0.0f;
+        if(!mReady)
+            return;
 
         // obtain camera intrinsics UBO from point cloud shader, assign properties
         auto* ubo = material_instance.getOrCreateUniform("cam_intrinsics");
@@ -108,5 +122,13 @@ namespace nap
         ubo = material_instance.getOrCreateUniform("UBO");
         ubo->getOrCreateUniform<UniformFloatInstance>("realsense_depth_scale")->setValue(depth_scale);
         ubo->getOrCreateUniform<UniformFloatInstance>("point_size")->setValue(mPointSize);
+
+        // camera to floor transform when a floor is available, otherwise only flip the y axis up
+        glm::mat4 camera_transform(1.0f);
+        camera_transform[1][1] = -1.0f;
+        if(mFloor.get() != nullptr && mFloor->isValid())
+            camera_transform = mFloor->getCameraTransform();
+        ubo->getOrCreateUniform<UniformMat4Instance>("camera_transform")->setValue(camera_transform);
+        ubo->getOrCreateUniform<UniformFloatInstance>("normal_shading")->setValue(shade ? 1.0f : 0.0f);
     }
 }
@@ -6,6 +6,8 @@
 
 #include "realsenserenderframecomponent.h"
 #include "realsenseframesetlistenercomponent.h"
+#include "realsensefloorcomponent.h"
+#include "realsensenormalscomponent.h"
 #include "pointcloudmesh.h"
 
 namespace nap
@@ -20,6 +22,9 @@ namespace nap
     /**
      * RealSenseRenderPointCloudComponent
      * RenderableMesh component that renders a pointcloud
+     * Points are rendered with the y axis pointing up. When a floor component is set the points are rendered in floor space instead:
+     * y along the floor normal, the floor at y = 0 and the camera above the origin, looking along -z.
+     * When a normals component with 'CreateTexture' enabled is set the points are shaded with the estimated normals.
      */
     class NAPAPI RealSenseRenderPointCloudComponent : public RenderableMeshComponent
     {
@@ -40,6 +45,8 @@ namespace nap
         ResourcePtr<RealSenseDevice> mDevice; ///< Property: 'Device' the device of which to extract the pointcloud
         ComponentPtr<RealSenseRenderFrameComponent> mDepthRenderer; ///< Property: 'DepthRenderer' the render frame component that renders the depth frame into a texture
         ComponentPtr<RealSenseRenderFrameComponent> mColorRenderer; ///< Property: 'ColorRenderer' the render frame component that renders the color frame into a texture
+        ComponentPtr<RealSenseFloorComponent> mFloor; ///< Property: 'Floor' optional floor component, renders the pointcloud in floor space
+        ComponentPtr<RealSenseNormalsComponent> mNormals; ///< Property: 'Normals' optional normals component, shades the pointcloud with its normal texture
         float mPointSize = 1.0f; ///< Property: 'PointSize' size of the point cloud points
     };
 
@@ -84,6 +91,8 @@ namespace nap
     private:
         ComponentInstancePtr<RealSenseRenderFrameComponent> mDepthRenderer = { this, &RealSenseRenderPointCloudComponent::mDepthRenderer };
         ComponentInstancePtr<RealSenseRenderFrameComponent> mColorRenderer = { this, &RealSenseRenderPointCloudComponent::mColorRenderer };
+        ComponentInstancePtr<RealSenseFloorComponent> mFloor = { this, &RealSenseRenderPointCloudComponent::mFloor };
+        ComponentInstancePtr<RealSenseNormalsComponent> mNormals = { this, &RealSenseRenderPointCloudComponent::mNormals };
         RealSenseDevice* mDevice;
         float mPointSize;
         bool mReady = false;
@@ -4,11 +4,23 @@
 
 // Local Includes
 #include "realsensedevice.h"
+#include "realsenseframefilter.h"
+#include "realsenseframesetfilter.h"
+#include "realsenseworkerpool.h"
+#include "realsensedevicegroup.h"
+#include "realsensedepthplayer.h"
+#include "realsensestreamreceiver.h"
+#include "realsensemetrics.h"
+#include "realsensemetricsgui.h"
+#include "realsensetrace.h"
 
 // External Includes
 #include <nap/core.h>
 #include <nap/logger.h>
+#include <nap/resourcemanager.h>
 #include <iostream>
+#include <fstream>
+#include <chrono>
 #include <utility/stringutils.h>
 
 // Local Includes
@@ -16,6 +28,14 @@
 
 // RealSense includes
 #include <rs.hpp>
+#include <hpp/rs_internal.hpp>
+
+RTTI_BEGIN_CLASS(nap::RealSenseServiceConfiguration)
+    RTTI_PROPERTY("WorkerThreads", &nap::RealSenseServiceConfiguration::mWorkerThreads, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Trace", &nap::RealSenseServiceConfiguration::mTrace, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("TraceBufferSize", &nap::RealSenseServiceConfiguration::mTraceBufferSize, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("TracePath", &nap::RealSenseServiceConfiguration::mTracePath, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseService)
 RTTI_CONSTRUCTOR(nap::ServiceConfiguration*)
@@ -23,51 +43,407 @@ RTTI_END_CLASS
 
 namespace nap
 {
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Interval in between reconnect attempts of disconnected devices
+     */
+    static constexpr std::chrono::milliseconds sReconnectInterval(2000);
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseService::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseService::Impl
+    {
+    public:
+        /**
+         * Connected device, the device handle is required to resolve removed devices in the device change callback
+         */
+        struct Entry
+        {
+            std::string mSerial;
+            rs2::device mDevice;
+        };
+
+        // Context shared by all devices
+        rs2::context mContext;
+
+        // Connected devices reported by the context, guarded by mSerialMutex of the service
+        std::vector<Entry> mEntries;
+
+        // Serial numbers of software devices added to the context
+        std::vector<std::string> mSoftwareSerials;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseServiceConfiguration
+    //////////////////////////////////////////////////////////////////////////
+
+    rtti::TypeInfo RealSenseServiceConfiguration::getServiceType() const
+    {
+        return RTTI_OF(RealSenseService);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     // RealSenseService
     //////////////////////////////////////////////////////////////////////////
 
 	RealSenseService::RealSenseService(ServiceConfiguration* configuration) :
-		Service(configuration)
+		Service(configuration), mMetrics(std::make_unique<RealSenseMetricsRegistry>())
 	{ }
 
 
-	RealSenseService::~RealSenseService() = default;
+	RealSenseService::~RealSenseService()
+    {
+        shutdown();
+    }
 
 
 	void RealSenseService::registerObjectCreators(rtti::Factory& factory)
 	{
         factory.addObjectCreator(std::make_unique<RealSenseDeviceObjectCreator>(*this));
+        factory.addObjectCreator(std::make_unique<RealSenseFrameSetAlignFilterObjectCreator>(*this));
+        factory.addObjectCreator(std::make_unique<RealSenseDeviceGroupObjectCreator>(*this));
+        factory.addObjectCreator(std::make_unique<RealSenseDepthPlayerObjectCreator>(*this));
+        factory.addObjectCreator(std::make_unique<RealSenseStreamReceiverObjectCreator>(*this));
+        factory.addObjectCreator(std::make_unique<RealSenseBackgroundSubtractFilterObjectCreator>(*this));
+        factory.addObjectCreator(std::make_unique<RealSenseMetricsGUIObjectCreator>(*this));
 	}
 
 
 	bool RealSenseService::init(nap::utility::ErrorState& errorState)
 	{
-        rs2::context ctx;
-        auto list = ctx.query_devices(); // Get a snapshot of currently connected devices
+        auto* configuration = getConfiguration<RealSenseServiceConfiguration>();
+        int worker_threads = configuration != nullptr ? configuration->mWorkerThreads : 0;
+        if(!errorState.check(worker_threads >= 0, "WorkerThreads must be 0 or higher"))
+            return false;
+
+        // configure tracing before the worker threads record their first event
+        if(configuration != nullptr && configuration->mTrace)
+        {
+            if(!errorState.check(configuration->mTraceBufferSize > 0, "TraceBufferSize must be higher than 0"))
+                return false;
+
+            RealSenseTrace::setBufferSize(configuration->mTraceBufferSize);
+            RealSenseTrace::setThreadName("Main");
+            RealSenseTrace::setEnabled(true);
+        }
+
+        mWorkerPool = std::make_unique<RealSenseWorkerPool>(worker_threads);
+        nap::Logger::info("RealSense worker pool uses %i worker threads.", mWorkerPool->getThreadCount());
 
-        nap::Logger::info("There are %d connected RealSense devices.", list.size());
-        for(size_t i = 0 ; i < list.size(); i++)
+        mImpl = std::make_unique<Impl>();
+        try
         {
-            rs2::device device = list[i];
+            auto list = mImpl->mContext.query_devices(); // Get a snapshot of currently connected devices
+
+            nap::Logger::info("There are %d connected RealSense devices.", list.size());
+            std::vector<std::string> serial_numbers;
+            for(size_t i = 0 ; i < list.size(); i++)
+            {
+                rs2::device device = list[i];
+
+                nap::Logger::info("RealSense device %i, an %s", i,  device.get_info(RS2_CAMERA_INFO_NAME));
+                nap::Logger::info("    Serial number: %s", device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER));
+                nap::Logger::info("    Firmware version: %s", device.get_info(RS2_CAMERA_INFO_FIRMWARE_VERSION));
+
+                serial_numbers.emplace_back(std::string(device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER)));
+                mImpl->mEntries.push_back({ serial_numbers.back(), device });
+            }
+            mConnectedSerialNumbers = serial_numbers;
+
+            // keep the registry up to date when devices are plugged in or unplugged
+            mImpl->mContext.set_devices_changed_callback([this](rs2::event_information& info)
+            {
+                std::vector<std::string> removed;
+                std::vector<std::string> added;
+                {
+                    std::lock_guard<std::mutex> lock(mSerialMutex);
+                    for(auto it = mImpl->mEntries.begin(); it != mImpl->mEntries.end();)
+                    {
+                        if(info.was_removed(it->mDevice))
+                        {
+                            removed.emplace_back(it->mSerial);
+                            it = mImpl->mEntries.erase(it);
+                            continue;
+                        }
+                        ++it;
+                    }
 
-            nap::Logger::info("RealSense device %i, an %s", i,  device.get_info(RS2_CAMERA_INFO_NAME));
-            nap::Logger::info("    Serial number: %s", device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER));
-            nap::Logger::info("    Firmware version: %s", device.get_info(RS2_CAMERA_INFO_FIRMWARE_VERSION));
+                    auto new_devices = info.get_new_devices();
+                    for(size_t i = 0; i < new_devices.size(); i++)
+                    {
+                        rs2::device device = new_devices[i];
+                        if(!device.supports(RS2_CAMERA_INFO_SERIAL_NUMBER))
+                            continue;
 
-            mConnectedSerialNumbers.emplace_back(std::string(device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER)));
+                        added.emplace_back(std::string(device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER)));
+                        mImpl->mEntries.push_back({ added.back(), device });
+                    }
+                }
+                onDevicesChanged(removed, added);
+            });
+        }
+        catch(const std::exception& e)
+        {
+            errorState.fail(e.what());
+            return false;
         }
 
+        mStopReconnect = false;
+        mReconnectThread = std::thread([this] { reconnect(); });
+
 		return true;
 	}
 
 
+    void RealSenseService::shutdown()
+    {
+        if(!mReconnectThread.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mReconnectMutex);
+            mStopReconnect = true;
+        }
+        mReconnectCondition.notify_one();
+        mReconnectThread.join();
+
+        auto* configuration = getConfiguration<RealSenseServiceConfiguration>();
+        if(configuration != nullptr && configuration->mTrace && !configuration->mTracePath.empty())
+        {
+            RealSenseTrace::setEnabled(false);
+            utility::ErrorState error_state;
+            if(!writeTrace(configuration->mTracePath, error_state))
+                nap::Logger::error("RealSenseService: %s", error_state.toString().c_str());
+        }
+    }
+
+
     bool RealSenseService::hasSerialNumber(const std::string& serialNumber) const
     {
+        std::lock_guard<std::mutex> lock(mSerialMutex);
         auto it = std::find_if(mConnectedSerialNumbers.begin(), mConnectedSerialNumbers.end(), [this, serialNumber](const std::string& other)
         {
             return other == serialNumber;
         });
         return it != mConnectedSerialNumbers.end();
     }
+
+
+    std::vector<std::string> RealSenseService::getConnectedSerialNumbers() const
+    {
+        std::lock_guard<std::mutex> lock(mSerialMutex);
+        return mConnectedSerialNumbers;
+    }
+
+
+    void RealSenseService::addSoftwareDevice(rs2::software_device& device)
+    {
+        std::string serial = device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER);
+        bool added;
+        {
+            std::lock_guard<std::mutex> lock(mSerialMutex);
+            added = std::find(mImpl->mSoftwareSerials.begin(), mImpl->mSoftwareSerials.end(), serial) != mImpl->mSoftwareSerials.end();
+            if(!added)
+                mImpl->mSoftwareSerials.emplace_back(serial);
+        }
+
+        // adding the device to the context can invoke the device change callback on this thread, don't hold the lock
+        if(!added)
+            device.add_to(mImpl->mContext);
+        onDevicesChanged({}, { serial });
+    }
+
+
+    void RealSenseService::removeSoftwareDevice(rs2::software_device& device)
+    {
+        onDevicesChanged({ std::string(device.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER)) }, {});
+    }
+
+
+    void RealSenseService::registerDevice(RealSenseDevice& device)
+    {
+        std::lock_guard<std::mutex> lock(mDevicesMutex);
+        if(std::find(mDevices.begin(), mDevices.end(), &device) == mDevices.end())
+            mDevices.emplace_back(&device);
+    }
+
+
+    void RealSenseService::unregisterDevice(RealSenseDevice& device)
+    {
+        std::lock_guard<std::mutex> lock(mDevicesMutex);
+        auto it = std::find(mDevices.begin(), mDevices.end(), &device);
+        if(it != mDevices.end())
+            mDevices.erase(it);
+    }
+
+
+    rs2::context& RealSenseService::getContext()
+    {
+        assert(mImpl != nullptr);
+        return mImpl->mContext;
+    }
+
+
+    void RealSenseService::onDevicesChanged(const std::vector<std::string>& removed, const std::vector<std::string>& added)
+    {
+        bool changed = false;
+        {
+            std::lock_guard<std::mutex> lock(mSerialMutex);
+            for(const auto& serial : removed)
+            {
+                auto it = std::find(mConnectedSerialNumbers.begin(), mConnectedSerialNumbers.end(), serial);
+                if(it == mConnectedSerialNumbers.end())
+                    continue;
+
+                mConnectedSerialNumbers.erase(it);
+                nap::Logger::info("RealSense device disconnected, serial number: %s", serial.c_str());
+                changed = true;
+            }
+
+            for(const auto& serial : added)
+            {
+                if(std::find(mConnectedSerialNumbers.begin(), mConnectedSerialNumbers.end(), serial) != mConnectedSerialNumbers.end())
+                    continue;
+
+                mConnectedSerialNumbers.emplace_back(serial);
+                nap::Logger::info("RealSense device connected, serial number: %s", serial.c_str());
+                changed = true;
+            }
+        }
+
+        if(!changed)
+            return;
+
+        mDeviceChangeCount++;
+        {
+            std::lock_guard<std::mutex> lock(mReconnectMutex);
+            mReconnectPending = true;
+        }
+        mReconnectCondition.notify_one();
+    }
+
+
+    void RealSenseService::reconnect()
+    {
+        std::unique_lock<std::mutex> lock(mReconnectMutex);
+        while(!mStopReconnect)
+        {
+            // wake up on device changes, retry disconnected devices periodically
+            mReconnectCondition.wait_for(lock, sReconnectInterval, [this] { return mStopReconnect || mReconnectPending; });
+            if(mStopReconnect)
+                break;
+
+            mReconnectPending = false;
+            lock.unlock();
+            {
+                // reconnect only schedules the open task of the device, the registry is never locked while a camera opens
+                std::lock_guard<std::mutex> devices_lock(mDevicesMutex);
+                for(auto* device : mDevices)
+                {
+                    switch(device->getState())
+                    {
+                    case ERealSenseDeviceState::Streaming:
+                    {
+                        if(!hasSerialNumber(device->getActiveSerial()))
+                            device->disconnect();
+                        break;
+                    }
+                    case ERealSenseDeviceState::Disconnected:
+                    {
+                        bool available = device->mSerial.empty() ? !getConnectedSerialNumbers().empty() : hasSerialNumber(device->mSerial);
+                        if(available)
+                            device->reconnect();
+                        break;
+                    }
+                    default:
+                        break;
+                    }
+                }
+            }
+            lock.lock();
+        }
+    }
+
+
+    std::string RealSenseService::getFilterStatisticsJSON()
+    {
+        std::vector<std::string> entries;
+        auto* resource_manager = getCore().getResourceManager();
+        for(const auto& filter : resource_manager->getObjects<RealSenseFrameFilter>())
+            entries.emplace_back(filter->getStatistics().getSnapshot().toJSON(filter->mID));
+
+        for(const auto& filter : resource_manager->getObjects<RealSenseFrameSetFilter>())
+            entries.emplace_back(filter->getStatistics().getSnapshot().toJSON(filter->mID));
+
+        std::string json = "[\n";
+        for(size_t i = 0; i < entries.size(); i++)
+        {
+            json += "    " + entries[i];
+            json += i + 1 < entries.size() ? ",\n" : "\n";
+        }
+        json += "]\n";
+        return json;
+    }
+
+
+    bool RealSenseService::writeFilterStatistics(const std::string& path, utility::ErrorState& errorState)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if(!errorState.check(file.is_open(), "Unable to open %s for writing", path.c_str()))
+            return false;
+
+        file << getFilterStatisticsJSON();
+        return true;
+    }
+
+
+    std::string RealSenseService::getFilterBudgetJSON()
+    {
+        std::vector<std::string> entries;
+        for(const auto& device : getCore().getResourceManager()->getObjects<RealSenseDevice>())
+            entries.emplace_back(device->getFilterBudget().getSnapshot().toJSON(device->mID));
+
+        {
+            std::lock_guard<std::mutex> lock(mFilterBudgetMutex);
+            for(const auto* budget : mFilterBudgets)
+                entries.emplace_back(budget->getSnapshot().toJSON(budget->getName()));
+        }
+
+        std::string json = "[\n";
+        for(size_t i = 0; i < entries.size(); i++)
+        {
+            json += "    " + entries[i];
+            json += i + 1 < entries.size() ? ",\n" : "\n";
+        }
+        json += "]\n";
+        return json;
+    }
+
+
+    void RealSenseService::registerFilterBudget(const RealSenseFilterBudget& budget)
+    {
+        std::lock_guard<std::mutex> lock(mFilterBudgetMutex);
+        if(std::find(mFilterBudgets.begin(), mFilterBudgets.end(), &budget) == mFilterBudgets.end())
+            mFilterBudgets.emplace_back(&budget);
+    }
+
+
+    void RealSenseService::unregisterFilterBudget(const RealSenseFilterBudget& budget)
+    {
+        std::lock_guard<std::mutex> lock(mFilterBudgetMutex);
+        auto it = std::find(mFilterBudgets.begin(), mFilterBudgets.end(), &budget);
+        if(it != mFilterBudgets.end())
+            mFilterBudgets.erase(it);
+    }
+
+
+    bool RealSenseService::writeTrace(const std::string& path, utility::ErrorState& errorState)
+    {
+        return RealSenseTrace::write(path, errorState);
+    }
 }
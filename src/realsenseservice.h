@@ -7,13 +7,54 @@
 // External Includes
 #include <nap/service.h>
 #include <rtti/factory.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+
+// rs2 forward declares
+namespace rs2
+{
+    class context;
+    class software_device;
+}
 
 namespace nap
 {
 	//////////////////////////////////////////////////////////////////////////
     // forward declares
     class RealSenseDevice;
+    class RealSenseWorkerPool;
+    class RealSenseMetricsRegistry;
+    class RealSenseFilterBudget;
+    class RealSenseService;
+
+    /**
+     * RealSenseServiceConfiguration
+     * Configuration of the RealSenseService
+     */
+    class NAPAPI RealSenseServiceConfiguration : public ServiceConfiguration
+    {
+        RTTI_ENABLE(ServiceConfiguration)
+    public:
+        /**
+         * @return RealSenseService type info
+         */
+        virtual rtti::TypeInfo getServiceType() const override;
 
+        int mWorkerThreads = 0; ///< Property: 'WorkerThreads' amount of worker threads used by filters and components, 0 uses one thread less than the amount of hardware threads
+        bool mTrace = false;    ///< Property: 'Trace' record a timeline of the capture, filter, listener and upload work of all threads, see RealSenseTrace
+        int mTraceBufferSize = 16384; ///< Property: 'TraceBufferSize' maximum amount of recorded events per thread, older events are overwritten
+        std::string mTracePath; ///< Property: 'TracePath' Chrome trace JSON file the timeline is written to on shutdown, empty to only write on demand
+    };
+
+    /**
+     * RealSenseService
+     * Keeps a live registry of connected RealSense devices, updated from librealsense device change callbacks.
+     * A RealSenseDevice that is unplugged, or that failed to start while 'AllowFailure' is enabled,
+     * is restarted on a background thread as soon as a matching device is connected.
+     */
 	class NAPAPI RealSenseService : public Service
 	{
         friend class RealSenseDevice;
@@ -44,6 +85,11 @@ namespace nap
 		 */
 		virtual bool init(nap::utility::ErrorState& errorState) override;
 
+        /**
+         * Stops the reconnect thread
+         */
+        virtual void shutdown() override;
+
         /**
          * Returns true if a device with given serial number is registered
          * @param serialNumber the serial number to check
@@ -52,11 +98,134 @@ namespace nap
         bool hasSerialNumber(const std::string& serialNumber) const;
 
         /**
-         * Returns const reference to vector of all serial number of connected realsense devices
-         * @return const reference to vector of all serial number of connected realsense devices
+         * Returns the serial numbers of all connected realsense devices, can be called from any thread
+         * @return copy of the serial numbers of all connected realsense devices
+         */
+        std::vector<std::string> getConnectedSerialNumbers() const;
+
+        /**
+         * Adds a software device to the context of the service, the device is registered as a connected device.
+         * The software device must have a serial number registered (RS2_CAMERA_INFO_SERIAL_NUMBER).
+         * Used to simulate hot-plugging without hardware.
+         * @param device the software device to add
+         */
+        void addSoftwareDevice(rs2::software_device& device);
+
+        /**
+         * Unregisters a software device previously added with addSoftwareDevice, devices streaming from it are disconnected.
+         * librealsense cannot remove software devices from a context, the device is only removed from the registry.
+         * Calling addSoftwareDevice again registers the device again.
+         * @param device the software device to remove
          */
-        const std::vector<std::string>& getConnectedSerialNumbers() const{ return mConnectedSerialNumbers; }
+        void removeSoftwareDevice(rs2::software_device& device);
+
+        /**
+         * @return amount of device connect and disconnect events received since init
+         */
+        int getDeviceChangeCount() const { return mDeviceChangeCount.load(); }
+
+        /**
+         * Serializes the execution statistics of all loaded frame and frameset filters into a JSON array
+         * @return JSON array of filter statistics
+         */
+        std::string getFilterStatisticsJSON();
+
+        /**
+         * Writes the execution statistics of all loaded frame and frameset filters to a JSON file
+         * @param path path to the file to write
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool writeFilterStatistics(const std::string& path, utility::ErrorState& errorState);
+
+        /**
+         * Serializes the frame budget counters of the filter chains of all loaded devices and registered components into a JSON array.
+         * The counters show how often and how long a chain skipped optional filters to stay within its budget.
+         * @return JSON array of filter budget counters
+         */
+        std::string getFilterBudgetJSON();
+
+        /**
+         * Registers the frame budget of a filter chain that is not owned by a device, such as the chain of a component.
+         * Registered budgets are included in getFilterBudgetJSON until they are unregistered.
+         * @param budget the budget to register, must stay valid until unregistered
+         */
+        void registerFilterBudget(const RealSenseFilterBudget& budget);
+
+        /**
+         * Unregisters a frame budget previously registered with registerFilterBudget
+         * @param budget the budget to unregister
+         */
+        void unregisterFilterBudget(const RealSenseFilterBudget& budget);
+
+        /**
+         * Writes the timeline recorded by RealSenseTrace to a Chrome trace JSON file.
+         * Open the file in chrome://tracing or ui.perfetto.dev. Tracing is enabled with the 'Trace' property of the configuration.
+         * @param path path to the file to write
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool writeTrace(const std::string& path, utility::ErrorState& errorState);
+
+        /**
+         * Returns the worker pool used to split per-frame work of filters and components over multiple threads
+         * @return the worker pool, valid after init
+         */
+        RealSenseWorkerPool& getWorkerPool() { return *mWorkerPool; }
+
+        /**
+         * Returns the registry of frame rates, drops, queue depths, timings and throughput of all devices and components.
+         * Metrics are updated lock-free from the capture and worker threads, see RealSenseMetricsGUI to display them.
+         * @return the metrics registry, valid for the lifetime of the service
+         */
+        RealSenseMetricsRegistry& getMetrics() { return *mMetrics; }
 	private:
-        std::vector<std::string> mConnectedSerialNumbers;
+        /**
+         * Registers a started device, the device is reconnected when it is disconnected or failed to start
+         */
+        void registerDevice(RealSenseDevice& device);
+
+        /**
+         * Unregisters a device, the device is not reconnected anymore.
+         * Does not wait for a reconnect in progress, devices open on their own task.
+         */
+        void unregisterDevice(RealSenseDevice& device);
+
+        /**
+         * @return the librealsense context shared by all devices
+         */
+        rs2::context& getContext();
+
+        /**
+         * Updates the registry, called from the librealsense device change callback and for software devices
+         */
+        void onDevicesChanged(const std::vector<std::string>& removed, const std::vector<std::string>& added);
+
+        /**
+         * Reconnect thread function, disconnects devices that were unplugged and reconnects devices that became available
+         */
+        void reconnect();
+
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        std::vector<std::string> mConnectedSerialNumbers;   ///< Guarded by mSerialMutex
+        mutable std::mutex mSerialMutex;
+        std::atomic<int> mDeviceChangeCount = { 0 };
+
+        std::vector<RealSenseDevice*> mDevices;             ///< Guarded by mDevicesMutex
+        std::mutex mDevicesMutex;
+
+        std::thread mReconnectThread;
+        std::mutex mReconnectMutex;
+        std::condition_variable mReconnectCondition;
+        bool mReconnectPending = false;
+        bool mStopReconnect = false;
+
+        std::vector<const RealSenseFilterBudget*> mFilterBudgets;   ///< Guarded by mFilterBudgetMutex
+        std::mutex mFilterBudgetMutex;
+
+        std::unique_ptr<RealSenseWorkerPool> mWorkerPool;
+        std::unique_ptr<RealSenseMetricsRegistry> mMetrics;
 	};
 }
@@ -0,0 +1,262 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+/**
+ * Shared memory layout of the RealSenseSharedMemoryExporter and a header-only reader.
+ * This header only depends on the standard library and POSIX, consumers in other processes include it without NAP or librealsense.
+ *
+ * Every exported stream is a separate POSIX shared memory segment named "/<name>.<stream>", for example "/naprealsense.depth".
+ * A segment starts with a SharedMemoryRingHeader followed by 'SlotCount' slots of 'SlotSize' bytes.
+ * Every slot starts with a SharedMemorySlotHeader, the pixel data follows the header.
+ * Slots are guarded by a sequence lock: the writer makes the sequence odd while writing and even when done.
+ * The writer never waits for readers, a reader validates the sequence after consuming the pixels in place.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nap
+{
+    namespace realsense
+    {
+        constexpr uint32_t sharedMemoryMagic = 0x4d535352;   ///< 'RSSM'
+        constexpr uint32_t sharedMemoryVersion = 1;           ///< Bumped on every layout change
+        constexpr uint32_t sharedMemoryAlignment = 64;        ///< Alignment of the slots and pixel data
+
+        /**
+         * Header at the start of a shared memory segment
+         */
+        struct SharedMemoryRingHeader
+        {
+            uint32_t mMagic;                        ///< sharedMemoryMagic when the segment is initialized
+            uint32_t mVersion;                      ///< sharedMemoryVersion of the writer
+            uint32_t mSlotCount;                    ///< Amount of slots in the ring
+            uint32_t mSlotSize;                     ///< Size of a slot in bytes, including the slot header
+            uint64_t mSlotOffset;                   ///< Offset of the first slot from the start of the segment
+            std::atomic<uint64_t> mWriteCount;      ///< Amount of slots written, the latest slot is (mWriteCount - 1) % mSlotCount
+            std::atomic<uint32_t> mClosed;          ///< Set by the writer before the segment is unlinked, readers should reopen the segment
+        };
+
+        /**
+         * Header at the start of every slot
+         */
+        struct alignas(64) SharedMemorySlotHeader
+        {
+            std::atomic<uint64_t> mSequence;        ///< Odd while the writer is writing the slot
+            uint64_t mFrameNumber;                  ///< Frame number assigned by librealsense
+            double mTimestamp;                      ///< Frame timestamp in milliseconds
+            int32_t mStreamType;                    ///< ERealSenseStreamType / rs2_stream
+            int32_t mFormat;                        ///< ERealSenseStreamFormat / rs2_format
+            int32_t mWidth;                         ///< Width in pixels
+            int32_t mHeight;                        ///< Height in pixels
+            int32_t mStride;                        ///< Bytes per row
+            int32_t mBytesPerPixel;                 ///< Bytes per pixel
+            uint32_t mDataSize;                     ///< Size of the pixel data in bytes
+            float mDepthScale;                      ///< Meters per depth unit, 0 for other streams
+            float mPPX;                             ///< Horizontal principal point in pixels
+            float mPPY;                             ///< Vertical principal point in pixels
+            float mFX;                              ///< Horizontal focal length in pixels
+            float mFY;                              ///< Vertical focal length in pixels
+            int32_t mModel;                         ///< ERealSenseDistortionModels / rs2_distortion
+            float mCoeffs[5];                       ///< Distortion coefficients
+        };
+
+        /**
+         * @return shared memory segment name of a stream, stream is the lower case librealsense stream name
+         */
+        inline std::string getSharedMemoryName(const std::string& name, const std::string& stream)
+        {
+            return "/" + name + "." + stream;
+        }
+
+        /**
+         * @return size of a slot holding dataSize bytes of pixel data
+         */
+        inline uint32_t getSharedMemorySlotSize(uint32_t dataSize)
+        {
+            uint32_t size = static_cast<uint32_t>(sizeof(SharedMemorySlotHeader)) + dataSize;
+            return (size + sharedMemoryAlignment - 1) / sharedMemoryAlignment * sharedMemoryAlignment;
+        }
+
+#ifndef _WIN32
+        /**
+         * SharedMemoryReader
+         * Maps a segment of a RealSenseSharedMemoryExporter read-only and gives access to the latest frame without copying.
+         * Usage: call read(), consume the pixels in place, then call isValid() to check the writer did not overwrite the slot meanwhile.
+         * Slots are overwritten after 'SlotCount' frames, consume or copy a frame within that window.
+         */
+        class SharedMemoryReader final
+        {
+        public:
+            /**
+             * A frame in shared memory
+             */
+            struct Frame
+            {
+                const SharedMemorySlotHeader* mHeader = nullptr;   ///< Slot header, fields are only stable while the frame is valid
+                const uint8_t* mData = nullptr;                     ///< Pixel data
+                uint64_t mSequence = 0;                             ///< Sequence of the slot when the frame was read
+            };
+
+            SharedMemoryReader() = default;
+            SharedMemoryReader(const SharedMemoryReader&) = delete;
+            SharedMemoryReader& operator=(const SharedMemoryReader&) = delete;
+
+            /**
+             * Unmaps the segment
+             */
+            ~SharedMemoryReader()                   { close(); }
+
+            /**
+             * Opens and maps a segment, fails when the exporter did not create the segment yet
+             * @param segment name of the segment, see getSharedMemoryName()
+             * @return true on success
+             */
+            bool open(const std::string& segment)
+            {
+                close();
+                int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+                if(fd < 0)
+                    return false;
+
+                struct stat info;
+                if(fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SharedMemoryRingHeader))
+                {
+                    ::close(fd);
+                    return false;
+                }
+
+                void* memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if(memory == MAP_FAILED)
+                    return false;
+
+                mMemory = static_cast<const uint8_t*>(memory);
+                mSize = info.st_size;
+                mSegment = segment;
+                const auto* header = getHeader();
+                if(header->mMagic != sharedMemoryMagic || header->mVersion != sharedMemoryVersion ||
+                   header->mSlotCount == 0 || header->mSlotSize < sizeof(SharedMemorySlotHeader) ||
+                   header->mSlotOffset + static_cast<uint64_t>(header->mSlotCount) * header->mSlotSize > mSize)
+                {
+                    close();
+                    return false;
+                }
+                return true;
+            }
+
+            /**
+             * Unmaps the segment
+             */
+            void close()
+            {
+                if(mMemory != nullptr)
+                    munmap(const_cast<uint8_t*>(mMemory), mSize);
+                mMemory = nullptr;
+                mSize = 0;
+            }
+
+            /**
+             * @return if a segment is mapped
+             */
+            bool isOpen() const                     { return mMemory != nullptr; }
+
+            /**
+             * @return true if the writer closed the segment, reopen to continue reading, for example after a resolution change
+             */
+            bool isClosed() const                   { return mMemory == nullptr || getHeader()->mClosed.load(std::memory_order_acquire) != 0; }
+
+            /**
+             * Closes and reopens the segment
+             * @return true on success
+             */
+            bool reopen()                           { std::string segment = mSegment; return open(segment); }
+
+            /**
+             * Returns the latest frame, never blocks
+             * @param frame receives the frame
+             * @return false when no frame was written yet or the writer is currently writing the latest slot
+             */
+            bool read(Frame& frame) const
+            {
+                if(mMemory == nullptr)
+                    return false;
+
+                const auto* header = getHeader();
+                uint64_t count = header->mWriteCount.load(std::memory_order_acquire);
+                if(count == 0)
+                    return false;
+
+                const uint8_t* slot = mMemory + header->mSlotOffset + ((count - 1) % header->mSlotCount) * header->mSlotSize;
+                frame.mHeader = reinterpret_cast<const SharedMemorySlotHeader*>(slot);
+                frame.mData = slot + sizeof(SharedMemorySlotHeader);
+                frame.mSequence = frame.mHeader->mSequence.load(std::memory_order_acquire);
+                return (frame.mSequence & 1) == 0 && frame.mSequence != 0;
+            }
+
+            /**
+             * @return true if the slot of the frame was not overwritten since read(), call after consuming the frame
+             */
+            bool isValid(const Frame& frame) const
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return frame.mHeader != nullptr && frame.mHeader->mSequence.load(std::memory_order_relaxed) == frame.mSequence;
+            }
+
+            /**
+             * Copies the latest frame, retries when the slot is overwritten while copying.
+             * The copy is clamped to the slot payload, the sequence is checked again after copying.
+             * @param header receives the slot header
+             * @param data receives the pixel data, must hold at least capacity bytes
+             * @param capacity size of data in bytes
+             * @return false when no consistent frame could be copied, the frame is larger than its slot or capacity is too small
+             */
+            bool copy(SharedMemorySlotHeader& header, uint8_t* data, size_t capacity) const
+            {
+                for(int attempt = 0; attempt < 4; attempt++)
+                {
+                    Frame frame;
+                    if(!read(frame))
+                        continue;
+
+                    // the header can be torn when the writer overwrites the slot, never copy beyond the slot payload
+                    std::memcpy(static_cast<void*>(&header), frame.mHeader, sizeof(SharedMemorySlotHeader));
+                    size_t payload = getHeader()->mSlotSize - sizeof(SharedMemorySlotHeader);
+                    size_t size = std::min(static_cast<size_t>(header.mDataSize), payload);
+                    if(size > capacity)
+                    {
+                        if(isValid(frame))
+                            return false;
+                        continue;
+                    }
+
+                    std::memcpy(data, frame.mData, size);
+                    if(isValid(frame))
+                        return header.mDataSize <= payload;
+                }
+                return false;
+            }
+
+        private:
+            const SharedMemoryRingHeader* getHeader() const { return reinterpret_cast<const SharedMemoryRingHeader*>(mMemory); }
+
+            const uint8_t* mMemory = nullptr;
+            size_t mSize = 0;
+            std::string mSegment;
+        };
+#endif
+    }
+}
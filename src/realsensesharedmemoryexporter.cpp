@@ -0,0 +1,250 @@
+#include "realsensesharedmemoryexporter.h"
+#include "realsensesharedmemory.h"
+#include "realsensedevice.h"
+
+#include <rs.hpp>
+#include <nap/logger.h>
+#include <algorithm>
+#include <cctype>
+
+RTTI_BEGIN_CLASS(nap::RealSenseSharedMemoryExporter)
+    RTTI_PROPERTY("Name", &nap::RealSenseSharedMemoryExporter::mName, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Streams", &nap::RealSenseSharedMemoryExporter::mStreams, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("SlotCount", &nap::RealSenseSharedMemoryExporter::mSlotCount, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseSharedMemoryExporterInstance)
+    RTTI_CONSTRUCTOR(nap::EntityInstance&, nap::Component&)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseSharedMemoryExporter
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseSharedMemoryExporter::RealSenseSharedMemoryExporter() = default;
+
+
+    RealSenseSharedMemoryExporter::~RealSenseSharedMemoryExporter() = default;
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseSharedMemoryExporterInstance::Segment
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Shared memory ring buffer of a single stream
+     */
+    struct RealSenseSharedMemoryExporterInstance::Segment
+    {
+    public:
+        ~Segment()                                  { close(); }
+
+#ifndef _WIN32
+        /**
+         * Creates and maps the segment with slots of the given data size
+         */
+        bool create(uint32 dataSize, int slotCount, utility::ErrorState& errorState)
+        {
+            close();
+
+            // remove a stale segment of a previous run
+            shm_unlink(mName.c_str());
+            int fd = shm_open(mName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            if(!errorState.check(fd >= 0, "Unable to create shared memory segment %s", mName.c_str()))
+                return false;
+
+            uint32 slot_size = realsense::getSharedMemorySlotSize(dataSize);
+            size_t slot_offset = (sizeof(realsense::SharedMemoryRingHeader) + realsense::sharedMemoryAlignment - 1) /
+                                 realsense::sharedMemoryAlignment * realsense::sharedMemoryAlignment;
+            size_t size = slot_offset + static_cast<size_t>(slot_size) * slotCount;
+            if(!errorState.check(ftruncate(fd, size) == 0, "Unable to resize shared memory segment %s", mName.c_str()))
+            {
+                ::close(fd);
+                shm_unlink(mName.c_str());
+                return false;
+            }
+
+            void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(!errorState.check(memory != MAP_FAILED, "Unable to map shared memory segment %s", mName.c_str()))
+            {
+                shm_unlink(mName.c_str());
+                return false;
+            }
+
+            // ftruncate zero fills, only the ring header needs to be set, the magic is written last
+            mMemory = static_cast<uint8*>(memory);
+            mSize = size;
+            mDataSize = dataSize;
+            auto* header = getHeader();
+            header->mVersion = realsense::sharedMemoryVersion;
+            header->mSlotCount = static_cast<uint32>(slotCount);
+            header->mSlotSize = slot_size;
+            header->mSlotOffset = slot_offset;
+            std::atomic_thread_fence(std::memory_order_release);
+            header->mMagic = realsense::sharedMemoryMagic;
+            return true;
+        }
+
+
+        /**
+         * Marks the segment closed for readers, unmaps and unlinks it
+         */
+        void close()
+        {
+            if(mMemory == nullptr)
+                return;
+
+            getHeader()->mClosed.store(1, std::memory_order_release);
+            munmap(mMemory, mSize);
+            shm_unlink(mName.c_str());
+            mMemory = nullptr;
+            mSize = 0;
+        }
+
+
+        /**
+         * Writes a frame into the next slot, never blocks
+         */
+        void write(const rs2::video_frame& frame, float depthScale)
+        {
+            auto* header = getHeader();
+            uint64 count = header->mWriteCount.load(std::memory_order_relaxed);
+            uint8* slot = mMemory + header->mSlotOffset + (count % header->mSlotCount) * header->mSlotSize;
+            auto* slot_header = reinterpret_cast<realsense::SharedMemorySlotHeader*>(slot);
+
+            // odd sequence, readers of this slot discard what they read
+            uint64 sequence = slot_header->mSequence.load(std::memory_order_relaxed);
+            slot_header->mSequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            auto profile = frame.get_profile().as<rs2::video_stream_profile>();
+            if(profile.unique_id() != mProfileID)
+            {
+                mIntrinsics = profile.get_intrinsics();
+                mProfileID = profile.unique_id();
+            }
+
+            slot_header->mFrameNumber = frame.get_frame_number();
+            slot_header->mTimestamp = frame.get_timestamp();
+            slot_header->mStreamType = profile.stream_type();
+            slot_header->mFormat = profile.format();
+            slot_header->mWidth = frame.get_width();
+            slot_header->mHeight = frame.get_height();
+            slot_header->mStride = frame.get_stride_in_bytes();
+            slot_header->mBytesPerPixel = frame.get_bytes_per_pixel();
+            slot_header->mDataSize = static_cast<uint32>(frame.get_data_size());
+            slot_header->mDepthScale = profile.stream_type() == RS2_STREAM_DEPTH ? depthScale : 0.0f;
+            slot_header->mPPX = mIntrinsics.ppx;
+            slot_header->mPPY = mIntrinsics.ppy;
+            slot_header->mFX = mIntrinsics.fx;
+            slot_header->mFY = mIntrinsics.fy;
+            slot_header->mModel = mIntrinsics.model;
+            std::memcpy(slot_header->mCoeffs, mIntrinsics.coeffs, sizeof(slot_header->mCoeffs));
+            std::memcpy(slot + sizeof(realsense::SharedMemorySlotHeader), frame.get_data(), frame.get_data_size());
+
+            // even sequence, publish the slot
+            slot_header->mSequence.store(sequence + 2, std::memory_order_release);
+            header->mWriteCount.store(count + 1, std::memory_order_release);
+        }
+#else
+        bool create(uint32 dataSize, int slotCount, utility::ErrorState& errorState)
+        {
+            errorState.fail("Shared memory export is not supported on this platform");
+            return false;
+        }
+
+        void close()                                { }
+        void write(const rs2::video_frame& frame, float depthScale) { }
+#endif
+
+        realsense::SharedMemoryRingHeader* getHeader() { return reinterpret_cast<realsense::SharedMemoryRingHeader*>(mMemory); }
+
+        ERealSenseStreamType mStream;
+        std::string mName;
+        uint8* mMemory = nullptr;
+        size_t mSize = 0;
+        uint32 mDataSize = 0;
+        bool mFailed = false;
+        int mProfileID = -1;
+        rs2_intrinsics mIntrinsics = {};
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseSharedMemoryExporterInstance
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseSharedMemoryExporterInstance::RealSenseSharedMemoryExporterInstance(EntityInstance& entity, Component& resource) :
+        RealSenseFrameSetListenerComponentInstance(entity, resource)
+    {}
+
+
+    RealSenseSharedMemoryExporterInstance::~RealSenseSharedMemoryExporterInstance() = default;
+
+
+    bool RealSenseSharedMemoryExporterInstance::onInit(utility::ErrorState& errorState)
+    {
+#ifdef _WIN32
+        errorState.fail("%s: shared memory export is not supported on this platform", getComponent()->mID.c_str());
+        return false;
+#else
+        mResource = getComponent<RealSenseSharedMemoryExporter>();
+        if(!errorState.check(mResource->mSlotCount > 0, "%s: slot count must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        for(auto stream : mResource->mStreams)
+        {
+            std::string stream_name = rs2_stream_to_string(static_cast<rs2_stream>(stream));
+            std::transform(stream_name.begin(), stream_name.end(), stream_name.begin(), ::tolower);
+
+            auto segment = std::make_unique<Segment>();
+            segment->mStream = stream;
+            segment->mName = realsense::getSharedMemoryName(mResource->mName, stream_name);
+            mSegments.emplace_back(std::move(segment));
+        }
+
+        frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
+        return true;
+#endif
+    }
+
+
+    void RealSenseSharedMemoryExporterInstance::destroy()
+    {
+        mSegments.clear();
+    }
+
+
+    void RealSenseSharedMemoryExporterInstance::onTrigger(const rs2::frameset& frameset)
+    {
+        for(auto& segment : mSegments)
+        {
+            if(segment->mFailed)
+                continue;
+
+            auto frame = frameset.first_or_default(static_cast<rs2_stream>(segment->mStream));
+            if(!frame || !frame.is<rs2::video_frame>())
+                continue;
+
+            // (re)create the segment when the frame does not fit
+            auto video_frame = frame.as<rs2::video_frame>();
+            auto data_size = static_cast<uint32>(video_frame.get_data_size());
+            if(segment->mMemory == nullptr || data_size != segment->mDataSize)
+            {
+                utility::ErrorState error_state;
+                if(!segment->create(data_size, mResource->mSlotCount, error_state))
+                {
+                    nap::Logger::error("%s: %s", mResource->mID.c_str(), error_state.toString().c_str());
+                    segment->mFailed = true;
+                    continue;
+                }
+                nap::Logger::info("%s: exporting %dx%d frames to %s", mResource->mID.c_str(),
+                                  video_frame.get_width(), video_frame.get_height(), segment->mName.c_str());
+            }
+
+            segment->write(video_frame, mDevice->getDepthScale());
+            mExportedFrames++;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include "realsenseframesetlistenercomponent.h"
+
+#include <atomic>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseSharedMemoryExporterInstance;
+
+    /**
+     * RealSenseSharedMemoryExporter
+     * Publishes the frames of selected streams into POSIX shared memory ring buffers, so processes on the same machine read frames without sockets.
+     * Every stream gets its own segment named "/<Name>.<stream>", for example "/naprealsense.depth".
+     * The segment of a stream is created on the first frame and recreated when the frame size changes.
+     * Frames are written from the capture thread of the device, the writer never waits for readers.
+     * Include realsensesharedmemory.h in the consuming process to read the frames without copying.
+     * Not supported on Windows, init fails.
+     */
+    class NAPAPI RealSenseSharedMemoryExporter : public RealSenseFrameSetListenerComponent
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponent)
+    DECLARE_COMPONENT(RealSenseSharedMemoryExporter, RealSenseSharedMemoryExporterInstance)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseSharedMemoryExporter();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseSharedMemoryExporter();
+
+        // Properties
+        std::string mName = "naprealsense";             ///< Property: 'Name' prefix of the shared memory segment names
+        std::vector<ERealSenseStreamType> mStreams;     ///< Property: 'Streams' the streams to export
+        int mSlotCount = 4;                             ///< Property: 'SlotCount' amount of frames in the ring buffer of a stream
+    };
+
+    /**
+     * RealSenseSharedMemoryExporterInstance writes every received frame of the exported streams into its shared memory ring buffer
+     */
+    class NAPAPI RealSenseSharedMemoryExporterInstance : public RealSenseFrameSetListenerComponentInstance
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponentInstance)
+    public:
+        /**
+         * Constructor
+         * @param entity reference to entity instance
+         * @param resource reference to component
+         */
+        RealSenseSharedMemoryExporterInstance(EntityInstance& entity, Component& resource);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseSharedMemoryExporterInstance();
+
+        /**
+         * @return amount of frames written to shared memory, can be called from any thread
+         */
+        uint64 getExportedFrameCount() const                { return mExportedFrames.load(); }
+
+    protected:
+        /**
+         * Internal init method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool onInit(utility::ErrorState& errorState) override;
+
+        /**
+         * Unlinks all segments
+         */
+        void destroy() override;
+
+        /**
+         * Called upon receiving a new frameset, called from RealSense device
+         * @param frameset a new frameset
+         */
+        void onTrigger(const rs2::frameset& frameset);
+
+    private:
+        struct Segment;
+        std::vector<std::unique_ptr<Segment>> mSegments;
+        RealSenseSharedMemoryExporter* mResource = nullptr;
+        std::atomic<uint64> mExportedFrames = { 0 };
+    };
+}
@@ -0,0 +1,126 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensesoftwareframepool.h"
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Stored in front of the data of every buffer
+     */
+    struct BufferHeader
+    {
+        std::shared_ptr<void> mOwner;   ///< Pool state while the buffer is in flight, empty while the buffer is free
+        size_t mSize = 0;               ///< Capacity of the buffer in bytes
+    };
+
+    static constexpr size_t sHeaderSize = 64;
+    static_assert(sizeof(BufferHeader) <= sHeaderSize, "buffer header does not fit");
+
+
+    static BufferHeader* getHeader(void* data)
+    {
+        return reinterpret_cast<BufferHeader*>(static_cast<uint8*>(data) - sHeaderSize);
+    }
+
+
+    static void* createBuffer(size_t size)
+    {
+        auto* block = new uint8[sHeaderSize + size];
+        auto* header = new (block) BufferHeader();
+        header->mSize = size;
+        return block + sHeaderSize;
+    }
+
+
+    static void destroyBuffer(void* data)
+    {
+        auto* header = getHeader(data);
+        header->~BufferHeader();
+        delete[] reinterpret_cast<uint8*>(header);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseSoftwareFramePool
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseSoftwareFramePool::State
+    {
+        ~State()
+        {
+            for(auto* data : mFree)
+                destroyBuffer(data);
+        }
+
+        std::mutex mMutex;
+        std::vector<void*> mFree;       ///< Released buffers, guarded by mMutex
+        size_t mMaxFree = 0;
+        bool mOpen = true;              ///< False once the pool is destroyed, guarded by mMutex
+    };
+
+
+    RealSenseSoftwareFramePool::RealSenseSoftwareFramePool(int maxFree) : mState(std::make_shared<State>())
+    {
+        mState->mMaxFree = static_cast<size_t>(maxFree > 0 ? maxFree : 0);
+    }
+
+
+    RealSenseSoftwareFramePool::~RealSenseSoftwareFramePool()
+    {
+        std::lock_guard<std::mutex> lock(mState->mMutex);
+        for(auto* data : mState->mFree)
+            destroyBuffer(data);
+        mState->mFree.clear();
+        mState->mOpen = false;
+    }
+
+
+    void* RealSenseSoftwareFramePool::acquire(size_t size)
+    {
+        void* data = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mState->mMutex);
+            while(data == nullptr && !mState->mFree.empty())
+            {
+                data = mState->mFree.back();
+                mState->mFree.pop_back();
+                if(getHeader(data)->mSize < size)
+                {
+                    destroyBuffer(data);
+                    data = nullptr;
+                }
+            }
+        }
+
+        if(data == nullptr)
+            data = createBuffer(size);
+        getHeader(data)->mOwner = mState;
+        return data;
+    }
+
+
+    void RealSenseSoftwareFramePool::release(void* data)
+    {
+        if(data == nullptr)
+            return;
+
+        // released after the lock, destroys the state when the pool is already gone
+        std::shared_ptr<void> owner;
+        owner.swap(getHeader(data)->mOwner);
+        auto* state = static_cast<State*>(owner.get());
+        std::lock_guard<std::mutex> lock(state->mMutex);
+        if(state->mOpen && state->mFree.size() < state->mMaxFree)
+            state->mFree.emplace_back(data);
+        else
+            destroyBuffer(data);
+    }
+}
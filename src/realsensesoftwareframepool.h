@@ -0,0 +1,55 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <cstddef>
+#include <memory>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseSoftwareFramePool
+     * Recycles the pixel buffers of frames submitted to a rs2::software_sensor.
+     * Pass release as deleter of the software frame, librealsense calls it when the frame is released and the buffer returns to its pool.
+     * Buffers that are too small for the requested size are freed, so the pool adapts when the resolution changes.
+     * Buffers in flight keep the pool state alive, the pool can be destroyed before librealsense releases its frames.
+     * Acquire and release can be called from any thread.
+     */
+    class NAPAPI RealSenseSoftwareFramePool final
+    {
+    public:
+        /**
+         * Constructor
+         * @param maxFree maximum amount of released buffers kept for reuse
+         */
+        RealSenseSoftwareFramePool(int maxFree = 16);
+
+        /**
+         * Destructor, frees all released buffers, buffers in flight are freed when released
+         */
+        ~RealSenseSoftwareFramePool();
+
+        /**
+         * Returns a buffer of at least size bytes, aligned to 16 bytes
+         * @param size size in bytes
+         * @return the buffer, return it with release
+         */
+        void* acquire(size_t size);
+
+        /**
+         * Returns a buffer to the pool it was acquired from, matches the deleter signature of a rs2 software frame
+         * @param data buffer returned by acquire
+         */
+        static void release(void* data);
+
+    private:
+        struct State;
+        std::shared_ptr<State> mState;
+    };
+}
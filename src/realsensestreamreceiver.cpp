@@ -0,0 +1,356 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensestreamreceiver.h"
+#include "realsensedepthfile.h"
+#include "realsenseservice.h"
+#include "realsensesoftwareframepool.h"
+
+#include <rs.hpp>
+#include <hpp/rs_internal.hpp>
+#include <nap/logger.h>
+#include <utility/stringutils.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseStreamReceiver)
+    RTTI_CONSTRUCTOR(nap::RealSenseService&)
+    RTTI_PROPERTY("Protocol", &nap::RealSenseStreamReceiver::mProtocol, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Port", &nap::RealSenseStreamReceiver::mPort, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Serial", &nap::RealSenseStreamReceiver::mSerial, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Streams", &nap::RealSenseStreamReceiver::mStreams, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static functions
+    //////////////////////////////////////////////////////////////////////////
+
+    static constexpr uint32 sMaxMessageSize = 64 * 1024 * 1024;
+
+    /**
+     * @return name of the software sensor that delivers the stream, streams of the same sensor are synchronized by librealsense
+     */
+    static std::string getSensorName(int stream)
+    {
+        switch(stream)
+        {
+        case RS2_STREAM_DEPTH:
+        case RS2_STREAM_INFRARED:
+            return "Stereo Module";
+        case RS2_STREAM_COLOR:
+            return "RGB Camera";
+        default:
+            return utility::stringFormat("%s Sensor", rs2_stream_to_string(static_cast<rs2_stream>(stream)));
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseStreamReceiver::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseStreamReceiver::Impl
+    {
+    public:
+        struct Stream
+        {
+            RealSenseNetworkFrameHeader mHeader;    ///< Header of the first frame, defines the stream profile
+            bool mReceived = false;
+            rs2::software_sensor* mSensor = nullptr;
+            rs2::stream_profile mProfile;
+        };
+
+        // Recycles the pixel buffers of submitted frames
+        RealSenseSoftwareFramePool mFramePool;
+
+        // Software camera, created once the first frame of every stream was received
+        std::unique_ptr<rs2::software_device> mDevice;
+        std::vector<std::pair<std::string, std::unique_ptr<rs2::software_sensor>>> mSensors;
+        std::vector<Stream> mStreams;
+
+        // Only used by the receive thread
+        RealSenseSocket mSocket;
+        RealSenseSocket mClient;
+        RealSenseFrameAssembler mAssembler;
+        RealSenseDepthFileFrame mEncoded;
+        std::vector<uint8> mMessage;
+        std::vector<uint8> mDatagram;
+        std::chrono::steady_clock::time_point mFirstFrame;
+        double mLatencySum = 0.0;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseStreamReceiver
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseStreamReceiver::RealSenseStreamReceiver(RealSenseService& service) : mService(service)
+    { }
+
+
+    RealSenseStreamReceiver::~RealSenseStreamReceiver() = default;
+
+
+    bool RealSenseStreamReceiver::init(utility::ErrorState& errorState)
+    {
+        if(!errorState.check(!mStreams.empty(), "%s: no streams", mID.c_str()))
+            return false;
+
+        if(!errorState.check(!mSerial.empty(), "%s: no serial number", mID.c_str()))
+            return false;
+
+        mImpl = std::make_unique<Impl>();
+        mImpl->mStreams.resize(mStreams.size());
+        return true;
+    }
+
+
+    bool RealSenseStreamReceiver::start(utility::ErrorState& errorState)
+    {
+        if(!mImpl->mSocket.bind(mProtocol, mPort, errorState))
+            return false;
+
+        mImpl->mAssembler.reset();
+        {
+            std::lock_guard<std::mutex> lock(mStatisticsMutex);
+            mStatistics = Statistics();
+            mImpl->mLatencySum = 0.0;
+        }
+
+        mRun.store(true);
+        mReceiveThread = std::thread([this]{ receive(); });
+        return true;
+    }
+
+
+    void RealSenseStreamReceiver::stop()
+    {
+        mRun.store(false);
+        if(mReceiveThread.joinable())
+            mReceiveThread.join();
+
+        mImpl->mClient.close();
+        mImpl->mSocket.close();
+        if(mConnected.load())
+        {
+            mService.removeSoftwareDevice(*mImpl->mDevice);
+            mConnected.store(false);
+        }
+    }
+
+
+    RealSenseStreamReceiver::Statistics RealSenseStreamReceiver::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mStatisticsMutex);
+        return mStatistics;
+    }
+
+
+    void RealSenseStreamReceiver::receive()
+    {
+        auto& socket = mImpl->mSocket;
+        auto& client = mImpl->mClient;
+        auto& message = mImpl->mMessage;
+        auto& datagram = mImpl->mDatagram;
+        datagram.resize(65536);
+        uint64 assembler_drops = 0;
+        while(mRun.load())
+        {
+            if(mProtocol == ERealSenseNetworkProtocol::UDP)
+            {
+                int size = socket.receive(datagram.data(), datagram.size(), 100);
+                if(size <= 0 || !mImpl->mAssembler.add(datagram.data(), static_cast<size_t>(size), message))
+                {
+                    // incomplete frames dropped by the assembler
+                    if(mImpl->mAssembler.getDroppedCount() != assembler_drops)
+                    {
+                        std::lock_guard<std::mutex> lock(mStatisticsMutex);
+                        mStatistics.mDroppedFrames += mImpl->mAssembler.getDroppedCount() - assembler_drops;
+                        assembler_drops = mImpl->mAssembler.getDroppedCount();
+                    }
+                    continue;
+                }
+                onMessage(message);
+                continue;
+            }
+
+            // wait for the sender to connect
+            if(!client.isOpen())
+            {
+                if(socket.accept(client, 100))
+                    nap::Logger::info("%s: sender connected", mID.c_str());
+                continue;
+            }
+
+            uint32 size = 0;
+            int received = client.receiveAll(&size, sizeof(size), 100);
+            if(received == 0)
+                continue;
+
+            bool valid = received > 0 && size > 0 && size <= sMaxMessageSize;
+            if(valid)
+            {
+                message.resize(size);
+                valid = client.receiveAll(message.data(), size, 1000) == static_cast<int>(size);
+            }
+
+            if(!valid)
+            {
+                nap::Logger::warn("%s: sender disconnected", mID.c_str());
+                client.close();
+                continue;
+            }
+            onMessage(message);
+        }
+    }
+
+
+    void RealSenseStreamReceiver::onMessage(const std::vector<uint8>& message)
+    {
+        auto drop = [this]()
+        {
+            std::lock_guard<std::mutex> lock(mStatisticsMutex);
+            mStatistics.mDroppedFrames++;
+        };
+
+        RealSenseNetworkFrameHeader header;
+        RealSenseNetworkFrameHeader expected;
+        if(message.size() < sizeof(header))
+            return drop();
+
+        std::memcpy(&header, message.data(), sizeof(header));
+        size_t band_bytes = static_cast<size_t>(header.mBandCount) * sizeof(uint32);
+        if(header.mMagic != expected.mMagic || header.mVersion != expected.mVersion || message.size() != sizeof(header) + band_bytes + header.mPayloadSize)
+            return drop();
+
+        // the header is not authenticated, a frame must fit the largest message before a stream is announced or a frame is allocated
+        if(header.mWidth <= 0 || header.mHeight <= 0 || header.mBytesPerPixel < 1 || header.mBytesPerPixel > 4 ||
+           static_cast<uint64>(header.mWidth) * static_cast<uint64>(header.mHeight) * static_cast<uint64>(header.mBytesPerPixel) > sMaxMessageSize)
+            return drop();
+
+        // statistics
+        {
+            double latency = static_cast<double>(realsense::getNetworkTime() - header.mSendTime) / 1000.0;
+            std::lock_guard<std::mutex> lock(mStatisticsMutex);
+            auto now = std::chrono::steady_clock::now();
+            if(mStatistics.mFrames == 0)
+                mImpl->mFirstFrame = now;
+            mStatistics.mFrames++;
+            mStatistics.mBytes += message.size();
+            mStatistics.mSeconds = std::chrono::duration<double>(now - mImpl->mFirstFrame).count();
+            mImpl->mLatencySum += latency;
+            mStatistics.mAverageLatency = mImpl->mLatencySum / mStatistics.mFrames;
+            mStatistics.mMaxLatency = std::max(mStatistics.mMaxLatency, latency);
+        }
+
+        auto it = std::find(mStreams.begin(), mStreams.end(), static_cast<ERealSenseStreamType>(header.mStreamType));
+        if(it == mStreams.end())
+            return drop();
+        auto& stream = mImpl->mStreams[it - mStreams.begin()];
+
+        // collect the stream profiles until a frame of every stream was received, then create the software device
+        if(mImpl->mDevice == nullptr)
+        {
+            if(!stream.mReceived)
+            {
+                stream.mHeader = header;
+                stream.mReceived = true;
+            }
+
+            if(std::any_of(mImpl->mStreams.begin(), mImpl->mStreams.end(), [](const Impl::Stream& s) { return !s.mReceived; }))
+                return;
+
+            try
+            {
+                auto device = std::make_unique<rs2::software_device>();
+                for(auto& entry : mImpl->mStreams)
+                {
+                    const auto& profile = entry.mHeader;
+                    std::string sensor_name = getSensorName(profile.mStreamType);
+                    auto sensor = std::find_if(mImpl->mSensors.begin(), mImpl->mSensors.end(), [&sensor_name](const auto& s) { return s.first == sensor_name; });
+                    if(sensor == mImpl->mSensors.end())
+                    {
+                        mImpl->mSensors.emplace_back(sensor_name, std::make_unique<rs2::software_sensor>(device->add_sensor(sensor_name)));
+                        sensor = mImpl->mSensors.end() - 1;
+                    }
+                    entry.mSensor = sensor->second.get();
+
+                    rs2_intrinsics intrinsics = {};
+                    intrinsics.width = profile.mWidth;
+                    intrinsics.height = profile.mHeight;
+                    intrinsics.ppx = profile.mPPX;
+                    intrinsics.ppy = profile.mPPY;
+                    intrinsics.fx = profile.mFX;
+                    intrinsics.fy = profile.mFY;
+                    intrinsics.model = static_cast<rs2_distortion>(profile.mModel);
+                    std::copy(std::begin(profile.mCoeffs), std::end(profile.mCoeffs), std::begin(intrinsics.coeffs));
+
+                    int uid = static_cast<int>(&entry - mImpl->mStreams.data());
+                    entry.mProfile = entry.mSensor->add_video_stream({ static_cast<rs2_stream>(profile.mStreamType), 0, uid,
+                                                                       profile.mWidth, profile.mHeight, profile.mFps > 0 ? profile.mFps : 30,
+                                                                       profile.mBytesPerPixel, static_cast<rs2_format>(profile.mFormat), intrinsics }, true);
+
+                    // the depth units option makes the software sensor a depth sensor
+                    if(profile.mStreamType == RS2_STREAM_DEPTH)
+                        entry.mSensor->add_read_only_option(RS2_OPTION_DEPTH_UNITS, profile.mDepthScale);
+                }
+                device->register_info(RS2_CAMERA_INFO_NAME, "Network Stream");
+                device->register_info(RS2_CAMERA_INFO_SERIAL_NUMBER, mSerial);
+                device->create_matcher(RS2_MATCHER_DEFAULT);
+                mImpl->mDevice = std::move(device);
+            }
+            catch(const std::exception& e)
+            {
+                nap::Logger::error("%s: unable to create software device: %s", mID.c_str(), e.what());
+                mRun.store(false);
+                return;
+            }
+        }
+
+        if(!mConnected.load())
+        {
+            mService.addSoftwareDevice(*mImpl->mDevice);
+            mConnected.store(true);
+            nap::Logger::info("%s: receiving streams as device %s", mID.c_str(), mSerial.c_str());
+        }
+
+        // profiles are fixed once the software device exists
+        const auto& profile = stream.mHeader;
+        if(header.mWidth != profile.mWidth || header.mHeight != profile.mHeight || header.mFormat != profile.mFormat ||
+           header.mBytesPerPixel != profile.mBytesPerPixel)
+            return drop();
+
+        // decode into a pooled buffer, librealsense returns it to the pool when the frame is released
+        size_t size = static_cast<size_t>(header.mWidth) * header.mHeight * header.mBytesPerPixel;
+        const uint8* payload = message.data() + sizeof(header) + band_bytes;
+        auto* pixels = static_cast<uint8*>(mImpl->mFramePool.acquire(size));
+        bool valid = false;
+        if(header.mCodec == ERealSenseNetworkCodec::Raw)
+        {
+            valid = header.mPayloadSize == size;
+            if(valid)
+                std::memcpy(pixels, payload, size);
+        }
+        else if(header.mCodec == ERealSenseNetworkCodec::RVL && header.mBytesPerPixel == static_cast<int>(sizeof(uint16)))
+        {
+            auto& encoded = mImpl->mEncoded;
+            encoded.mBandSizes.resize(header.mBandCount);
+            std::memcpy(encoded.mBandSizes.data(), message.data() + sizeof(header), band_bytes);
+            encoded.mData.assign(payload, payload + header.mPayloadSize);
+            valid = encoded.decode(reinterpret_cast<uint16*>(pixels), header.mWidth, header.mHeight, &mService.getWorkerPool());
+        }
+
+        if(!valid)
+        {
+            RealSenseSoftwareFramePool::release(pixels);
+            return drop();
+        }
+
+        stream.mSensor->on_video_frame({ pixels, &RealSenseSoftwareFramePool::release,
+                                         header.mWidth * header.mBytesPerPixel, header.mBytesPerPixel,
+                                         header.mTimestamp, RS2_TIMESTAMP_DOMAIN_SYSTEM_TIME, static_cast<int>(header.mFrameNumber),
+                                         stream.mProfile.get(), header.mDepthScale });
+    }
+}
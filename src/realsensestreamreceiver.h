@@ -0,0 +1,125 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/device.h>
+#include <rtti/factory.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// Local includes
+#include "realsensetypes.h"
+#include "realsensenetwork.h"
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseService;
+
+    /**
+     * RealSenseStreamReceiver
+     * Receives the frames of a RealSenseStreamSender and injects them into the module as a software camera.
+     * Once a frame of every stream in 'Streams' has been received, the receiver adds a software device with serial number 'Serial'
+     * to the RealSenseService. A RealSenseDevice with the same 'Serial' and 'AllowFailure' enabled connects to it,
+     * the frames then pass the same filters and listeners as frames of a physical camera.
+     * The stream profiles are fixed by the first frames, frames of which the resolution or format changes afterwards are dropped.
+     * Latency is measured with the wall clock time of the sender, only meaningful over loopback or between synchronized clocks.
+     * Not supported on Windows, start fails.
+     */
+    class NAPAPI RealSenseStreamReceiver final : public Device
+    {
+    RTTI_ENABLE(Device)
+    public:
+        /**
+         * Receiver statistics
+         */
+        struct NAPAPI Statistics
+        {
+            uint64 mFrames = 0;             ///< Amount of frames received
+            uint64 mDroppedFrames = 0;      ///< Amount of frames lost, incomplete, corrupt or not matching the stream profile
+            uint64 mBytes = 0;              ///< Amount of message bytes received
+            double mSeconds = 0.0;          ///< Time since the first frame in seconds
+            double mAverageLatency = 0.0;   ///< Average time between sending and receiving a frame in milliseconds
+            double mMaxLatency = 0.0;       ///< Largest time between sending and receiving a frame in milliseconds
+
+            /**
+             * @return received throughput in Mbit/s
+             */
+            double getThroughput() const    { return mSeconds <= 0.0 ? 0.0 : mBytes * 8.0 / mSeconds / 1000000.0; }
+        };
+
+        /**
+         * Constructor
+         * @param service reference to the RealSenseService
+         */
+        RealSenseStreamReceiver(RealSenseService& service);
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseStreamReceiver();
+
+        /**
+         * Initialization method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool init(utility::ErrorState& errorState) override;
+
+        /**
+         * Opens the socket and starts receiving frames
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool start(utility::ErrorState& errorState) override;
+
+        /**
+         * Stops receiving frames, closes the socket and removes the software device from the service
+         */
+        void stop() override;
+
+        /**
+         * @return if the software device was added to the service
+         */
+        bool isConnected() const                    { return mConnected.load(); }
+
+        /**
+         * @return copy of the receiver statistics, can be called from any thread
+         */
+        Statistics getStatistics() const;
+
+        ERealSenseNetworkProtocol mProtocol = ERealSenseNetworkProtocol::UDP; ///< Property: 'Protocol' transport protocol
+        int mPort = 7000;                           ///< Property: 'Port' port to receive on
+        std::string mSerial = "network";            ///< Property: 'Serial' serial number of the software device
+        std::vector<ERealSenseStreamType> mStreams; ///< Property: 'Streams' streams that are expected before the software device is added
+    private:
+        /**
+         * Receive thread function
+         */
+        void receive();
+
+        /**
+         * Decodes a message and submits it to the software device
+         */
+        void onMessage(const std::vector<uint8>& message);
+
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseService& mService;
+        std::thread mReceiveThread;
+        std::atomic<bool> mRun = { false };
+        std::atomic<bool> mConnected = { false };
+
+        mutable std::mutex mStatisticsMutex;
+        Statistics mStatistics;
+    };
+
+    using RealSenseStreamReceiverObjectCreator = rtti::ObjectCreator<RealSenseStreamReceiver, RealSenseService>;
+}
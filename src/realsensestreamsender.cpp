@@ -0,0 +1,357 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensestreamsender.h"
+#include "realsensedevice.h"
+#include "realsenseservice.h"
+
+#include <rs.hpp>
+#include <nap/core.h>
+#include <nap/logger.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+RTTI_BEGIN_CLASS(nap::RealSenseStreamSender)
+    RTTI_PROPERTY("Protocol", &nap::RealSenseStreamSender::mProtocol, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Host", &nap::RealSenseStreamSender::mHost, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Port", &nap::RealSenseStreamSender::mPort, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Streams", &nap::RealSenseStreamSender::mStreams, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("CompressDepth", &nap::RealSenseStreamSender::mCompressDepth, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Bands", &nap::RealSenseStreamSender::mBands, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("PacketSize", &nap::RealSenseStreamSender::mPacketSize, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::RealSenseStreamSenderInstance)
+    RTTI_CONSTRUCTOR(nap::EntityInstance&, nap::Component&)
+RTTI_END_CLASS
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static functions
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Appends the bytes of a value
+     */
+    template<typename T>
+    static void append(std::vector<uint8>& buffer, const T& value)
+    {
+        const auto* bytes = reinterpret_cast<const uint8*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+
+    /**
+     * Encodes a frame into a network message
+     */
+    static void encodeMessage(const rs2::video_frame& frame, float depthScale, bool compressDepth, int bands, RealSenseWorkerPool* pool,
+                              RealSenseDepthFileFrame& encoded, std::vector<uint8>& message)
+    {
+        auto profile = frame.get_profile().as<rs2::video_stream_profile>();
+        auto intrinsics = profile.get_intrinsics();
+
+        RealSenseNetworkFrameHeader header;
+        header.mStreamType = profile.stream_type();
+        header.mFormat = profile.format();
+        header.mWidth = frame.get_width();
+        header.mHeight = frame.get_height();
+        header.mBytesPerPixel = frame.get_bytes_per_pixel();
+        header.mFps = profile.fps();
+        header.mFrameNumber = frame.get_frame_number();
+        header.mTimestamp = frame.get_timestamp();
+        header.mDepthScale = profile.stream_type() == RS2_STREAM_DEPTH ? depthScale : 0.0f;
+        header.mPPX = intrinsics.ppx;
+        header.mPPY = intrinsics.ppy;
+        header.mFX = intrinsics.fx;
+        header.mFY = intrinsics.fy;
+        header.mModel = intrinsics.model;
+        std::copy(std::begin(intrinsics.coeffs), std::end(intrinsics.coeffs), std::begin(header.mCoeffs));
+
+        // rows are sent packed
+        size_t row_size = static_cast<size_t>(header.mWidth) * header.mBytesPerPixel;
+        const auto* pixels = static_cast<const uint8*>(frame.get_data());
+        int stride = frame.get_stride_in_bytes();
+
+        message.clear();
+        if(compressDepth && profile.format() == RS2_FORMAT_Z16 && stride == static_cast<int>(row_size))
+        {
+            encoded.encode(reinterpret_cast<const uint16*>(pixels), header.mWidth, header.mHeight, bands, pool);
+            header.mCodec = ERealSenseNetworkCodec::RVL;
+            header.mBandCount = static_cast<uint32>(encoded.mBandSizes.size());
+            header.mPayloadSize = static_cast<uint32>(encoded.mData.size());
+            header.mSendTime = realsense::getNetworkTime();
+            append(message, header);
+            for(auto size : encoded.mBandSizes)
+                append(message, size);
+            message.insert(message.end(), encoded.mData.begin(), encoded.mData.end());
+            return;
+        }
+
+        header.mCodec = ERealSenseNetworkCodec::Raw;
+        header.mPayloadSize = static_cast<uint32>(row_size * header.mHeight);
+        header.mSendTime = realsense::getNetworkTime();
+        append(message, header);
+        if(stride == static_cast<int>(row_size))
+        {
+            message.insert(message.end(), pixels, pixels + header.mPayloadSize);
+            return;
+        }
+
+        for(int row = 0; row < header.mHeight; row++)
+            message.insert(message.end(), pixels + row * stride, pixels + row * stride + row_size);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseStreamWriter
+    //////////////////////////////////////////////////////////////////////////
+
+    bool RealSenseStreamWriter::connect(ERealSenseNetworkProtocol protocol, const std::string& host, int port, int packetSize, utility::ErrorState& errorState)
+    {
+        if(!errorState.check(packetSize > static_cast<int>(sizeof(RealSenseNetworkFragmentHeader)) && packetSize <= 65507,
+                             "packet size must be between %d and 65507", static_cast<int>(sizeof(RealSenseNetworkFragmentHeader)) + 1))
+            return false;
+
+        mProtocol = protocol;
+        mPacketSize = packetSize;
+        mSessionID = std::random_device()();
+        mMessageID = 0;
+        return mSocket.connect(protocol, host, port, errorState);
+    }
+
+
+    bool RealSenseStreamWriter::write(const rs2::video_frame& frame, float depthScale, bool compressDepth, int bands, RealSenseWorkerPool* pool)
+    {
+        encodeMessage(frame, depthScale, compressDepth, bands, pool, mEncoded, mMessage);
+        if(mProtocol == ERealSenseNetworkProtocol::TCP)
+        {
+            uint32 size = static_cast<uint32>(mMessage.size());
+            return mSocket.send(&size, sizeof(size)) && mSocket.send(mMessage.data(), mMessage.size());
+        }
+
+        // fragment, a lost datagram drops the frame on the receiver
+        RealSenseNetworkFragmentHeader header;
+        header.mSessionID = mSessionID;
+        header.mMessageID = mMessageID++;
+        header.mMessageSize = static_cast<uint32>(mMessage.size());
+        header.mFragmentSize = static_cast<uint32>(mPacketSize - sizeof(RealSenseNetworkFragmentHeader));
+        for(header.mOffset = 0; header.mOffset < header.mMessageSize; header.mOffset += header.mFragmentSize)
+        {
+            uint32 size = std::min(header.mFragmentSize, header.mMessageSize - header.mOffset);
+            mDatagram.resize(sizeof(header) + size);
+            std::memcpy(mDatagram.data(), &header, sizeof(header));
+            std::memcpy(mDatagram.data() + sizeof(header), mMessage.data() + header.mOffset, size);
+            if(!mSocket.send(mDatagram.data(), mDatagram.size()))
+                return false;
+        }
+        return true;
+    }
+
+
+    void RealSenseStreamWriter::close()
+    {
+        mSocket.close();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseStreamSender
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseStreamSender::RealSenseStreamSender() = default;
+
+
+    RealSenseStreamSender::~RealSenseStreamSender() = default;
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseStreamSenderInstance::Impl
+    //////////////////////////////////////////////////////////////////////////
+
+    struct RealSenseStreamSenderInstance::Impl
+    {
+    public:
+        // Latest unsent frame of every stream, guarded by mMutex
+        std::vector<rs2::frame> mPending;
+
+        // Only used by the sender thread
+        RealSenseStreamWriter mWriter;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseStreamSenderInstance
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseStreamSenderInstance::RealSenseStreamSenderInstance(EntityInstance& entity, Component& resource) :
+        RealSenseFrameSetListenerComponentInstance(entity, resource)
+    {}
+
+
+    RealSenseStreamSenderInstance::~RealSenseStreamSenderInstance()
+    {
+        stopThread();
+    }
+
+
+    bool RealSenseStreamSenderInstance::onInit(utility::ErrorState& errorState)
+    {
+        mImpl = std::make_unique<Impl>();
+        mResource = getComponent<RealSenseStreamSender>();
+        mPool = &getEntityInstance()->getCore()->getService<RealSenseService>()->getWorkerPool();
+
+        if(!errorState.check(!mResource->mStreams.empty(), "%s: no streams to send", mResource->mID.c_str()))
+            return false;
+
+        if(!errorState.check(mResource->mBands > 0, "%s: bands must be larger than 0", mResource->mID.c_str()))
+            return false;
+
+        if(!errorState.check(mResource->mPacketSize > static_cast<int>(sizeof(RealSenseNetworkFragmentHeader)) && mResource->mPacketSize <= 65507,
+                             "%s: packet size must be between %d and 65507", mResource->mID.c_str(), static_cast<int>(sizeof(RealSenseNetworkFragmentHeader)) + 1))
+            return false;
+
+        // UDP sockets are connected once, TCP connections are established by the sender thread
+        if(mResource->mProtocol == ERealSenseNetworkProtocol::UDP &&
+           !mImpl->mWriter.connect(mResource->mProtocol, mResource->mHost, mResource->mPort, mResource->mPacketSize, errorState))
+            return false;
+
+        mImpl->mPending.resize(mResource->mStreams.size());
+        frameSetReceived.connect([this](const rs2::frameset& frameset){ onTrigger(frameset); });
+
+        mStop = false;
+        mSendThread = std::thread([this]{ send(); });
+        return true;
+    }
+
+
+    void RealSenseStreamSenderInstance::destroy()
+    {
+        stopThread();
+    }
+
+
+    void RealSenseStreamSenderInstance::stopThread()
+    {
+        if(!mSendThread.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        mSendThread.join();
+    }
+
+
+    RealSenseStreamSenderInstance::Statistics RealSenseStreamSenderInstance::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mStatisticsMutex);
+        return mStatistics;
+    }
+
+
+    void RealSenseStreamSenderInstance::onTrigger(const rs2::frameset& frameset)
+    {
+        int replaced = 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for(size_t i = 0; i < mResource->mStreams.size(); i++)
+            {
+                auto frame = frameset.first_or_default(static_cast<rs2_stream>(mResource->mStreams[i]));
+                if(!frame || !frame.is<rs2::video_frame>())
+                    continue;
+
+                // frame level drop policy: an unsent frame is replaced by the newer frame
+                if(mImpl->mPending[i])
+                    replaced++;
+                mImpl->mPending[i] = frame;
+            }
+        }
+        mCondition.notify_all();
+
+        if(replaced > 0)
+        {
+            std::lock_guard<std::mutex> lock(mStatisticsMutex);
+            mStatistics.mDroppedFrames += replaced;
+        }
+    }
+
+
+    void RealSenseStreamSenderInstance::send()
+    {
+        auto& writer = mImpl->mWriter;
+        bool tcp = mResource->mProtocol == ERealSenseNetworkProtocol::TCP;
+        auto last_connect = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+        bool logged = false;
+        std::vector<rs2::frame> frames;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]
+                {
+                    return mStop || std::any_of(mImpl->mPending.begin(), mImpl->mPending.end(), [](const rs2::frame& f) { return static_cast<bool>(f); });
+                });
+                if(mStop)
+                    return;
+
+                frames.clear();
+                for(auto& pending : mImpl->mPending)
+                {
+                    if(pending)
+                        frames.emplace_back(std::move(pending));
+                    pending = rs2::frame();
+                }
+            }
+
+            // (re)connect at most once per second, frames are dropped while not connected
+            if(tcp && !writer.isConnected())
+            {
+                if(std::chrono::steady_clock::now() - last_connect < std::chrono::seconds(1))
+                {
+                    std::lock_guard<std::mutex> lock(mStatisticsMutex);
+                    mStatistics.mDroppedFrames += frames.size();
+                    continue;
+                }
+
+                last_connect = std::chrono::steady_clock::now();
+                utility::ErrorState error_state;
+                if(!writer.connect(mResource->mProtocol, mResource->mHost, mResource->mPort, mResource->mPacketSize, error_state))
+                {
+                    if(!logged)
+                        nap::Logger::warn("%s: %s", mResource->mID.c_str(), error_state.toString().c_str());
+                    logged = true;
+                    std::lock_guard<std::mutex> lock(mStatisticsMutex);
+                    mStatistics.mDroppedFrames += frames.size();
+                    continue;
+                }
+                nap::Logger::info("%s: connected to %s:%d", mResource->mID.c_str(), mResource->mHost.c_str(), mResource->mPort);
+                logged = false;
+            }
+
+            for(const auto& frame : frames)
+            {
+                auto video_frame = frame.as<rs2::video_frame>();
+                bool sent = writer.write(video_frame, mDevice->getDepthScale(), mResource->mCompressDepth, mResource->mBands, mPool);
+                if(!sent && tcp)
+                {
+                    nap::Logger::warn("%s: connection to %s:%d lost", mResource->mID.c_str(), mResource->mHost.c_str(), mResource->mPort);
+                    writer.close();
+                }
+
+                std::lock_guard<std::mutex> lock(mStatisticsMutex);
+                if(sent)
+                {
+                    mStatistics.mFrames++;
+                    mStatistics.mBytes += writer.getMessageSize();
+                    mStatistics.mRawBytes += video_frame.get_data_size();
+                }
+                else
+                {
+                    mStatistics.mDroppedFrames++;
+                }
+            }
+        }
+    }
+}
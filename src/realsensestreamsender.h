@@ -0,0 +1,200 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include "realsenseframesetlistenercomponent.h"
+#include "realsensedepthfile.h"
+#include "realsensenetwork.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// rs2 video frame forward declaration
+namespace rs2
+{
+    class video_frame;
+}
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    // forward declares
+    class RealSenseStreamSenderInstance;
+    class RealSenseWorkerPool;
+
+    /**
+     * RealSenseStreamWriter
+     * Encodes frames into network messages and sends them to a RealSenseStreamReceiver, used by the RealSenseStreamSender on its sender thread.
+     * TCP messages are length prefixed, UDP messages are fragmented into datagrams of at most 'packetSize' bytes.
+     * Not thread safe, write from one thread at a time.
+     */
+    class NAPAPI RealSenseStreamWriter final
+    {
+    public:
+        /**
+         * Connects to the receiver, every connection starts a new session so the receiver drops the messages of a previous connection
+         * @param protocol transport protocol
+         * @param host host name or address of the receiver
+         * @param port port of the receiver
+         * @param packetSize maximum UDP datagram size in bytes
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool connect(ERealSenseNetworkProtocol protocol, const std::string& host, int port, int packetSize, utility::ErrorState& errorState);
+
+        /**
+         * Encodes and sends a frame
+         * @param frame the frame
+         * @param depthScale meters per depth unit, sent with depth frames
+         * @param compressDepth compress Z16 depth with RVL
+         * @param bands amount of bands a depth frame is split in for parallel compression
+         * @param pool worker pool to compress the bands on, compresses on the calling thread when null
+         * @return false when sending failed, the TCP connection is lost and should be closed
+         */
+        bool write(const rs2::video_frame& frame, float depthScale, bool compressDepth, int bands, RealSenseWorkerPool* pool);
+
+        /**
+         * Closes the connection
+         */
+        void close();
+
+        /**
+         * @return if connected to a receiver
+         */
+        bool isConnected() const                    { return mSocket.isOpen(); }
+
+        /**
+         * @return size of the last written message in bytes, excluding protocol headers
+         */
+        size_t getMessageSize() const               { return mMessage.size(); }
+
+    private:
+        RealSenseSocket mSocket;
+        ERealSenseNetworkProtocol mProtocol = ERealSenseNetworkProtocol::UDP;
+        int mPacketSize = 1400;
+        RealSenseDepthFileFrame mEncoded;
+        std::vector<uint8> mMessage;
+        std::vector<uint8> mDatagram;
+        uint32 mSessionID = 0;
+        uint32 mMessageID = 0;
+    };
+
+
+    /**
+     * RealSenseStreamSender
+     * Streams the frames of selected streams, including intrinsics and depth scale, to a RealSenseStreamReceiver on another machine.
+     * Z16 depth is compressed with RVL on the worker pool of the RealSenseService when 'CompressDepth' is enabled, other streams are sent as is.
+     * Frames are sent from a separate thread, only the latest frame of every stream is kept: a frame that is not sent before the next one arrives is dropped.
+     * UDP frames are fragmented into datagrams of at most 'PacketSize' bytes, TCP frames are length prefixed and the connection is re-established when lost.
+     * Not supported on Windows, init fails.
+     */
+    class NAPAPI RealSenseStreamSender : public RealSenseFrameSetListenerComponent
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponent)
+    DECLARE_COMPONENT(RealSenseStreamSender, RealSenseStreamSenderInstance)
+    public:
+        /**
+         * Constructor
+         */
+        RealSenseStreamSender();
+
+        /**
+         * Destructor
+         */
+        virtual ~RealSenseStreamSender();
+
+        // Properties
+        ERealSenseNetworkProtocol mProtocol = ERealSenseNetworkProtocol::UDP; ///< Property: 'Protocol' transport protocol
+        std::string mHost = "127.0.0.1";            ///< Property: 'Host' host name or address of the receiver
+        int mPort = 7000;                           ///< Property: 'Port' port of the receiver
+        std::vector<ERealSenseStreamType> mStreams; ///< Property: 'Streams' the streams to send
+        bool mCompressDepth = true;                 ///< Property: 'CompressDepth' compress Z16 depth with RVL
+        int mBands = 4;                             ///< Property: 'Bands' amount of bands a depth frame is split in for parallel compression
+        int mPacketSize = 1400;                     ///< Property: 'PacketSize' maximum UDP datagram size in bytes, keep below the network MTU
+    };
+
+    /**
+     * RealSenseStreamSenderInstance sends the received frames to the receiver
+     */
+    class NAPAPI RealSenseStreamSenderInstance : public RealSenseFrameSetListenerComponentInstance
+    {
+    RTTI_ENABLE(RealSenseFrameSetListenerComponentInstance)
+    public:
+        /**
+         * Sender statistics
+         */
+        struct NAPAPI Statistics
+        {
+            uint64 mFrames = 0;             ///< Amount of frames sent
+            uint64 mDroppedFrames = 0;      ///< Amount of frames replaced by a newer frame before they were sent, or that failed to send
+            uint64 mBytes = 0;              ///< Amount of bytes sent, excluding protocol headers
+            uint64 mRawBytes = 0;           ///< Uncompressed size of the sent frames
+        };
+
+        /**
+         * Constructor
+         * @param entity reference to entity instance
+         * @param resource reference to component
+         */
+        RealSenseStreamSenderInstance(EntityInstance& entity, Component& resource);
+
+        /**
+         * Destructor, stops the sender thread
+         */
+        virtual ~RealSenseStreamSenderInstance();
+
+        /**
+         * @return copy of the sender statistics, can be called from any thread
+         */
+        Statistics getStatistics() const;
+
+    protected:
+        /**
+         * Internal init method
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        bool onInit(utility::ErrorState& errorState) override;
+
+        /**
+         * Stops the sender thread
+         */
+        void destroy() override;
+
+        /**
+         * Called upon receiving a new frameset, called from RealSense device
+         * @param frameset a new frameset
+         */
+        void onTrigger(const rs2::frameset& frameset);
+
+    private:
+        /**
+         * Sender thread function
+         */
+        void send();
+
+        /**
+         * Stops and joins the sender thread
+         */
+        void stopThread();
+
+        struct Impl;
+        std::unique_ptr<Impl> mImpl;
+
+        RealSenseStreamSender* mResource = nullptr;
+        RealSenseWorkerPool* mPool = nullptr;
+
+        std::thread mSendThread;
+        std::mutex mMutex;                          ///< Guards the pending frames and the stop flag
+        std::condition_variable mCondition;
+        bool mStop = false;
+
+        mutable std::mutex mStatisticsMutex;
+        Statistics mStatistics;
+    };
+}
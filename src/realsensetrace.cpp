@@ -0,0 +1,264 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsensetrace.h"
+#include "realsenseconversion.h"
+
+#include <utility/stringutils.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Static helpers
+    //////////////////////////////////////////////////////////////////////////
+
+    static constexpr int sNameLength = 48;
+
+    /**
+     * Event slot of a ring, guarded by a sequence number: odd while the owning thread writes the slot
+     */
+    struct TraceEvent
+    {
+        std::atomic<uint32> mSequence = { 0 };
+        int64 mStart = 0;                       ///< Nanoseconds since the trace epoch
+        int64 mDuration = 0;                    ///< Nanoseconds
+        const char* mCategory = nullptr;
+        char mName[sNameLength] = {};
+    };
+
+
+    /**
+     * Single producer ring of events of one thread
+     */
+    struct TraceRing
+    {
+        TraceRing(size_t capacity, int id) : mEvents(new TraceEvent[capacity]), mMask(capacity - 1), mID(id) { }
+
+        std::unique_ptr<TraceEvent[]> mEvents;
+        size_t mMask;
+        int mID;
+        std::string mName;                      ///< Guarded by the mutex of the trace state
+        bool mInUse = true;                     ///< If a thread owns the ring, guarded by the mutex of the trace state
+        std::atomic<uint64> mWrite = { 0 };     ///< Amount of events ever written
+        std::atomic<uint64> mCleared = { 0 };   ///< Events before this index are discarded
+    };
+
+
+    /**
+     * Rings of all threads that recorded an event. Rings are never removed so they can be exported after their thread exits,
+     * the ring of an exited thread is reused by the next thread that starts recording.
+     */
+    struct TraceState
+    {
+        std::atomic<bool> mEnabled = { false };
+        std::atomic<int> mBufferSize = { 16384 };
+        std::chrono::steady_clock::time_point mEpoch = std::chrono::steady_clock::now();
+        std::vector<std::unique_ptr<TraceRing>> mRings;
+        std::mutex mMutex;
+    };
+
+
+    static TraceState& getState()
+    {
+        static TraceState state;
+        return state;
+    }
+
+
+    /**
+     * Ring of the calling thread, returned to the trace state when the thread exits
+     */
+    struct TraceRingOwner
+    {
+        ~TraceRingOwner()
+        {
+            if(mRing == nullptr)
+                return;
+
+            std::lock_guard<std::mutex> lock(getState().mMutex);
+            mRing->mInUse = false;
+        }
+
+        TraceRing* mRing = nullptr;
+    };
+
+
+    static thread_local TraceRingOwner tRing;
+    static thread_local std::string tThreadName;
+
+
+    static TraceRing& getThreadRing()
+    {
+        if(tRing.mRing != nullptr)
+            return *tRing.mRing;
+
+        auto& state = getState();
+        std::lock_guard<std::mutex> lock(state.mMutex);
+
+        // a thread with the same name continues the timeline of the exited thread, for example the capture thread
+        // of a reconnected device. Otherwise any free ring is reused and its events are discarded.
+        TraceRing* free_ring = nullptr;
+        for(auto& ring : state.mRings)
+        {
+            if(ring->mInUse)
+                continue;
+
+            if(!tThreadName.empty() && ring->mName == tThreadName)
+            {
+                free_ring = ring.get();
+                break;
+            }
+
+            if(free_ring == nullptr)
+                free_ring = ring.get();
+        }
+
+        if(free_ring != nullptr)
+        {
+            if(free_ring->mName != tThreadName)
+                free_ring->mCleared.store(free_ring->mWrite.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        else
+        {
+            size_t capacity = 2;
+            while(capacity < static_cast<size_t>(std::max(state.mBufferSize.load(), 2)))
+                capacity <<= 1;
+
+            int id = static_cast<int>(state.mRings.size()) + 1;
+            state.mRings.emplace_back(std::make_unique<TraceRing>(capacity, id));
+            free_ring = state.mRings.back().get();
+        }
+
+        free_ring->mInUse = true;
+        free_ring->mName = tThreadName.empty() ? utility::stringFormat("Thread %d", free_ring->mID) : tThreadName;
+        tRing.mRing = free_ring;
+        return *free_ring;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseTrace
+    //////////////////////////////////////////////////////////////////////////
+
+    void RealSenseTrace::setEnabled(bool enabled)
+    {
+        getState().mEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+
+    bool RealSenseTrace::isEnabled()
+    {
+        return getState().mEnabled.load(std::memory_order_relaxed);
+    }
+
+
+    void RealSenseTrace::setBufferSize(int eventCount)
+    {
+        getState().mBufferSize.store(eventCount);
+    }
+
+
+    void RealSenseTrace::setThreadName(const std::string& name)
+    {
+        tThreadName = name;
+        if(tRing.mRing != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(getState().mMutex);
+            tRing.mRing->mName = name;
+        }
+    }
+
+
+    void RealSenseTrace::record(const char* name, const char* category, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+    {
+        auto& ring = getThreadRing();
+        uint64 index = ring.mWrite.load(std::memory_order_relaxed);
+        auto& event = ring.mEvents[index & ring.mMask];
+
+        uint32 sequence = event.mSequence.load(std::memory_order_relaxed);
+        event.mSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        event.mStart = std::chrono::duration_cast<std::chrono::nanoseconds>(start - getState().mEpoch).count();
+        event.mDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        event.mCategory = category;
+        std::strncpy(event.mName, name, sNameLength - 1);
+        event.mName[sNameLength - 1] = '\0';
+
+        event.mSequence.store(sequence + 2, std::memory_order_release);
+        ring.mWrite.store(index + 1, std::memory_order_release);
+    }
+
+
+    void RealSenseTrace::clear()
+    {
+        auto& state = getState();
+        std::lock_guard<std::mutex> lock(state.mMutex);
+        for(auto& ring : state.mRings)
+            ring->mCleared.store(ring->mWrite.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+
+    std::string RealSenseTrace::toJSON()
+    {
+        auto& state = getState();
+        std::lock_guard<std::mutex> lock(state.mMutex);
+
+        std::string json = "{\n\"displayTimeUnit\": \"ms\",\n\"traceEvents\": [\n";
+        bool first = true;
+        auto append = [&json, &first](const std::string& entry)
+        {
+            json += first ? "    " : ",\n    ";
+            json += entry;
+            first = false;
+        };
+
+        for(const auto& ring : state.mRings)
+        {
+            append(utility::stringFormat("{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": { \"name\": \"%s\" } }",
+                                         ring->mID, realsense::escapeJSON(ring->mName).c_str()));
+
+            uint64 write = ring->mWrite.load(std::memory_order_acquire);
+            uint64 capacity = ring->mMask + 1;
+            uint64 begin = std::max(write > capacity ? write - capacity : 0, ring->mCleared.load(std::memory_order_relaxed));
+            for(uint64 index = begin; index < write; index++)
+            {
+                // copy the slot and skip it when the owning thread wrote to it in the meantime
+                const auto& event = ring->mEvents[index & ring->mMask];
+                uint32 sequence = event.mSequence.load(std::memory_order_acquire);
+                int64 start = event.mStart;
+                int64 duration = event.mDuration;
+                const char* category = event.mCategory;
+                char name[sNameLength];
+                std::memcpy(name, event.mName, sNameLength);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if((sequence & 1) != 0 || event.mSequence.load(std::memory_order_relaxed) != sequence || category == nullptr)
+                    continue;
+
+                name[sNameLength - 1] = '\0';
+                append(utility::stringFormat("{ \"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d }",
+                                             realsense::escapeJSON(name).c_str(), category, start / 1000.0, duration / 1000.0, ring->mID));
+            }
+        }
+        json += "\n]\n}\n";
+        return json;
+    }
+
+
+    bool RealSenseTrace::write(const std::string& path, utility::ErrorState& errorState)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if(!errorState.check(file.is_open(), "Unable to open %s for writing", path.c_str()))
+            return false;
+
+        file << toJSON();
+        return true;
+    }
+}
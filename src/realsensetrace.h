@@ -0,0 +1,123 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <utility/errorstate.h>
+#include <chrono>
+#include <string>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseTrace
+     * Opt-in timeline of scoped events on the capture, worker, filter and main threads, exported as Chrome trace JSON.
+     * Open the exported file in chrome://tracing or ui.perfetto.dev to see how the threads interact over time.
+     * Every thread records into its own lock-free ring buffer, created when the thread records its first event.
+     * The ring of an exited thread is reused: a thread with the same name continues its timeline, otherwise the events are discarded.
+     * When a ring is full the oldest events are overwritten. Recording is disabled by default, a disabled scope costs a single atomic load.
+     * The trace is process wide because filters and components record events without access to the RealSenseService,
+     * the service enables it from its configuration and writes it on shutdown.
+     */
+    class NAPAPI RealSenseTrace final
+    {
+    public:
+        /**
+         * Starts or stops recording, can be called from any thread
+         * @param enabled if events are recorded
+         */
+        static void setEnabled(bool enabled);
+
+        /**
+         * @return if events are recorded, can be called from any thread
+         */
+        static bool isEnabled();
+
+        /**
+         * Sets the amount of events per thread, applies to threads that record their first event afterwards
+         * @param eventCount maximum amount of events per thread, rounded up to a power of two
+         */
+        static void setBufferSize(int eventCount);
+
+        /**
+         * Names the calling thread in the exported trace
+         * @param name name of the thread
+         */
+        static void setThreadName(const std::string& name);
+
+        /**
+         * Records a completed event on the calling thread, lock-free
+         * @param name name of the event, truncated to 47 characters
+         * @param category category of the event, must be a string literal
+         * @param start start of the event
+         * @param end end of the event
+         */
+        static void record(const char* name, const char* category, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+        /**
+         * Discards all recorded events, can be called from any thread
+         */
+        static void clear();
+
+        /**
+         * Serializes the recorded events of all threads into Chrome trace JSON, can be called while recording.
+         * Events that are overwritten while serializing are skipped.
+         * @return Chrome trace JSON object
+         */
+        static std::string toJSON();
+
+        /**
+         * Writes the recorded events of all threads to a Chrome trace JSON file
+         * @param path path to the file to write
+         * @param errorState contains any errors
+         * @return true on success
+         */
+        static bool write(const std::string& path, utility::ErrorState& errorState);
+    };
+
+    /**
+     * RealSenseTraceScope
+     * Records an event that spans the lifetime of the scope when tracing is enabled on construction.
+     * The name must stay valid for the lifetime of the scope.
+     */
+    class NAPAPI RealSenseTraceScope final
+    {
+    public:
+        /**
+         * Starts the event when tracing is enabled
+         * @param name name of the event
+         * @param category category of the event, must be a string literal
+         */
+        RealSenseTraceScope(const char* name, const char* category)
+        {
+            if(RealSenseTrace::isEnabled())
+            {
+                mName = name;
+                mCategory = category;
+                mStart = std::chrono::steady_clock::now();
+            }
+        }
+
+        /**
+         * Records the event
+         */
+        ~RealSenseTraceScope()
+        {
+            if(mName != nullptr)
+                RealSenseTrace::record(mName, mCategory, mStart, std::chrono::steady_clock::now());
+        }
+
+        RealSenseTraceScope(const RealSenseTraceScope&) = delete;
+        RealSenseTraceScope& operator=(const RealSenseTraceScope&) = delete;
+
+    private:
+        const char* mName = nullptr;
+        const char* mCategory = nullptr;
+        std::chrono::steady_clock::time_point mStart;
+    };
+}
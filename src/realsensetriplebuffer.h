@@ -0,0 +1,68 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <array>
+#include <atomic>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseTripleBuffer
+     * Lock-free hand-over of results from one producer thread to one consumer thread.
+     * The producer fills the write buffer and publishes it, the consumer picks up the latest published buffer with update.
+     * Neither side ever waits: a result that is not picked up before the next one is published is replaced.
+     * Buffers are reused, containers in T keep their capacity.
+     */
+    template<typename T>
+    class RealSenseTripleBuffer final
+    {
+    public:
+        /**
+         * @return buffer to fill, only call from the producer thread
+         */
+        T& getWriteBuffer()                         { return mBuffers[mWrite]; }
+
+        /**
+         * Publishes the write buffer, afterwards getWriteBuffer returns a different buffer. Only call from the producer thread.
+         */
+        void publish()
+        {
+            int previous = mShared.exchange(mWrite | sFresh, std::memory_order_acq_rel);
+            mWrite = previous & sIndexMask;
+        }
+
+        /**
+         * Picks up the latest published buffer, only call from the consumer thread
+         * @return true when a new buffer was published since the previous call
+         */
+        bool update()
+        {
+            if((mShared.load(std::memory_order_relaxed) & sFresh) == 0)
+                return false;
+
+            int previous = mShared.exchange(mRead, std::memory_order_acq_rel);
+            mRead = previous & sIndexMask;
+            return true;
+        }
+
+        /**
+         * @return the buffer picked up by the last call to update, only call from the consumer thread
+         */
+        const T& getReadBuffer() const              { return mBuffers[mRead]; }
+
+    private:
+        static constexpr int sFresh = 4;            ///< Set on the shared index when it holds a buffer the consumer did not pick up yet
+        static constexpr int sIndexMask = 3;
+
+        std::array<T, 3> mBuffers;
+        int mWrite = 0;                             ///< Owned by the producer
+        int mRead = 1;                              ///< Owned by the consumer
+        std::atomic<int> mShared = { 2 };           ///< Buffer in between, with the fresh flag
+    };
+}
@@ -76,4 +76,27 @@ namespace nap
         ERealSenseDistortionModels mModel;    /**< Distortion model of the image */
         float         mCoeffs[5]; /**< Distortion coefficients. Order for Brown-Conrady: [k1, k2, p1, p2, k3]. Order for F-Theta Fish-eye: [k1, k2, k3, k4, 0]. Other models are subject to their own interpretations */
     };
-}
\ No newline at end of file
+
+    struct NAPAPI RealSenseCameraExtrinsics
+    {
+        float         mRotation[9];    /**< Column-major 3x3 rotation matrix */
+        float         mTranslation[3]; /**< Three-element translation vector, in meters */
+    };
+
+    /**
+     * Metadata of a single frame, extracted once on the capture thread of a RealSenseDevice.
+     * Metadata the camera does not report is -1.
+     */
+    struct NAPAPI RealSenseFrameInfo
+    {
+        ERealSenseStreamType mStream = REALSENSE_STREAMTYPE_ANY; /**< Stream type of the frame */
+        int           mStreamIndex = 0;       /**< Index of the stream, distinguishes the infrared streams */
+        uint64        mFrameNumber = 0;       /**< Frame counter of the camera */
+        uint32        mDropped = 0;           /**< Amount of frames dropped before this frame, derived from gaps in the frame counter */
+        double        mTimestamp = 0.0;       /**< Timestamp of the frame in milliseconds */
+        int64         mHardwareTimestamp = -1; /**< Timestamp of the sensor in microseconds */
+        int64         mExposure = -1;         /**< Actual exposure in microseconds */
+        int64         mGain = -1;             /**< Gain level */
+        int64         mLaserPower = -1;       /**< Laser power of the projector */
+    };
+}
@@ -0,0 +1,129 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "realsenseworkerpool.h"
+#include "realsensetrace.h"
+
+#include <utility/stringutils.h>
+#include <algorithm>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+    // RealSenseWorkerPool
+    //////////////////////////////////////////////////////////////////////////
+
+    RealSenseWorkerPool::RealSenseWorkerPool(int threadCount)
+    {
+        if(threadCount <= 0)
+            threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
+        for(int i = 0; i < threadCount; i++)
+        {
+            mThreads.emplace_back([this, i]
+            {
+                RealSenseTrace::setThreadName(utility::stringFormat("RealSense Worker %d", i));
+                workerLoop();
+            });
+        }
+    }
+
+
+    RealSenseWorkerPool::~RealSenseWorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mJobAvailable.notify_all();
+
+        for(auto& thread : mThreads)
+            thread.join();
+    }
+
+
+    void RealSenseWorkerPool::parallelFor(int count, const std::function<void(int)>& task)
+    {
+        if(count <= 0)
+            return;
+
+        // nothing to distribute
+        if(count == 1 || mThreads.empty())
+        {
+            for(int i = 0; i < count; i++)
+                task(i);
+            return;
+        }
+
+        Job job;
+        job.mTask = &task;
+        job.mCount = count;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJobs.emplace_back(&job);
+        }
+        mJobAvailable.notify_all();
+
+        // participate
+        run(job);
+
+        // remove job from queue and wait for all workers to leave it
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto it = std::find(mJobs.begin(), mJobs.end(), &job);
+        if(it != mJobs.end())
+            mJobs.erase(it);
+        mJobFinished.wait(lock, [&job]{ return job.mActive == 0 && job.mDone.load() == job.mCount; });
+    }
+
+
+    void RealSenseWorkerPool::parallelFor(RealSenseWorkerPool* pool, int count, const std::function<void(int)>& task)
+    {
+        if(pool != nullptr)
+        {
+            pool->parallelFor(count, task);
+            return;
+        }
+
+        for(int i = 0; i < count; i++)
+            task(i);
+    }
+
+
+    void RealSenseWorkerPool::run(Job& job)
+    {
+        int index;
+        while((index = job.mNext.fetch_add(1)) < job.mCount)
+        {
+            (*job.mTask)(index);
+            job.mDone.fetch_add(1);
+        }
+    }
+
+
+    void RealSenseWorkerPool::workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while(true)
+        {
+            mJobAvailable.wait(lock, [this]{ return mStop || !mJobs.empty(); });
+            if(mStop)
+                return;
+
+            // all tasks of this job are claimed, remove it
+            Job* job = mJobs.front();
+            if(job->mNext.load() >= job->mCount)
+            {
+                mJobs.pop_front();
+                continue;
+            }
+
+            job->mActive++;
+            lock.unlock();
+            run(*job);
+            lock.lock();
+            if(--job->mActive == 0)
+                mJobFinished.notify_all();
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+
+namespace nap
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    /**
+     * RealSenseWorkerPool
+     * Pool of worker threads used by the RealSense filters and components to split per-frame work, for example by rows or tiles.
+     * parallelFor can be called from multiple capture threads at the same time, the calling thread always participates in the work.
+     * The pool is owned by the RealSenseService.
+     */
+    class NAPAPI RealSenseWorkerPool final
+    {
+    public:
+        /**
+         * Constructor, starts the worker threads
+         * @param threadCount amount of worker threads, 0 creates one thread less than the amount of hardware threads
+         */
+        RealSenseWorkerPool(int threadCount);
+
+        /**
+         * Destructor, stops and joins all worker threads
+         */
+        ~RealSenseWorkerPool();
+
+        /**
+         * Calls task for every index in [0, count) and blocks until all tasks completed.
+         * Tasks are distributed over the worker threads and the calling thread.
+         * @param count amount of tasks
+         * @param task the task to execute, receives the task index
+         */
+        void parallelFor(int count, const std::function<void(int)>& task);
+
+        /**
+         * Calls task for every index in [0, count) on the given pool, or on the calling thread when no pool is given.
+         * Used by the kernels that accept an optional pool.
+         * @param pool the pool to distribute the tasks over, may be null
+         * @param count amount of tasks
+         * @param task the task to execute, receives the task index
+         */
+        static void parallelFor(RealSenseWorkerPool* pool, int count, const std::function<void(int)>& task);
+
+        /**
+         * @return amount of worker threads, excluding the calling thread
+         */
+        int getThreadCount() const                      { return static_cast<int>(mThreads.size()); }
+
+    private:
+        struct Job
+        {
+            const std::function<void(int)>* mTask = nullptr;
+            int mCount = 0;
+            int mActive = 0;                            ///< Amount of worker threads working on this job, guarded by mMutex
+            std::atomic<int> mNext = { 0 };
+            std::atomic<int> mDone = { 0 };
+        };
+
+        void run(Job& job);
+        void workerLoop();
+
+        std::vector<std::thread> mThreads;
+        std::deque<Job*> mJobs;
+        std::mutex mMutex;
+        std::condition_variable mJobAvailable;
+        std::condition_variable mJobFinished;
+        bool mStop = false;
+    };
+}